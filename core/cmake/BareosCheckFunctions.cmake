@@ -1,6 +1,6 @@
 #   BAREOS® - Backup Archiving REcovery Open Sourced
 #
-#   Copyright (C) 2017-2023 Bareos GmbH & Co. KG
+#   Copyright (C) 2017-2024 Bareos GmbH & Co. KG
 #
 #   This program is Free Software; you can redistribute it and/or
 #   modify it under the terms of version three of the GNU Affero General Public
@@ -26,6 +26,7 @@ check_function_exists(fchown HAVE_FCHOWN)
 
 check_function_exists(add_proplist_entry HAVE_ADD_PROPLIST_ENTRY)
 check_function_exists(closefrom HAVE_CLOSEFROM)
+check_function_exists(copy_file_range HAVE_COPY_FILE_RANGE)
 check_function_exists(extattr_get_file HAVE_EXTATTR_GET_FILE)
 check_function_exists(extattr_get_link HAVE_EXTATTR_GET_LINK)
 check_function_exists(extattr_list_file HAVE_EXTATTR_LIST_FILE)
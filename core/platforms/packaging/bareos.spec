@@ -1376,6 +1376,7 @@ mkdir -p %{?buildroot}/%{_libdir}/bareos/plugins/vmware_plugin
 %dir %{script_dir}/ddl/grants
 %dir %{script_dir}/ddl/updates
 %{script_dir}/create_bareos_database
+%{script_dir}/create_bareos_file_search_indexes
 %{script_dir}/drop_bareos_database
 %{script_dir}/drop_bareos_tables
 %{script_dir}/grant_bareos_privileges
@@ -0,0 +1,156 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+
+/* Per file cost of the attribute encoding that runs for every file during
+ * backup, catalog insert, accurate and restore. */
+
+#include <benchmark/benchmark.h>
+#include "include/bareos.h"
+#include "include/filetypes.h"
+#include "include/streams.h"
+#include "lib/attr.h"
+#include "lib/attribs.h"
+#include "lib/base64.h"
+
+#include <random>
+#include <vector>
+
+namespace bm = benchmark;
+
+static constexpr int kFiles = 1024;
+
+static std::vector<struct stat> MakeStats()
+{
+  std::mt19937_64 gen(1);
+  std::vector<struct stat> stats(kFiles);
+  for (auto& statp : stats) {
+    statp = {};
+    statp.st_dev = 2051;
+    statp.st_ino = gen() & 0xFFFFFFFF;
+    statp.st_mode = 0100644;
+    statp.st_nlink = 1;
+    statp.st_uid = 1000;
+    statp.st_gid = 100;
+    statp.st_size = gen() & 0xFFFFFFFFF;
+    statp.st_blksize = 4096;
+    statp.st_blocks = statp.st_size / 512;
+    statp.st_atime = 1700000000 + (gen() & 0xFFFFFF);
+    statp.st_mtime = statp.st_atime;
+    statp.st_ctime = statp.st_atime;
+  }
+  return stats;
+}
+
+static std::vector<std::vector<char>> MakeLStats()
+{
+  std::vector<std::vector<char>> lstats;
+  for (auto& statp : MakeStats()) {
+    std::vector<char> buf(256);
+    EncodeStat(buf.data(), &statp, sizeof(statp), 0, STREAM_FILE_DATA);
+    lstats.push_back(std::move(buf));
+  }
+  return lstats;
+}
+
+static void BM_EncodeStat(bm::State& state)
+{
+  auto stats = MakeStats();
+  char buf[256];
+  for (auto _ : state) {
+    for (auto& statp : stats) {
+      EncodeStat(buf, &statp, sizeof(statp), 0, STREAM_FILE_DATA);
+      bm::DoNotOptimize(buf);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kFiles);
+}
+BENCHMARK(BM_EncodeStat);
+
+static void BM_DecodeStat(bm::State& state)
+{
+  auto lstats = MakeLStats();
+  struct stat statp;
+  int32_t LinkFI;
+  for (auto _ : state) {
+    for (auto& lstat : lstats) {
+      bm::DoNotOptimize(
+          DecodeStat(lstat.data(), &statp, sizeof(statp), &LinkFI));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kFiles);
+}
+BENCHMARK(BM_DecodeStat);
+
+// Digests are stored base64 encoded, argument is the digest size in bytes
+static void BM_BinToBase64(bm::State& state)
+{
+  std::mt19937 gen(2);
+  std::vector<char> digest(state.range(0));
+  for (auto& c : digest) { c = static_cast<char>(gen()); }
+  char buf[128];
+  for (auto _ : state) {
+    for (int i = 0; i < kFiles; i++) {
+      bm::DoNotOptimize(BinToBase64(buf, sizeof(buf), digest.data(),
+                                    digest.size(), false));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kFiles);
+}
+BENCHMARK(BM_BinToBase64)->Arg(16)->Arg(20)->Arg(32)->Arg(64);
+
+static void BM_Base64ToBin(bm::State& state)
+{
+  std::mt19937 gen(3);
+  std::vector<char> digest(state.range(0));
+  for (auto& c : digest) { c = static_cast<char>(gen()); }
+  char encoded[128], decoded[128];
+  int len = BinToBase64(encoded, sizeof(encoded), digest.data(),
+                        digest.size(), true);
+  for (auto _ : state) {
+    for (int i = 0; i < kFiles; i++) {
+      bm::DoNotOptimize(Base64ToBin(decoded, sizeof(decoded), encoded, len));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kFiles);
+}
+BENCHMARK(BM_Base64ToBin)->Arg(16)->Arg(20)->Arg(32)->Arg(64);
+
+static void BM_UnpackAttributesRecord(bm::State& state)
+{
+  std::vector<std::vector<char>> records;
+  for (auto& lstat : MakeLStats()) {
+    PoolMem rec(PM_MESSAGE);
+    int len = Mmsg(rec, "%d %d %s%c%s%c%c%c", (int)records.size() + 1,
+                   FT_REG, "/usr/share/doc/bareos/some/file.txt", 0,
+                   lstat.data(), 0, 0, 0);
+    records.emplace_back(rec.c_str(), rec.c_str() + len + 1);
+  }
+  Attributes* attr = new_attr(nullptr);
+  for (auto _ : state) {
+    for (auto& rec : records) {
+      bm::DoNotOptimize(UnpackAttributesRecord(
+          nullptr, STREAM_UNIX_ATTRIBUTES, rec.data(), rec.size(), attr));
+    }
+  }
+  FreeAttr(attr);
+  state.SetItemsProcessed(state.iterations() * kFiles);
+}
+BENCHMARK(BM_UnpackAttributesRecord);
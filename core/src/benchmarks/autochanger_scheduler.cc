@@ -0,0 +1,245 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+
+/* Simulates a tape library where every drive of the changer gets a new
+ * volume at the same time, like several jobs starting on the
+ * autochanger_test_device. AutoloadDevice() runs a fake changer command: the
+ * robot arm can only move one cartridge at a time, but the wait for the drive
+ * to become ready after the move happens in every drive on its own. */
+
+#include <benchmark/benchmark.h>
+#include "include/bareos.h"
+
+#define STORAGE_DAEMON 1
+#include "include/jcr.h"
+#include "lib/parse_conf.h"
+#include "stored/acquire.h"
+#include "stored/autochanger.h"
+#include "stored/device_control_record.h"
+#include "stored/job.h"
+#include "stored/sd_device_control_record.h"
+#include "stored/stored.h"
+#include "stored/stored_globals.h"
+#include "stored/stored_jcr_impl.h"
+#include "stored/vol_mgr.h"
+#include "stored/wait.h"
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace bm = benchmark;
+using namespace storagedaemon;
+
+namespace storagedaemon {
+extern bool ParseSdConfig(const char* configfile, int exit_code);
+}  // namespace storagedaemon
+
+static constexpr int kDrives = 4;
+static constexpr int kSlots = 5 * kDrives;
+static constexpr const char* kRobotMove = "0.01";
+static constexpr const char* kDriveReady = "0.04";
+static std::atomic<int64_t> failed_loads{0};
+
+namespace fs = std::filesystem;
+
+// Removes the generated configuration when the benchmark exits
+static struct TestData {
+  fs::path dir;
+  ~TestData()
+  {
+    if (!dir.empty()) { fs::remove_all(dir); }
+  }
+} test_data;
+
+/* Called as "<script> <changer> <command> <slot> <archive device> <drive>".
+ * Every drive keeps its loaded slot in a file of its own. */
+static void WriteChangerScript(const fs::path& dir)
+{
+  fs::path script = dir / "fake-changer";
+  std::ofstream(script)
+      << "#!/bin/sh\n"
+      << "dir=" << dir.string() << "\n"
+      << "cmd=\"$2\"; slot=\"$3\"\n"
+      << "state=\"$4.slot\"\n"
+      << "move() { flock \"$dir/robot-arm\" sleep " << kRobotMove << "; }\n"
+      << "case \"$cmd\" in\n"
+      << "  slots) echo " << kSlots << " ;;\n"
+      << "  loaded) cat \"$state\" 2>/dev/null || echo 0 ;;\n"
+      << "  load) move; echo \"$slot\" >\"$state\"; sleep " << kDriveReady
+      << " ;;\n"
+      << "  unload) sleep " << kDriveReady << "; move; echo 0 >\"$state\" ;;\n"
+      << "  listall)\n"
+      << "    for f in \"$(dirname \"$4\")\"/drive*.slot; do\n"
+      << "      [ -f \"$f\" ] || continue\n"
+      << "      d=$(basename \"$f\" .slot); s=$(cat \"$f\")\n"
+      << "      [ \"$s\" = 0 ] && echo \"D:${d#drive}:E\" \\\n"
+      << "        || echo \"D:${d#drive}:F:$s:vol$s\"\n"
+      << "    done ;;\n"
+      << "esac\n";
+  fs::permissions(script, fs::perms::owner_all);
+}
+
+// One changer per value of Maximum Concurrent Operations
+static std::string Changer(int max_operations)
+{
+  return "changer" + std::to_string(max_operations);
+}
+
+static std::string CreateConfiguration()
+{
+  fs::path dir = fs::temp_directory_path()
+                 / ("bareos-autochanger-" + std::to_string(getpid()));
+  test_data.dir = dir;
+  fs::create_directories(dir / "bareos-sd.d" / "storage");
+  fs::create_directories(dir / "bareos-sd.d" / "device");
+  fs::create_directories(dir / "bareos-sd.d" / "autochanger");
+  WriteChangerScript(dir);
+
+  std::ofstream(dir / "bareos-sd.d" / "storage" / "bench.conf")
+      << "Storage {\n  Name = bench-sd\n"
+#if defined(HAVE_DYNAMIC_SD_BACKENDS)
+      << "  Backend Directory = " BACKEND_DIRECTORY "\n"
+#endif
+      << "}\n";
+
+  std::ofstream devices(dir / "bareos-sd.d" / "device" / "devices.conf");
+  std::ofstream changers(dir / "bareos-sd.d" / "autochanger"
+                         / "changers.conf");
+  for (int max_operations : {1, 2, kDrives}) {
+    std::string changer = Changer(max_operations);
+    fs::create_directories(dir / changer);
+    changers << "Autochanger {\n  Name = " << changer << "\n"
+             << "  Changer Device = /dev/null\n"
+             << "  Changer Command = \"" << (dir / "fake-changer").string()
+             << " %c %o %S %a %d\"\n"
+             << "  Maximum Concurrent Operations = " << max_operations << "\n";
+    for (int i = 0; i < kDrives; i++) {
+      std::string name = changer + "-drive" + std::to_string(i);
+      fs::path archive = dir / changer / ("drive" + std::to_string(i));
+      fs::create_directories(archive);
+      devices << "Device {\n  Name = " << name << "\n"
+              << "  Media Type = Tape\n"
+              << "  Device Type = autochanger_test\n"
+              << "  Archive Device = " << archive.string() << "\n"
+              << "  Random Access = yes\n  Automatic Mount = no\n"
+              << "  Removable Media = no\n  Always Open = no\n"
+              << "  Autochanger = yes\n  Drive Index = " << i << "\n"
+              // Wait for the changer command without polling every second
+              << "  Maximum Changer Wait = 0\n"
+              << "}\n";
+      changers << "  Device = " << name << "\n";
+    }
+    changers << "}\n";
+  }
+
+  return dir.string() + "/";
+}
+
+static bool InitStorageDaemon()
+{
+  static std::string config_dir = CreateConfiguration();
+
+  OSDependentInit();
+  configfile = strdup(config_dir.c_str());
+  my_config = InitSdConfig(configfile, M_CONFIG_ERROR);
+  ParseSdConfig(configfile, M_CONFIG_ERROR);
+  InitReservationsLock();
+  CreateVolumeLists();
+  InitAutochangers();
+
+  return true;
+}
+
+// A job that has one drive of the changer reserved for the whole benchmark
+struct DriveJob {
+  JobControlRecord* jcr{};
+  DeviceControlRecord* dcr{};
+};
+
+static std::vector<DriveJob> SetupDriveJobs(const std::string& changer)
+{
+  std::vector<DriveJob> jobs;
+
+  for (int i = 0; i < kDrives; i++) {
+    std::string name = changer + "-drive" + std::to_string(i);
+    DeviceResource* device_resource
+        = (DeviceResource*)my_config->GetResWithName(R_DEVICE, name.c_str());
+    DriveJob job;
+
+    job.jcr = NewStoredJcr();
+    job.jcr->JobId = i + 1;
+    job.dcr = new StorageDaemonDeviceControlRecord;
+    SetupNewDcrDevice(job.jcr, job.dcr,
+                      FactoryCreateDevice(job.jcr, device_resource), nullptr);
+    jobs.push_back(job);
+  }
+
+  return jobs;
+}
+
+static void LoadVolume(DeviceControlRecord* dcr, slot_number_t slot)
+{
+  dcr->VolCatInfo.InChanger = true;
+  dcr->VolCatInfo.Slot = slot;
+  bstrncpy(dcr->VolumeName, ("vol" + std::to_string(slot)).c_str(),
+           sizeof(dcr->VolumeName));
+
+  if (AutoloadDevice(dcr, false, nullptr) != 1) { failed_loads++; }
+}
+
+/* Every drive loads a slot no drive held before, so no drive has to give up
+ * a cartridge for another one. */
+static void BM_LoadAllDrives(bm::State& state)
+{
+  [[maybe_unused]] static bool initialized = InitStorageDaemon();
+  std::vector<DriveJob> jobs = SetupDriveJobs(Changer(state.range(0)));
+  int round = 0;
+
+  for (auto _ : state) {
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kDrives; i++) {
+      slot_number_t slot = 1 + (round * kDrives + i) % kSlots;
+      threads.emplace_back(LoadVolume, jobs[i].dcr, slot);
+    }
+    for (auto& thread : threads) { thread.join(); }
+    round++;
+  }
+  state.counters["loads/s"]
+      = bm::Counter(state.iterations() * kDrives, bm::Counter::kIsRate);
+  state.counters["failed"] = failed_loads.exchange(0);
+
+  for (auto& job : jobs) {
+    Device* dev = job.dcr->dev;
+    FreeDeviceControlRecord(job.dcr);
+    delete dev;
+    FreeJcr(job.jcr);
+  }
+}
+BENCHMARK(BM_LoadAllDrives)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(kDrives)
+    ->Unit(bm::kMillisecond)
+    ->UseRealTime();
@@ -0,0 +1,436 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+
+/* Throughput of the backup data path: a file daemon job runs
+ * BlastDataToStorageDaemon() on a synthetic file tree and sends its streams
+ * over a loopback connection to a storage daemon stage, which reads them like
+ * the append loop does, puts the records into blocks and writes those to a
+ * device that discards them. The Director and the catalog are left out, so
+ * only reading, digests, compression, encryption, the network protocol and
+ * the record packing are measured.
+ *
+ * Arguments are compression (0 none, 1 gzip, 2 lz4), digest (0 none,
+ * 1 SHA256, 2 XXH128), sparse and encryption. Besides bytes and files per
+ * second the CPU time used by each of the two daemons is reported. */
+
+#include <benchmark/benchmark.h>
+#include "include/bareos.h"
+#include "include/jcr.h"
+#include "include/streams.h"
+#include "filed/filed.h"
+#include "filed/filed_globals.h"
+#include "filed/backup.h"
+#include "filed/dir_cmd.h"
+#include "filed/filed_jcr_impl.h"
+#include "filed/filed_utils.h"
+#include "filed/fileset.h"
+#include "lib/bget_msg.h"
+#include "lib/bnet.h"
+#include "lib/bsock_tcp.h"
+#include "lib/parse_conf.h"
+#include "stored/block.h"
+#include "stored/crc32/crc32.h"
+#include "stored/dev.h"
+#include "stored/device_control_record.h"
+#include "stored/record.h"
+#include "tools/dummysockets.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <time.h>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+
+namespace bm = benchmark;
+namespace fs = std::filesystem;
+using namespace filedaemon;
+
+static constexpr int kTextFiles = 256;
+static constexpr int kRandomFiles = 16;
+static constexpr int kLargeTextFiles = 4;
+static constexpr uint64_t kSparseFileSize = 64 * 1024 * 1024;
+
+static double CpuSeconds(clockid_t clock)
+{
+  struct timespec ts;
+  clock_gettime(clock, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Incompressible data, the same byte stream tools/gentestdata prints
+static void WriteRandom(std::ofstream& out,
+                        uint64_t size,
+                        std::mt19937_64& generator)
+{
+  using val_type = decltype(generator());
+  char buf[sizeof(val_type)];
+  for (uint64_t written = 0; written < size; written += sizeof(val_type)) {
+    auto value = generator();
+    memcpy(buf, &value, sizeof(val_type));
+    out.write(buf, std::min<uint64_t>(sizeof(val_type), size - written));
+  }
+}
+
+// Text that compresses about as well as source code or logs
+static void WriteText(std::ofstream& out,
+                      uint64_t size,
+                      std::mt19937_64& generator)
+{
+  static const char* words[]
+      = {"backup", "restore", "volume", "the",    "of",    "job",
+         "client", "storage", "file",   "daemon", "error", "2024-01-01",
+         "{",      "}",       "return", "int",    "=",     "bareos"};
+  std::string text;
+  while (text.size() < size) {
+    text += words[generator() % (sizeof(words) / sizeof(char*))];
+    text += generator() % 12 ? ' ' : '\n';
+  }
+  out.write(text.data(), size);
+}
+
+static void CreateTree(const fs::path& dir)
+{
+  std::mt19937_64 generator{};
+  fs::create_directories(dir / "text");
+  fs::create_directories(dir / "random");
+  for (int i = 0; i < kTextFiles; i++) {
+    std::ofstream out(dir / "text" / (std::to_string(i) + ".txt"));
+    WriteText(out, 4096 + generator() % (60 * 1024), generator);
+  }
+  for (int i = 0; i < kLargeTextFiles; i++) {
+    std::ofstream out(dir / "text" / ("large" + std::to_string(i) + ".log"));
+    WriteText(out, 4 * 1024 * 1024, generator);
+  }
+  for (int i = 0; i < kRandomFiles; i++) {
+    std::ofstream out(dir / "random" / (std::to_string(i) + ".bin"));
+    WriteRandom(out, 1024 * 1024, generator);
+  }
+
+  // A disk image with 2 MiB of data every 16 MiB and holes in between
+  fs::path image = dir / "disk.img";
+  {
+    std::ofstream out(image);
+    for (uint64_t offset = 0; offset < kSparseFileSize;
+         offset += 16 * 1024 * 1024) {
+      out.seekp(offset);
+      WriteRandom(out, 2 * 1024 * 1024, generator);
+    }
+  }
+  fs::resize_file(image, kSparseFileSize);
+}
+
+static fs::path BenchmarkDirectory()
+{
+  return fs::temp_directory_path()
+         / ("bareos-backup-data-path-" + std::to_string(getpid()));
+}
+
+static bool have_pki_keypair = false;
+
+static std::string CreateConfiguration(const fs::path& dir)
+{
+  fs::path config = dir / "bareos-fd.conf";
+  have_pki_keypair = fs::exists(PKI_KEYPAIR);
+
+  std::ofstream out(config);
+  out << "Client {\n  Name = bench-fd\n"
+      << "  Working Directory = " << dir.string() << "\n"
+      << "  Maximum Network Buffer Size = 65536\n";
+  if (have_pki_keypair) {
+    out << "  PKI Signatures = yes\n  PKI Encryption = yes\n"
+        << "  PKI Key Pair = " PKI_KEYPAIR "\n";
+  }
+  out << "}\n"
+      << "Director {\n  Name = bench-dir\n  Password = bench\n}\n"
+      << "Messages {\n  Name = Standard\n}\n";
+
+  return config.string();
+}
+
+// Removes the generated tree when the benchmark exits
+static struct TestData {
+  fs::path dir;
+  ~TestData()
+  {
+    if (!dir.empty()) { fs::remove_all(dir); }
+  }
+} test_data;
+
+static bool InitFileDaemon()
+{
+  test_data.dir = BenchmarkDirectory();
+  CreateTree(test_data.dir / "data");
+  std::string config = CreateConfiguration(test_data.dir);
+
+  OSDependentInit();
+  my_config = InitFdConfig(config.c_str(), M_CONFIG_ERROR);
+  my_config->ParseConfigOrExit();
+  return CheckResources();
+}
+
+// The device the storage daemon stage writes its blocks to
+class NullDevice : public storagedaemon::Device {
+ public:
+  NullDevice() { max_block_size = DEFAULT_BLOCK_SIZE; }
+  ~NullDevice() override = default;
+
+  storagedaemon::SeekMode GetSeekMode() const override
+  {
+    return storagedaemon::SeekMode::BYTES;
+  }
+  int d_ioctl(int, ioctl_req_t, char*) override { return -1; }
+  int d_open(const char*, int, int) override { return 0; }
+  int d_close(int) override { return 0; }
+  ssize_t d_read(int, void*, size_t) override { return 0; }
+  ssize_t d_write(int, const void*, size_t count) override { return count; }
+  boffset_t d_lseek(storagedaemon::DeviceControlRecord*,
+                    boffset_t,
+                    int) override
+  {
+    return 0;
+  }
+  bool d_truncate(storagedaemon::DeviceControlRecord*) override
+  {
+    return true;
+  }
+};
+
+struct StorageStage {
+  bool ok{false};
+  uint64_t records{};
+  uint64_t bytes{};
+  uint64_t blocks{};
+  double cpu{};
+};
+
+static void WriteBlock(storagedaemon::DeviceBlock* block,
+                       NullDevice& dev,
+                       StorageStage& stage)
+{
+  block->BlockNumber++;
+  bm::DoNotOptimize(crc32_fast((uint8_t*)block->buf + BLKHDR_CS_LENGTH,
+                               block->binbuf - BLKHDR_CS_LENGTH));
+  dev.d_write(-1, block->buf, block->binbuf);
+  storagedaemon::EmptyBlock(block);
+  stage.blocks++;
+}
+
+/* Reads the streams of one job like DoAppendData() does: a header with the
+ * file index and the stream, the data messages of the stream and an end of
+ * data signal, until an end of data signal comes instead of a header. */
+static void ReceiveAppendData(BareosSocket* fd, StorageStage* stage)
+{
+  using namespace storagedaemon;
+
+  NullDevice dev;
+  DeviceControlRecord dcr;
+  dcr.dev = &dev;
+  dcr.block = new_block(&dev);
+  DeviceRecord* rec = new_record(false);
+
+  for (;;) {
+    if (BgetMsg(fd) < 0) {
+      stage->ok = fd->message_length == BNET_EOD;
+      break;
+    }
+    int32_t file_index, stream;
+    if (sscanf(fd->msg, "%d %d", &file_index, &stream) != 2) { break; }
+
+    int32_t n;
+    while ((n = BgetMsg(fd)) >= 0) {
+      rec->FileIndex = file_index;
+      rec->Stream = stream;
+      rec->maskedStream = stream & STREAMMASK_TYPE;
+      rec->data_len = n;
+      rec->data = fd->msg;
+      while (!WriteRecordToBlock(&dcr, rec)) {
+        WriteBlock(dcr.block, dev, *stage);
+      }
+      stage->records++;
+      stage->bytes += n;
+    }
+    if (n != BNET_SIGNAL || fd->message_length != BNET_EOD) { break; }
+  }
+  if (dcr.block->binbuf > WRITE_BLKHDR_LENGTH) {
+    WriteBlock(dcr.block, dev, *stage);
+  }
+
+  FreeRecord(rec);
+  FreeBlock(dcr.block);
+  dcr.block = nullptr;
+  stage->cpu = CpuSeconds(CLOCK_THREAD_CPUTIME_ID);
+}
+
+static BareosSocket* WrapSocket(int sockfd, const char* who, int port)
+{
+  BareosSocket* bs = new BareosSocketTCP;
+  bs->fd_ = sockfd;
+  bs->SetWho(strdup(who));
+  bs->SetHost(strdup("127.0.0.1"));
+  bs->SetPort(port);
+  return bs;
+}
+
+// Connects the file daemon to the storage daemon stage over 127.0.0.1
+static bool ConnectLoopback(BareosSocket** fd_side, BareosSocket** sd_side)
+{
+  int listener = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(addr);
+  if (listener < 0 || bind(listener, (struct sockaddr*)&addr, len) != 0
+      || listen(listener, 1) != 0
+      || getsockname(listener, (struct sockaddr*)&addr, &len) != 0) {
+    if (listener >= 0) { close(listener); }
+    return false;
+  }
+
+  int client = socket(AF_INET, SOCK_STREAM, 0);
+  if (client < 0 || connect(client, (struct sockaddr*)&addr, len) != 0) {
+    if (client >= 0) { close(client); }
+    close(listener);
+    return false;
+  }
+  int server = accept(listener, nullptr, nullptr);
+  close(listener);
+  if (server < 0) {
+    close(client);
+    return false;
+  }
+
+  int port = ntohs(addr.sin_port);
+  *fd_side = WrapSocket(client, "Storage daemon", port);
+  *sd_side = WrapSocket(server, "File daemon", port);
+  return true;
+}
+
+static std::string FilesetOptions(const bm::State& state)
+{
+  static const char* compression[] = {"", "Z6", "Zf4"};
+  static const char* digest[] = {"", "S2", "S4"};
+  std::string options = "O ";
+  options += compression[state.range(0)];
+  options += digest[state.range(1)];
+  if (state.range(2)) { options += 's'; }
+  return options;
+}
+
+static void BM_BackupDataPath(bm::State& state)
+{
+  static bool initialized = InitFileDaemon();
+  if (!initialized) {
+    state.SkipWithError("could not set up the file daemon");
+    return;
+  }
+  bool encrypt = state.range(3);
+  if (encrypt && !have_pki_keypair) {
+    state.SkipWithError("no PKI key pair for encryption found");
+    return;
+  }
+
+  std::string data_dir = "F " + (test_data.dir / "data").string();
+  std::string options = FilesetOptions(state);
+  uint64_t read_bytes = 0, files = 0, sent_bytes = 0;
+  double fd_cpu = 0, sd_cpu = 0;
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    BareosSocket *fd_side, *sd_side;
+    if (!ConnectLoopback(&fd_side, &sd_side)) {
+      state.SkipWithError("could not connect over the loopback interface");
+      break;
+    }
+
+    JobControlRecord* jcr = create_new_director_session(new EmptySocket);
+    jcr->JobId = 1;
+    jcr->store_bsock = fd_side;
+    fd_side->SetJcr(jcr);
+    jcr->fd_impl->crypto.pki_sign = encrypt;
+    jcr->fd_impl->crypto.pki_encrypt = encrypt;
+
+    InitFileset(jcr);
+    for (const char* item : {"I", options.c_str(), "N", data_dir.c_str(), "N"}) {
+      AddFileset(jcr, item);
+    }
+    TermFileset(jcr);
+    crypto_cipher_t cipher = CRYPTO_CIPHER_NONE;
+    GetWantedCryptoCipher(jcr, &cipher);
+    state.ResumeTiming();
+
+    double process_cpu = CpuSeconds(CLOCK_PROCESS_CPUTIME_ID);
+    StorageStage stage;
+    std::thread storage_daemon(ReceiveAppendData, sd_side, &stage);
+    bool ok = BlastDataToStorageDaemon(jcr, cipher);
+    storage_daemon.join();
+    double used_cpu = CpuSeconds(CLOCK_PROCESS_CPUTIME_ID) - process_cpu;
+
+    state.PauseTiming();
+    if (!ok || !stage.ok) {
+      state.SkipWithError("backup failed");
+    }
+    read_bytes += jcr->ReadBytes;
+    files += jcr->JobFiles;
+    sent_bytes += stage.bytes;
+    fd_cpu += used_cpu - stage.cpu;
+    sd_cpu += stage.cpu;
+
+    CleanupFileset(jcr);
+    FreeJcr(jcr);
+    sd_side->close();
+    delete sd_side;
+    state.ResumeTiming();
+    if (!ok || !stage.ok) { break; }
+  }
+
+  state.SetBytesProcessed(read_bytes);
+  state.SetItemsProcessed(files);
+  state.counters["fd_cpu"] = bm::Counter(fd_cpu, bm::Counter::kAvgIterations);
+  state.counters["sd_cpu"] = bm::Counter(sd_cpu, bm::Counter::kAvgIterations);
+  if (read_bytes) {
+    state.counters["sent/read"] = static_cast<double>(sent_bytes) / read_bytes;
+  }
+}
+
+static void DataPathArguments(bm::internal::Benchmark* benchmark)
+{
+  benchmark->ArgNames({"compression", "digest", "sparse", "encryption"});
+  for (int compression = 0; compression < 3; compression++) {
+    for (int digest = 0; digest < 3; digest++) {
+      for (int sparse = 0; sparse < 2; sparse++) {
+        for (int encryption = 0; encryption < 2; encryption++) {
+          benchmark->Args({compression, digest, sparse, encryption});
+        }
+      }
+    }
+  }
+}
+BENCHMARK(BM_BackupDataPath)
+    ->Apply(DataPathArguments)
+    ->Unit(bm::kMillisecond)
+    ->UseRealTime();
@@ -0,0 +1,146 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+
+/* Per file cost of the regex = options of a fileset, as evaluated by the
+ * FD for every file it looks at, with regexec() on every pattern in turn
+ * and with a RegexSet. */
+
+#include <benchmark/benchmark.h>
+#include "include/bareos.h"
+#include "lib/regex_set.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace bm = benchmark;
+
+static constexpr int kFiles = 1024;
+
+// Typical exclude patterns of filesets found in the wild
+static const std::vector<const char*> fileset_patterns{
+    "\\.(mp3|avi|mkv|mp4|iso)$",
+    "^/home/[^/]+/\\.cache/",
+    "/\\.snapshot(/|$)",
+    "\\.(tmp|temp|bak|swp|old)$",
+    "~$",
+    "/(Temp|Temporary Internet Files|Cache|Caches)/",
+    "^/home/[^/]+/Downloads/",
+    "/node_modules/",
+    "/\\.git/objects/",
+    "\\.o$",
+    "^/(proc|sys|dev|run)/",
+    "/lost\\+found$",
+};
+
+static std::vector<std::string> MakePaths()
+{
+  static const char* dirs[]
+      = {"/home/alice",  "/home/bob/.cache/thumbnails", "/srv/www/htdocs",
+         "/usr/share/doc", "/var/lib/postgresql/data",   "/home/bob/src",
+         "/data/.snapshot/hourly.0", "/home/alice/Downloads"};
+  static const char* names[]
+      = {"report.pdf", "index.html", "song.mp3",  "main.o",   "notes.txt",
+         "notes.txt~", "core.c",     "backup.bak", "README",  "photo.jpg"};
+  std::mt19937 gen(1);
+  std::vector<std::string> paths;
+  for (int i = 0; i < kFiles; i++) {
+    std::string path = dirs[gen() % (sizeof(dirs) / sizeof(char*))];
+    for (int depth = gen() % 4; depth > 0; depth--) {
+      path += "/subdir" + std::to_string(gen() % 100);
+    }
+    path += '/';
+    path += names[gen() % (sizeof(names) / sizeof(char*))];
+    paths.push_back(path);
+  }
+  return paths;
+}
+
+// Argument is the number of patterns used
+static void BM_Regexec(bm::State& state)
+{
+  auto paths = MakePaths();
+  std::vector<regex_t> pregs(state.range(0));
+  for (size_t i = 0; i < pregs.size(); i++) {
+    regcomp(&pregs[i], fileset_patterns[i], REG_EXTENDED);
+  }
+  for (auto _ : state) {
+    for (auto& path : paths) {
+      bool match = false;
+      for (auto& preg : pregs) {
+        if (regexec(&preg, path.c_str(), 0, nullptr, 0) == 0) {
+          match = true;
+          break;
+        }
+      }
+      bm::DoNotOptimize(match);
+    }
+  }
+  for (auto& preg : pregs) { regfree(&preg); }
+  state.SetItemsProcessed(state.iterations() * kFiles);
+}
+BENCHMARK(BM_Regexec)->Arg(1)->Arg(4)->Arg(12);
+
+static void BM_RegexSet(bm::State& state)
+{
+  auto paths = MakePaths();
+  RegexSet set;
+  std::string errmsg;
+  for (int i = 0; i < state.range(0); i++) {
+    set.Add(fileset_patterns[i], REG_EXTENDED, errmsg);
+  }
+  for (auto _ : state) {
+    for (auto& path : paths) { bm::DoNotOptimize(set.Search(path.c_str())); }
+  }
+  state.SetItemsProcessed(state.iterations() * kFiles);
+}
+BENCHMARK(BM_RegexSet)->Arg(1)->Arg(4)->Arg(12);
+
+/* A pattern that backtracking matchers need exponential time for, argument
+ * is the length of the subject. */
+static const char* pathological_pattern = "^(a|aa)+$";
+
+static std::string PathologicalSubject(int length)
+{
+  return std::string(length, 'a') + '!';
+}
+
+static void BM_RegexecPathological(bm::State& state)
+{
+  std::string subject = PathologicalSubject(state.range(0));
+  regex_t preg;
+  regcomp(&preg, pathological_pattern, REG_EXTENDED);
+  for (auto _ : state) {
+    bm::DoNotOptimize(regexec(&preg, subject.c_str(), 0, nullptr, 0));
+  }
+  regfree(&preg);
+}
+BENCHMARK(BM_RegexecPathological)->Arg(16)->Arg(24)->Arg(28);
+
+static void BM_RegexSetPathological(bm::State& state)
+{
+  std::string subject = PathologicalSubject(state.range(0));
+  RegexSet set;
+  std::string errmsg;
+  set.Add(pathological_pattern, REG_EXTENDED, errmsg);
+  for (auto _ : state) { bm::DoNotOptimize(set.Search(subject.c_str())); }
+}
+BENCHMARK(BM_RegexSetPathological)->Arg(16)->Arg(24)->Arg(28)->Arg(4096);
@@ -0,0 +1,273 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+
+/* Simulates the start of a backup window: many jobs send their use device
+ * commands to a storage daemon with a lot of file devices at the same time.
+ * The Director side is a scripted socket, so only the reservation code of the
+ * storage daemon is measured. */
+
+#include <benchmark/benchmark.h>
+#include "include/bareos.h"
+
+#define STORAGE_DAEMON 1
+#include "include/jcr.h"
+#include "lib/bsock.h"
+#include "lib/parse_conf.h"
+#include "stored/device_control_record.h"
+#include "stored/job.h"
+#include "stored/stored.h"
+#include "stored/stored_globals.h"
+#include "stored/stored_jcr_impl.h"
+#include "stored/wait.h"
+
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace bm = benchmark;
+using namespace storagedaemon;
+
+namespace storagedaemon {
+extern bool ParseSdConfig(const char* configfile, int exit_code);
+}  // namespace storagedaemon
+
+static constexpr int kDevices = 200;
+static constexpr int kMediaTypes = 4;
+static const char* kPools[] = {"Full", "Differential", "Incremental"};
+static std::atomic<int64_t> failed_reservations{0};
+
+// Plays the Director side of the use commands of one job.
+class ScriptedDirector : public BareosSocket {
+ public:
+  explicit ScriptedDirector(std::deque<std::string> script)
+      : script_(std::move(script))
+  {
+  }
+  ~ScriptedDirector() override
+  {
+    if (msg) { FreePoolMemory(msg); }
+    if (errmsg) { FreePoolMemory(errmsg); }
+    msg = errmsg = nullptr;
+  }
+
+  int32_t recv() override
+  {
+    if (script_.empty()) { return BNET_EOD; }
+    std::string line = std::move(script_.front());
+    script_.pop_front();
+    if (line.empty()) { return BNET_EOD; }
+    PmStrcpy(msg, line.c_str());
+    message_length = line.size();
+    return message_length;
+  }
+  bool send() override { return true; }
+
+  BareosSocket* clone() override { return nullptr; }
+  bool connect(JobControlRecord*,
+               int,
+               utime_t,
+               utime_t,
+               const char*,
+               const char*,
+               char*,
+               int,
+               bool) override
+  {
+    return false;
+  }
+  int32_t read_nbytes(char*, int32_t) override { return -1; }
+  int32_t write_nbytes(char*, int32_t nbytes) override { return nbytes; }
+  void close() override {}
+  void destroy() override {}
+  int GetPeer(char*, socklen_t) override { return -1; }
+  bool SetBufferSize(uint32_t, int) override { return true; }
+  int SetNonblocking() override { return 0; }
+  int SetBlocking() override { return 0; }
+  void RestoreBlocking(int) override {}
+  bool ConnectionReceivedTerminateSignal() override { return false; }
+  int WaitData(int, int) override { return Timeout; }
+  int WaitDataIntr(int, int) override { return Timeout; }
+  void FinInit(JobControlRecord*,
+               int,
+               const char*,
+               const char*,
+               int,
+               struct sockaddr*) override
+  {
+  }
+  bool open(JobControlRecord*,
+            const char*,
+            const char*,
+            char*,
+            int,
+            utime_t,
+            int*) override
+  {
+    return false;
+  }
+
+ private:
+  std::deque<std::string> script_;
+};
+
+namespace fs = std::filesystem;
+
+// Removes the generated configuration when the benchmark exits
+static struct TestData {
+  fs::path dir;
+  ~TestData()
+  {
+    if (!dir.empty()) { fs::remove_all(dir); }
+  }
+} test_data;
+
+// Standalone file devices are spread over a few media types
+static std::string MediaType(const std::string& device)
+{
+  if (device == "changer") { return "Changer"; }
+  return "File" + std::to_string(std::stoi(device.substr(4)) % kMediaTypes);
+}
+
+static std::string CreateConfiguration()
+{
+  fs::path dir = fs::temp_directory_path()
+                 / ("bareos-sd-use-device-" + std::to_string(getpid()));
+  test_data.dir = dir;
+  fs::create_directories(dir / "bareos-sd.d" / "storage");
+  fs::create_directories(dir / "bareos-sd.d" / "device");
+  fs::create_directories(dir / "bareos-sd.d" / "autochanger");
+
+  std::ofstream(dir / "bareos-sd.d" / "storage" / "bench.conf")
+      << "Storage {\n  Name = bench-sd\n"
+#if defined(HAVE_DYNAMIC_SD_BACKENDS)
+      << "  Backend Directory = " BACKEND_DIRECTORY "\n"
+#endif
+      << "}\n";
+
+  std::ofstream devices(dir / "bareos-sd.d" / "device" / "devices.conf");
+  std::ofstream changer(dir / "bareos-sd.d" / "autochanger" / "changer.conf");
+  changer << "Autochanger {\n  Name = changer\n"
+          << "  Changer Device = /dev/null\n  Changer Command = \"\"\n";
+  for (int i = 0; i < kDevices; i++) {
+    for (const char* kind : {"file", "drive"}) {
+      std::string name = kind + std::to_string(i);
+      devices << "Device {\n  Name = " << name << "\n"
+              << "  Media Type = "
+              << MediaType(kind[0] == 'd' ? "changer" : name) << "\n"
+              << "  Device Type = File\n"
+              << "  Archive Device = " << dir.string() << "\n"
+              << "  Label Media = yes\n  Random Access = yes\n"
+              << "  Automatic Mount = no\n  Removable Media = no\n"
+              << "  Always Open = no\n";
+      if (kind[0] == 'd') {
+        devices << "  Autochanger = yes\n  Drive Index = " << i << "\n";
+        changer << "  Device = drive" << i << "\n";
+      }
+      devices << "}\n";
+    }
+  }
+  changer << "}\n";
+
+  return dir.string() + "/";
+}
+
+static bool InitStorageDaemon()
+{
+  static std::string config_dir = CreateConfiguration();
+
+  OSDependentInit();
+  configfile = strdup(config_dir.c_str());
+  my_config = InitSdConfig(configfile, M_CONFIG_ERROR);
+  ParseSdConfig(configfile, M_CONFIG_ERROR);
+  InitReservationsLock();
+  CreateVolumeLists();
+
+  return true;
+}
+
+/* A backup job of one of the usual pools. When asked for the next volume,
+ * the Director hands every job its own appendable volume. */
+static void RunJob(uint32_t jobid, const std::string& device)
+{
+  std::string pool = kPools[jobid % (sizeof(kPools) / sizeof(kPools[0]))];
+  std::string volume = pool + "-" + std::to_string(jobid);
+  ScriptedDirector dir(
+      {"use storage=bench-sd media_type=" + MediaType(device) + " pool_name="
+           + pool + " pool_type=Backup append=1 copy=0 stripe=0",
+       "use device=" + device, "", "",
+       "1000 OK VolName=" + volume
+           + " VolJobs=0 VolFiles=0 VolBlocks=0 VolBytes=0 VolMounts=0"
+             " VolErrors=0 VolWrites=0 MaxVolBytes=0 VolCapacityBytes=0"
+             " VolStatus=Append Slot=0 MaxVolJobs=0 MaxVolFiles=0"
+             " InChanger=0 VolReadTime=0 VolWriteTime=0 EndFile=0"
+             " EndBlock=0 LabelType=0 MediaId="
+           + std::to_string(jobid)
+           + " EncryptionKey=*None* MinBlocksize=0 MaxBlocksize=0"});
+  JobControlRecord* jcr = NewStoredJcr();
+
+  jcr->JobId = jobid;
+  jcr->sd_auth_key = strdup("no key set");
+  jcr->dir_bsock = &dir;
+
+  dir.recv();
+  if (use_cmd(jcr)) {
+    jcr->sd_impl->dcr->UnreserveDevice();
+    ReleaseDeviceCond();
+  } else {
+    failed_reservations++;
+  }
+
+  jcr->JobId = 0;
+  jcr->dir_bsock = nullptr;
+  FreeJcr(jcr);
+}
+
+static void RunJobs(bm::State& state, bool use_changer)
+{
+  [[maybe_unused]] static bool initialized = InitStorageDaemon();
+  int jobs = state.range(0);
+
+  for (auto _ : state) {
+    std::vector<std::thread> threads;
+    for (int i = 0; i < jobs; i++) {
+      // Standalone devices at the end of the configuration are the worst case
+      std::string device = use_changer
+                               ? std::string("changer")
+                               : "file" + std::to_string(kDevices - 1 - i);
+      threads.emplace_back(RunJob, i + 1, device);
+    }
+    for (auto& thread : threads) { thread.join(); }
+  }
+  state.counters["reservations/s"]
+      = bm::Counter(state.iterations() * jobs, bm::Counter::kIsRate);
+  state.counters["failed"] = failed_reservations.exchange(0);
+}
+
+static void BM_UseDevice(bm::State& state) { RunJobs(state, false); }
+BENCHMARK(BM_UseDevice)->Arg(1)->Arg(50)->Arg(kDevices)->UseRealTime();
+
+static void BM_UseAutochanger(bm::State& state) { RunJobs(state, true); }
+BENCHMARK(BM_UseAutochanger)->Arg(1)->Arg(50)->Arg(kDevices)->UseRealTime();
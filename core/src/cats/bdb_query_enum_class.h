@@ -91,7 +91,8 @@ class BareosDbQueryEnum {
     subscription_select_backup_unit_total_1 = 80,
     subscription_select_unclassified_client_fileset_0 = 81,
     subscription_select_unclassified_amount_data_0 = 82,
-    SQL_QUERY_NUMBER = 83
+    bvfs_find_files_4 = 83,
+    SQL_QUERY_NUMBER = 84
   };
 };
 
@@ -34,6 +34,7 @@
 #  include "cats/bvfs.h"
 #  include "lib/edit.h"
 
+#  include <string>
 #  include <unordered_set>
 
 #  define dbglevel 10
@@ -370,6 +371,8 @@ Bvfs::Bvfs(JobControlRecord* j, BareosDb* mdb)
   prev_dir = GetPoolMemory(PM_NAME);
   pattern = GetPoolMemory(PM_NAME);
   *jobids = *prev_dir = *pattern = 0;
+  min_size = max_size = 0;
+  min_mtime = max_mtime = 0;
   pwd_id = 0;
   see_copies = false;
   see_all_versions = false;
@@ -518,6 +521,66 @@ void Bvfs::GetAllFileVersions(DBId_t pathid,
   db->SqlQuery(query.c_str(), list_entries, user_data);
 }
 
+/* Convert a search string into an escaped ILIKE pattern that matches it
+ * anywhere in a name, with * and ? as wildcards. */
+static void SearchToLikePattern(BareosDb* db,
+                                JobControlRecord* jcr,
+                                const char* search,
+                                PoolMem& escaped)
+{
+  std::string like = "%";
+
+  for (const char* p = search; *p; p++) {
+    switch (*p) {
+      case '*':
+        like += '%';
+        break;
+      case '?':
+        like += '_';
+        break;
+      case '%':
+      case '_':
+      case '\\':
+        like += '\\';
+        like += *p;
+        break;
+      default:
+        like += *p;
+        break;
+    }
+  }
+  like += '%';
+
+  escaped.check_size(like.size() * 2 + 1);
+  db->EscapeString(jcr, escaped.c_str(), like.c_str(), like.size());
+}
+
+/**
+ * Search the file names of all backups, and optionally their paths.
+ * With the trigram indexes created by create_bareos_file_search_indexes this
+ * does not scan the File table.
+ */
+void Bvfs::FindFiles(const char* name, const char* path, const char* filter)
+{
+  PoolMem query(PM_MESSAGE);
+  PoolMem where(PM_MESSAGE);
+  PoolMem name_like(PM_NAME);
+  PoolMem path_like(PM_NAME);
+
+  Dmsg3(dbglevel, "FindFiles(%s, %s, %s)\n", name, NPRT(path), filter);
+
+  SearchToLikePattern(db, jcr, name, name_like);
+  if (path && *path) {
+    SearchToLikePattern(db, jcr, path, path_like);
+    Mmsg(where, " AND Path.Path ILIKE '%s' ", path_like.c_str());
+  }
+  PmStrcat(where, filter);
+
+  db->FillQuery(query, BareosDb::SQL_QUERY::bvfs_find_files_4,
+                name_like.c_str(), where.c_str(), limit, offset);
+  db->SqlQuery(query.c_str(), list_entries, user_data);
+}
+
 DBId_t Bvfs::get_root()
 {
   int p;
@@ -596,6 +659,34 @@ static void build_ls_files_query(JobControlRecord*,
   }
 }
 
+/**
+ * Restrict a listing to a range of a stat value. Files that were backed up
+ * before the File table had typed stat columns only have the value in LStat.
+ */
+static void AddStatRangeFilter(PoolMem& filter,
+                               const char* column,
+                               const char* stat_field,
+                               int64_t min,
+                               int64_t max)
+{
+  PoolMem value(PM_MESSAGE);
+  PoolMem range(PM_MESSAGE);
+
+  if (min <= 0 && max <= 0) { return; }
+
+  Mmsg(value,
+       "COALESCE(%s, (SELECT %s FROM decode_lstat(LStat, ARRAY['%s'])))",
+       column, stat_field, stat_field);
+  if (min > 0) {
+    Mmsg(range, " AND %s >= %lld", value.c_str(), (long long)min);
+    PmStrcat(filter, range.c_str());
+  }
+  if (max > 0) {
+    Mmsg(range, " AND %s <= %lld", value.c_str(), (long long)max);
+    PmStrcat(filter, range.c_str());
+  }
+}
+
 // Returns true if we have files to read
 bool Bvfs::ls_files()
 {
@@ -612,6 +703,8 @@ bool Bvfs::ls_files()
   if (*pattern) {
     db->FillQuery(filter, BareosDb::SQL_QUERY::match_query2, pattern);
   }
+  AddStatRangeFilter(filter, "Size", "st_size", min_size, max_size);
+  AddStatRangeFilter(filter, "MTime", "st_mtime", min_mtime, max_mtime);
 
   build_ls_files_query(jcr, db, query, jobids, pathid, filter.c_str(), limit,
                        offset);
@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2009 Free Software Foundation Europe e.V.
    Copyright (C) 2016-2016 Planets Communications B.V.
-   Copyright (C) 2016-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2016-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -78,6 +78,19 @@ class Bvfs {
     db->EscapeString(jcr, pattern, p, len);
   }
 
+  /* Only list files within these bounds, 0 leaves a bound open */
+  void SetSizeRange(uint64_t min, uint64_t max)
+  {
+    min_size = min;
+    max_size = max;
+  }
+
+  void SetMTimeRange(utime_t min, utime_t max)
+  {
+    min_mtime = min;
+    max_mtime = max;
+  }
+
   /* Get the root point */
   DBId_t get_root();
 
@@ -99,6 +112,10 @@ class Bvfs {
                           const char* client);
   void GetAllFileVersions(DBId_t pathid, const char* fname, const char* client);
 
+  /* Search file names (and paths) of all backups for a pattern where * and ?
+   * are wildcards, filter is appended to the where clause of the query */
+  void FindFiles(const char* name, const char* path, const char* filter);
+
   void SetSeeAllVersions(bool val) { see_all_versions = val; }
 
   void SetSeeCopies(bool val) { see_copies = val; }
@@ -137,6 +154,10 @@ class Bvfs {
   uint32_t offset;
   uint32_t nb_record; /* number of records of the last query */
   POOLMEM* pattern;
+  uint64_t min_size;
+  uint64_t max_size;
+  utime_t min_mtime;
+  utime_t max_mtime;
   DBId_t pwd_id;     /* Current pathid */
   POOLMEM* prev_dir; /* ls_dirs query returns all versions, take the 1st one */
   Attributes* attr;  /* Can be use by handler to call DecodeStat() */
@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2012 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2016 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -205,6 +205,20 @@ struct AttributesDbRecord {
   uint64_t Fhnode = 0; /**< NDMP fh_node for DAR*/
 };
 
+/* Typed columns of the File table. They hold the stat values that are most
+ * often needed, so they can be read and selected on without decoding LStat. */
+struct FileStatColumns {
+  bool valid = false; /**< false if LStat could not be decoded */
+  uint64_t Size = 0;
+  int64_t MTime = 0;
+  uint32_t Mode = 0;
+  uint32_t NLink = 0;
+  uint32_t Uid = 0;
+  uint32_t Gid = 0;
+  uint64_t Inode = 0;
+  int32_t LinkFI = 0; /**< FileIndex of the hard linked file data */
+};
+
 struct RestoreObjectDbRecord {
   char* object_name = nullptr;
   char* object = nullptr;
@@ -464,12 +478,20 @@ typedef int(DB_RESULT_HANDLER)(void*, int, char**);
 
 class pathid_cache;
 
+/* One statement of a batch executed by BareosDb::SqlQueryPipeline(). */
+struct PipelinedQuery {
+  std::string query;
+  DB_RESULT_HANDLER* ResultHandler = nullptr; /**< called for every row */
+  void* ctx = nullptr;
+  int affected_rows = -1; /**< set after execution, -1 if not executed */
+};
+
 // Initial size of query hash table and hint for number of pages.
 #define QUERY_INITIAL_HASH_SIZE 1024
 #define QUERY_HTABLE_PAGES 128
 
 // Current database version number schema = 2000 + 10 * Major + Minor
-#define BDB_VERSION 2230
+#define BDB_VERSION 2240
 
 typedef char** SQL_ROW;
 
@@ -512,6 +534,8 @@ class BareosDb : public BareosDbQueryEnum {
   int pnl = 0;             /**< Path name length */
   bool disabled_batch_insert_
       = false;                 /**< Explicitly disabled batch insert mode ? */
+  bool fill_file_stat_columns_
+      = false;                 /**< Fill the stat columns of File records ? */
   bool is_private_ = false;    /**< Private connection ? */
   uint32_t cached_path_id = 0; /**< Cached path id */
   uint32_t last_hash_key_ = 0; /**< Last hash key lookup on query table */
@@ -559,7 +583,9 @@ class BareosDb : public BareosDbQueryEnum {
   bool IsConnected(void) { return connected_; }
   bool BatchInsertAvailable(void) { return have_batch_insert_; }
   bool IsPrivate(void) { return is_private_; }
+  void SetFillFileStatColumns(bool fill) { fill_file_stat_columns_ = fill; }
   void IncrementRefcount(void) { ref_count_++; }
+  uint32_t GetRefcount(void) { return ref_count_; }
 
   int SqlNumRows(void)
   {
@@ -645,8 +671,8 @@ class BareosDb : public BareosDbQueryEnum {
   /* sql_delete.c */
   bool DeletePoolRecord(JobControlRecord* jcr, PoolDbRecord* pool_dbr);
   bool DeleteMediaRecord(JobControlRecord* jcr, MediaDbRecord* mr);
-  void PurgeFiles(const char* jobids);
-  void PurgeJobs(const char* jobids);
+  int64_t PurgeFiles(const char* jobids);
+  int64_t PurgeJobs(const char* jobids, int64_t* files = nullptr);
 
   /* sql_find.c */
 
@@ -746,6 +772,13 @@ class BareosDb : public BareosDbQueryEnum {
   bool get_quota_jobbytes_nofailed(JobControlRecord* jcr,
                                    JobDbRecord* jr,
                                    utime_t JobRetention);
+  bool GetReplicationLag(JobControlRecord* jcr, utime_t* lag);
+  bool GetWalPosition(JobControlRecord* jcr, std::string& position);
+  bool HasReplayedWalPosition(JobControlRecord* jcr,
+                              const std::string& position);
+  bool GetJobsState(JobControlRecord* jcr,
+                    const char* jobids,
+                    std::string& state);
   int GetNdmpLevelMapping(JobControlRecord* jcr,
                           JobDbRecord* jr,
                           char* filesystem);
@@ -789,9 +822,17 @@ class BareosDb : public BareosDbQueryEnum {
                       bool count,
                       OutputFormatter* sendit,
                       e_list_type type);
+  enum class JobTotalsGrouping
+  {
+    kByJob,
+    kByClient,
+    kByPool
+  };
+
   void ListJobTotals(JobControlRecord* jcr,
                      JobDbRecord* jr,
-                     OutputFormatter* sendit);
+                     OutputFormatter* sendit,
+                     JobTotalsGrouping grouping = JobTotalsGrouping::kByJob);
   void ListFilesForJob(JobControlRecord* jcr,
                        uint32_t jobid,
                        OutputFormatter* sendit);
@@ -886,6 +927,7 @@ class BareosDb : public BareosDbQueryEnum {
   bool SqlQuery(SQL_QUERY query, ...);
   bool SqlQuery(const char* query, int flags = 0);
   bool SqlQuery(const char* query, DB_RESULT_HANDLER* ResultHandler, void* ctx);
+  bool SqlQueryPipeline(std::vector<PipelinedQuery>& queries);
 
   /* sql_update.c */
   bool UpdateJobStartRecord(JobControlRecord* jcr, JobDbRecord* jr);
@@ -910,6 +952,7 @@ class BareosDb : public BareosDbQueryEnum {
                              int type);
   bool MarkFileRecord(JobControlRecord* jcr, FileId_t FileId, JobId_t JobId);
   void MakeInchangerUnique(JobControlRecord* jcr, MediaDbRecord* mr);
+  bool MakeInchangerUniqueQuery(JobControlRecord* jcr, MediaDbRecord* mr);
   int UpdateStats(JobControlRecord* jcr, utime_t age);
   void UpgradeCopies(const char* jobids);
 
@@ -953,9 +996,14 @@ class BareosDb : public BareosDbQueryEnum {
   virtual bool OpenDatabase(JobControlRecord* jcr) = 0;
   virtual void CloseDatabase(JobControlRecord* jcr) = 0;
   virtual bool ValidateConnection(void) = 0;
+  virtual bool ResetSession(void) = 0;
   virtual void StartTransaction(JobControlRecord* jcr) = 0;
   virtual void EndTransaction(JobControlRecord* jcr) = 0;
 
+  /* By default, the statements are executed one after the other */
+  virtual bool SqlQueryPipelineWithHandlers(
+      std::vector<PipelinedQuery>& queries);
+
   /* By default, we use db_sql_query */
   virtual bool BigSqlQuery(const char* query,
                            DB_RESULT_HANDLER* ResultHandler,
@@ -1038,38 +1086,6 @@ class DbLocker {
   DbLocker(DbLocker&& other) = delete;
 };
 
-// Pooled backend connection.
-struct SqlPoolEntry {
-  int id = 0; /**< Unique ID, connection numbering can have holes and the pool
-             is not sorted on it */
-  int reference_count = 0; /**< Reference count for this entry */
-  time_t last_update = 0;  /**< When was this connection last updated either
-                          used  or put back on the pool */
-  BareosDb* db_handle = nullptr; /**< Connection handle to the database */
-  dlink<SqlPoolEntry> link;      /**< list management */
-};
-
-// Pooled backend list descriptor (one defined per backend defined in config)
-struct SqlPoolDescriptor {
-  bool active = false;    /**< Is this an active pool, after a config reload an
-                      pool is    made inactive */
-  time_t last_update = 0; /**< When was this pool last updated */
-  int min_connections
-      = 0; /**< Minimum number of connections in the connection pool
-            */
-  int max_connections
-      = 0; /**< Maximum number of connections in the connection pool
-            */
-  int increment_connections = 0; /**< Increase/Decrease the number of
-                                connection in the pool with this value */
-  int idle_timeout = 0;     /**< Number of seconds to wait before tearing down a
-                           connection */
-  int validate_timeout = 0; /**< Number of seconds after which an idle
-                           connection should be validated */
-  int nr_connections = 0;   /**< Number of active connections in the pool */
-  dlink<SqlPoolDescriptor> link; /**< list management */
-};
-
 #include "include/jcr.h"
 
 // Object used in db_list_xxx function
@@ -1099,6 +1115,8 @@ class ListContext {
   }
 };
 
+FileStatColumns DecodeFileStatColumns(const char* lstat);
+
 // Some functions exported by sql.c for use within the cats directory.
 int ListResult(void* vctx, int cols, char** row);
 int ListResult(JobControlRecord* jcr,
@@ -1,5 +1,7 @@
 DROP FUNCTION IF EXISTS decode_lstat();
 DROP FUNCTION IF EXISTS bareos_frombase64();
+DROP FUNCTION IF EXISTS job_summary_trigger() CASCADE;
+DROP FUNCTION IF EXISTS volume_summary_trigger() CASCADE;
 DROP VIEW IF EXISTS backup_unit_overview;
 DROP VIEW IF EXISTS latest_full_size_categorized;
 -- DROP TABLE IF EXISTS unsavedfiles;
@@ -26,6 +28,8 @@ DROP TABLE IF EXISTS NDMPJobEnvironment;
 DROP TABLE IF EXISTS DeviceStats;
 DROP TABLE IF EXISTS JobStats;
 DROP TABLE IF EXISTS TapeAlerts;
+DROP TABLE IF EXISTS JobSummary;
+DROP TABLE IF EXISTS VolumeSummary;
 DROP TABLE IF EXISTS log;
 DROP TABLE IF EXISTS Location;
 DROP TABLE IF EXISTS locationlog;
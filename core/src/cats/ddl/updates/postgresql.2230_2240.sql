@@ -0,0 +1,178 @@
+-- update db schema from 2230 to 2240
+-- start transaction
+begin;
+
+-- typed stat columns of the File table.
+-- Adding nullable columns without a default only changes the catalog
+-- metadata, so this is fast even on large File tables. The columns are only
+-- filled when the catalog has FileStatColumns enabled, rows without them are
+-- read through LStat instead.
+ALTER TABLE File ADD COLUMN Size   BIGINT;
+ALTER TABLE File ADD COLUMN MTime  BIGINT;
+ALTER TABLE File ADD COLUMN Mode   INTEGER;
+ALTER TABLE File ADD COLUMN NLink  INTEGER;
+ALTER TABLE File ADD COLUMN Uid    BIGINT;
+ALTER TABLE File ADD COLUMN Gid    BIGINT;
+ALTER TABLE File ADD COLUMN Inode  BIGINT;
+ALTER TABLE File ADD COLUMN LinkFI INTEGER;
+
+-- job and volume summary tables
+-- Totals of the Job table, kept up to date by job_summary_trigger(),
+-- so list jobtotals does not have to aggregate over all jobs.
+CREATE TABLE JobSummary
+(
+    Name              TEXT        NOT NULL,
+    Type              CHAR(1)     NOT NULL,
+    ClientId          INTEGER     NOT NULL,
+    PoolId            INTEGER     NOT NULL,
+    Jobs              BIGINT      DEFAULT 0,
+    JobFiles          BIGINT      DEFAULT 0,
+    JobBytes          BIGINT      DEFAULT 0,
+    LastSuccess       TIMESTAMP   WITHOUT TIME ZONE,
+    PRIMARY KEY (Name, Type, ClientId, PoolId)
+);
+
+-- Number of jobs with data on a volume, kept up to date by
+-- volume_summary_trigger().
+CREATE TABLE VolumeSummary
+(
+    MediaId           INTEGER     NOT NULL,
+    Jobs              INTEGER     DEFAULT 0,
+    PRIMARY KEY (MediaId)
+);
+
+-- Maintain JobSummary. The triggers run once per statement, so pruning
+-- and purging update each summary row once, not once per job. Rows are
+-- locked in key order to avoid deadlocks between concurrent prunes.
+create or replace function job_summary_trigger() returns trigger as $$
+begin
+  if tg_op in ('UPDATE', 'DELETE') then
+    perform 1 from JobSummary
+      where (Name, Type, ClientId, PoolId) in
+            (select Name, Type, coalesce(ClientId, 0), coalesce(PoolId, 0)
+               from old_jobs)
+      order by Name, Type, ClientId, PoolId
+      for update;
+    update JobSummary s
+       set Jobs = s.Jobs - d.Jobs,
+           JobFiles = s.JobFiles - d.JobFiles,
+           JobBytes = s.JobBytes - d.JobBytes,
+           LastSuccess = case
+             when d.LastSuccess >= s.LastSuccess then
+               (select max(EndTime) from Job
+                 where Job.Name = s.Name and Job.Type = s.Type
+                   and coalesce(Job.ClientId, 0) = s.ClientId
+                   and coalesce(Job.PoolId, 0) = s.PoolId
+                   and Job.JobStatus in ('T', 'W'))
+             else s.LastSuccess
+           end
+      from (select Name, Type, coalesce(ClientId, 0) as ClientId,
+                   coalesce(PoolId, 0) as PoolId, count(*) as Jobs,
+                   sum(coalesce(JobFiles, 0)) as JobFiles,
+                   sum(coalesce(JobBytes, 0)) as JobBytes,
+                   max(case when JobStatus in ('T', 'W') then EndTime end)
+                     as LastSuccess
+              from old_jobs
+             group by 1, 2, 3, 4) d
+     where s.Name = d.Name and s.Type = d.Type
+       and s.ClientId = d.ClientId and s.PoolId = d.PoolId;
+  end if;
+
+  if tg_op in ('INSERT', 'UPDATE') then
+    insert into JobSummary (Name, Type, ClientId, PoolId, Jobs, JobFiles,
+                            JobBytes, LastSuccess)
+    select Name, Type, coalesce(ClientId, 0), coalesce(PoolId, 0), count(*),
+           sum(coalesce(JobFiles, 0)), sum(coalesce(JobBytes, 0)),
+           max(case when JobStatus in ('T', 'W') then EndTime end)
+      from new_jobs
+     group by 1, 2, 3, 4
+     order by 1, 2, 3, 4
+    on conflict (Name, Type, ClientId, PoolId) do update
+       set Jobs = JobSummary.Jobs + excluded.Jobs,
+           JobFiles = JobSummary.JobFiles + excluded.JobFiles,
+           JobBytes = JobSummary.JobBytes + excluded.JobBytes,
+           LastSuccess = greatest(JobSummary.LastSuccess,
+                                  excluded.LastSuccess);
+  end if;
+
+  if tg_op in ('UPDATE', 'DELETE') then
+    delete from JobSummary
+     where Jobs <= 0
+       and (Name, Type, ClientId, PoolId) in
+           (select Name, Type, coalesce(ClientId, 0), coalesce(PoolId, 0)
+              from old_jobs);
+  end if;
+  return null;
+end
+$$ language 'plpgsql';
+
+-- Maintain VolumeSummary. A job counts once per volume, no matter how many
+-- JobMedia records it has there. JobId and MediaId of a JobMedia record
+-- are never updated.
+create or replace function volume_summary_trigger() returns trigger as $$
+begin
+  if tg_op = 'INSERT' then
+    insert into VolumeSummary (MediaId, Jobs)
+    select p.MediaId, count(*)
+      from (select JobId, MediaId, count(*) as Added
+              from new_jobmedia
+             group by JobId, MediaId) p
+     where (select count(*) from JobMedia j
+             where j.JobId = p.JobId and j.MediaId = p.MediaId) = p.Added
+     group by p.MediaId
+     order by p.MediaId
+    on conflict (MediaId) do update
+       set Jobs = VolumeSummary.Jobs + excluded.Jobs;
+  else
+    perform 1 from VolumeSummary
+      where MediaId in (select MediaId from old_jobmedia)
+      order by MediaId
+      for update;
+    update VolumeSummary v
+       set Jobs = v.Jobs - d.Jobs
+      from (select p.MediaId, count(*) as Jobs
+              from (select distinct JobId, MediaId from old_jobmedia) p
+             where not exists (select 1 from JobMedia j
+                                where j.JobId = p.JobId
+                                  and j.MediaId = p.MediaId)
+             group by p.MediaId) d
+     where v.MediaId = d.MediaId;
+    delete from VolumeSummary
+     where Jobs <= 0 and MediaId in (select MediaId from old_jobmedia);
+  end if;
+  return null;
+end
+$$ language 'plpgsql';
+
+create trigger job_summary_insert after insert on Job
+  referencing new table as new_jobs
+  for each statement execute procedure job_summary_trigger();
+create trigger job_summary_update after update on Job
+  referencing old table as old_jobs new table as new_jobs
+  for each statement execute procedure job_summary_trigger();
+create trigger job_summary_delete after delete on Job
+  referencing old table as old_jobs
+  for each statement execute procedure job_summary_trigger();
+create trigger volume_summary_insert after insert on JobMedia
+  referencing new table as new_jobmedia
+  for each statement execute procedure volume_summary_trigger();
+create trigger volume_summary_delete after delete on JobMedia
+  referencing old table as old_jobmedia
+  for each statement execute procedure volume_summary_trigger();
+
+-- initial contents of the summary tables
+INSERT INTO JobSummary (Name, Type, ClientId, PoolId, Jobs, JobFiles,
+                        JobBytes, LastSuccess)
+SELECT Name, Type, coalesce(ClientId, 0), coalesce(PoolId, 0), count(*),
+       sum(coalesce(JobFiles, 0)), sum(coalesce(JobBytes, 0)),
+       max(CASE WHEN JobStatus IN ('T', 'W') THEN EndTime END)
+  FROM Job
+ GROUP BY 1, 2, 3, 4;
+INSERT INTO VolumeSummary (MediaId, Jobs)
+SELECT MediaId, count(DISTINCT JobId) FROM JobMedia GROUP BY MediaId;
+
+update Version set VersionId = 2240;
+
+commit;
+set client_min_messages = warning;
+analyze;
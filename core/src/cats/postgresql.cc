@@ -3,7 +3,7 @@
 
    Copyright (C) 2003-2011 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2016 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -310,6 +310,32 @@ bool BareosDbPostgresql::ValidateConnection(void)
   return true;
 }
 
+/**
+ * Reset what the previous user of a pooled connection left behind, open
+ * transactions, cursors and temporary tables like the batch table, so the
+ * next user gets a clean session. The SET statements done when connecting
+ * are kept.
+ */
+bool BareosDbPostgresql::ResetSession(void)
+{
+  DbLocker _{this};
+
+  if (PQtransactionStatus(db_handle_) != PQTRANS_IDLE) {
+    if (!SqlQueryWithoutHandler("ROLLBACK")) { return false; }
+  }
+  transaction_ = false;
+  changes = 0;
+
+  if (!SqlQueryWithoutHandler("CLOSE ALL")
+      || !SqlQueryWithoutHandler("DISCARD TEMP")) {
+    return false;
+  }
+
+  SqlFreeResult();
+
+  return true;
+}
+
 /**
  * Escape strings so that PostgreSQL is happy
  *
@@ -661,6 +687,106 @@ ok_out:
   return retval;
 }
 
+#  ifdef LIBPQ_HAS_PIPELINING
+/**
+ * Send all statements in pipeline mode and only then collect their
+ * results, see BareosDb::SqlQueryPipeline(). There is no reconnect here,
+ * without a working connection the statements are run one by one, which
+ * does reconnect if configured to.
+ */
+bool BareosDbPostgresql::SqlQueryPipelineWithHandlers(
+    std::vector<PipelinedQuery>& queries)
+{
+  if (queries.size() < 2 || PQstatus(db_handle_) != CONNECTION_OK
+      || !PQenterPipelineMode(db_handle_)) {
+    return BareosDb::SqlQueryPipelineWithHandlers(queries);
+  }
+
+  SqlFreeResult();
+
+  std::size_t sent = 0;
+  while (sent < queries.size()
+         && PQsendQueryParams(db_handle_, queries[sent].query.c_str(), 0,
+                              nullptr, nullptr, nullptr, nullptr, 0)) {
+    sent++;
+  }
+  bool retval = sent == queries.size();
+  bool synced = PQpipelineSync(db_handle_) == 1;
+  if (!retval || !synced) {
+    Mmsg(errmsg, T_("Sending queries failed: ERR=%s\n"), sql_strerror());
+    retval = false;
+  }
+
+  for (std::size_t i = 0; synced && i < sent; i++) {
+    PipelinedQuery& query = queries[i];
+    PGresult* result = PQgetResult(db_handle_);
+    if (!result) {  // lost the connection
+      Mmsg(errmsg, T_("Query failed: %s: ERR=%s\n"), query.query.c_str(),
+           sql_strerror());
+      retval = synced = false;
+      break;
+    }
+
+    switch (PQresultStatus(result)) {
+      case PGRES_TUPLES_OK:
+      case PGRES_COMMAND_OK:
+        result_ = result;
+        num_fields_ = PQnfields(result_);
+        num_rows_ = PQntuples(result_);
+        row_number_ = 0;
+        query.affected_rows = SqlAffectedRows();
+        if (query.ResultHandler) {
+          SQL_ROW row;
+          while ((row = SqlFetchRow()) != nullptr) {
+            if (query.ResultHandler(query.ctx, num_fields_, row)) { break; }
+          }
+        }
+        SqlFreeResult();
+        result = nullptr;
+        break;
+      case PGRES_PIPELINE_ABORTED:
+        Dmsg1(50, "Pipelined query not executed: %s\n", query.query.c_str());
+        break;
+      default:
+        Dmsg2(50, "Pipelined query failed: %s, %s\n", query.query.c_str(),
+              PQresultErrorMessage(result));
+        if (retval) {
+          Mmsg(errmsg, T_("Query failed: %s: ERR=%s\n"), query.query.c_str(),
+               PQresultErrorMessage(result));
+          retval = false;
+        }
+        break;
+    }
+    if (result) { PQclear(result); }
+
+    // Every result is followed by a null pointer
+    while ((result = PQgetResult(db_handle_)) != nullptr) { PQclear(result); }
+  }
+
+  if (synced) {
+    PGresult* result = PQgetResult(db_handle_);
+    if (PQresultStatus(result) != PGRES_PIPELINE_SYNC) {
+      Dmsg0(50, "Pipeline did not end with a sync\n");
+    }
+    PQclear(result);
+  }
+
+  /* Only fails if results are left over after a lost connection, the next
+   * query then takes the reconnect path of SqlQueryWithoutHandler(). */
+  if (!PQexitPipelineMode(db_handle_)) {
+    Dmsg1(50, "Leaving pipeline mode failed: %s\n", sql_strerror());
+    retval = false;
+  }
+
+  // After a failure none of the statements has taken effect
+  if (!retval) {
+    for (auto& query : queries) { query.affected_rows = -1; }
+  }
+
+  return retval;
+}
+#  endif
+
 void BareosDbPostgresql::SqlFreeResult(void)
 {
   DbLocker _{this};
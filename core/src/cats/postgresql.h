@@ -3,7 +3,7 @@
 
    Copyright (C) 2009-2011 Free Software Foundation Europe e.V.
    Copyright (C) 2016-2016 Planets Communications B.V.
-   Copyright (C) 2016-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2016-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -63,6 +63,7 @@ class BareosDbPostgresql : public BareosDb {
   bool OpenDatabase(JobControlRecord* jcr) override;
   void CloseDatabase(JobControlRecord* jcr) override;
   bool ValidateConnection(void) override;
+  bool ResetSession(void) override;
   void EscapeString(JobControlRecord* jcr,
                     char* snew,
                     const char* old,
@@ -86,6 +87,10 @@ class BareosDbPostgresql : public BareosDb {
                            DB_RESULT_HANDLER* ResultHandler,
                            void* ctx) override;
   bool SqlQueryWithoutHandler(const char* query, int flags = 0) override;
+#  ifdef LIBPQ_HAS_PIPELINING
+  bool SqlQueryPipelineWithHandlers(
+      std::vector<PipelinedQuery>& queries) override;
+#  endif
   void SqlFreeResult(void) override;
   SQL_ROW SqlFetchRow(void) override;
   const char* sql_strerror(void) override;
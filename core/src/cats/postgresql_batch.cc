@@ -3,7 +3,7 @@
 
    Copyright (C) 2003-2011 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2016 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -49,7 +49,15 @@ bool BareosDbPostgresql::SqlBatchStartFileTable(JobControlRecord*)
                               "Md5 varchar,"
                               "DeltaSeq smallint,"
                               "Fhinfo NUMERIC(20),"
-                              "Fhnode NUMERIC(20))")) {
+                              "Fhnode NUMERIC(20),"
+                              "Size bigint,"
+                              "MTime bigint,"
+                              "Mode int,"
+                              "NLink int,"
+                              "Uid bigint,"
+                              "Gid bigint,"
+                              "Inode bigint,"
+                              "LinkFI int)")) {
     Dmsg0(500, "SqlBatchStartFileTable failed\n");
     return false;
   }
@@ -202,6 +210,7 @@ bool BareosDbPostgresql::SqlBatchInsertFileTable(JobControlRecord*,
   size_t len;
   const char* digest;
   char ed1[50], ed2[50], ed3[50];
+  PoolMem stat_columns(PM_NAME);
 
   esc_name = CheckPoolMemorySize(esc_name, fnl * 2 + 1);
   pgsql_copy_escape(esc_name, fname, fnl);
@@ -215,10 +224,21 @@ bool BareosDbPostgresql::SqlBatchInsertFileTable(JobControlRecord*,
     digest = ar->Digest;
   }
 
-  len = Mmsg(cmd, "%u\t%s\t%s\t%s\t%s\t%s\t%u\t%s\t%s\n", ar->FileIndex,
-             edit_int64(ar->JobId, ed1), esc_path, esc_name, ar->attr, digest,
-             ar->DeltaSeq, edit_uint64(ar->Fhinfo, ed2),
-             edit_uint64(ar->Fhnode, ed3));
+  FileStatColumns columns;
+  if (fill_file_stat_columns_) { columns = DecodeFileStatColumns(ar->attr); }
+  if (columns.valid) {
+    Mmsg(stat_columns, "%llu\t%lld\t%u\t%u\t%u\t%u\t%lld\t%d",
+         (unsigned long long)columns.Size, (long long)columns.MTime,
+         columns.Mode, columns.NLink, columns.Uid, columns.Gid,
+         (long long)columns.Inode, columns.LinkFI);
+  } else {
+    PmStrcpy(stat_columns, "\\N\t\\N\t\\N\t\\N\t\\N\t\\N\t\\N\t\\N");
+  }
+
+  len = Mmsg(cmd, "%u\t%s\t%s\t%s\t%s\t%s\t%u\t%s\t%s\t%s\n",
+             ar->FileIndex, edit_int64(ar->JobId, ed1), esc_path, esc_name,
+             ar->attr, digest, ar->DeltaSeq, edit_uint64(ar->Fhinfo, ed2),
+             edit_uint64(ar->Fhnode, ed3), stat_columns.c_str());
 
   do {
     res = PQputCopyData(db_handle_, cmd, len);
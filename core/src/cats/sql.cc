@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2009 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2016 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -35,6 +35,7 @@
 #if HAVE_POSTGRESQL
 
 #  include "cats.h"
+#  include "lib/attribs.h"
 #  include "lib/edit.h"
 
 /* Forward referenced subroutines */
@@ -320,6 +321,42 @@ int BareosDb::GetSqlRecordMax(JobControlRecord* jcr)
 
 char* BareosDb::strerror() { return errmsg; }
 
+/**
+ * Decode the values of the typed columns of the File table from the LStat of
+ * a file. LStat values that don't hold a full stat, like the ones of deleted
+ * files, leave the columns empty.
+ */
+FileStatColumns DecodeFileStatColumns(const char* lstat)
+{
+  FileStatColumns columns;
+  struct stat statp;
+  int fields = 1;
+
+  if (!lstat || !*lstat) { return columns; }
+  for (const char* p = lstat; *p; p++) {
+    if (*p == ' ') {
+      fields++;
+    } else if (!B_ISALPHA(*p) && !B_ISDIGIT(*p) && *p != '+' && *p != '/'
+               && *p != '-') {
+      return columns;
+    }
+  }
+  if (fields < 13) { return columns; }
+
+  DecodeStat(const_cast<char*>(lstat), &statp, sizeof(statp),
+             &columns.LinkFI);
+  columns.valid = true;
+  columns.Size = statp.st_size;
+  columns.MTime = statp.st_mtime;
+  columns.Mode = statp.st_mode;
+  columns.NLink = statp.st_nlink;
+  columns.Uid = statp.st_uid;
+  columns.Gid = statp.st_gid;
+  columns.Inode = statp.st_ino;
+
+  return columns;
+}
+
 /**
  * Given a full filename, split it into its path
  *  and filename parts. They are returned in pool memory
@@ -862,6 +899,7 @@ bool BareosDb::OpenBatchConnection(JobControlRecord* jcr)
       return false;
     }
   }
+  jcr->db_batch->fill_file_stat_columns_ = fill_file_stat_columns_;
   return true;
 }
 
@@ -106,42 +106,43 @@ bool BareosDb::CreateJobmediaRecord(JobControlRecord* jcr, JobMediaDbRecord* jm)
 {
   DbLocker _{this};
 
-  Mmsg(cmd, "SELECT count(*) from JobMedia WHERE JobId=%lu", jm->JobId);
-  int count = GetSqlRecordMax(jcr);
-  if (count < 0) { count = 0; }
-  count++;
-
+  /* The VolIndex is counted by the INSERT itself, so the JobMedia record
+   * and the Media update go to the database in one round trip. */
+  std::vector<PipelinedQuery> queries(2);
   /* clang-format off */
   Mmsg(cmd,
        "INSERT INTO JobMedia (JobId,MediaId,FirstIndex,LastIndex,"
        "StartFile,EndFile,StartBlock,EndBlock,VolIndex,JobBytes) "
-       "VALUES (%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%llu)",
+       "VALUES (%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,"
+       "(SELECT count(*)+1 FROM JobMedia WHERE JobId=%lu),%llu)",
        jm->JobId,
        jm->MediaId,
        jm->FirstIndex, jm->LastIndex,
        jm->StartFile, jm->EndFile,
        jm->StartBlock, jm->EndBlock,
-       count,
+       jm->JobId,
        jm->JobBytes);
   /* clang-format on */
+  queries[0].query = cmd;
 
-  Dmsg0(300, cmd);
-  if (INSERT_DB(jcr, cmd) != 1) {
-    Mmsg2(errmsg, T_("Create JobMedia record %s failed: ERR=%s\n"), cmd,
-          sql_strerror());
-  } else {
-    // Worked, now update the Media record with the EndFile and EndBlock
-    Mmsg(cmd, "UPDATE Media SET EndFile=%lu, EndBlock=%lu WHERE MediaId=%lu",
-         jm->EndFile, jm->EndBlock, jm->MediaId);
-    if (UPDATE_DB(jcr, cmd) == -1) {
-      Mmsg2(errmsg, T_("Update Media record %s failed: ERR=%s\n"), cmd,
-            sql_strerror());
-    } else {
-      return true;
-    }
+  // Update the Media record with the EndFile and EndBlock
+  Mmsg(cmd, "UPDATE Media SET EndFile=%lu, EndBlock=%lu WHERE MediaId=%lu",
+       jm->EndFile, jm->EndBlock, jm->MediaId);
+  queries[1].query = cmd;
+
+  Dmsg1(300, "%s\n", queries[0].query.c_str());
+  if (!SqlQueryPipeline(queries)) {
+    Jmsg(jcr, M_ERROR, 0, "%s", errmsg);
+    return false;
   }
+  if (queries[0].affected_rows != 1) {
+    Mmsg2(errmsg, T_("Create JobMedia record %s failed: ERR=%s\n"),
+          queries[0].query.c_str(), T_("no record inserted"));
+    return false;
+  }
+  changes += 2;
 
-  return false;
+  return true;
 }
 
 /**
@@ -809,9 +810,12 @@ bool BareosDb::WriteBatchFileRecords(JobControlRecord* jcr)
 
   /* clang-format off */
   if (!jcr->db_batch->SqlQuery(
-        "INSERT INTO File (FileIndex, JobId, PathId, Name, LStat, MD5, DeltaSeq, Fhinfo, Fhnode) "
+        "INSERT INTO File (FileIndex, JobId, PathId, Name, LStat, MD5, DeltaSeq, Fhinfo, Fhnode, "
+        "Size, MTime, Mode, NLink, Uid, Gid, Inode, LinkFI) "
         "SELECT batch.FileIndex, batch.JobId, Path.PathId, "
-        "batch.Name, batch.LStat, batch.MD5, batch.DeltaSeq, batch.Fhinfo, batch.Fhnode "
+        "batch.Name, batch.LStat, batch.MD5, batch.DeltaSeq, batch.Fhinfo, batch.Fhnode, "
+        "batch.Size, batch.MTime, batch.Mode, batch.NLink, batch.Uid, batch.Gid, "
+        "batch.Inode, batch.LinkFI "
         "FROM batch "
         "JOIN Path ON (batch.Path = Path.Path) ")) {
      Jmsg1(jcr, M_FATAL, 0, "Fill File table %s\n", errmsg);
@@ -919,6 +923,7 @@ bool BareosDb::CreateFileRecord(JobControlRecord* jcr, AttributesDbRecord* ar)
   bool retval = false;
   static const char* no_digest = "0";
   const char* digest;
+  PoolMem stat_columns(PM_NAME);
 
   ASSERT(ar->JobId);
   ASSERT(ar->PathId);
@@ -932,12 +937,25 @@ bool BareosDb::CreateFileRecord(JobControlRecord* jcr, AttributesDbRecord* ar)
     digest = ar->Digest;
   }
 
+  FileStatColumns columns;
+  if (fill_file_stat_columns_) { columns = DecodeFileStatColumns(ar->attr); }
+  if (columns.valid) {
+    Mmsg(stat_columns, "%llu,%lld,%u,%u,%u,%u,%lld,%d",
+         (unsigned long long)columns.Size, (long long)columns.MTime,
+         columns.Mode, columns.NLink, columns.Uid, columns.Gid,
+         (long long)columns.Inode, columns.LinkFI);
+  } else {
+    PmStrcpy(stat_columns, "NULL,NULL,NULL,NULL,NULL,NULL,NULL,NULL");
+  }
+
   /* clang-format off */
   Mmsg(cmd,
        "INSERT INTO File (FileIndex,JobId,PathId,Name,"
-       "LStat,MD5,DeltaSeq,Fhinfo,Fhnode) VALUES (%u,%u,%u,'%s','%s','%s',%u,%llu,%llu)",
+       "LStat,MD5,DeltaSeq,Fhinfo,Fhnode,Size,MTime,Mode,NLink,Uid,Gid,Inode,LinkFI) "
+       "VALUES (%u,%u,%u,'%s','%s','%s',%u,%llu,%llu,%s)",
        ar->FileIndex, ar->JobId, ar->PathId, esc_name,
-       ar->attr, digest, ar->DeltaSeq, ar->Fhinfo, ar->Fhnode);
+       ar->attr, digest, ar->DeltaSeq, ar->Fhinfo, ar->Fhnode,
+       stat_columns.c_str());
   /* clang-format on */
 
   ar->FileId = SqlInsertAutokeyRecord(cmd, NT_("File"));
@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2006 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2016 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -218,36 +218,43 @@ bool BareosDb::DeleteMediaRecord(JobControlRecord* jcr, MediaDbRecord* mr)
   return DELETE_DB(jcr, cmd) != -1;
 }
 
-void BareosDb::PurgeFiles(const char* jobids)
+/* Returns the number of File records removed. */
+int64_t BareosDb::PurgeFiles(const char* jobids)
 {
   if (strcmp(jobids, "") == 0) {
     Dmsg0(100, "No jobids to use for purging files\n");
-    return;
+    return 0;
   }
 
   PoolMem query(PM_MESSAGE);
+  int64_t files = 0;
 
   Mmsg(query, "DELETE FROM File WHERE JobId IN (%s)", jobids);
-  SqlQuery(query.c_str());
+  if (SqlQuery(query.c_str())) { files = SqlAffectedRows(); }
 
   Mmsg(query, "DELETE FROM BaseFiles WHERE JobId IN (%s)", jobids);
   SqlQuery(query.c_str());
 
   Mmsg(query, "UPDATE Job SET PurgedFiles=1 WHERE JobId IN (%s)", jobids);
   SqlQuery(query.c_str());
+
+  return files;
 }
 
-void BareosDb::PurgeJobs(const char* jobids)
+/* Returns the number of Job records removed, and that of the File records
+ * in files if given. */
+int64_t BareosDb::PurgeJobs(const char* jobids, int64_t* files)
 {
   PoolMem query(PM_MESSAGE);
 
   if (strcmp(jobids, "") == 0) {
     Dmsg0(100, "No jobids to purge\n");
-    return;
+    return 0;
   }
 
   /* Delete (or purge) records associated with the job */
-  PurgeFiles(jobids);
+  int64_t purged_files = PurgeFiles(jobids);
+  if (files) { *files = purged_files; }
 
   Mmsg(query, "DELETE FROM JobMedia WHERE JobId IN (%s)", jobids);
   SqlQuery(query.c_str());
@@ -271,6 +278,7 @@ void BareosDb::PurgeJobs(const char* jobids)
 
   /* Now remove the Job record itself */
   Mmsg(query, "DELETE FROM Job WHERE JobId IN (%s)", jobids);
-  SqlQuery(query.c_str());
+  if (!SqlQuery(query.c_str())) { return 0; }
+  return SqlAffectedRows();
 }
 #endif /* HAVE_POSTGRESQL */
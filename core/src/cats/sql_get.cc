@@ -1231,7 +1231,7 @@ bool BareosDb::GetFileList(JobControlRecord*,
    * Migration */
   Mmsg(query,
        "SELECT Path.Path, T1.Name, T1.FileIndex, T1.JobId, LStat, DeltaSeq, "
-       "MD5, Fhinfo, Fhnode "
+       "MD5, Fhinfo, Fhnode, Mode, NLink, LinkFI "
        "FROM ( %s ) AS T1 "
        "JOIN Path ON (Path.PathId = T1.PathId) "
        "WHERE FileIndex > 0 "
@@ -1391,7 +1391,7 @@ bool BareosDb::GetBaseFileList(JobControlRecord* jcr,
 
   Mmsg(query,
        "SELECT Path, Name, FileIndex, JobId, LStat, 0 As DeltaSeq, MD5, "
-       "Fhinfo, Fhnode "
+       "Fhinfo, Fhnode, NULL AS Mode, NULL AS NLink, NULL AS LinkFI "
        "FROM new_basefile%lld ORDER BY JobId, FileIndex ASC",
        (uint64_t)jcr->JobId);
 
@@ -1608,6 +1608,143 @@ bool BareosDb::GetQuotaRecord(JobControlRecord* jcr, ClientDbRecord* cdbr)
   return retval;
 }
 
+/**
+ * Get the number of seconds a replica of the catalog lags behind its primary.
+ * A replica that has replayed all it received has no lag, even when the last
+ * transaction it replayed is old, as does a database that is no replica.
+ *
+ * Returns false: on failure
+ *         true: on success
+ */
+bool BareosDb::GetReplicationLag(JobControlRecord* jcr, utime_t* lag)
+{
+  SQL_ROW row;
+  bool retval = false;
+
+  DbLocker _{this};
+
+  Mmsg(cmd,
+       "SELECT CASE WHEN NOT pg_is_in_recovery()"
+       " OR pg_last_wal_receive_lsn() = pg_last_wal_replay_lsn() THEN 0"
+       " ELSE COALESCE(CEIL(EXTRACT(EPOCH FROM"
+       " now() - pg_last_xact_replay_timestamp())), 0) END");
+  if (QUERY_DB(jcr, cmd)) {
+    if (SqlNumRows() == 1 && (row = SqlFetchRow()) != nullptr && row[0]) {
+      *lag = str_to_int64(row[0]);
+      retval = true;
+    }
+    SqlFreeResult();
+  }
+
+  if (!retval) {
+    Mmsg(errmsg, T_("Cannot get replication lag: ERR=%s\n"), sql_strerror());
+  }
+
+  return retval;
+}
+
+/**
+ * Get the current position in the write ahead log of the primary, or the
+ * position up to which a replica has replayed it.
+ *
+ * Returns false: on failure
+ *         true: on success
+ */
+bool BareosDb::GetWalPosition(JobControlRecord* jcr, std::string& position)
+{
+  SQL_ROW row;
+  bool retval = false;
+
+  DbLocker _{this};
+
+  Mmsg(cmd,
+       "SELECT CASE WHEN pg_is_in_recovery() THEN pg_last_wal_replay_lsn()"
+       " ELSE pg_current_wal_lsn() END");
+  if (QUERY_DB(jcr, cmd)) {
+    if (SqlNumRows() == 1 && (row = SqlFetchRow()) != nullptr && row[0]) {
+      position = row[0];
+      retval = true;
+    }
+    SqlFreeResult();
+  }
+
+  if (!retval) {
+    Mmsg(errmsg, T_("Cannot get WAL position: ERR=%s\n"), sql_strerror());
+  }
+
+  return retval;
+}
+
+/**
+ * Check whether a replica has replayed the write ahead log up to position,
+ * as returned by GetWalPosition() on the primary.
+ *
+ * Returns false: on failure or when it has not
+ *         true: when it has
+ */
+bool BareosDb::HasReplayedWalPosition(JobControlRecord* jcr,
+                                      const std::string& position)
+{
+  SQL_ROW row;
+  bool retval = false;
+  std::vector<char> esc(position.size() * 2 + 1);
+
+  DbLocker _{this};
+
+  EscapeString(jcr, esc.data(), position.c_str(), position.size());
+  Mmsg(cmd,
+       "SELECT CASE WHEN pg_is_in_recovery()"
+       " THEN pg_last_wal_replay_lsn() >= '%s'::pg_lsn ELSE true END",
+       esc.data());
+  if (QUERY_DB(jcr, cmd)) {
+    if (SqlNumRows() == 1 && (row = SqlFetchRow()) != nullptr && row[0]) {
+      retval = bstrcmp(row[0], "t");
+    }
+    SqlFreeResult();
+  }
+
+  return retval;
+}
+
+/**
+ * Get the status and bvfs cache state of the given jobs as one string, so
+ * a replica can be checked to show the jobs the same way as the primary.
+ *
+ * Returns false: on failure
+ *         true: on success
+ */
+bool BareosDb::GetJobsState(JobControlRecord* jcr,
+                            const char* jobids,
+                            std::string& state)
+{
+  SQL_ROW row;
+  bool retval = false;
+
+  DbLocker _{this};
+
+  state.clear();
+  Mmsg(cmd,
+       "SELECT JobId, JobStatus, HasCache FROM Job WHERE JobId IN (%s)"
+       " ORDER BY JobId",
+       jobids);
+  if (QUERY_DB(jcr, cmd)) {
+    while ((row = SqlFetchRow()) != nullptr) {
+      for (int i = 0; i < 3; i++) {
+        state += row[i] ? row[i] : "";
+        state += i < 2 ? ":" : " ";
+      }
+    }
+    SqlFreeResult();
+    retval = true;
+  }
+
+  if (!retval) {
+    Mmsg(errmsg, T_("Cannot get job state: ERR=%s\n"), sql_strerror());
+  }
+
+  return retval;
+}
+
 /**
  * Fetch the NDMP Dump Level value.
  *
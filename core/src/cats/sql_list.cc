@@ -599,18 +599,42 @@ void BareosDb::ListJobRecords(JobControlRecord* jcr,
   SqlFreeResult();
 }
 
+/* The totals are read from JobSummary, which the catalog keeps up to date
+ * with the Job table, so this does not scan all jobs. */
 void BareosDb::ListJobTotals(JobControlRecord* jcr,
                              JobDbRecord*,
-                             OutputFormatter* sendit)
+                             OutputFormatter* sendit,
+                             JobTotalsGrouping grouping)
 {
   DbLocker _{this};
 
-  // List by Job
   // JobTypes BACKUP(B),ARCHIVE(A,a), JOB_COPY(C)
-  Mmsg(cmd,
-       "SELECT COUNT(*) AS Jobs, SUM(JobFiles) "
-       "AS Files, SUM(JobBytes) AS Bytes, Name AS Job FROM Job WHERE Type IN "
-       "('B','A','a','C') GROUP BY Name");
+  switch (grouping) {
+    case JobTotalsGrouping::kByJob:
+      Mmsg(cmd,
+           "SELECT SUM(Jobs) AS Jobs, SUM(JobFiles) AS Files, "
+           "SUM(JobBytes) AS Bytes, Name AS Job FROM JobSummary "
+           "WHERE Type IN ('B','A','a','C') GROUP BY Name");
+      break;
+    case JobTotalsGrouping::kByClient:
+      Mmsg(cmd,
+           "SELECT SUM(Jobs) AS Jobs, SUM(JobFiles) AS Files, "
+           "SUM(JobBytes) AS Bytes, MAX(LastSuccess) AS LastSuccess, "
+           "Client.Name AS Client FROM JobSummary "
+           "LEFT JOIN Client USING (ClientId) "
+           "WHERE Type IN ('B','A','a','C') "
+           "GROUP BY ClientId, Client.Name ORDER BY Client.Name");
+      break;
+    case JobTotalsGrouping::kByPool:
+      Mmsg(cmd,
+           "SELECT SUM(Jobs) AS Jobs, SUM(JobFiles) AS Files, "
+           "SUM(JobBytes) AS Bytes, MAX(LastSuccess) AS LastSuccess, "
+           "Pool.Name AS Pool FROM JobSummary "
+           "LEFT JOIN Pool USING (PoolId) "
+           "WHERE Type IN ('B','A','a','C') "
+           "GROUP BY PoolId, Pool.Name ORDER BY Pool.Name");
+      break;
+  }
 
   if (!QUERY_DB(jcr, cmd)) { return; }
 
@@ -623,9 +647,9 @@ void BareosDb::ListJobTotals(JobControlRecord* jcr,
   // Do Grand Total
   // JobTypes BACKUP(B),ARCHIVE(A,a), JOB_COPY(C)
   Mmsg(cmd,
-       "SELECT COUNT(*) AS Jobs, SUM(JobFiles) "
-       "AS Files, SUM(JobBytes) AS Bytes FROM Job WHERE Type IN "
-       "('B','A','a','C')");
+       "SELECT COALESCE(SUM(Jobs), 0) AS Jobs, SUM(JobFiles) AS Files, "
+       "SUM(JobBytes) AS Bytes FROM JobSummary "
+       "WHERE Type IN ('B','A','a','C')");
 
   if (!QUERY_DB(jcr, cmd)) { return; }
 
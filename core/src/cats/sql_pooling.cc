@@ -3,7 +3,7 @@
 
    Copyright (C) 2010-2012 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2016 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -31,6 +31,251 @@
 #if HAVE_POSTGRESQL
 
 #  include "cats.h"
+#  include "sql_pooling.h"
+
+#  include <algorithm>
+#  include <memory>
+#  include <mutex>
+
+namespace {
+
+// A connection owned by a pool.
+struct SqlPoolEntry {
+  BareosDb* db_handle = nullptr;
+  bool batch = false;        /**< Member of the batch sub-pool */
+  bool busy = false;         /**< Being checked before it is handed out */
+  bool needs_reset = false;  /**< Handed out since the last session reset */
+  time_t last_used = 0;      /**< Last handed out or put back */
+  time_t last_validated = 0; /**< Last time the connection was known to work */
+};
+
+/*
+ * The connection pool of a catalog (one defined per Catalog resource). It has
+ * two sub-pools: interactive connections can be shared by several users like
+ * the single connection used without pooling, batch connections
+ * (mult_db_connections) have transactions and are used by one user at a time.
+ */
+struct SqlPoolDescriptor {
+  SqlPoolDescriptor() = default;
+  SqlPoolDescriptor(const SqlPoolDescriptor&) = delete;
+  SqlPoolDescriptor& operator=(const SqlPoolDescriptor&) = delete;
+  ~SqlPoolDescriptor();
+
+  bool active = true; /**< After a config reload a pool is made inactive */
+  char* db_driver = nullptr;
+  char* db_name = nullptr;
+  char* db_user = nullptr;
+  char* db_password = nullptr;
+  char* db_address = nullptr;
+  char* db_socket = nullptr;
+  int db_port = 0;
+  bool disable_batch_insert = false;
+  bool try_reconnect = false;
+  bool exit_on_fatal = false;
+  int min_connections = 0;
+  int max_connections = 0;
+  int increment_connections = 0;
+  int idle_timeout = 0;     /**< Seconds before an idle connection is closed */
+  int validate_timeout = 0; /**< Seconds before an idle connection is checked */
+  int opening = 0;          /**< Connections being opened right now */
+  std::vector<std::unique_ptr<SqlPoolEntry>> entries;
+  SqlPoolStatistics statistics;
+};
+
+SqlPoolDescriptor::~SqlPoolDescriptor()
+{
+  for (char* value :
+       {db_driver, db_name, db_user, db_password, db_address, db_socket}) {
+    if (value) { free(value); }
+  }
+}
+
+}  // namespace
+
+static std::vector<std::unique_ptr<SqlPoolDescriptor>> pools;
+static std::mutex pool_mutex;
+
+static char* DupOrNull(const char* value)
+{
+  return value ? strdup(value) : nullptr;
+}
+
+/*
+ * A pooled connection holds one reference for the pool, every user of it
+ * holds another one.
+ */
+static bool InUse(const SqlPoolEntry* entry)
+{
+  return entry->busy || entry->db_handle->GetRefcount() > 1;
+}
+
+static SqlPoolDescriptor* FindPool(const char* db_name,
+                                   const char* db_user,
+                                   const char* db_address,
+                                   int db_port,
+                                   const char* db_socket)
+{
+  for (auto& pool : pools) {
+    if (pool->active && bstrcmp(pool->db_name, db_name)
+        && bstrcmp(pool->db_user, db_user)
+        && bstrcmp(pool->db_address, db_address) && pool->db_port == db_port
+        && bstrcmp(pool->db_socket, db_socket)) {
+      return pool.get();
+    }
+  }
+
+  return nullptr;
+}
+
+static SqlPoolEntry* FindEntry(BareosDb* mdb, SqlPoolDescriptor** pool_out)
+{
+  for (auto& pool : pools) {
+    for (auto& entry : pool->entries) {
+      if (entry->db_handle == mdb) {
+        *pool_out = pool.get();
+        return entry.get();
+      }
+    }
+  }
+
+  return nullptr;
+}
+
+// Most recently used idle connection, so the others can time out.
+static SqlPoolEntry* FindIdleEntry(SqlPoolDescriptor* pool, bool batch)
+{
+  SqlPoolEntry* found = nullptr;
+
+  for (auto& entry : pool->entries) {
+    if (entry->batch == batch && !InUse(entry.get())
+        && (!found || entry->last_used > found->last_used)) {
+      found = entry.get();
+    }
+  }
+
+  return found;
+}
+
+static SqlPoolEntry* FindLeastUsedInteractiveEntry(SqlPoolDescriptor* pool)
+{
+  SqlPoolEntry* found = nullptr;
+
+  for (auto& entry : pool->entries) {
+    if (!entry->batch && !entry->busy
+        && (!found
+            || entry->db_handle->GetRefcount()
+                   < found->db_handle->GetRefcount())) {
+      found = entry.get();
+    }
+  }
+
+  return found;
+}
+
+static SqlPoolEntry* AddEntry(SqlPoolDescriptor* pool,
+                              BareosDb* mdb,
+                              bool batch)
+{
+  auto entry = std::make_unique<SqlPoolEntry>();
+
+  entry->db_handle = mdb;
+  entry->batch = batch;
+  entry->last_used = entry->last_validated = time(nullptr);
+  pool->entries.push_back(std::move(entry));
+
+  return pool->entries.back().get();
+}
+
+static void RemoveEntry(SqlPoolDescriptor* pool,
+                        SqlPoolEntry* entry,
+                        std::vector<BareosDb*>& to_close)
+{
+  to_close.push_back(entry->db_handle);
+  pool->entries.erase(std::find_if(
+      pool->entries.begin(), pool->entries.end(),
+      [entry](const auto& other) { return other.get() == entry; }));
+}
+
+/*
+ * Take the idle connections out of a pool that were not used for longer than
+ * the idle timeout, keeping min_connections open. When all is set every idle
+ * connection is taken out. The connections must be closed after unlocking.
+ */
+static void TakeIdleConnections(SqlPoolDescriptor* pool,
+                                std::vector<BareosDb*>& to_close,
+                                bool all)
+{
+  time_t now = time(nullptr);
+  int connections = pool->entries.size();
+
+  for (auto it = pool->entries.begin(); it != pool->entries.end();) {
+    SqlPoolEntry* entry = it->get();
+
+    if (!InUse(entry)
+        && (all
+            || (pool->idle_timeout > 0
+                && connections > pool->min_connections
+                && now - entry->last_used > pool->idle_timeout))) {
+      if (!all) { pool->statistics.idle_closed++; }
+      to_close.push_back(entry->db_handle);
+      it = pool->entries.erase(it);
+      connections--;
+    } else {
+      ++it;
+    }
+  }
+}
+
+// Drop the pools of a previous configuration once all connections are back.
+static void RemoveRetiredPools()
+{
+  pools.erase(std::remove_if(pools.begin(), pools.end(),
+                             [](const auto& pool) {
+                               return !pool->active && pool->entries.empty();
+                             }),
+              pools.end());
+}
+
+static void CloseConnections(std::vector<BareosDb*>& to_close)
+{
+  for (BareosDb* mdb : to_close) { mdb->CloseDatabase(nullptr); }
+  to_close.clear();
+}
+
+/*
+ * Pooled connections are opened as private connections, so the shared
+ * connection handling of db_init_database() never hands them out.
+ */
+static BareosDb* OpenConnection(JobControlRecord* jcr,
+                                const SqlPoolDescriptor* pool,
+                                bool batch)
+{
+  return DbSqlGetNonPooledConnection(
+      jcr, pool->db_driver, pool->db_name, pool->db_user, pool->db_password,
+      pool->db_address, pool->db_port, pool->db_socket, batch,
+      pool->disable_batch_insert, pool->try_reconnect, pool->exit_on_fatal,
+      true);
+}
+
+/*
+ * Make an idle connection ready for its next user. What the previous user
+ * left behind is reset, which also shows the connection still works.
+ * Otherwise it is checked when it was not used for validate_timeout seconds.
+ */
+static bool PrepareConnection(const SqlPoolDescriptor* pool,
+                              SqlPoolEntry* entry)
+{
+  time_t now = time(nullptr);
+
+  if (entry->needs_reset) {
+    if (!entry->db_handle->ResetSession()) { return false; }
+  } else if (now - entry->last_validated >= pool->validate_timeout) {
+    if (!entry->db_handle->ValidateConnection()) { return false; }
+  }
+  entry->last_validated = now;
+
+  return true;
+}
 
 /**
  * Get a non-pooled connection used when either sql pooling is
@@ -73,43 +318,130 @@ BareosDb* DbSqlGetNonPooledConnection(JobControlRecord* jcr,
 }
 
 /**
- * Initialize the sql connection pool.
- * For non pooling this is a no-op.
+ * Initialize the sql connection pool of a catalog and open its
+ * min_connections connections. A max_connections of 0 disables pooling.
  */
-bool db_sql_pool_initialize(const char*,
-                            const char*,
-                            const char*,
-                            const char*,
-                            const char*,
-                            int,
-                            const char*,
-                            bool,
-                            bool,
-                            bool,
-                            int,
-                            int,
-                            int,
-                            int,
-                            int)
+bool db_sql_pool_initialize(const char* db_drivername,
+                            const char* db_name,
+                            const char* db_user,
+                            const char* db_password,
+                            const char* db_address,
+                            int db_port,
+                            const char* db_socket,
+                            bool disable_batch_insert,
+                            bool try_reconnect,
+                            bool exit_on_fatal,
+                            int min_connections,
+                            int max_connections,
+                            int increment_connections,
+                            int idle_timeout,
+                            int validate_timeout)
 {
+  if (max_connections <= 0) { return true; }
+
+  std::unique_lock<std::mutex> lock(pool_mutex);
+  SqlPoolDescriptor* pool
+      = FindPool(db_name, db_user, db_address, db_port, db_socket);
+
+  if (!pool) {
+    pools.push_back(std::make_unique<SqlPoolDescriptor>());
+    pool = pools.back().get();
+    pool->db_driver = DupOrNull(db_drivername);
+    pool->db_name = DupOrNull(db_name);
+    pool->db_user = DupOrNull(db_user);
+    pool->db_password = DupOrNull(db_password);
+    pool->db_address = DupOrNull(db_address);
+    pool->db_socket = DupOrNull(db_socket);
+    pool->db_port = db_port;
+    pool->statistics.db_name = db_name ? db_name : "";
+    pool->statistics.db_address = db_address ? db_address : "";
+    pool->statistics.db_port = db_port;
+  }
+  pool->disable_batch_insert = disable_batch_insert;
+  pool->try_reconnect = try_reconnect;
+  pool->exit_on_fatal = exit_on_fatal;
+  pool->max_connections = max_connections;
+  pool->min_connections = std::min(min_connections, max_connections);
+  pool->increment_connections = std::max(increment_connections, 1);
+  pool->idle_timeout = idle_timeout;
+  pool->validate_timeout = validate_timeout;
+  pool->statistics.min_connections = pool->min_connections;
+  pool->statistics.max_connections = pool->max_connections;
+
+  int wanted = pool->min_connections - (int)pool->entries.size();
+  if (wanted <= 0) { return true; }
+
+  /* The connections are opened without holding the lock. If the database
+   * can't be reached now, connections get opened when they are needed. */
+  std::vector<BareosDb*> opened;
+  pool->opening += wanted;
+  lock.unlock();
+  for (int i = 0; i < wanted; i++) {
+    BareosDb* mdb = OpenConnection(nullptr, pool, false);
+
+    if (!mdb) { break; }
+    opened.push_back(mdb);
+  }
+  lock.lock();
+  pool->opening -= wanted;
+  for (BareosDb* mdb : opened) { AddEntry(pool, mdb, false); }
+  pool->statistics.opened += opened.size();
+
+  Dmsg3(100, "sql pool for database %s: %d of %d connections opened\n",
+        db_name, (int)opened.size(), wanted);
+
   return true;
 }
 
-/**
- * Cleanup the sql connection pools.
- * For non pooling this is a no-op.
- */
-void DbSqlPoolDestroy(void) {}
+// Cleanup the sql connection pools.
+void DbSqlPoolDestroy(void)
+{
+  std::vector<BareosDb*> to_close;
+
+  {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+
+    for (auto& pool : pools) {
+      for (auto& entry : pool->entries) {
+        to_close.push_back(entry->db_handle);
+      }
+    }
+    pools.clear();
+  }
+
+  CloseConnections(to_close);
+}
 
 /**
- * Flush the sql connection pools.
- * For non pooling this is a no-op.
+ * Flush the sql connection pools before a config reload. The pools are made
+ * inactive, idle connections are closed right away, the others when they
+ * are put back.
  */
-void DbSqlPoolFlush(void) {}
+void DbSqlPoolFlush(void)
+{
+  std::vector<BareosDb*> to_close;
+
+  {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+
+    for (auto& pool : pools) {
+      pool->active = false;
+      TakeIdleConnections(pool.get(), to_close, true);
+    }
+    RemoveRetiredPools();
+  }
+
+  CloseConnections(to_close);
+}
 
 /**
- * Get a new connection from the pool.
- * For non pooling we just call DbSqlGetNonPooledConnection.
+ * Get a connection from the pool.
+ *
+ * Batch connections (mult_db_connections) are used by one user at a time.
+ * Interactive connections are handed out idle when possible, but when the
+ * pool is full they are shared like the single connection used without
+ * pooling. When there is no pool for the database, or a batch connection is
+ * needed with the pool being full, a non pooled connection is returned.
  */
 BareosDb* DbSqlGetPooledConnection(JobControlRecord* jcr,
                                    const char* db_drivername,
@@ -125,19 +457,170 @@ BareosDb* DbSqlGetPooledConnection(JobControlRecord* jcr,
                                    bool exit_on_fatal,
                                    bool need_private)
 {
-  return DbSqlGetNonPooledConnection(
-      jcr, db_drivername, db_name, db_user, db_password, db_address, db_port,
-      db_socket, mult_db_connections, disable_batch_insert, try_reconnect,
-      exit_on_fatal, need_private);
+  std::vector<BareosDb*> to_close;
+  std::unique_lock<std::mutex> lock(pool_mutex);
+  bool batch = mult_db_connections;
+  BareosDb* mdb = nullptr;
+  SqlPoolDescriptor* pool = nullptr;
+
+  // Private connections without transactions are not pooled.
+  if (batch || !need_private) {
+    pool = FindPool(db_name, db_user, db_address, db_port, db_socket);
+  }
+
+  if (pool) {
+    pool->statistics.requests++;
+    TakeIdleConnections(pool, to_close, false);
+  }
+
+  while (pool) {
+    SqlPoolEntry* entry = FindIdleEntry(pool, batch);
+
+    if (entry) {
+      entry->busy = true;
+      entry->db_handle->IncrementRefcount();
+      lock.unlock();
+      bool usable = PrepareConnection(pool, entry);
+      lock.lock();
+      entry->busy = false;
+
+      if (!usable) {
+        Dmsg1(100, "Dropping broken pooled connection to database %s\n",
+              db_name);
+        pool->statistics.invalid++;
+        entry->db_handle->CloseDatabase(jcr);
+        RemoveEntry(pool, entry, to_close);
+        continue;
+      }
+
+      pool->statistics.reused++;
+      entry->needs_reset = true;
+      entry->last_used = time(nullptr);
+      mdb = entry->db_handle;
+      break;
+    }
+
+    int room = pool->max_connections - (int)pool->entries.size()
+               - pool->opening;
+    if (room > 0) {
+      int wanted = std::min(pool->increment_connections, room);
+      std::vector<BareosDb*> opened;
+
+      /* Open the connections without holding the lock, the first one is for
+       * the caller, the others are put on the pool. */
+      pool->opening += wanted;
+      lock.unlock();
+      for (int i = 0; i < wanted; i++) {
+        BareosDb* opened_mdb = OpenConnection(i == 0 ? jcr : nullptr, pool,
+                                              batch);
+
+        if (!opened_mdb) { break; }
+        opened.push_back(opened_mdb);
+      }
+      lock.lock();
+      pool->opening -= wanted;
+      pool->statistics.opened += opened.size();
+
+      for (BareosDb* opened_mdb : opened) {
+        SqlPoolEntry* added = AddEntry(pool, opened_mdb, batch);
+
+        if (!mdb) {
+          added->needs_reset = true;
+          mdb = opened_mdb;
+          mdb->IncrementRefcount();
+        }
+      }
+      break;
+    }
+
+    if (!batch && (entry = FindLeastUsedInteractiveEntry(pool))) {
+      pool->statistics.shared++;
+      entry->last_used = time(nullptr);
+      mdb = entry->db_handle;
+      mdb->IncrementRefcount();
+      break;
+    }
+
+    pool->statistics.unpooled++;
+    pool = nullptr;
+  }
+
+  lock.unlock();
+  CloseConnections(to_close);
+
+  if (!pool) {
+    return DbSqlGetNonPooledConnection(
+        jcr, db_drivername, db_name, db_user, db_password, db_address, db_port,
+        db_socket, mult_db_connections, disable_batch_insert, try_reconnect,
+        exit_on_fatal, need_private);
+  }
+
+  return mdb;
 }
 
 /**
- * Put a connection back onto the pool for reuse.
- * For non pooling we just do a CloseDatabase.
+ * Put a connection back onto the pool for reuse. Connections that are not
+ * from a pool are closed. With abort the connection is not reused.
  */
-void DbSqlClosePooledConnection(JobControlRecord* jcr, BareosDb* mdb, bool)
+void DbSqlClosePooledConnection(JobControlRecord* jcr,
+                                BareosDb* mdb,
+                                bool abort)
 {
+  std::vector<BareosDb*> to_close;
+  std::unique_lock<std::mutex> lock(pool_mutex);
+  SqlPoolDescriptor* pool = nullptr;
+
+  if (!FindEntry(mdb, &pool)) {
+    lock.unlock();
+    mdb->CloseDatabase(jcr);
+    return;
+  }
+
+  // Commit without holding the lock, as that can take a while.
+  lock.unlock();
+  mdb->EndTransaction(jcr);
+  lock.lock();
+
+  SqlPoolEntry* entry = FindEntry(mdb, &pool);
   mdb->CloseDatabase(jcr);
+  if (!entry) { return; }
+
+  entry->last_used = time(nullptr);
+  if ((abort || !pool->active) && !InUse(entry)) {
+    RemoveEntry(pool, entry, to_close);
+  }
+  if (pool->active) { TakeIdleConnections(pool, to_close, false); }
+  RemoveRetiredPools();
+
+  lock.unlock();
+  CloseConnections(to_close);
+}
+
+// Get the usage of the connection pools.
+std::vector<SqlPoolStatistics> DbSqlPoolStatistics(void)
+{
+  std::vector<SqlPoolStatistics> statistics;
+  std::lock_guard<std::mutex> lock(pool_mutex);
+
+  for (auto& pool : pools) {
+    if (!pool->active) { continue; }
+
+    SqlPoolStatistics current = pool->statistics;
+    for (auto& entry : pool->entries) {
+      bool in_use = InUse(entry.get());
+
+      if (entry->batch) {
+        current.batch_connections++;
+        if (in_use) { current.batch_in_use++; }
+      } else {
+        current.interactive_connections++;
+        if (in_use) { current.interactive_in_use++; }
+      }
+    }
+    statistics.push_back(current);
+  }
+
+  return statistics;
 }
 
 #endif /* HAVE_POSTGRESQL */
@@ -1,7 +1,7 @@
 /*
    BAREOS® - Backup Archiving REcovery Open Sourced
 
-   Copyright (C) 2018-2019 Bareos GmbH & Co. KG
+   Copyright (C) 2018-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -21,8 +21,32 @@
 #ifndef BAREOS_CATS_SQL_POOLING_H_
 #define BAREOS_CATS_SQL_POOLING_H_
 
+#include <cstdint>
+#include <string>
+#include <vector>
+
 class BareosDb;
 
+// Usage of the connection pool of one catalog, see "status director".
+struct SqlPoolStatistics {
+  std::string db_name;
+  std::string db_address;
+  int db_port = 0;
+  int min_connections = 0;
+  int max_connections = 0;
+  int interactive_connections = 0; /**< Connections that can be shared */
+  int interactive_in_use = 0;
+  int batch_connections = 0; /**< Connections used by one user at a time */
+  int batch_in_use = 0;
+  uint64_t requests = 0; /**< Connections asked for */
+  uint64_t reused = 0;   /**< Served by an idle pooled connection */
+  uint64_t shared = 0;   /**< Served by sharing a busy interactive one */
+  uint64_t opened = 0;   /**< Connections opened by the pool */
+  uint64_t unpooled = 0; /**< Served by a connection outside of the pool */
+  uint64_t invalid = 0;  /**< Idle connections that failed the health check */
+  uint64_t idle_closed = 0; /**< Connections closed after the idle timeout */
+};
+
 bool db_sql_pool_initialize(const char* db_drivername,
                             const char* db_name,
                             const char* db_user,
@@ -69,5 +93,6 @@ BareosDb* DbSqlGetPooledConnection(JobControlRecord* jcr,
 void DbSqlClosePooledConnection(JobControlRecord* jcr,
                                 BareosDb* mdb,
                                 bool abort = false);
+std::vector<SqlPoolStatistics> DbSqlPoolStatistics(void);
 
 #endif  // BAREOS_CATS_SQL_POOLING_H_
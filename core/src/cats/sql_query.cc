@@ -2,7 +2,7 @@
    BAREOS® - Backup Archiving REcovery Open Sourced
 
    Copyright (C) 2016-2016 Planets Communications B.V.
-   Copyright (C) 2016-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2016-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -155,4 +155,48 @@ bool BareosDb::SqlQuery(const char* query,
 
   return retval;
 }
+
+/**
+ * Execute a batch of statements, each of them a single SQL statement.
+ * Backends that support it send all statements to the server before
+ * waiting for the first result, so the batch costs one round trip instead
+ * of one per statement. The statements then run in one implicit
+ * transaction (unless a transaction is already open): if one fails, the
+ * ones before are rolled back and the ones after are not executed.
+ * Otherwise they are executed one after the other, stopping at the first
+ * one that fails.
+ *
+ * Returns: true if all statements succeeded
+ */
+bool BareosDb::SqlQueryPipeline(std::vector<PipelinedQuery>& queries)
+{
+  Dmsg2(debuglevel, "called: %s with %d queries\n", __PRETTY_FUNCTION__,
+        (int)queries.size());
+
+  DbLocker _{this};
+  for (auto& query : queries) { query.affected_rows = -1; }
+  return SqlQueryPipelineWithHandlers(queries);
+}
+
+bool BareosDb::SqlQueryPipelineWithHandlers(
+    std::vector<PipelinedQuery>& queries)
+{
+  for (auto& query : queries) {
+    if (!SqlQueryWithoutHandler(query.query.c_str(), QF_STORE_RESULT)) {
+      Mmsg(errmsg, T_("Query failed: %s: ERR=%s\n"), query.query.c_str(),
+           sql_strerror());
+      return false;
+    }
+    query.affected_rows = SqlAffectedRows();
+    if (query.ResultHandler) {
+      SQL_ROW row;
+      while ((row = SqlFetchRow()) != nullptr) {
+        if (query.ResultHandler(query.ctx, SqlNumFields(), row)) { break; }
+      }
+    }
+    SqlFreeResult();
+  }
+
+  return true;
+}
 #endif /* HAVE_POSTGRESQL */
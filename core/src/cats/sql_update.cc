@@ -298,6 +298,10 @@ bool BareosDb::UpdateMediaRecord(JobControlRecord* jcr, MediaDbRecord* mr)
   EscapeString(jcr, esc_medianame, mr->VolumeName, strlen(mr->VolumeName));
   EscapeString(jcr, esc_status, mr->VolStatus, strlen(mr->VolStatus));
 
+  /* All updates of the record are sent to the database together, this is
+   * done at every volume change of a job. */
+  std::vector<PipelinedQuery> queries;
+
   if (mr->set_first_written) {
     Dmsg1(400, "Set FirstWritten Vol=%s\n", mr->VolumeName);
     ttime = mr->FirstWritten;
@@ -306,7 +310,7 @@ bool BareosDb::UpdateMediaRecord(JobControlRecord* jcr, MediaDbRecord* mr)
          "UPDATE Media SET FirstWritten='%s' "
          "WHERE VolumeName='%s'",
          dt, esc_medianame);
-    UPDATE_DB(jcr, cmd);
+    queries.push_back({cmd});
     Dmsg1(400, "Firstwritten=%d\n", mr->FirstWritten);
   }
 
@@ -319,7 +323,7 @@ bool BareosDb::UpdateMediaRecord(JobControlRecord* jcr, MediaDbRecord* mr)
          "UPDATE Media SET LabelDate='%s' "
          "WHERE VolumeName='%s'",
          dt, esc_medianame);
-    UPDATE_DB(jcr, cmd);
+    queries.push_back({cmd});
   }
 
   if (mr->LastWritten != 0) {
@@ -329,7 +333,7 @@ bool BareosDb::UpdateMediaRecord(JobControlRecord* jcr, MediaDbRecord* mr)
          "UPDATE Media Set LastWritten='%s' "
          "WHERE VolumeName='%s'",
          dt, esc_medianame);
-    UPDATE_DB(jcr, cmd);
+    queries.push_back({cmd});
   }
 
   Mmsg(cmd,
@@ -356,13 +360,19 @@ bool BareosDb::UpdateMediaRecord(JobControlRecord* jcr, MediaDbRecord* mr)
        mr->ActionOnPurge, mr->MinBlocksize, mr->MaxBlocksize, esc_medianame);
 
   Dmsg1(400, "%s\n", cmd);
-
-  bool retval = UPDATE_DB(jcr, cmd) > 0;
+  queries.push_back({cmd});
+  std::size_t media_update = queries.size() - 1;
 
   // Make sure InChanger is 0 for any record having the same Slot
-  MakeInchangerUnique(jcr, mr);
+  if (MakeInchangerUniqueQuery(jcr, mr)) { queries.push_back({cmd}); }
 
-  return retval;
+  if (!SqlQueryPipeline(queries)) {
+    Jmsg(jcr, M_ERROR, 0, "%s", errmsg);
+    return false;
+  }
+  changes += queries.size();
+
+  return queries[media_update].affected_rows > 0;
 }
 
 /**
@@ -415,6 +425,17 @@ bool BareosDb::UpdateMediaDefaults(JobControlRecord* jcr, MediaDbRecord* mr)
  * This routine assumes the database is already locked.
  */
 void BareosDb::MakeInchangerUnique(JobControlRecord* jcr, MediaDbRecord* mr)
+{
+  if (MakeInchangerUniqueQuery(jcr, mr)) {
+    Dmsg1(100, "%s\n", cmd);
+    UPDATE_DB(jcr, cmd);
+  }
+}
+
+/* Put the query for MakeInchangerUnique() into cmd, returns false if there
+ * is nothing to do. */
+bool BareosDb::MakeInchangerUniqueQuery(JobControlRecord* jcr,
+                                        MediaDbRecord* mr)
 {
   char ed1[50], ed2[50];
   char esc[MAX_ESCAPE_NAME_LENGTH];
@@ -439,9 +460,9 @@ void BareosDb::MakeInchangerUnique(JobControlRecord* jcr, MediaDbRecord* mr)
            "Slot=%d AND StorageId=%s",
            mr->Slot, edit_int64(mr->StorageId, ed1), mr->VolumeName);
     }
-    Dmsg1(100, "%s\n", cmd);
-    UPDATE_DB(jcr, cmd);
+    return true;
   }
+  return false;
 }
 
 /**
@@ -71,7 +71,8 @@ static char OKpassiveclient[] = "2000 OK passive client\n";
 static char EndJob[]
     = "2800 End Job TermCode=%d JobFiles=%u "
       "ReadBytes=%llu JobBytes=%llu Errors=%u "
-      "VSS=%d Encrypt=%d\n";
+      "VSS=%d Encrypt=%d "
+      "CompressSkipped=%llu CompressCpuSaved=%llu\n";
 
 static inline bool ValidateClient(JobControlRecord* jcr)
 {
@@ -203,6 +204,10 @@ static bool GetBaseJobids(JobControlRecord* jcr, db_list_ctx* jobids)
  * Foreach files in currrent list, send "/path/fname\0LStat\0MD5\0Delta" to FD
  *      row[0]=Path, row[1]=Filename, row[2]=FileIndex
  *      row[3]=JobId row[4]=LStat row[5]=DeltaSeq row[6]=MD5
+ *      row[7]=Fhinfo row[8]=Fhnode row[9]=Mode row[10]=NLink row[11]=LinkFI
+ * Without checksums MD5 is left out of the query and the fields shift.
+ * The FD compares all stat fields, so LStat is sent and not the typed
+ * File columns.
  */
 static int AccurateListHandler(void* ctx, int num_fields, char** row)
 {
@@ -215,7 +220,7 @@ static int AccurateListHandler(void* ctx, int num_fields, char** row)
   }
 
   /* sending with checksum */
-  if (jcr->dir_impl->use_accurate_chksum && num_fields == 9 && row[6][0]
+  if (jcr->dir_impl->use_accurate_chksum && num_fields == 12 && row[6][0]
       && /* skip checksum = '0' */
       row[6][1]) {
     jcr->file_bsock->fsend("%s%s%c%s%c%s%c%s", row[0], row[1], 0, row[4], 0,
@@ -645,6 +650,8 @@ int WaitForJobTermination(JobControlRecord* jcr, int timeout)
   uint64_t JobBytes = 0;
   int VSS = 0;
   int Encrypt = 0;
+  uint64_t CompressSkipped = 0;
+  uint64_t CompressCpuSaved = 0;
   btimer_t* tid = nullptr;
 
   jcr->setJobStatusWithPriorityCheck(JS_Running);
@@ -658,8 +665,9 @@ int WaitForJobTermination(JobControlRecord* jcr, int timeout)
     while ((n = BgetDirmsg(fd)) >= 0) {
       if (!fd_ok
           && sscanf(fd->msg, EndJob, &jcr->dir_impl->FDJobStatus, &JobFiles,
-                    &ReadBytes, &JobBytes, &JobErrors, &VSS, &Encrypt)
-                 == 7) {
+                    &ReadBytes, &JobBytes, &JobErrors, &VSS, &Encrypt,
+                    &CompressSkipped, &CompressCpuSaved)
+                 >= 7) { /* older clients do not send the compression stats */
         fd_ok = true;
         jcr->setJobStatusWithPriorityCheck(jcr->dir_impl->FDJobStatus);
         Dmsg1(100, "FDStatus=%c\n", (char)jcr->getJobStatus());
@@ -708,6 +716,8 @@ int WaitForJobTermination(JobControlRecord* jcr, int timeout)
     jcr->JobWarnings = JobWarnings;
     jcr->dir_impl->VSS = VSS;
     jcr->dir_impl->Encrypt = Encrypt;
+    jcr->dir_impl->FDCompressSkipped = CompressSkipped;
+    jcr->dir_impl->FDCompressCpuSaved = CompressCpuSaved;
   } else {
     Jmsg(jcr, M_FATAL, 0, T_("No Job status returned from FD.\n"));
   }
@@ -1086,6 +1096,14 @@ void GenerateBackupSummary(JobControlRecord *jcr, ClientDbRecord *cr, int msg_ty
                  jcr->accurate ? T_("yes") : T_("no"));
          }
 
+         if (jcr->dir_impl->FDCompressSkipped) {
+            Mmsg(temp, T_("  Compression Skipped:    %s (%sB), %.1f s cpu saved\n"),
+                 edit_uint64_with_commas(jcr->dir_impl->FDCompressSkipped, ec1),
+                 edit_uint64_with_suffix(jcr->dir_impl->FDCompressSkipped, ec2),
+                 jcr->dir_impl->FDCompressCpuSaved / 1000.0);
+            PmStrcat(client_options, temp.c_str());
+         }
+
          Mmsg(daemon_status, T_(
               "  Non-fatal FD errors:    %d\n"
               "  SD Errors:              %d\n"
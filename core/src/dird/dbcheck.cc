@@ -3,7 +3,7 @@
 
    Copyright (C) 2002-2011 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2016 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -35,6 +35,7 @@
 #include "lib/util.h"
 
 #include "dbcheck_utils.h"
+#include "dbcheck_bulk.h"
 
 using namespace directordaemon;
 
@@ -828,6 +829,29 @@ int main(int argc, char* argv[])
 
   dbcheck_app.add_flag("-f,--fix", fix, "Fix inconsistencies.");
 
+  bool bulk = false;
+  auto bulk_flag = dbcheck_app.add_flag(
+      "--bulk", bulk,
+      "Only run the orphaned record checks, as set based statements on the "
+      "database server. Without --fix the orphans are only counted.");
+
+  BulkCheckOptions bulk_options;
+  dbcheck_app
+      .add_option("--bulk-batch-size", bulk_options.batch_size,
+                  "Number of ids handled per statement in bulk mode "
+                  "(default: 100000).")
+      ->check(CLI::PositiveNumber)
+      ->needs(bulk_flag)
+      ->type_name("<ids>");
+
+  dbcheck_app
+      .add_option("--bulk-connections", bulk_options.connections,
+                  "Number of independent checks run concurrently in bulk "
+                  "mode, each on its own database connection (default: 4).")
+      ->check(CLI::PositiveNumber)
+      ->needs(bulk_flag)
+      ->type_name("<number>");
+
   AddVerboseOption(dbcheck_app);
 
   auto manual_args
@@ -936,7 +960,22 @@ int main(int argc, char* argv[])
   // Drop temporary index idx_tmp_name if it already exists
   DropTmpIdx("idxPIchk", "File");
 
-  if (batch) {
+  int exit_code = BEXIT_SUCCESS;
+  if (bulk) {
+    bulk_options.fix = fix;
+    bulk_options.connect = [&]() -> BareosDb* {
+      BareosDb* mdb = db_init_database(
+          nullptr, db_driver, db_name.c_str(), user.c_str(), password.c_str(),
+          dbhost.c_str(), dbport, nullptr, true, false, false, false);
+      if (mdb && !mdb->OpenDatabase(nullptr)) {
+        printf("%s\n", mdb->strerror());
+        mdb->CloseDatabase(nullptr);
+        return nullptr;
+      }
+      return mdb;
+    };
+    if (!RunBulkChecks(bulk_options)) { exit_code = BEXIT_FAILURE; }
+  } else if (batch) {
     run_all_commands();
   } else {
     do_interactive_mode();
@@ -949,5 +988,5 @@ int main(int argc, char* argv[])
   CloseMsg(nullptr);
   TermMsg();
 
-  return BEXIT_SUCCESS;
+  return exit_code;
 }
@@ -0,0 +1,251 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+// Set based, parallel orphan checks of bareos-dbcheck
+
+#include "include/bareos.h"
+#include "cats/cats.h"
+#include "cats/sql.h"
+#include "lib/edit.h"
+#include "dird/dbcheck_bulk.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct BulkCheck {
+  const char* description;
+  const char* table;
+  const char* id_column;
+  const char* orphan_condition;
+  // A stage only starts when all checks of the previous stage are done.
+  int stage;
+  /* Evaluate orphan_condition once into a temporary table. Used when the
+   * referencing table has no index on the referencing column, as File has
+   * none on PathId, so every window would otherwise scan it again. */
+  bool snapshot;
+};
+
+/* Deleting orphaned Jobs creates new orphans in the tables referencing Job,
+ * and deleting orphaned Files new orphans in Path, hence the stages. */
+const BulkCheck bulk_checks[] = {
+    {"orphaned Job records", "Job", "JobId",
+     "NOT EXISTS (SELECT 1 FROM Client WHERE Client.ClientId = Job.ClientId)",
+     0, false},
+    {"orphaned JobMedia records", "JobMedia", "JobMediaId",
+     "NOT EXISTS (SELECT 1 FROM Job WHERE Job.JobId = JobMedia.JobId)", 1,
+     false},
+    {"orphaned File records", "File", "FileId",
+     "NOT EXISTS (SELECT 1 FROM Job WHERE Job.JobId = File.JobId)", 1, false},
+    {"orphaned Log records", "Log", "LogId",
+     "NOT EXISTS (SELECT 1 FROM Job WHERE Job.JobId = Log.JobId)", 1, false},
+    {"orphaned FileSet records", "FileSet", "FileSetId",
+     "NOT EXISTS (SELECT 1 FROM Job WHERE Job.FileSetId = FileSet.FileSetId)",
+     1, false},
+    {"orphaned Client records", "Client", "ClientId",
+     "NOT EXISTS (SELECT 1 FROM Job WHERE Job.ClientId = Client.ClientId)", 1,
+     false},
+    {"orphaned Path records", "Path", "PathId",
+     "NOT EXISTS (SELECT 1 FROM File WHERE File.PathId = Path.PathId) "
+     "AND NOT EXISTS (SELECT 1 FROM PathHierarchy "
+     "WHERE PathHierarchy.PPathId = Path.PathId)",
+     2, true},
+};
+
+constexpr auto kProgressInterval = std::chrono::seconds(10);
+
+struct IdRange {
+  int64_t min{0};
+  int64_t max{-1};
+};
+
+int IdRangeHandler(void* ctx, int num_fields, char** row)
+{
+  IdRange* range = static_cast<IdRange*>(ctx);
+
+  // min() and max() of an empty table are NULL
+  if (num_fields == 2 && row[0] && row[1]) {
+    range->min = str_to_int64(row[0]);
+    range->max = str_to_int64(row[1]);
+  }
+  return 0;
+}
+
+void PrintProgress(const BulkCheck& check,
+                   const BulkCheckOptions& options,
+                   const IdRange& range,
+                   int64_t next_id,
+                   uint64_t records,
+                   std::chrono::steady_clock::time_point start)
+{
+  char ed1[50], ed2[200];
+  const char* action = options.fix ? T_("deleted") : T_("found");
+  auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+
+  if (next_id > range.max) {
+    printf(T_("%s: %s %s in %s.\n"), check.description,
+           edit_uint64_with_commas(records, ed1), action,
+           edit_utime(elapsed, ed2, sizeof(ed2)));
+    fflush(stdout);
+    return;
+  }
+
+  double done = double(next_id - range.min) / double(range.max - range.min);
+  utime_t eta = done > 0 ? utime_t(elapsed / done - elapsed) : 0;
+  printf(T_("%s: %d%% done, %s %s so far, about %s left.\n"),
+         check.description, int(done * 100),
+         edit_uint64_with_commas(records, ed1), action,
+         edit_utime(eta, ed2, sizeof(ed2)));
+  fflush(stdout);
+}
+
+bool RunBulkCheck(BareosDb* db,
+                  const BulkCheck& check,
+                  const BulkCheckOptions& options)
+{
+  PoolMem query(PM_MESSAGE);
+  PoolMem condition(PM_MESSAGE);
+  PoolMem snapshot(PM_NAME);
+  const char* range_table = check.table;
+  const char* range_column = check.id_column;
+  char ed1[50], ed2[50];
+
+  printf(T_("Checking for %s.\n"), check.description);
+  fflush(stdout);
+
+  PmStrcpy(condition, check.orphan_condition);
+  if (check.snapshot) {
+    Mmsg(snapshot, "dbcheck_%s", check.table);
+    Mmsg(query, "CREATE TEMPORARY TABLE %s (Id BIGINT PRIMARY KEY)",
+         snapshot.c_str());
+    if (!db->SqlQuery(query.c_str())) {
+      printf("%s\n", db->strerror());
+      return false;
+    }
+    Mmsg(query, "INSERT INTO %s SELECT %s FROM %s WHERE %s", snapshot.c_str(),
+         check.id_column, check.table, check.orphan_condition);
+    if (verbose > 1) { printf("%s\n", query.c_str()); }
+    if (!db->SqlQuery(query.c_str())) {
+      printf("%s\n", db->strerror());
+      return false;
+    }
+    Mmsg(condition, "EXISTS (SELECT 1 FROM %s WHERE %s.Id = %s.%s)",
+         snapshot.c_str(), snapshot.c_str(), check.table, check.id_column);
+    range_table = snapshot.c_str();
+    range_column = "Id";
+  }
+
+  IdRange range;
+  Mmsg(query, "SELECT min(%s), max(%s) FROM %s", range_column, range_column,
+       range_table);
+  if (!db->SqlQuery(query.c_str(), IdRangeHandler, &range)) {
+    printf("%s\n", db->strerror());
+    return false;
+  }
+
+  uint64_t records = 0;
+  auto start = std::chrono::steady_clock::now();
+  auto last_report = start;
+  int64_t first = range.min;
+  while (first <= range.max) {
+    int64_t last = first + options.batch_size - 1;
+
+    edit_int64(first, ed1);
+    edit_int64(last, ed2);
+    if (options.fix) {
+      Mmsg(query, "DELETE FROM %s WHERE %s BETWEEN %s AND %s AND %s",
+           check.table, check.id_column, ed1, ed2, condition.c_str());
+      if (verbose > 1) { printf("%s\n", query.c_str()); }
+      int deleted = db->DELETE_DB(nullptr, query.c_str());
+      if (deleted < 0) { return false; }
+      records += deleted;
+    } else {
+      db_int64_ctx count;
+      Mmsg(query, "SELECT count(*) FROM %s WHERE %s BETWEEN %s AND %s AND %s",
+           check.table, check.id_column, ed1, ed2, condition.c_str());
+      if (verbose > 1) { printf("%s\n", query.c_str()); }
+      if (!db->SqlQuery(query.c_str(), db_int64_handler, &count)) {
+        printf("%s\n", db->strerror());
+        return false;
+      }
+      records += count.value;
+    }
+    first = last + 1;
+
+    auto now = std::chrono::steady_clock::now();
+    if (first <= range.max && now - last_report >= kProgressInterval) {
+      PrintProgress(check, options, range, first, records, start);
+      last_report = now;
+    }
+  }
+  PrintProgress(check, options, range, range.max + 1, records, start);
+
+  if (check.snapshot) {
+    Mmsg(query, "DROP TABLE %s", snapshot.c_str());
+    db->SqlQuery(query.c_str());
+  }
+  return true;
+}
+
+}  // namespace
+
+bool RunBulkChecks(const BulkCheckOptions& options)
+{
+  std::atomic<bool> ok{true};
+  int last_stage = 0;
+
+  for (const auto& check : bulk_checks) {
+    last_stage = std::max(last_stage, check.stage);
+  }
+
+  for (int stage = 0; stage <= last_stage && ok; stage++) {
+    std::vector<const BulkCheck*> checks;
+    for (const auto& check : bulk_checks) {
+      if (check.stage == stage) { checks.push_back(&check); }
+    }
+
+    std::atomic<size_t> next_check{0};
+    auto worker = [&]() {
+      BareosDb* db = options.connect();
+      if (!db) {
+        ok = false;
+        return;
+      }
+      for (size_t i = next_check++; i < checks.size(); i = next_check++) {
+        if (!RunBulkCheck(db, *checks[i], options)) { ok = false; }
+      }
+      db->CloseDatabase(nullptr);
+    };
+
+    size_t num_workers = std::min(
+        checks.size(), static_cast<size_t>(std::max(1, options.connections)));
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < num_workers; i++) { workers.emplace_back(worker); }
+    for (auto& thread : workers) { thread.join(); }
+  }
+
+  return ok;
+}
@@ -0,0 +1,47 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+
+#ifndef BAREOS_DIRD_DBCHECK_BULK_H_
+#define BAREOS_DIRD_DBCHECK_BULK_H_
+
+#include <cstdint>
+#include <functional>
+
+class BareosDb;
+
+/* Set based orphan checks of bareos-dbcheck.
+ *
+ * Instead of fetching the ids of orphaned records and deleting them one by
+ * one, every check walks the primary key of its table in windows of
+ * batch_size ids and lets the database delete (or only count, if fix is
+ * not set) the orphans of each window with a single anti-join statement.
+ * Checks that do not depend on each other run concurrently, each on its
+ * own connection returned by connect. */
+struct BulkCheckOptions {
+  bool fix{false};
+  int64_t batch_size{100000};
+  int connections{4};
+  std::function<BareosDb*()> connect;
+};
+
+bool RunBulkChecks(const BulkCheckOptions& options);
+
+#endif  // BAREOS_DIRD_DBCHECK_BULK_H_
@@ -534,6 +534,9 @@ static bRC bareosGetValue(PluginContext* ctx, brDirVariable var, void* value)
       Dmsg1(debuglevel, "dir-plugin: return bDirVarPluginDir=%s\n",
             NPRT(*((char**)value)));
       break;
+    case bDirVarPythonPluginOwnGil:
+      *((bool*)value) = me->python_plugin_own_gil;
+      break;
     default:
       if (!ctx) { return bRC_Error; }
       jcr = ((b_plugin_ctx*)ctx->core_private_context)->jcr;
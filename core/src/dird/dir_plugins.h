@@ -82,7 +82,8 @@ typedef enum
   bDirVarPluginDir = 24,
   bDirVarLastRate = 25,
   bDirVarJobBytes = 26,
-  bDirVarReadBytes = 27
+  bDirVarReadBytes = 27,
+  bDirVarPythonPluginOwnGil = 28
 } brDirVariable;
 
 // Bareos Variable Ids (Write)
@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2011 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -127,6 +127,8 @@ static ResourceItem dir_items[] = {
      "14.2.0-", "Plugins are loaded from this directory. To load only specific plugins, use 'Plugin Names'." },
   { "PluginNames", CFG_TYPE_PLUGIN_NAMES, ITEM(res_dir, plugin_names), 0, 0, NULL,
       "14.2.0-", "List of plugins, that should get loaded from 'Plugin Directory' (only basenames, '-dir.so' is added automatically). If empty, all plugins will get loaded." },
+  { "PythonPluginOwnGil", CFG_TYPE_BOOL, ITEM(res_dir, python_plugin_own_gil), 0, CFG_ITEM_DEFAULT, "false",
+      "24.0.0-", "Run every Python plugin instance in a sub-interpreter with its own GIL (requires Python >= 3.12)." },
   { "ScriptsDirectory", CFG_TYPE_DIR, ITEM(res_dir, scripts_directory), 0, 0, NULL, NULL, "This directive is currently unused." },
   { "Subscriptions", CFG_TYPE_PINT32, ITEM(res_dir, subscriptions), 0, CFG_ITEM_DEFAULT, "0", "12.4.4-", NULL },
   { "MaximumConcurrentJobs", CFG_TYPE_PINT32, ITEM(res_dir, MaxConcurrentJobs), 0, CFG_ITEM_DEFAULT, "1", NULL, NULL },
@@ -310,15 +312,25 @@ static ResourceItem cat_items[] = {
   { "ExitOnFatal", CFG_TYPE_BOOL, ITEM(res_cat, exit_on_fatal), 0, CFG_ITEM_DEFAULT, "false",
      "15.1.0-", "Make any fatal error in the connection to the database exit the program" },
   { "MinConnections", CFG_TYPE_PINT32, ITEM(res_cat, pooling_min_connections), 0, CFG_ITEM_DEFAULT, "1", NULL,
-     "This directive is used by the experimental database pooling functionality. Only use this for non production sites. This sets the minimum number of connections to a database to keep in this database pool." },
-  { "MaxConnections", CFG_TYPE_PINT32, ITEM(res_cat, pooling_max_connections), 0, CFG_ITEM_DEFAULT, "5", NULL,
-     "This directive is used by the experimental database pooling functionality. Only use this for non production sites. This sets the maximum number of connections to a database to keep in this database pool." },
+     "This directive is used by the database connection pool. It sets the number of connections to the database that are opened at start and kept open even when they are idle." },
+  { "MaxConnections", CFG_TYPE_PINT32, ITEM(res_cat, pooling_max_connections), 0, CFG_ITEM_DEFAULT, "0", NULL,
+     "This directive is used by the database connection pool. It sets the maximum number of connections the pool opens to the database. The pool is only used when this is set to a value larger than 0. When all connections are in use, interactive users share a connection and other connections are opened outside of the pool." },
   { "IncConnections", CFG_TYPE_PINT32, ITEM(res_cat, pooling_increment_connections), 0, CFG_ITEM_DEFAULT, "1", NULL,
-    "This directive is used by the experimental database pooling functionality. Only use this for non production sites. This sets the number of connections to add to a database pool when not enough connections are available on the pool anymore." },
+    "This directive is used by the database connection pool. It sets the number of connections to open at once when the pool needs more connections." },
   { "IdleTimeout", CFG_TYPE_PINT32, ITEM(res_cat, pooling_idle_timeout), 0, CFG_ITEM_DEFAULT, "30", NULL,
-     "This directive is used by the experimental database pooling functionality. Only use this for non production sites.  This sets the idle time after which a database pool should be shrinked." },
+     "This directive is used by the database connection pool. Connections that were idle for longer than this number of seconds are closed, down to Min Connections. 0 keeps idle connections open." },
   { "ValidateTimeout", CFG_TYPE_PINT32, ITEM(res_cat, pooling_validate_timeout), 0, CFG_ITEM_DEFAULT, "120", NULL,
-     "This directive is used by the experimental database pooling functionality. Only use this for non production sites. This sets the validation timeout after which the database connection is polled to see if its still alive." },
+     "This directive is used by the database connection pool. Connections that were idle for this number of seconds are checked with a query before they are handed out again." },
+  { "ReplicaAddress", CFG_TYPE_STR, ITEM(res_cat, replica_address), 0, 0, NULL, "24.0.0-",
+     "Address of a read-only streaming replica of the catalog database. Read-only queries of list, llist, bvfs and of building the restore tree are sent to the replica instead of the primary. Database name, user and password are the same as for the primary." },
+  { "ReplicaPort", CFG_TYPE_PINT32, ITEM(res_cat, replica_port), 0, 0, NULL, "24.0.0-",
+     "Port of the read-only replica of the catalog database." },
+  { "ReplicaSocket", CFG_TYPE_STR, ITEM(res_cat, replica_socket), 0, 0, NULL, "24.0.0-",
+     "Socket of the read-only replica of the catalog database." },
+  { "ReplicaMaxLag", CFG_TYPE_TIME, ITEM(res_cat, replica_max_lag), 0, CFG_ITEM_DEFAULT, "30", "24.0.0-",
+     "The replica is only used while it lags behind the primary by less than this time. Otherwise, or when the replica cannot be reached, the queries go to the primary." },
+  { "FileStatColumns", CFG_TYPE_BOOL, ITEM(res_cat, file_stat_columns), 0, CFG_ITEM_DEFAULT, "false", "24.0.0-",
+     "Also store size, modification time, mode, link count, owner, inode and hard link target of each file in their own columns of the File table. Building the restore tree and filtering .bvfs_lsfiles by size or time get cheaper, but each File record gets about 50 bytes bigger, as the complete stat is still kept in LStat." },
   {nullptr, 0, 0, nullptr, 0, 0, nullptr, nullptr, nullptr}
 };
 
@@ -1958,6 +1970,9 @@ void FilesetResource::PrintConfigIncludeExcludeOptions(
           case 'o':
             send.KeyQuotedString("Compression", "LZO");
             break;
+          case 'a':
+            send.KeyBool("AdaptiveCompression", true);
+            break;
           case 'f':
             p++; /* skip f */
             switch (*p) {
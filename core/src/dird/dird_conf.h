@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2011 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -118,6 +118,7 @@ class DirectorResource
   char* scripts_directory = nullptr;    /* ScriptsDirectory */
   char* plugin_directory = nullptr;     /* Plugin Directory */
   alist<const char*>* plugin_names = nullptr; /* Plugin names to load */
+  bool python_plugin_own_gil = false; /* Python plugins get their own GIL */
   MessagesResource* messages = nullptr;       /* Daemon message handler */
   uint32_t MaxConcurrentJobs = 0; /* Max concurrent jobs for whole director */
   uint32_t MaxConsoleConnections = 0; /* Max concurrent console connections */
@@ -270,6 +271,14 @@ class CatalogResource : public BareosResource {
   uint32_t pooling_validate_timeout = 0; /**< When using sql pooling set this to
                                         the number of seconds after a idle
                                         connection should be validated */
+  char* replica_address = nullptr; /**< Hostname of a read-only replica */
+  uint32_t replica_port = 0;        /**< Port of the replica */
+  char* replica_socket = nullptr;   /**< Socket of the replica */
+  utime_t replica_max_lag = 0;      /**< Use the replica only while it lags
+                                         behind less than this */
+  bool file_stat_columns = false;   /**< Fill the stat columns of File */
+
+  bool HasReplica() const { return replica_address || replica_socket; }
 
   /**< Methods */
   char* display(POOLMEM* dst); /**< Get catalog information */
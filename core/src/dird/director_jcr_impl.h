@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2012 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -115,6 +115,8 @@ struct DirectorJcrImpl {
   uint32_t SDJobFiles{};          /**< Number of files written, this job */
   uint64_t SDJobBytes{};          /**< Number of bytes processed this job */
   uint32_t SDErrors{};            /**< Number of non-fatal errors */
+  uint64_t FDCompressSkipped{};   /**< Bytes the FD did not compress */
+  uint64_t FDCompressCpuSaved{};  /**< Estimated compression cpu saved (ms) */
   std::atomic<int32_t> SDJobStatus{}; /**< Storage Job Status */
   std::atomic<int32_t> FDJobStatus{}; /**< File daemon Job Status */
   uint32_t DumpLevel{};           /**< Dump level when doing a NDMP backup */
@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2012 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2016 Planets Communications B.V.
-   Copyright (C) 2019-2022 Bareos GmbH & Co. KG
+   Copyright (C) 2019-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -32,7 +32,7 @@ namespace directordaemon {
 
 BareosDb* GetDatabaseConnection(JobControlRecord* jcr)
 {
-  return DbSqlGetPooledConnection(
+  BareosDb* db = DbSqlGetPooledConnection(
       jcr, jcr->dir_impl->res.catalog->db_driver,
       jcr->dir_impl->res.catalog->db_name, jcr->dir_impl->res.catalog->db_user,
       jcr->dir_impl->res.catalog->db_password.value,
@@ -43,6 +43,12 @@ BareosDb* GetDatabaseConnection(JobControlRecord* jcr)
       jcr->dir_impl->res.catalog->disable_batch_insert,
       jcr->dir_impl->res.catalog->try_reconnect,
       jcr->dir_impl->res.catalog->exit_on_fatal);
+
+  if (db) {
+    db->SetFillFileStatColumns(jcr->dir_impl->res.catalog->file_stat_columns);
+  }
+
+  return db;
 }
 
 }  // namespace directordaemon
@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2009 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -91,7 +91,8 @@ enum
   INC_KW_SIZE,
   INC_KW_SHADOWING,
   INC_KW_AUTO_EXCLUDE,
-  INC_KW_FORCE_ENCRYPTION
+  INC_KW_FORCE_ENCRYPTION,
+  INC_KW_ADAPTIVE_COMPRESSION
 };
 
 /*
@@ -130,6 +131,7 @@ static struct s_kw FS_option_kw[]
        {"shadowing", INC_KW_SHADOWING},
        {"autoexclude", INC_KW_AUTO_EXCLUDE},
        {"forceencryption", INC_KW_FORCE_ENCRYPTION},
+       {"adaptivecompression", INC_KW_ADAPTIVE_COMPRESSION},
        {NULL, 0}};
 
 // Options for FileSet keywords
@@ -221,6 +223,8 @@ static struct s_fs_opt FS_options[]
        {"no", INC_KW_AUTO_EXCLUDE, "x"},
        {"yes", INC_KW_FORCE_ENCRYPTION, "Ef"},
        {"no", INC_KW_FORCE_ENCRYPTION, "0"},
+       {"yes", INC_KW_ADAPTIVE_COMPRESSION, "Za"},
+       {"no", INC_KW_ADAPTIVE_COMPRESSION, "0"},
        {NULL, 0, 0}};
 
 // Imported subroutines
@@ -282,6 +286,7 @@ ResourceItem options_items[] = {
   { "Shadowing", CFG_TYPE_OPTION, 0, nullptr, 0, 0, NULL, NULL, NULL },
   { "AutoExclude", CFG_TYPE_OPTION, 0, nullptr, 0, 0, NULL, NULL, NULL },
   { "ForceEncryption", CFG_TYPE_OPTION, 0, nullptr, 0, 0, NULL, NULL, NULL },
+  { "AdaptiveCompression", CFG_TYPE_OPTION, 0, nullptr, 0, 0, NULL, NULL, NULL },
   { "Meta", CFG_TYPE_META, 0, nullptr, 0, 0, 0, NULL, NULL },
   { NULL, 0, 0, nullptr, 0, 0, NULL, NULL, NULL }
 };
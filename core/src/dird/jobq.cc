@@ -3,7 +3,7 @@
 
    Copyright (C) 2003-2011 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -38,6 +38,7 @@
 #include "dird/jobq.h"
 #include "dird/storage.h"
 #include "lib/berrno.h"
+#include "lib/event_loop.h"
 #include "lib/thread_specific_data.h"
 #include "dird/jcr_util.h"
 
@@ -47,7 +48,6 @@ static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
 
 /* Forward referenced functions */
 extern "C" void* jobq_server(void* arg);
-extern "C" void* sched_wait(void* arg);
 
 static int StartServer(jobq_t* jq);
 static bool AcquireResources(JobControlRecord* jcr);
@@ -146,51 +146,33 @@ int JobqDestroy(jobq_t* jq)
   return (status != 0 ? status : (status1 != 0 ? status1 : status2));
 }
 
-struct wait_pkt {
-  JobControlRecord* jcr;
-  jobq_t* jq;
-};
-
 /**
  * Wait until schedule time arrives before starting. Normally
  * this routine is only used for jobs started from the console
  * for which the user explicitly specified a start time. Otherwise
  * most jobs are put into the job queue only when their
  * scheduled time arives.
+ *
+ * The waiting is done by the shared event loop, checking every 30
+ * seconds if the job was canceled, so a waiting job takes no thread.
  */
-extern "C" void* sched_wait(void* arg)
+static void SchedWait(jobq_t* jq, JobControlRecord* jcr)
 {
-  JobControlRecord* jcr = ((wait_pkt*)arg)->jcr;
-  jobq_t* jq = ((wait_pkt*)arg)->jq;
-
-  SetJcrInThreadSpecificData(nullptr);
-  Dmsg0(2300, "Enter sched_wait.\n");
-  free(arg);
   time_t wtime = jcr->sched_time - time(NULL);
-  jcr->setJobStatusWithPriorityCheck(JS_WaitStartTime);
-
-  // Wait until scheduled time arrives
-  if (wtime > 0) {
-    Jmsg(jcr, M_INFO, 0,
-         T_("Job %s waiting %d seconds for scheduled start time.\n"), jcr->Job,
-         wtime);
-  }
 
-  // Check every 30 seconds if canceled
-  while (wtime > 0) {
+  if (wtime > 0 && !jcr->IsJobCanceled()) {
     Dmsg3(2300, "Waiting on sched time, jobid=%d secs=%d use=%d\n", jcr->JobId,
           wtime, jcr->UseCount());
     if (wtime > 30) { wtime = 30; }
-    Bmicrosleep(wtime, 0);
-    if (jcr->IsJobCanceled()) { break; }
-    wtime = jcr->sched_time - time(NULL);
+    EventLoop::Shared().RunAfter(std::chrono::seconds(wtime),
+                                 [jq, jcr]() { SchedWait(jq, jcr); });
+    return;
   }
+
   Dmsg1(200, "resched use=%d\n", jcr->UseCount());
   JobqAdd(jq, jcr);
   FreeJcr(jcr); /* we are done with jcr */
   Dmsg0(2300, "Exit sched_wait\n");
-
-  return NULL;
 }
 
 /**
@@ -203,8 +185,6 @@ int JobqAdd(jobq_t* jq, JobControlRecord* jcr)
   jobq_item_t *item, *li;
   bool inserted = false;
   time_t wtime = jcr->sched_time - time(NULL);
-  pthread_t id;
-  wait_pkt* sched_pkt;
 
   if (!jcr->dir_impl->term_wait_inited) {
     // Initialize termination condition variable
@@ -228,16 +208,13 @@ int JobqAdd(jobq_t* jq, JobControlRecord* jcr)
   Dmsg3(2300, "JobqAdd jobid=%d jcr=0x%x UseCount=%d\n", jcr->JobId, jcr,
         jcr->UseCount());
   if (!jcr->IsJobCanceled() && wtime > 0) {
-    sched_pkt = (wait_pkt*)malloc(sizeof(wait_pkt));
-    sched_pkt->jcr = jcr;
-    sched_pkt->jq = jq;
-    status = pthread_create(&id, &jq->attr, sched_wait, (void*)sched_pkt);
-    if (status != 0) { /* thread not created */
-      BErrNo be;
-      Jmsg1(jcr, M_ERROR, 0, T_("pthread_thread_create: ERR=%s\n"),
-            be.bstrerror(status));
-    }
-    return status;
+    Dmsg0(2300, "Enter sched_wait.\n");
+    jcr->setJobStatusWithPriorityCheck(JS_WaitStartTime);
+    Jmsg(jcr, M_INFO, 0,
+         T_("Job %s waiting %d seconds for scheduled start time.\n"), jcr->Job,
+         wtime);
+    SchedWait(jq, jcr);
+    return 0;
   }
 
   lock_mutex(jq->mutex);
@@ -3,7 +3,7 @@
 
    Copyright (C) 2004-2012 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2016 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -61,12 +61,7 @@
 #include "dird/jcr_util.h"
 
 #include "cats/sql.h"
-
-#ifndef HAVE_REGEX_H
-#  include "lib/bregex.h"
-#else
-#  include <regex.h>
-#endif
+#include "lib/regex_set.h"
 
 namespace directordaemon {
 
@@ -191,8 +186,9 @@ static const char* sql_migrate_ndmp_metadata
 // Copy NDMP Job MetaData.
 static const char* sql_copy_ndmp_metadata
     = "INSERT INTO File (FileIndex, JobId, PathId, Name, DeltaSeq, MarkId, "
-      "LStat, MD5) "
-      "SELECT FileIndex, %s, PathId, Name, DeltaSeq, MarkId, LStat, MD5 "
+      "LStat, MD5, Size, MTime, Mode, NLink, Uid, Gid, Inode, LinkFI) "
+      "SELECT FileIndex, %s, PathId, Name, DeltaSeq, MarkId, LStat, MD5, "
+      "Size, MTime, Mode, NLink, Uid, Gid, Inode, LinkFI "
       "FROM File "
       "WHERE JobId=%s "
       "AND Name NOT IN ("
@@ -595,9 +591,8 @@ static bool regex_find_jobids(JobControlRecord* jcr,
   dlist<uitem>* item_chain;
   uitem* item = NULL;
   uitem* last_item = NULL;
-  regex_t preg{};
-  char prbuf[500];
-  int rc;
+  RegexSet selection;
+  std::string errmsg;
   bool ok = false;
   PoolMem query(PM_MESSAGE);
 
@@ -626,13 +621,11 @@ static bool regex_find_jobids(JobControlRecord* jcr,
     goto bail_out; /* skip regex match */
   } else {
     // Compile regex expression
-    rc = regcomp(&preg, jcr->dir_impl->res.job->selection_pattern,
-                 REG_EXTENDED);
-    if (rc != 0) {
-      regerror(rc, &preg, prbuf, sizeof(prbuf));
+    if (!selection.Add(jcr->dir_impl->res.job->selection_pattern,
+                       REG_EXTENDED, errmsg)) {
       Jmsg(jcr, M_FATAL, 0,
            T_("Could not compile regex pattern \"%s\" ERR=%s\n"),
-           jcr->dir_impl->res.job->selection_pattern, prbuf);
+           jcr->dir_impl->res.job->selection_pattern, errmsg.c_str());
       goto bail_out;
     }
 
@@ -644,8 +637,7 @@ static bool regex_find_jobids(JobControlRecord* jcr,
         item_chain->remove(last_item);
       }
       Dmsg1(dbglevel, "get name Item=%s\n", item->item);
-      rc = regexec(&preg, item->item, 0, NULL, 0);
-      if (rc == 0) {
+      if (selection.Search(item->item)) {
         last_item = NULL; /* keep this one */
       } else {
         last_item = item;
@@ -657,8 +649,6 @@ static bool regex_find_jobids(JobControlRecord* jcr,
       Dmsg1(dbglevel, "Remove item %s\n", last_item->item);
       item_chain->remove(last_item);
     }
-
-    regfree(&preg);
   }
 
   if (item_chain->size() == 0) {
@@ -2,7 +2,7 @@
    BAREOS® - Backup Archiving REcovery Open Sourced
 
    Copyright (C) 2015-2015 Planets Communications B.V.
-   Copyright (C) 2015-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2015-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -27,6 +27,7 @@
 
 #include "include/bareos.h"
 #include "include/filetypes.h"
+#include "include/protocol_types.h"
 #include "dird.h"
 
 #if defined(HAVE_NDMP) && defined(HAVE_LMDB)
@@ -35,6 +36,13 @@
 #  include "ndmp_dma_priv.h"
 #  include "lmdb/lmdb.h"
 
+#  include <algorithm>
+#  include <list>
+#  include <string>
+#  include <unordered_map>
+#  include <utility>
+#  include <vector>
+
 namespace directordaemon {
 
 // What is actually stored in the LMDB
@@ -42,26 +50,61 @@ struct fhdb_payload {
   ndmp9_u_quad node;
   ndmp9_u_quad dir_node;
   ndmp9_file_stat ndmp_fstat;
+  bool stored; /* Attribute record already written while the dump was running */
   char namebuffer[1];
 };
 
+// Full path of a resolved directory and its position in the LRU list.
+struct fhdb_cached_path {
+  std::string path;
+  std::list<uint64_t>::iterator lru;
+};
+
 struct fhdb_state {
-  uint64_t root_node;
-  POOLMEM* pay_load;
-  POOLMEM* lmdb_name;
-  POOLMEM* path;
-  MDB_env* db_env;
-  MDB_dbi db_dbi;
-  MDB_txn* db_rw_txn;
-  MDB_txn* db_ro_txn;
+  uint64_t root_node{0};
+  POOLMEM* pay_load{nullptr};
+  POOLMEM* lmdb_name{nullptr};
+  std::string path;
+  MDB_env* db_env{nullptr};
+  MDB_dbi db_dbi{0};
+  MDB_txn* db_rw_txn{nullptr};
+  MDB_txn* db_ro_txn{nullptr};
+  bool store_while_dumping{false};
+  uint64_t stored_while_dumping{0};
+  uint64_t stored_afterwards{0};
+  /* Full path of already resolved directories keyed by their node, so
+   * siblings share the lookups of their common parents. Once the paths use
+   * more than MAX_PATH_CACHE_BYTES the least recently used ones are dropped,
+   * path_lru holds the nodes with the most recently used one first. */
+  std::unordered_map<uint64_t, fhdb_cached_path> path_cache;
+  std::list<uint64_t> path_lru;
+  size_t path_cache_bytes{0};
 };
 
 static int debuglevel = 100;
 
-// Payload = 8 + 8 + 96 = 112 bytes + namelength.
+// Payload = 8 + 8 + 96 + 8 = 120 bytes + namelength.
 #  define AVG_NR_BYTES_PER_ENTRY 256
 #  define B_PAGE_SIZE 4096
 
+// Upper bound of the memory used by the directory paths in the path cache.
+#  ifndef MAX_PATH_CACHE_BYTES
+#    define MAX_PATH_CACHE_BYTES (64 * 1024 * 1024)
+#  endif
+
+// Estimated memory used per cached path besides the path itself.
+#  define PATH_CACHE_ENTRY_OVERHEAD 96
+
+// Number of entries sorted by directory in one go when processing the LMDB.
+#  define PROCESS_BATCH_SIZE (64 * 1024)
+
+static bool CalculatePath(uint64_t node,
+                          fhdb_state* fhdb_state,
+                          MDB_txn* txn);
+static void StoreFhdbEntry(NIS* nis,
+                           fhdb_state* fhdb_state,
+                           const fhdb_payload* payload);
+
 extern "C" int bndmp_fhdb_lmdb_add_dir(struct ndmlog* ixlog,
                                        int,
                                        char* raw_name,
@@ -95,6 +138,7 @@ extern "C" int bndmp_fhdb_lmdb_add_dir(struct ndmlog* ixlog,
     payload->node = node;
     payload->dir_node = dir_node;
     memset(&payload->ndmp_fstat, 0, sizeof(ndmp9_file_stat));
+    payload->stored = false;
     memcpy(payload->namebuffer, raw_name, length + 1);
 
     key.mv_data = &payload->node;
@@ -190,6 +234,15 @@ extern "C" int bndmp_fhdb_lmdb_add_node(struct ndmlog* ixlog,
         // Copy the new file statistics,
         memcpy(&payload->ndmp_fstat, ndmp_fstat, sizeof(ndmp9_file_stat));
 
+        /* When all parent directories are already known we can store the
+         * attribute record right away instead of after the dump finished. */
+        if (fhdb_state->store_while_dumping && !payload->stored
+            && payload->ndmp_fstat.node.valid == NDMP9_VALIDITY_VALID
+            && CalculatePath(payload->dir_node, fhdb_state,
+                             fhdb_state->db_rw_txn)) {
+          payload->stored = true;
+        }
+
         // Keys and length don't change only content.
         data.mv_data = payload;
 
@@ -274,6 +327,11 @@ extern "C" int bndmp_fhdb_lmdb_add_node(struct ndmlog* ixlog,
                   mdb_strerror(result));
             goto bail_out;
         }
+
+        if (payload->stored) {
+          StoreFhdbEntry(nis, fhdb_state, payload);
+          fhdb_state->stored_while_dumping++;
+        }
         break;
       case MDB_TXN_FULL:
         /* Seems we filled the transaction.
@@ -344,6 +402,7 @@ extern "C" int bndmp_fhdb_lmdb_add_dirnode_root(struct ndmlog* ixlog,
     payload->dir_node = root_node;
     payload->namebuffer[0] = '\0';
     memset(&payload->ndmp_fstat, 0, sizeof(payload->ndmp_fstat));
+    payload->stored = false;
 
     key.mv_data = &payload->node;
     key.mv_size = sizeof(payload->node);
@@ -421,12 +480,15 @@ void NdmpFhdbLmdbRegister(struct ndmlog* ixlog)
     struct fhdb_state* fhdb_state;
 
     // Initiate LMDB environment
-    fhdb_state = (struct fhdb_state*)malloc(sizeof(struct fhdb_state));
-    memset(fhdb_state, 0, sizeof(struct fhdb_state));
+    fhdb_state = new struct fhdb_state;
 
     fhdb_state->lmdb_name = GetPoolMemory(PM_FNAME);
     fhdb_state->pay_load = GetPoolMemory(PM_MESSAGE);
-    fhdb_state->path = GetPoolMemory(PM_FNAME);
+
+    /* With NDMP_BAREOS the attribute record is shared with the attributes
+     * sent by the storage daemon, so only store them early for native NDMP. */
+    fhdb_state->store_while_dumping
+        = (nis->jcr->getJobProtocol() == PT_NDMP_NATIVE);
 
     result = mdb_env_create(&fhdb_state->db_env);
     if (result) {
@@ -517,9 +579,8 @@ void NdmpFhdbLmdbRegister(struct ndmlog* ixlog)
 
     FreePoolMemory(fhdb_state->lmdb_name);
     FreePoolMemory(fhdb_state->pay_load);
-    FreePoolMemory(fhdb_state->path);
 
-    free(fhdb_state);
+    delete fhdb_state;
 
     return;
   }
@@ -533,8 +594,9 @@ void NdmpFhdbLmdbUnregister(struct ndmlog* ixlog)
   ndmfhdb_unregister_callbacks(ixlog);
 
   if (fhdb_state) {
-    // Abort any pending write transaction.
+    // Abort any pending write transaction and the read transaction.
     if (fhdb_state->db_rw_txn) { mdb_txn_abort(fhdb_state->db_rw_txn); }
+    if (fhdb_state->db_ro_txn) { mdb_txn_abort(fhdb_state->db_ro_txn); }
 
     if (fhdb_state->db_env) {
       // Drop the contents of the LMDB.
@@ -558,38 +620,93 @@ void NdmpFhdbLmdbUnregister(struct ndmlog* ixlog)
     }
 
     FreePoolMemory(fhdb_state->pay_load);
-    FreePoolMemory(fhdb_state->path);
     SecureErase(nis->jcr, fhdb_state->lmdb_name);
     FreePoolMemory(fhdb_state->lmdb_name);
 
-    free(fhdb_state);
+    delete fhdb_state;
   }
 }
 
-static inline void CalculatePath(uint64_t node, fhdb_state* fhdb_state)
+static inline size_t CachedPathBytes(const std::string& path)
+{
+  return path.size() + PATH_CACHE_ENTRY_OVERHEAD;
+}
+
+// Lookup the path of a directory node and mark it as most recently used.
+static const std::string* LookupCachedPath(fhdb_state* fhdb_state,
+                                           uint64_t node)
+{
+  auto cached = fhdb_state->path_cache.find(node);
+  if (cached == fhdb_state->path_cache.end()) { return nullptr; }
+
+  fhdb_state->path_lru.splice(fhdb_state->path_lru.begin(),
+                              fhdb_state->path_lru, cached->second.lru);
+  return &cached->second.path;
+}
+
+/*
+ * Add the path of a directory node to the path cache and drop the least
+ * recently used paths until the cache fits into MAX_PATH_CACHE_BYTES again.
+ * Dropped directories are looked up in the LMDB again when needed.
+ */
+static void CachePath(fhdb_state* fhdb_state,
+                      uint64_t node,
+                      const std::string& path)
+{
+  if (fhdb_state->path_cache.find(node) != fhdb_state->path_cache.end()) {
+    return;
+  }
+
+  fhdb_state->path_lru.push_front(node);
+  fhdb_state->path_cache.emplace(
+      node, fhdb_cached_path{path, fhdb_state->path_lru.begin()});
+  fhdb_state->path_cache_bytes += CachedPathBytes(path);
+
+  while (fhdb_state->path_cache_bytes > MAX_PATH_CACHE_BYTES) {
+    auto evicted = fhdb_state->path_cache.find(fhdb_state->path_lru.back());
+    fhdb_state->path_cache_bytes -= CachedPathBytes(evicted->second.path);
+    fhdb_state->path_cache.erase(evicted);
+    fhdb_state->path_lru.pop_back();
+  }
+}
+
+/*
+ * Calculate the path of directory node into fhdb_state->path by walking up
+ * the tree until either the root node or an already cached directory is found.
+ * Every directory resolved on the way is added to the path cache.
+ *
+ * Returns true when the path could be resolved up to the root node, false when
+ * one of the parent directories is not (yet) known. In that case
+ * fhdb_state->path contains the part of the path that could be resolved.
+ */
+static bool CalculatePath(uint64_t node, fhdb_state* fhdb_state, MDB_txn* txn)
 {
-  PoolMem temp;
   int result = 0;
   MDB_val rkey, rdata;
   struct fhdb_payload* payload;
   bool root_node_reached = false;
+  std::vector<std::pair<uint64_t, std::string>> components;
 
   Dmsg1(100, "CalculatePath for node %llu\n", node);
 
-  PmStrcpy(fhdb_state->path, "");
+  fhdb_state->path.clear();
   while (!result && !root_node_reached) {
+    const std::string* cached = LookupCachedPath(fhdb_state, node);
+    if (cached) {
+      fhdb_state->path = *cached;
+      root_node_reached = true;
+      break;
+    }
+
     rkey.mv_data = &node;
     rkey.mv_size = sizeof(node);
 
-    result = mdb_get(fhdb_state->db_ro_txn, fhdb_state->db_dbi, &rkey, &rdata);
+    result = mdb_get(txn, fhdb_state->db_dbi, &rkey, &rdata);
     switch (result) {
       case 0:
         payload = (struct fhdb_payload*)rdata.mv_data;
         if (node != fhdb_state->root_node) {
-          PmStrcpy(temp, "/");
-          PmStrcat(temp, payload->namebuffer);
-          PmStrcat(temp, fhdb_state->path);
-          PmStrcpy(fhdb_state->path, temp.c_str());
+          components.emplace_back(node, payload->namebuffer);
           node = payload->dir_node;
         } else {
           // Root reached
@@ -606,6 +723,78 @@ static inline void CalculatePath(uint64_t node, fhdb_state* fhdb_state)
         break;
     }
   }
+
+  for (auto it = components.rbegin(); it != components.rend(); ++it) {
+    fhdb_state->path.append("/");
+    fhdb_state->path.append(it->second);
+    if (root_node_reached) {
+      CachePath(fhdb_state, it->first, fhdb_state->path);
+    }
+  }
+
+  return root_node_reached;
+}
+
+// Store the attributes of a single entry using fhdb_state->path as its path.
+static void StoreFhdbEntry(NIS* nis,
+                           fhdb_state* fhdb_state,
+                           const fhdb_payload* payload)
+{
+  int8_t FileType = 0;
+  PoolMem attribs(PM_FNAME);
+  PoolMem full_path(PM_FNAME);
+  ndmp9_file_stat ndmp_fstat = payload->ndmp_fstat;
+
+  NdmpConvertFstat(&ndmp_fstat, nis->FileIndex, &FileType, attribs);
+
+  PmStrcpy(full_path, nis->filesystem);
+  PmStrcat(full_path, fhdb_state->path.c_str());
+  PmStrcat(full_path, "/");
+  PmStrcat(full_path, payload->namebuffer);
+
+  if (FileType == FT_DIREND) {
+    /* SplitPathAndFilename() expects directories to end with a '/'
+     * so append '/' if full_path does not already end with '/' */
+    if (full_path.c_str()[strlen(full_path.c_str()) - 1] != '/') {
+      Dmsg1(100, ("appending / to %s \n"), full_path.c_str());
+      PmStrcat(full_path, "/");
+    }
+  }
+  NdmpStoreAttributeRecord(nis->jcr, full_path.c_str(), nis->virtual_filename,
+                           attribs.c_str(), FileType, 0,
+                           (ndmp_fstat.fh_info.valid == NDMP9_VALIDITY_VALID)
+                               ? ndmp_fstat.fh_info.value
+                               : 0);
+}
+
+/*
+ * Store the entries not yet stored while the dump was running. The LMDB is
+ * ordered by node, so the entries are collected in batches and sorted by their
+ * parent directory first so all entries of a directory reuse the same path.
+ * The payloads point into the read transaction and stay valid during it.
+ */
+static inline void StorePendingEntries(
+    NIS* nis,
+    struct fhdb_state* fhdb_state,
+    std::vector<const fhdb_payload*>& pending)
+{
+  std::stable_sort(pending.begin(), pending.end(),
+                   [](const fhdb_payload* a, const fhdb_payload* b) {
+                     return a->dir_node < b->dir_node;
+                   });
+
+  bool have_dir_node = false;
+  uint64_t dir_node = 0;
+  for (const fhdb_payload* payload : pending) {
+    if (!have_dir_node || payload->dir_node != dir_node) {
+      dir_node = payload->dir_node;
+      have_dir_node = true;
+      CalculatePath(dir_node, fhdb_state, fhdb_state->db_ro_txn);
+    }
+    StoreFhdbEntry(nis, fhdb_state, payload);
+    fhdb_state->stored_afterwards++;
+  }
+  pending.clear();
 }
 
 static inline void ProcessLmdb(NIS* nis, struct fhdb_state* fhdb_state)
@@ -613,12 +802,9 @@ static inline void ProcessLmdb(NIS* nis, struct fhdb_state* fhdb_state)
   int result;
   uint64_t node;
   MDB_cursor* cursor;
-  int8_t FileType = 0;
   MDB_val rkey, rdata;
-  PoolMem attribs(PM_FNAME);
-  ndmp9_file_stat ndmp_fstat;
-  PoolMem full_path(PM_FNAME);
   struct fhdb_payload* payload;
+  std::vector<const fhdb_payload*> pending;
 
   result = mdb_cursor_open(fhdb_state->db_ro_txn, fhdb_state->db_dbi, &cursor);
   if (result) { Dmsg1(debuglevel, "%s\n", mdb_strerror(result)); }
@@ -628,39 +814,21 @@ static inline void ProcessLmdb(NIS* nis, struct fhdb_state* fhdb_state)
   result = mdb_cursor_get(cursor, &rkey, &rdata, MDB_FIRST);
   if (result) { Dmsg1(debuglevel, "%s\n", mdb_strerror(result)); }
 
+  pending.reserve(PROCESS_BATCH_SIZE);
   while (!result) {
     switch (result) {
       case 0:
         payload = (struct fhdb_payload*)rdata.mv_data;
-        ndmp_fstat = payload->ndmp_fstat;
         node = *(uint64_t*)rkey.mv_data;
 
-        if (ndmp_fstat.node.valid == NDMP9_VALIDITY_VALID) {
-          CalculatePath(payload->dir_node, fhdb_state);
-          NdmpConvertFstat(&ndmp_fstat, nis->FileIndex, &FileType, attribs);
-
-          PmStrcpy(full_path, nis->filesystem);
-          PmStrcat(full_path, fhdb_state->path);
-          PmStrcat(full_path, "/");
-          PmStrcat(full_path, payload->namebuffer);
-
-          if (FileType == FT_DIREND) {
-            /* SplitPathAndFilename() expects directories to end with a '/'
-             * so append '/' if full_path does not already end with '/' */
-            if (full_path.c_str()[strlen(full_path.c_str()) - 1] != '/') {
-              Dmsg1(100, ("appending / to %s \n"), full_path.c_str());
-              PmStrcat(full_path, "/");
-            }
-          }
-          NdmpStoreAttributeRecord(
-              nis->jcr, full_path.c_str(), nis->virtual_filename,
-              attribs.c_str(), FileType, 0,
-              (ndmp_fstat.fh_info.valid == NDMP9_VALIDITY_VALID)
-                  ? ndmp_fstat.fh_info.value
-                  : 0);
-        } else {
+        if (payload->ndmp_fstat.node.valid != NDMP9_VALIDITY_VALID) {
           Dmsg1(100, "skipping node %lu because it has no valid node data\n",
                 node);
+        } else if (!payload->stored) {
+          pending.push_back(payload);
+          if (pending.size() >= PROCESS_BATCH_SIZE) {
+            StorePendingEntries(nis, fhdb_state, pending);
+          }
         }
         result = mdb_cursor_get(cursor, &rkey, &rdata, MDB_NEXT);
         break;
@@ -669,6 +837,9 @@ static inline void ProcessLmdb(NIS* nis, struct fhdb_state* fhdb_state)
         break;
     }
   }
+
+  StorePendingEntries(nis, fhdb_state, pending);
+  mdb_cursor_close(cursor);
 }
 
 void NdmpFhdbLmdbProcessDb(struct ndmlog* ixlog)
@@ -711,6 +882,9 @@ void NdmpFhdbLmdbProcessDb(struct ndmlog* ixlog)
 
   ProcessLmdb(nis, fhdb_state);
 
+  Dmsg2(100,
+        "%llu entries stored while dumping, %llu entries stored afterwards\n",
+        fhdb_state->stored_while_dumping, fhdb_state->stored_afterwards);
   Jmsg(nis->jcr, M_INFO, 0, "Processing lmdb database done\n");
 }
 
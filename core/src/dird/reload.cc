@@ -1,7 +1,7 @@
 /*
    BAREOS® - Backup Archiving REcovery Open Sourced
 
-   Copyright (C) 2022-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2022-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -207,6 +207,18 @@ bool InitializeSqlPooling(void)
       retval = false;
       goto bail_out;
     }
+
+    // The read-only replica gets its own pool with the same settings.
+    if (catalog->HasReplica()) {
+      db_sql_pool_initialize(
+          catalog->db_driver, catalog->db_name, catalog->db_user,
+          catalog->db_password.value, catalog->replica_address,
+          catalog->replica_port, catalog->replica_socket,
+          catalog->disable_batch_insert, catalog->try_reconnect, false,
+          catalog->pooling_min_connections, catalog->pooling_max_connections,
+          catalog->pooling_increment_connections,
+          catalog->pooling_idle_timeout, catalog->pooling_validate_timeout);
+    }
   }
 
 bail_out:
@@ -257,6 +269,8 @@ bool DoReloadConfig()
     me = (DirectorResource*)my_config->GetNextRes(R_DIRECTOR, nullptr);
     assert(me);
     my_config->own_resource_ = me;
+    // The pools were flushed above, so set them up again.
+    InitializeSqlPooling();
   }
   SetWorkingDirectory(me->working_directory);
   StartStatisticsThread();
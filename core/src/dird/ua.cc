@@ -1,7 +1,7 @@
 /*
    BAREOS® - Backup Archiving REcovery Open Sourced
 
-   Copyright (C) 2018-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2018-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -34,6 +34,7 @@ UaContext::UaContext(bool console_connected)
     , db(nullptr)
     , shared_db(nullptr)
     , private_db(nullptr)
+    , replica_db(nullptr)
     , catalog(nullptr)
     , user_acl(nullptr)
     , cmd(nullptr)
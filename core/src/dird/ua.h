@@ -3,7 +3,7 @@
 
    Copyright (C) 2001-2011 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2016 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -62,6 +62,9 @@ class UaContext {
   BareosDb* db;
   BareosDb* shared_db;  /**< Shared database connection used by multiple ua's */
   BareosDb* private_db; /**< Private database connection only used by this ua */
+  BareosDb* replica_db; /**< Read-only connection to the catalog replica */
+  std::string replica_wal_position{}; /**< WAL position after the last write
+                                         later commands read on the replica */
   CatalogResource* catalog;
   UserAcl* user_acl;              /**< acl from console or user resource */
   POOLMEM* cmd;                   /**< Return command/name buffer */
@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2012 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2016 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -113,6 +113,7 @@ extern bool DotBvfsLsfilesCmd(UaContext* ua, const char* cmd);
 extern bool DotBvfsUpdateCmd(UaContext* ua, const char* cmd);
 extern bool DotBvfsGetJobidsCmd(UaContext* ua, const char* cmd);
 extern bool DotBvfsVersionsCmd(UaContext* ua, const char* cmd);
+extern bool DotBvfsFindCmd(UaContext* ua, const char* cmd);
 extern bool DotBvfsRestoreCmd(UaContext* ua, const char* cmd);
 extern bool DotBvfsCleanupCmd(UaContext* ua, const char* cmd);
 extern bool DotBvfsClearCacheCmd(UaContext* ua, const char* cmd);
@@ -251,6 +252,11 @@ static struct ua_cmdstruct commands[] = {
      NT_("jobid=0 client=<client-name> pathid=<path-id> filename=<file-name> "
          "[copies] [versions]"),
      true, true},
+    {NT_(".bvfs_find"), DotBvfsFindCmd,
+     T_("Find files by name in all backups"),
+     NT_("name=<pattern> [path=<pattern>] [client=<client-name>] "
+         "[limit=<limit>] [offset=<offset>]"),
+     true, true},
     {NT_(".bvfs_restore"), DotBvfsRestoreCmd,
      T_("Mark BVFS files/directories for restore. Stored in handle."),
      NT_("path=<handle> jobid=<jobid> [fileid=<file-id>] [dirid=<dirid>] "
@@ -340,7 +346,7 @@ static struct ua_cmdstruct commands[] = {
          "jobid=<jobid> | ujobid=<complete_name> |\n"
          "joblog jobid=<jobid> | joblog ujobid=<complete_name> |\n"
          "jobmedia jobid=<jobid> | jobmedia ujobid=<complete_name> |\n"
-         "jobtotals |\n"
+         "jobtotals [client | pool] |\n"
          "jobstatistics jobid=<jobid> |\n"
          "log [ limit=<number> [ offset=<number> ] ] [reverse]|\n"
          "media [ jobid=<jobid> | ujobid=<complete_name> | pool=<pool-name> | "
@@ -379,7 +385,7 @@ static struct ua_cmdstruct commands[] = {
          "joblog jobid=<jobid> [count] | joblog ujobid=<complete_name> [count] "
          "|\n"
          "jobmedia jobid=<jobid> | jobmedia ujobid=<complete_name> |\n"
-         "jobtotals |\n"
+         "jobtotals [client | pool] |\n"
          "media [ jobid=<jobid> | ujobid=<complete_name> | pool=<pool-name> | "
          "all ] |\n"
          "media=<media-name> |\n"
@@ -408,7 +414,9 @@ static struct ua_cmdstruct commands[] = {
      true, true},
     {NT_("prune"), PruneCmd, T_("Prune records from catalog"),
      NT_("files [client=<client>] [pool=<pool>] [yes] |\n"
+         "files all [batch=<jobs>] [yes] |\n"
          "jobs [client=<client>] [pool=<pool>] [yes] |\n"
+         "jobs all [batch=<jobs>] [yes] |\n"
          "volume [all] [=volume] [pool=<pool>] [yes] |\n"
          "stats [yes] |\n"
          "directory [=directory] [client=<client>] [recursive] [yes] |\n"),
@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2012 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2016 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -33,6 +33,11 @@
 #include "cats/sql_pooling.h"
 #include "dird/ua_select.h"
 
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <string>
+
 namespace directordaemon {
 
 /* Imported subroutines */
@@ -175,6 +180,176 @@ void CloseDb(UaContext* ua)
     DbSqlClosePooledConnection(ua->jcr, ua->private_db);
     ua->private_db = NULL;
   }
+
+  if (ua->replica_db) {
+    DbSqlClosePooledConnection(ua->jcr, ua->replica_db);
+    ua->replica_db = NULL;
+  }
+}
+
+// Don't try to connect to a replica again for this long after a failure.
+static constexpr time_t kReplicaRetryInterval = 60;
+static std::mutex replica_mutex;
+static std::map<std::string, time_t> replica_failures;
+
+static bool ReplicaRecentlyFailed(CatalogResource* catalog)
+{
+  std::lock_guard<std::mutex> lock(replica_mutex);
+  auto failure = replica_failures.find(catalog->resource_name_);
+
+  return failure != replica_failures.end()
+         && failure->second + kReplicaRetryInterval > time(nullptr);
+}
+
+static void SetReplicaFailed(UaContext* ua)
+{
+  {
+    std::lock_guard<std::mutex> lock(replica_mutex);
+    replica_failures[ua->catalog->resource_name_] = time(nullptr);
+  }
+
+  if (ua->replica_db) {
+    DbSqlClosePooledConnection(ua->jcr, ua->replica_db, true);
+    ua->replica_db = NULL;
+  }
+}
+
+/**
+ * Remember the WAL position after a write of this session that later
+ * commands of the session expect to find on the replica, e.g. the bvfs cache.
+ */
+void RememberReplicaWrite(UaContext* ua)
+{
+  std::string position;
+
+  if (!ua->db || !ua->catalog || !ua->catalog->HasReplica()) { return; }
+
+  if (ua->db->GetWalPosition(ua->jcr, position)) {
+    ua->replica_wal_position = position;
+  } else {
+    Dmsg1(100, "%s", ua->db->strerror());
+  }
+}
+
+/**
+ * Check that the replica has replayed the last write of this session and
+ * shows the given jobs in the same state as the primary.
+ */
+static bool ReplicaIsCurrent(UaContext* ua,
+                             const char* jobids,
+                             const std::string& jobs_state)
+{
+  if (!ua->replica_wal_position.empty()
+      && !ua->replica_db->HasReplayedWalPosition(ua->jcr,
+                                                 ua->replica_wal_position)) {
+    return false;
+  }
+
+  if (jobids) {
+    std::string replica_jobs_state;
+    if (!ua->replica_db->GetJobsState(ua->jcr, jobids, replica_jobs_state)) {
+      Dmsg1(100, "%s", ua->replica_db->strerror());
+      return false;
+    }
+    return replica_jobs_state == jobs_state;
+  }
+
+  return true;
+}
+
+// How long to wait for the replica to catch up before using the primary.
+static constexpr int kReplicaCatchUpWaitMs = 2000;
+static constexpr int kReplicaCatchUpPollMs = 100;
+
+/**
+ * Point ua->db to the read-only replica of the current catalog. The primary
+ * connection stays in use when the catalog has no replica, the replica cannot
+ * be reached or lags behind the primary more than Replica Max Lag.
+ *
+ * With need_current the replica must also have replayed the last write of
+ * this session (see RememberReplicaWrite()), e.g. the bvfs cache, and show
+ * the given jobs just like the primary. Writes of other sessions, like
+ * running backups, do not matter. A replica that is not current yet is
+ * given a short time to catch up.
+ */
+bool UseReplicaDb(UaContext* ua, bool need_current, const char* jobids)
+{
+  CatalogResource* catalog = ua->catalog;
+  std::string jobs_state;
+  utime_t lag = 0;
+
+  if (!ua->db || !catalog || !catalog->HasReplica()) { return false; }
+  if (!ua->replica_db && ReplicaRecentlyFailed(catalog)) { return false; }
+
+  if (need_current && jobids && *jobids
+      && !ua->db->GetJobsState(ua->jcr, jobids, jobs_state)) {
+    Dmsg1(100, "%s", ua->db->strerror());
+    return false;
+  }
+  if (jobids && !*jobids) { jobids = nullptr; }
+
+  if (!ua->replica_db) {
+    // Errors go to the director log, the command itself continues.
+    ua->replica_db = DbSqlGetPooledConnection(
+        nullptr, catalog->db_driver, catalog->db_name, catalog->db_user,
+        catalog->db_password.value, catalog->replica_address,
+        catalog->replica_port, catalog->replica_socket, false,
+        catalog->disable_batch_insert, catalog->try_reconnect, false);
+    if (!ua->replica_db) {
+      SetReplicaFailed(ua);
+      return false;
+    }
+  }
+
+  if (!ua->replica_db->GetReplicationLag(ua->jcr, &lag)) {
+    Dmsg1(100, "%s", ua->replica_db->strerror());
+    SetReplicaFailed(ua);
+    return false;
+  }
+
+  if (lag > catalog->replica_max_lag) {
+    Dmsg2(100, "Replica of catalog %s lags %lld seconds behind, using "
+          "primary\n", catalog->resource_name_, (long long)lag);
+    return false;
+  }
+
+  if (need_current) {
+    int waited = 0;
+    int max_wait = std::min<int64_t>(kReplicaCatchUpWaitMs,
+                                     catalog->replica_max_lag * 1000);
+
+    while (!ReplicaIsCurrent(ua, jobids, jobs_state)) {
+      if (waited >= max_wait) {
+        Dmsg1(100, "Replica of catalog %s is not current, using primary\n",
+              catalog->resource_name_);
+        return false;
+      }
+      Bmicrosleep(0, kReplicaCatchUpPollMs * 1000);
+      waited += kReplicaCatchUpPollMs;
+    }
+  }
+
+  Dmsg1(150, "Using replica of catalog %s\n", catalog->resource_name_);
+  ua->db = ua->replica_db;
+  if (ua->jcr) { ua->jcr->db = ua->db; }
+
+  return true;
+}
+
+ReplicaDbScope::ReplicaDbScope(UaContext* ua,
+                               bool need_current,
+                               const char* jobids)
+    : ua_(ua), primary_(ua->db)
+{
+  UseReplicaDb(ua, need_current, jobids);
+}
+
+ReplicaDbScope::~ReplicaDbScope()
+{
+  if (ua_->db && ua_->db == ua_->replica_db) {
+    ua_->db = primary_;
+    if (ua_->jcr) { ua_->jcr->db = primary_; }
+  }
 }
 
 /**
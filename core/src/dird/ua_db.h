@@ -1,7 +1,7 @@
 /*
    BAREOS® - Backup Archiving REcovery Open Sourced
 
-   Copyright (C) 2018-2018 Bareos GmbH & Co. KG
+   Copyright (C) 2018-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -27,6 +27,26 @@ namespace directordaemon {
 bool OpenClientDb(UaContext* ua, bool use_private = false);
 bool OpenDb(UaContext* ua, bool use_private = false);
 void CloseDb(UaContext* ua);
+bool UseReplicaDb(UaContext* ua,
+                  bool need_current = false,
+                  const char* jobids = nullptr);
+void RememberReplicaWrite(UaContext* ua);
+
+/* Sends the catalog queries of a read-only command to the replica of the
+ * catalog for as long as it exists, see UseReplicaDb(). */
+class ReplicaDbScope {
+ public:
+  explicit ReplicaDbScope(UaContext* ua,
+                          bool need_current = false,
+                          const char* jobids = nullptr);
+  ~ReplicaDbScope();
+  ReplicaDbScope(const ReplicaDbScope&) = delete;
+  ReplicaDbScope& operator=(const ReplicaDbScope&) = delete;
+
+ private:
+  UaContext* ua_;
+  BareosDb* primary_;
+};
 int CreatePool(JobControlRecord* jcr,
                BareosDb* db,
                PoolResource* pool,
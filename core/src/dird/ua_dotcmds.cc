@@ -3,7 +3,7 @@
 
    Copyright (C) 2002-2011 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2016 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -120,6 +120,7 @@ bool DotBvfsUpdateCmd(UaContext* ua, const char*)
     /* update cache for all jobids */
     ua->db->BvfsUpdateCache(ua->jcr);
   }
+  RememberReplicaWrite(ua);
 
   return true;
 }
@@ -132,6 +133,7 @@ bool DotBvfsClearCacheCmd(UaContext* ua, const char*)
   if (pos != -1) {
     Bvfs fs(ua->jcr, ua->db);
     fs.clear_cache();
+    RememberReplicaWrite(ua);
     ua->InfoMsg("OK\n");
   } else {
     ua->ErrorMsg("Can't find 'yes' argument\n");
@@ -445,6 +447,7 @@ bool DotBvfsRestoreCmd(UaContext* ua, const char*)
 /**
  * .bvfs_lsfiles jobid=1,2,3,4 path=/
  * .bvfs_lsfiles jobid=1,2,3,4 pathid=10
+ * .bvfs_lsfiles jobid=1,2,3,4 pathid=10 minsize=1024 maxmtime=1700000000
  */
 bool DotBvfsLsfilesCmd(UaContext* ua, const char*)
 {
@@ -452,6 +455,8 @@ bool DotBvfsLsfilesCmd(UaContext* ua, const char*)
   DBId_t pathid = 0;
   char* pattern = NULL;
   int limit = 2000, offset = 0;
+  uint64_t min_size = 0, max_size = 0;
+  utime_t min_mtime = 0, max_mtime = 0;
   char *path = NULL, *jobid = NULL;
   PoolMem filtered_jobids(PM_FNAME);
 
@@ -466,14 +471,43 @@ bool DotBvfsLsfilesCmd(UaContext* ua, const char*)
   }
 
   if ((i = FindArgWithValue(ua, "pattern")) >= 0) { pattern = ua->argv[i]; }
+  if ((i = FindArgWithValue(ua, "minsize")) >= 0) {
+    if (!size_to_uint64(ua->argv[i], &min_size)) {
+      ua->ErrorMsg(T_("Invalid minsize: %s\n"), ua->argv[i]);
+      return false;
+    }
+  }
+  if ((i = FindArgWithValue(ua, "maxsize")) >= 0) {
+    if (!size_to_uint64(ua->argv[i], &max_size)) {
+      ua->ErrorMsg(T_("Invalid maxsize: %s\n"), ua->argv[i]);
+      return false;
+    }
+  }
+  if ((i = FindArgWithValue(ua, "minmtime")) >= 0) {
+    if (!Is_a_number(ua->argv[i])) {
+      ua->ErrorMsg(T_("Invalid minmtime: %s\n"), ua->argv[i]);
+      return false;
+    }
+    min_mtime = str_to_int64(ua->argv[i]);
+  }
+  if ((i = FindArgWithValue(ua, "maxmtime")) >= 0) {
+    if (!Is_a_number(ua->argv[i])) {
+      ua->ErrorMsg(T_("Invalid maxmtime: %s\n"), ua->argv[i]);
+      return false;
+    }
+    max_mtime = str_to_int64(ua->argv[i]);
+  }
 
   if (!ua->guid) { ua->guid = new_guid_list(); }
 
+  ReplicaDbScope replica(ua, true, filtered_jobids.c_str());
   Bvfs fs(ua->jcr, ua->db);
   fs.SetJobids(filtered_jobids.c_str());
   fs.SetHandler(BvfsResultHandler, ua);
   fs.SetLimit(limit);
   if (pattern) { fs.SetPattern(pattern); }
+  fs.SetSizeRange(min_size, max_size);
+  fs.SetMTimeRange(min_mtime, max_mtime);
   if (pathid) {
     fs.ChDir(pathid);
   } else {
@@ -513,6 +547,7 @@ bool DotBvfsLsdirsCmd(UaContext* ua, const char*)
 
   if (!ua->guid) { ua->guid = new_guid_list(); }
 
+  ReplicaDbScope replica(ua, true, filtered_jobids.c_str());
   Bvfs fs(ua->jcr, ua->db);
   fs.SetJobids(filtered_jobids.c_str());
 
@@ -567,6 +602,7 @@ bool DotBvfsVersionsCmd(UaContext* ua, const char*)
 
   if (!ua->guid) { ua->guid = new_guid_list(); }
 
+  ReplicaDbScope replica(ua, true);
   Bvfs fs(ua->jcr, ua->db);
   fs.SetSeeAllVersions(versions);
   fs.SetSeeCopies(copies);
@@ -584,6 +620,157 @@ bool DotBvfsVersionsCmd(UaContext* ua, const char*)
   return true;
 }
 
+// Output of .bvfs_find, see 0084_bvfs_find_files_4 for the row layout
+static int BvfsFindHandler(void* ctx, int, char** row)
+{
+  UaContext* ua = (UaContext*)ctx;
+  int32_t LinkFI = 0;
+
+  ua->send->ObjectStart();
+  ua->send->ObjectKeyValue("JobId", str_to_uint64(row[0]), "%lld\t");
+  ua->send->ObjectKeyValue("Job", row[1]);
+  ua->send->ObjectKeyValue("Client", row[2], "%s\t");
+  ua->send->ObjectKeyValue("StartTime", row[3], "%s\t");
+  ua->send->ObjectKeyValue("Version", str_to_uint64(row[9]), "%lld\t");
+  ua->send->ObjectKeyValue("FileId", str_to_uint64(row[4]));
+  ua->send->ObjectKeyValue("PathId", str_to_uint64(row[5]));
+  ua->send->ObjectKeyValue("Path", row[6], "%s");
+  ua->send->ObjectKeyValue("Name", row[7], "%s\n");
+  ua->send->ObjectKeyValue("lstat", row[8]);
+  BvfsStat(ua, row[8], &LinkFI);
+  ua->send->ObjectKeyValue("LinkFileIndex", LinkFI);
+  ua->send->ObjectEnd();
+
+  return 0;
+}
+
+static int BvfsFindNameHandler(void* ctx, int, char** row)
+{
+  std::vector<std::string>* names = (std::vector<std::string>*)ctx;
+
+  if (row[0]) { names->emplace_back(row[0]); }
+  return 0;
+}
+
+/**
+ * Build the part of the where clause of .bvfs_find that restricts the
+ * result to the jobs, clients and filesets allowed under the current ACLs.
+ * Filtering in the query keeps limit and offset working. Returns false if
+ * nothing at all is allowed.
+ */
+static bool BvfsFindAclFilter(UaContext* ua, PoolMem& filter)
+{
+  static const struct {
+    int acl;
+    const char* names_query;
+    const char* condition;
+  } restrictions[] = {
+      {Job_ACL, "SELECT DISTINCT Name FROM Job", " AND Job.Name IN (%s) "},
+      {Client_ACL, "SELECT Name FROM Client", " AND Client.Name IN (%s) "},
+      {FileSet_ACL, "SELECT DISTINCT FileSet FROM FileSet",
+       " AND Job.FileSetId IN "
+       "(SELECT FileSetId FROM FileSet WHERE FileSet IN (%s)) "},
+  };
+  PoolMem condition(PM_MESSAGE);
+
+  for (const auto& restriction : restrictions) {
+    if (ua->AclNoRestrictions(restriction.acl)) { continue; }
+
+    std::vector<std::string> names;
+    if (!ua->db->SqlQuery(restriction.names_query, BvfsFindNameHandler,
+                          &names)) {
+      return false;
+    }
+
+    std::string allowed;
+    for (const auto& name : names) {
+      if (!ua->AclAccessOk(restriction.acl, name.c_str(), false)) {
+        continue;
+      }
+      std::vector<char> esc(name.size() * 2 + 1);
+      ua->db->EscapeString(ua->jcr, esc.data(), name.c_str(), name.size());
+      if (!allowed.empty()) { allowed += ","; }
+      allowed += "'";
+      allowed += esc.data();
+      allowed += "'";
+    }
+    if (allowed.empty()) { return false; }
+
+    Mmsg(condition, restriction.condition, allowed.c_str());
+    PmStrcat(filter, condition.c_str());
+  }
+
+  return true;
+}
+
+/**
+ * .bvfs_find name=<pattern> [path=<pattern>] [client=<client-name>]
+ * [limit=<limit>] [offset=<offset>]
+ *
+ * Search all backups for files whose name (and path) contains the pattern,
+ * * and ? can be used as wildcards. Lists every backed up version.
+ */
+bool DotBvfsFindCmd(UaContext* ua, const char*)
+{
+  int pos;
+  int limit = 1000, offset = 0;
+  const char* name = nullptr;
+  const char* path = nullptr;
+  PoolMem filter(PM_MESSAGE);
+
+  if ((pos = FindArgWithValue(ua, NT_("name"))) < 0) {
+    ua->ErrorMsg(T_("Can't find name argument\n"));
+    return false;
+  }
+  name = ua->argv[pos];
+
+  // The trigram indexes only help with at least three characters
+  int search_len = 0;
+  for (const char* p = name; *p; p++) {
+    if (*p != '*' && *p != '?') { search_len++; }
+  }
+  if (search_len < 3) {
+    ua->ErrorMsg(T_("name must contain at least 3 characters\n"));
+    return false;
+  }
+
+  if ((pos = FindArgWithValue(ua, NT_("path"))) >= 0) { path = ua->argv[pos]; }
+  if ((pos = FindArgWithValue(ua, NT_("limit"))) >= 0
+      && Is_a_number(ua->argv[pos])) {
+    limit = str_to_int64(ua->argv[pos]);
+  }
+  if ((pos = FindArgWithValue(ua, NT_("offset"))) >= 0
+      && Is_a_number(ua->argv[pos])) {
+    offset = str_to_int64(ua->argv[pos]);
+  }
+
+  if (!OpenClientDb(ua, true)) { return false; }
+
+  ReplicaDbScope replica(ua, true);
+  if ((pos = FindArgWithValue(ua, NT_("client"))) >= 0) {
+    const char* client = ua->argv[pos];
+    if (!ua->AclAccessOk(Client_ACL, client)) {
+      ua->ErrorMsg(T_("Unauthorized command from this console.\n"));
+      return false;
+    }
+    std::vector<char> esc(strlen(client) * 2 + 1);
+    ua->db->EscapeString(ua->jcr, esc.data(), client, strlen(client));
+    Mmsg(filter, " AND Client.Name = '%s' ", esc.data());
+  }
+
+  ua->send->ArrayStart("files");
+  if (BvfsFindAclFilter(ua, filter)) {
+    Bvfs fs(ua->jcr, ua->db);
+    fs.SetHandler(BvfsFindHandler, ua);
+    fs.SetLimit(limit);
+    fs.SetOffset(offset);
+    fs.FindFiles(name, path, filter.c_str());
+  }
+  ua->send->ArrayEnd("files");
+
+  return true;
+}
+
 /**
  * .bvfs_get_jobids jobid=1
  *  -> returns needed jobids to restore
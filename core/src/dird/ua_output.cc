@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2012 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2016 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -324,6 +324,8 @@ bool show_cmd(UaContext* ua, const char*)
  *  list files ujobid=name
  *  list pools                  - list pool records
  *  list jobtotals              - list totals for all jobs
+ *  list jobtotals client       - list totals per client
+ *  list jobtotals pool         - list totals per pool
  *  list media                  - list media for given pool (deprecated)
  *  list volumes                - list Volumes
  *  list clients                - list clients
@@ -614,6 +616,7 @@ static bool DoListCmd(UaContext* ua, const char* cmd, e_list_type llist)
   const int secs_in_hour = 3600;
 
   if (!OpenClientDb(ua, true)) { return true; }
+  ReplicaDbScope replica(ua);
 
   Dmsg1(20, "list: %s\n", cmd);
 
@@ -740,8 +743,14 @@ static bool DoListCmd(UaContext* ua, const char* cmd, e_list_type llist)
                            poolname, schedtime, optionslist.last,
                            optionslist.count, ua->send, llist);
   } else if (Bstrcasecmp(ua->argk[1], NT_("jobtotals"))) {
-    // List JOBTOTALS
-    ua->db->ListJobTotals(ua->jcr, &jr, ua->send);
+    // List JOBTOTALS [client | pool]
+    auto grouping = BareosDb::JobTotalsGrouping::kByJob;
+    if (FindArg(ua, NT_("client")) > 1) {
+      grouping = BareosDb::JobTotalsGrouping::kByClient;
+    } else if (FindArg(ua, NT_("pool")) > 1) {
+      grouping = BareosDb::JobTotalsGrouping::kByPool;
+    }
+    ua->db->ListJobTotals(ua->jcr, &jr, ua->send, grouping);
   } else if ((Bstrcasecmp(ua->argk[1], NT_("jobid"))
               || Bstrcasecmp(ua->argk[1], NT_("ujobid")))
              && ua->argv[1]) {
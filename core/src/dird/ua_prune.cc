@@ -3,7 +3,7 @@
 
    Copyright (C) 2002-2009 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2016 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -40,6 +40,9 @@
 #include "lib/edit.h"
 #include "lib/parse_conf.h"
 
+#include <algorithm>
+#include <chrono>
+
 namespace directordaemon {
 
 /* Forward referenced functions */
@@ -171,6 +174,20 @@ bool PruneCmd(UaContext* ua, const char*)
 
   switch (kw) {
     case 0: /* prune files */
+      if (FindArg(ua, NT_("all")) >= 0) {
+        if (ua->AclHasRestrictions(Client_ACL)
+            || ua->AclHasRestrictions(Pool_ACL)) {
+          ua->ErrorMsg(permission_denied_message, "client and pool");
+          return false;
+        }
+        if (FindArg(ua, NT_("yes")) < 0
+            && (!GetYesno(ua, T_("Prune Files of all clients and pools "
+                                 "(yes/no): "))
+                || !ua->pint32_val)) {
+          return false;
+        }
+        return PruneAllFiles(ua);
+      }
 
       if (!(client = get_client_resource(ua))) { return false; }
 
@@ -194,6 +211,21 @@ bool PruneCmd(UaContext* ua, const char*)
 
       return true;
     case 1: { /* prune jobs */
+      if (FindArg(ua, NT_("all")) >= 0) {
+        if (ua->AclHasRestrictions(Client_ACL)
+            || ua->AclHasRestrictions(Pool_ACL)) {
+          ua->ErrorMsg(permission_denied_message, "client and pool");
+          return false;
+        }
+        if (FindArg(ua, NT_("yes")) < 0
+            && (!GetYesno(ua, T_("Prune Jobs of all clients and pools "
+                                 "(yes/no): "))
+                || !ua->pint32_val)) {
+          return false;
+        }
+        return PruneAllJobs(ua);
+      }
+
       if (!(client = get_client_resource(ua))) { return false; }
 
       if ((FindArgWithValue(ua, NT_("pool")) >= 0)
@@ -775,6 +807,380 @@ bool PruneJobs(UaContext* ua, ClientResource* client, PoolResource* pool)
   return true;
 }
 
+/* Pruning all clients and pools at once.
+ *
+ * Instead of running the queries of PruneFiles() and PruneJobs() for every
+ * client and pool, the retention periods of all configured clients and pools
+ * are put into two temporary lookup tables and the expired jobs of the whole
+ * catalog are selected with a few joins against them. The retention rules
+ * are the same: the File/Job Retention of the pool if it is set, else that
+ * of the client, and jobs of clients no longer in the configuration are
+ * left alone. The selected jobs are then deleted in batches, so no single
+ * statement or transaction grows with the size of the catalog. */
+
+// Default number of jobs deleted together by prune files all/jobs all.
+static constexpr int kPruneAllBatchSize = 1000;
+
+// Rows inserted into a lookup table with one statement.
+static constexpr int kRetentionRowsPerInsert = 500;
+
+struct RetentionRow {
+  const char* name;
+  utime_t file_retention;
+  utime_t job_retention;
+};
+
+static void DropPruneAllTables(UaContext* ua)
+{
+  ua->db->SqlQuery("DROP TABLE IF EXISTS PruneClientRetention");
+  ua->db->SqlQuery("DROP TABLE IF EXISTS PrunePoolRetention");
+  ua->db->SqlQuery("DROP TABLE IF EXISTS PrunePairs");
+  ua->db->SqlQuery("DROP TABLE IF EXISTS PruneKeep");
+}
+
+static bool FillRetentionTable(UaContext* ua,
+                               const char* table,
+                               const std::vector<RetentionRow>& rows)
+{
+  PoolMem query(PM_MESSAGE), tmp(PM_MESSAGE);
+  char esc[MAX_ESCAPE_NAME_LENGTH], ed1[50], ed2[50];
+
+  Mmsg(query,
+       "CREATE TEMPORARY TABLE %s (Name TEXT PRIMARY KEY, "
+       "FileRetention BIGINT NOT NULL, JobRetention BIGINT NOT NULL)",
+       table);
+  if (!ua->db->SqlQuery(query.c_str())) {
+    ua->ErrorMsg("%s", ua->db->strerror());
+    return false;
+  }
+
+  for (size_t i = 0; i < rows.size(); i += kRetentionRowsPerInsert) {
+    Mmsg(query, "INSERT INTO %s (Name, FileRetention, JobRetention) VALUES ",
+         table);
+    size_t end = std::min(rows.size(), i + kRetentionRowsPerInsert);
+    for (size_t j = i; j < end; j++) {
+      ua->db->EscapeString(ua->jcr, esc, rows[j].name, strlen(rows[j].name));
+      Mmsg(tmp, "%s('%s',%s,%s)", j == i ? "" : ",", esc,
+           edit_int64(rows[j].file_retention, ed1),
+           edit_int64(rows[j].job_retention, ed2));
+      PmStrcat(query, tmp.c_str());
+    }
+    if (!ua->db->SqlQuery(query.c_str())) {
+      ua->ErrorMsg("%s", ua->db->strerror());
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Build the lookup tables from the retention periods in the configuration.
+static bool CreateRetentionTables(UaContext* ua)
+{
+  std::vector<RetentionRow> rows;
+
+  DropPruneAllTables(ua);
+
+  ClientResource* client = nullptr;
+  foreach_res (client, R_CLIENT) {
+    rows.push_back(
+        {client->resource_name_, client->FileRetention, client->JobRetention});
+  }
+  if (!FillRetentionTable(ua, "PruneClientRetention", rows)) { return false; }
+
+  rows.clear();
+  PoolResource* pool = nullptr;
+  foreach_res (pool, R_POOL) {
+    rows.push_back(
+        {pool->resource_name_, pool->FileRetention, pool->JobRetention});
+  }
+  if (!FillRetentionTable(ua, "PrunePoolRetention", rows)) { return false; }
+
+  ua->db->SqlQuery("ANALYZE PruneClientRetention");
+  ua->db->SqlQuery("ANALYZE PrunePoolRetention");
+
+  return true;
+}
+
+/* FROM and WHERE clause selecting the jobs whose File (Job) Retention has
+ * expired, with the pool retention taking precedence over the one of the
+ * client like in prune_set_filter(). */
+static void AllExpiredFilter(PoolMem& from,
+                             PoolMem& where,
+                             const char* retention)
+{
+  char ed1[50];
+
+  Mmsg(from,
+       "Job "
+       "JOIN Client USING (ClientId) "
+       "JOIN PruneClientRetention ClientRet ON ClientRet.Name = Client.Name "
+       "LEFT JOIN Pool USING (PoolId) "
+       "LEFT JOIN PrunePoolRetention PoolRet ON PoolRet.Name = Pool.Name ");
+  Mmsg(where,
+       "Job.JobTDate < %s - COALESCE(NULLIF(PoolRet.%s, 0), ClientRet.%s) ",
+       edit_int64((utime_t)time(NULL), ed1), retention, retention);
+}
+
+static int GetPruneBatchSize(UaContext* ua)
+{
+  int i = FindArgWithValue(ua, NT_("batch"));
+  if (i >= 0) {
+    int batch_size = str_to_int64(ua->argv[i]);
+    if (batch_size > 0) { return batch_size; }
+    ua->WarningMsg(T_("Invalid batch size \"%s\", using %d.\n"), ua->argv[i],
+                   kPruneAllBatchSize);
+  }
+  return kPruneAllBatchSize;
+}
+
+static double SecondsSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                       - start)
+      .count();
+}
+
+/* Remove the jobs in prune_list in batches, or only their File records.
+ * Every batch takes the catalog lock on its own, so other jobs can use the
+ * catalog in between. */
+static void PurgeInBatches(UaContext* ua,
+                           std::vector<JobId_t>& prune_list,
+                           bool files_only,
+                           int batch_size,
+                           int64_t& jobs,
+                           int64_t& files)
+{
+  PrepareJobidsTobedeleted(ua, prune_list);
+
+  for (size_t i = 0; i < prune_list.size(); i += batch_size) {
+    size_t end = std::min(prune_list.size(), i + batch_size);
+    BStringList jobids;
+    for (size_t j = i; j < end; j++) {
+      jobids.emplace_back(std::to_string(prune_list[j]));
+    }
+
+    DbLocker _{ua->db};
+    if (files_only) {
+      files += ua->db->PurgeFiles(jobids.Join(',').c_str());
+      jobs += end - i;
+    } else {
+      int64_t batch_files = 0;
+      jobs += ua->db->PurgeJobs(jobids.Join(',').c_str(), &batch_files);
+      files += batch_files;
+    }
+    Dmsg2(100, "prune all: %lld of %lld jobs done\n", (long long)end,
+          (long long)prune_list.size());
+  }
+}
+
+// Prune the File records of all clients and pools.
+bool PruneAllFiles(UaContext* ua)
+{
+  auto start = std::chrono::steady_clock::now();
+  std::vector<JobId_t> prune_list;
+  PoolMem from(PM_MESSAGE), where(PM_MESSAGE), query(PM_MESSAGE);
+  int batch_size = GetPruneBatchSize(ua);
+
+  ua->SendMsg(T_("Begin pruning Files of all clients and pools.\n"));
+  {
+    DbLocker _{ua->db};
+    if (!CreateRetentionTables(ua)) {
+      DropPruneAllTables(ua);
+      return false;
+    }
+
+    AllExpiredFilter(from, where, "FileRetention");
+    Mmsg(query,
+         "SELECT JobId FROM %s WHERE Job.PurgedFiles=0 AND %s ORDER BY JobId",
+         from.c_str(), where.c_str());
+    Dmsg1(050, "select sql=%s\n", query.c_str());
+    if (!ua->db->SqlQuery(query.c_str(), FileDeleteHandler,
+                          static_cast<void*>(&prune_list))) {
+      ua->ErrorMsg("%s", ua->db->strerror());
+    }
+    DropPruneAllTables(ua);
+  }
+
+  int64_t jobs = 0, files = 0;
+  char ed1[50], ed2[50];
+  PurgeInBatches(ua, prune_list, true, batch_size, jobs, files);
+  ua->InfoMsg(T_("Pruned %s File records of %s Jobs from catalog in %.1f "
+                 "seconds.\n"),
+              edit_uint64_with_commas(files, ed1),
+              edit_uint64_with_commas(jobs, ed2), SecondsSince(start));
+
+  return true;
+}
+
+/* Fill PruneKeep with the jobs needed to restore the latest state of every
+ * client and fileset in pairs, i.e. what AccurateGetJobids() returns for an
+ * incremental backup, for all of them with one statement. */
+static bool CreateKeepTable(UaContext* ua,
+                            const std::vector<accurate_check_ctx>& pairs)
+{
+  PoolMem query(PM_MESSAGE), tmp(PM_MESSAGE);
+  char ed1[50], ed2[50], date[MAX_TIME_LENGTH];
+
+  if (!ua->db->SqlQuery("CREATE TEMPORARY TABLE PrunePairs ("
+                        "ClientId INTEGER, FileSetId INTEGER)")
+      || !ua->db->SqlQuery("CREATE TEMPORARY TABLE PruneKeep ("
+                           "JobId INTEGER)")) {
+    return false;
+  }
+
+  for (size_t i = 0; i < pairs.size(); i += kRetentionRowsPerInsert) {
+    PmStrcpy(query, "INSERT INTO PrunePairs (ClientId, FileSetId) VALUES ");
+    size_t end = std::min(pairs.size(), i + kRetentionRowsPerInsert);
+    for (size_t j = i; j < end; j++) {
+      Mmsg(tmp, "%s(%s,%s)", j == i ? "" : ",",
+           edit_int64(pairs[j].ClientId, ed1),
+           edit_int64(pairs[j].FileSetId, ed2));
+      PmStrcat(query, tmp.c_str());
+    }
+    if (!ua->db->SqlQuery(query.c_str())) { return false; }
+  }
+
+  bstrutime(date, sizeof(date), time(NULL) + 1);
+  Mmsg(query,
+       "INSERT INTO PruneKeep (JobId) "
+       "WITH Pairs AS ("
+       " SELECT DISTINCT ClientId, FileSetId, FileSet.FileSet "
+       " FROM PrunePairs JOIN FileSet USING (FileSetId)), "
+       "LastFull AS ("
+       " SELECT DISTINCT ON (Pairs.ClientId, Pairs.FileSetId)"
+       "  Pairs.ClientId, Pairs.FileSetId, Pairs.FileSet, Job.JobId,"
+       "  Job.EndTime"
+       " FROM Pairs JOIN Job ON Job.ClientId = Pairs.ClientId"
+       "  AND Job.FileSetId = Pairs.FileSetId"
+       " WHERE Job.Level = 'F' AND Job.JobStatus IN ('T','W')"
+       "  AND Job.Type = 'B' AND Job.StartTime < '%s'"
+       " ORDER BY Pairs.ClientId, Pairs.FileSetId, Job.JobId DESC), "
+       "LastDiff AS ("
+       " SELECT DISTINCT ON (LastFull.ClientId, LastFull.FileSetId)"
+       "  LastFull.ClientId, LastFull.FileSetId, Job.JobId, Job.EndTime"
+       " FROM LastFull JOIN FileSet ON FileSet.FileSet = LastFull.FileSet"
+       " JOIN Job ON Job.ClientId = LastFull.ClientId"
+       "  AND Job.FileSetId = FileSet.FileSetId"
+       " WHERE Job.Level = 'D' AND Job.JobFiles > 0"
+       "  AND Job.JobStatus IN ('T','W') AND Job.Type = 'B'"
+       "  AND Job.StartTime > LastFull.EndTime AND Job.StartTime < '%s'"
+       " ORDER BY LastFull.ClientId, LastFull.FileSetId, Job.JobTDate DESC) "
+       "SELECT JobId FROM LastFull "
+       "UNION SELECT JobId FROM LastDiff "
+       "UNION SELECT Job.JobId"
+       " FROM LastFull LEFT JOIN LastDiff USING (ClientId, FileSetId)"
+       " JOIN FileSet ON FileSet.FileSet = LastFull.FileSet"
+       " JOIN Job ON Job.ClientId = LastFull.ClientId"
+       "  AND Job.FileSetId = FileSet.FileSetId"
+       " WHERE Job.Level = 'I' AND Job.JobStatus IN ('T','W')"
+       "  AND Job.Type = 'B' AND Job.StartTime < '%s'"
+       "  AND Job.StartTime > GREATEST(LastFull.EndTime, LastDiff.EndTime)",
+       date, date, date);
+  Dmsg1(050, "keep sql=%s\n", query.c_str());
+  if (!ua->db->SqlQuery(query.c_str())) { return false; }
+
+  // The base jobs the kept jobs refer to have to stay as well
+  return ua->db->SqlQuery(
+      "INSERT INTO PruneKeep (JobId) "
+      "SELECT DISTINCT BaseJobId "
+      "FROM Job JOIN BaseFiles USING (JobId) "
+      "WHERE Job.HasBase = 1 AND Job.JobId IN (SELECT JobId FROM PruneKeep)");
+}
+
+/* Prune the Job records of all clients and pools, with the same exceptions
+ * as PruneJobs(). */
+bool PruneAllJobs(UaContext* ua)
+{
+  auto start = std::chrono::steady_clock::now();
+  std::vector<JobId_t> prune_list;
+  PoolMem from(PM_MESSAGE), where(PM_MESSAGE), query(PM_MESSAGE);
+  int batch_size = GetPruneBatchSize(ua);
+
+  ua->SendMsg(T_("Begin pruning Jobs of all clients and pools.\n"));
+  {
+    DbLocker _{ua->db};
+    DropTempTables(ua);
+    if (!CreateTempTables(ua) || !CreateRetentionTables(ua)) {
+      DropPruneAllTables(ua);
+      DropTempTables(ua);
+      return false;
+    }
+
+    AllExpiredFilter(from, where, "JobRetention");
+    Mmsg(query,
+         "INSERT INTO DelCandidates "
+         "SELECT JobId, PurgedFiles, FileSetId, JobFiles, JobStatus "
+         "FROM %s WHERE Job.Type NOT IN ('A') AND %s",
+         from.c_str(), where.c_str());
+    Dmsg1(050, "select sql=%s\n", query.c_str());
+    if (!ua->db->SqlQuery(query.c_str())) {
+      ua->ErrorMsg("%s", ua->db->strerror());
+      DropPruneAllTables(ua);
+      DropTempTables(ua);
+      return false;
+    }
+
+    /* Client and fileset of the candidates, as in PruneJobs(), the jobs
+     * needed to restore their latest backup are kept. */
+    std::vector<accurate_check_ctx> accurate_job_check;
+    Mmsg(query,
+         "SELECT DISTINCT Job.Name, FileSet, Client.Name, Job.FileSetId, "
+         "Job.ClientId, Job.Type "
+         "FROM DelCandidates "
+         "JOIN Job USING (JobId) "
+         "JOIN Client USING (ClientId) "
+         "JOIN FileSet ON (Job.FileSetId = FileSet.FileSetId) "
+         "WHERE Job.Type IN ('B') "
+         "AND Job.JobStatus IN ('T', 'W') ");
+    if (!ua->db->SqlQuery(query.c_str(), JobSelectHandler,
+                          &accurate_job_check)
+        || !CreateKeepTable(ua, accurate_job_check)) {
+      ua->ErrorMsg("%s", ua->db->strerror());
+      DropPruneAllTables(ua);
+      DropTempTables(ua);
+      return false;
+    }
+
+    // Keep the latest Verify level=InitCatalog job of each client and pool
+    Mmsg(query,
+         "INSERT INTO PruneKeep (JobId) "
+         "SELECT DISTINCT ON (Job.ClientId, Job.PoolId) JobId "
+         "FROM DelCandidates JOIN Job USING (JobId) "
+         "WHERE Job.Type = 'V' AND Job.Level = 'V' "
+         "ORDER BY Job.ClientId, Job.PoolId, Job.JobTDate DESC");
+    if (!ua->db->SqlQuery(query.c_str())
+        || !ua->db->SqlQuery("DELETE FROM DelCandidates "
+                             "WHERE JobId IN (SELECT JobId FROM PruneKeep) "
+                             "AND JobFiles != 0")) {
+      ua->ErrorMsg("%s", ua->db->strerror());
+      DropPruneAllTables(ua);
+      DropTempTables(ua);
+      return false;
+    }
+
+    if (!ua->db->SqlQuery("SELECT DISTINCT JobId FROM DelCandidates "
+                          "ORDER BY JobId",
+                          JobDeleteHandler, static_cast<void*>(&prune_list))) {
+      ua->ErrorMsg("%s", ua->db->strerror());
+    }
+    DropPruneAllTables(ua);
+    DropTempTables(ua);
+  }
+
+  ExcludeRunningJobsFromList(prune_list);
+
+  int64_t jobs = 0, files = 0;
+  char ed1[50], ed2[50];
+  PurgeInBatches(ua, prune_list, false, batch_size, jobs, files);
+  ua->InfoMsg(T_("Pruned %s Jobs with %s File records from catalog in %.1f "
+                 "seconds.\n"),
+              edit_uint64_with_commas(jobs, ed1),
+              edit_uint64_with_commas(files, ed2), SecondsSince(start));
+
+  return true;
+}
+
 // Prune a given Volume
 bool PruneVolume(UaContext* ua, MediaDbRecord* mr)
 {
@@ -31,6 +31,8 @@ struct del_ctx;
 
 bool PruneFiles(UaContext* ua, ClientResource* client, PoolResource* pool);
 bool PruneJobs(UaContext* ua, ClientResource* client, PoolResource* pool);
+bool PruneAllFiles(UaContext* ua);
+bool PruneAllJobs(UaContext* ua);
 bool PruneVolume(UaContext* ua, MediaDbRecord* mr);
 int JobDeleteHandler(void* ctx, int num_fields, char** row);
 int DelCountHandler(void* ctx, int num_fields, char** row);
@@ -3,7 +3,7 @@
 
    Copyright (C) 2002-2011 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2016 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -1250,10 +1250,14 @@ static bool BuildDirectoryTree(UaContext* ua, RestoreContext* rx)
   ua->LogAuditEventInfoMsg(T_("Building directory tree for JobId(s) %s"),
                            rx->JobIds);
 
-  if (!ua->db->GetFileList(ua->jcr, rx->JobIds, false /* do not use md5 */,
-                           true /* get delta */, InsertTreeHandler,
-                           (void*)&tree)) {
-    ua->ErrorMsg("%s", ua->db->strerror());
+  {
+    // Reading the files of big jobs is left to the replica, if possible.
+    ReplicaDbScope replica(ua, true, rx->JobIds);
+    if (!ua->db->GetFileList(ua->jcr, rx->JobIds, false /* do not use md5 */,
+                             true /* get delta */, InsertTreeHandler,
+                             (void*)&tree)) {
+      ua->ErrorMsg("%s", ua->db->strerror());
+    }
   }
 
   if (*rx->BaseJobIds) {
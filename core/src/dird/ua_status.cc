@@ -3,7 +3,7 @@
 
    Copyright (C) 2001-2012 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2016 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -61,6 +61,7 @@ static void ListScheduledJobs(UaContext* ua);
 static void ListRunningJobs(UaContext* ua);
 static void ListTerminatedJobs(UaContext* ua);
 static void ListConnectedClients(UaContext* ua);
+static void ListCatalogConnectionPools(UaContext* ua);
 static void DoDirectorStatus(UaContext* ua);
 static void DoSchedulerStatus(UaContext* ua);
 static bool DoSubscriptionStatus(UaContext* ua);
@@ -783,6 +784,7 @@ static void DoDirectorStatus(UaContext* ua)
   ListRunningJobs(ua);
   ListTerminatedJobs(ua);
   ListConnectedClients(ua);
+  ListCatalogConnectionPools(ua);
   ua->SendMsg("====\n");
 }
 
@@ -1293,6 +1295,56 @@ static void ListConnectedClients(UaContext* ua)
   ua->send->ArrayEnd("client-connection");
 }
 
+static void ListCatalogConnectionPools(UaContext* ua)
+{
+  std::vector<SqlPoolStatistics> pools = DbSqlPoolStatistics();
+  const char* separator = "====================";
+
+  if (pools.empty()) { return; }
+
+  ua->send->Decoration("\n");
+  ua->send->Decoration("Catalog Connection Pools:\n");
+  ua->send->Decoration("%-20s%-14s%-14s%10s%10s%10s%10s%10s%10s%10s\n",
+                       "Database", "Interactive", "Batch", "Requests",
+                       "Reused", "Shared", "Opened", "Unpooled", "Invalid",
+                       "Idle");
+  ua->send->Decoration("%-20s%-14.14s%-14.14s%10.10s%10.10s%10.10s%10.10s"
+                       "%10.10s%10.10s%10.10s\n",
+                       separator, separator, separator, separator, separator,
+                       separator, separator, separator, separator, separator);
+  ua->send->ArrayStart("catalog-connection-pools");
+  for (auto& pool : pools) {
+    PoolMem interactive, batch;
+
+    Mmsg(interactive, "%d/%d", pool.interactive_in_use,
+         pool.interactive_connections);
+    Mmsg(batch, "%d/%d", pool.batch_in_use, pool.batch_connections);
+
+    ua->send->ObjectStart();
+    ua->send->ObjectKeyValue("database", pool.db_name.c_str(), "%-20s");
+    ua->send->ObjectKeyValue("address", pool.db_address.c_str());
+    ua->send->ObjectKeyValue("port", pool.db_port);
+    ua->send->ObjectKeyValue("min_connections", pool.min_connections);
+    ua->send->ObjectKeyValue("max_connections", pool.max_connections);
+    ua->send->ObjectKeyValue("interactive_connections",
+                             pool.interactive_connections);
+    ua->send->ObjectKeyValue("interactive_in_use", pool.interactive_in_use);
+    ua->send->ObjectKeyValue("batch_connections", pool.batch_connections);
+    ua->send->ObjectKeyValue("batch_in_use", pool.batch_in_use);
+    ua->send->Decoration("%-14s%-14s", interactive.c_str(), batch.c_str());
+    ua->send->ObjectKeyValue("requests", pool.requests, "%10llu");
+    ua->send->ObjectKeyValue("reused", pool.reused, "%10llu");
+    ua->send->ObjectKeyValue("shared", pool.shared, "%10llu");
+    ua->send->ObjectKeyValue("opened", pool.opened, "%10llu");
+    ua->send->ObjectKeyValue("unpooled", pool.unpooled, "%10llu");
+    ua->send->ObjectKeyValue("invalid", pool.invalid, "%10llu");
+    ua->send->ObjectKeyValue("idle_closed", pool.idle_closed, "%10llu");
+    ua->send->ObjectEnd();
+    ua->send->Decoration("\n");
+  }
+  ua->send->ArrayEnd("catalog-connection-pools");
+}
+
 static void ContentSendInfoApi(UaContext* ua,
                                char type,
                                int Slot,
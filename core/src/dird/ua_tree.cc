@@ -3,7 +3,7 @@
 
    Copyright (C) 2002-2011 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2016 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -215,6 +215,10 @@ bool UserSelectFilesFromTree(TreeContext* tree)
  * See uar_sel_files in sql_cmds.c for query that calls us.
  * row[0]=Path, row[1]=Filename, row[2]=FileIndex
  * row[3]=JobId row[4]=LStat row[5]=DeltaSeq row[6]=Fhinfo row[7]=Fhnode
+ * row[8]=Mode row[9]=NLink row[10]=LinkFI
+ *
+ * Mode, NLink and LinkFI are NULL for files that were backed up before the
+ * File table had typed stat columns, they are then decoded from LStat.
  */
 int InsertTreeHandler(void* ctx, int, char** row)
 {
@@ -239,7 +243,13 @@ int InsertTreeHandler(void* ctx, int, char** row)
   } else {
     type = TN_FILE;
   }
-  DecodeStat(row[4], &statp, sizeof(statp), &LinkFI);
+  if (row[8] && *row[8] && row[9] && *row[9] && row[10] && *row[10]) {
+    statp.st_mode = str_to_int64(row[8]);
+    statp.st_nlink = str_to_int64(row[9]);
+    LinkFI = str_to_int64(row[10]);
+  } else {
+    DecodeStat(row[4], &statp, sizeof(statp), &LinkFI);
+  }
   hard_link = (LinkFI != 0);
   node = insert_tree_node(row[0], row[1], type, tree->root, NULL);
   JobId = str_to_int64(row[3]);
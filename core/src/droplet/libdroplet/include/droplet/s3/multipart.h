@@ -56,5 +56,9 @@ dpl_status_t dpl_s3_stream_multipart_put(dpl_ctx_t* ctx,
                                          char* buf,
                                          unsigned int len,
                                          const char** etagp);
+dpl_status_t dpl_s3_stream_multipart_abort(dpl_ctx_t* ctx,
+                                           const char* bucket,
+                                           const char* resource,
+                                           const char* uploadid);
 
 #endif  // BAREOS_DROPLET_LIBDROPLET_INCLUDE_DROPLET_S3_MULTIPART_H_
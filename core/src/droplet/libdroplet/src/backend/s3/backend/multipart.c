@@ -582,3 +582,103 @@ end:
 
   return ret;
 }
+
+/*
+ * Abort a multipart upload, so the server drops the parts uploaded so far
+ * instead of keeping (and billing) them until a lifecycle rule cleans up.
+ */
+dpl_status_t dpl_s3_stream_multipart_abort(dpl_ctx_t* ctx,
+                                           const char* bucket,
+                                           const char* resource,
+                                           const char* uploadid)
+{
+  dpl_status_t ret;
+  dpl_conn_t* conn = NULL;
+  char header[dpl_header_size];
+  u_int header_len;
+  struct iovec iov[10];
+  int n_iov = 0;
+  int connection_close = 0;
+  dpl_dict_t* headers_request = NULL;
+  dpl_dict_t* headers_reply = NULL;
+  dpl_req_t* req = NULL;
+  char subresource[strlen(uploadid) + 10 /* for 'uploadId=' */];
+
+  snprintf(subresource, sizeof(subresource), "uploadId=%s", uploadid);
+
+  req = dpl_req_new(ctx);
+  if (NULL == req) {
+    ret = DPL_ENOMEM;
+    goto end;
+  }
+
+  dpl_req_set_method(req, DPL_METHOD_DELETE);
+
+  if (NULL == bucket) {
+    ret = DPL_EINVAL;
+    goto end;
+  }
+
+  ret = dpl_req_set_bucket(req, bucket);
+  if (DPL_SUCCESS != ret) goto end;
+
+  ret = dpl_req_set_resource(req, resource);
+  if (DPL_SUCCESS != ret) goto end;
+
+  ret = dpl_req_set_subresource(req, subresource);
+  if (DPL_SUCCESS != ret) goto end;
+
+  ret = dpl_s3_req_build(req, 0u, &headers_request);
+  if (DPL_SUCCESS != ret) goto end;
+
+  ret = dpl_try_connect(ctx, req, &conn);
+  if (DPL_SUCCESS != ret) goto end;
+
+  ret = dpl_add_host_to_headers(req, headers_request);
+  if (DPL_SUCCESS != ret) goto end;
+
+  ret = dpl_s3_add_authorization_to_headers(req, headers_request, NULL, NULL);
+  if (DPL_SUCCESS != ret) goto end;
+
+  ret = dpl_req_gen_http_request(ctx, req, headers_request, NULL, header,
+                                 sizeof(header), &header_len);
+  if (DPL_SUCCESS != ret) goto end;
+
+  iov[n_iov].iov_base = header;
+  iov[n_iov].iov_len = header_len;
+  n_iov++;
+
+  // final crlf
+  iov[n_iov].iov_base = "\r\n";
+  iov[n_iov].iov_len = 2;
+  n_iov++;
+
+  ret = dpl_conn_writev_all(conn, iov, n_iov, conn->ctx->write_timeout);
+  if (DPL_SUCCESS != ret) {
+    DPL_TRACE(conn->ctx, DPL_TRACE_ERR, "writev failed");
+    connection_close = 1;
+    goto end;
+  }
+
+  ret = dpl_read_http_reply(conn, 1, NULL, NULL, &headers_reply,
+                            &connection_close);
+  if (DPL_SUCCESS != ret) goto end;
+
+  ret = DPL_SUCCESS;
+
+end:
+  if (NULL != conn) {
+    if (1 == connection_close)
+      dpl_conn_terminate(conn);
+    else
+      dpl_conn_release(conn);
+  }
+
+  if (NULL != headers_reply) dpl_dict_free(headers_reply);
+
+  if (NULL != headers_request) dpl_dict_free(headers_request);
+
+  if (NULL != req) dpl_req_free(req);
+
+  return ret;
+}
@@ -0,0 +1,138 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+
+#include "filed/adaptive_compression.h"
+
+#include <cctype>
+#include <cstring>
+
+namespace filedaemon {
+
+// Longer ones are most likely not an extension but part of the name
+static constexpr std::size_t kMaxExtensionLength = 10;
+
+std::string AdaptiveCompression::Extension(const char* fname)
+{
+  const char* base = fname;
+  for (const char* p = fname; *p; p++) {
+    if (*p == '/' || *p == '\\') { base = p + 1; }
+  }
+  const char* dot = strrchr(base, '.');
+  if (!dot || dot == base) { return {}; }
+
+  std::string ext{dot + 1};
+  if (ext.size() > kMaxExtensionLength) { return {}; }
+  for (auto& c : ext) {
+    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  }
+  return ext;
+}
+
+bool AdaptiveCompression::Incompressible(const Stats& stats) const
+{
+  // allow for the odd compressible file, e.g. an uncompressed pdf
+  return stats.files >= kLearnFiles
+         && stats.incompressible * 10 >= stats.files * 9;
+}
+
+bool AdaptiveCompression::StartFile(const char* fname, std::uint64_t size)
+{
+  std::lock_guard lock(mutex_);
+  current_ = &extensions_[Extension(fname)];
+  file_ = Stats{};
+  file_stored_ = 0;
+
+  if (Incompressible(*current_)
+      && ++current_->skipped % kResampleInterval != 0) {
+    mode_ = Mode::kStore;
+    file_stored_ = size;
+    return false;
+  }
+  mode_ = Mode::kSample;
+  return true;
+}
+
+bool AdaptiveCompression::CompressBlock()
+{
+  std::lock_guard lock(mutex_);
+  return mode_ != Mode::kStore;
+}
+
+void AdaptiveCompression::BlockCompressed(std::size_t in,
+                                          std::size_t out,
+                                          std::chrono::nanoseconds time)
+{
+  std::lock_guard lock(mutex_);
+  file_.in += in;
+  file_.out += out;
+  file_.time += time;
+  if (mode_ == Mode::kSample && file_.in >= kSampleBytes) {
+    mode_ = file_.out > file_.in * (1.0 - kMinSavings) ? Mode::kStore
+                                                       : Mode::kCompress;
+  }
+}
+
+void AdaptiveCompression::BlockStored(std::size_t bytes)
+{
+  std::lock_guard lock(mutex_);
+  file_stored_ += bytes;
+}
+
+void AdaptiveCompression::FinishFile()
+{
+  std::lock_guard lock(mutex_);
+  if (!current_) { return; }
+
+  if (file_.in > 0) {
+    current_->files++;
+    if (file_.out > file_.in * (1.0 - kMinSavings)) {
+      current_->incompressible++;
+    }
+    current_->in += file_.in;
+    current_->out += file_.out;
+    current_->time += file_.time;
+  }
+
+  if (file_stored_ > 0) {
+    skipped_bytes_ += file_stored_;
+    // price the skipped data like what was compressed of it
+    const Stats& rate = file_.in > 0 ? file_ : *current_;
+    if (rate.in > 0) {
+      cpu_saved_ += std::chrono::nanoseconds(static_cast<std::int64_t>(
+          static_cast<double>(rate.time.count()) * file_stored_ / rate.in));
+    }
+  }
+  current_ = nullptr;
+}
+
+std::uint64_t AdaptiveCompression::SkippedBytes() const
+{
+  std::lock_guard lock(mutex_);
+  return skipped_bytes_;
+}
+
+std::chrono::milliseconds AdaptiveCompression::CpuSaved() const
+{
+  std::lock_guard lock(mutex_);
+  return std::chrono::duration_cast<std::chrono::milliseconds>(cpu_saved_);
+}
+
+}  // namespace filedaemon
@@ -0,0 +1,102 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+
+#ifndef BAREOS_FILED_ADAPTIVE_COMPRESSION_H_
+#define BAREOS_FILED_ADAPTIVE_COMPRESSION_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace filedaemon {
+
+/* Decides per file whether compressing its data is worth the cpu time.
+ *
+ * The first kSampleBytes of every file are compressed as usual; if that
+ * saved less than kMinSavings the rest of the file is sent as stored
+ * (COMPRESS_NONE) blocks. What was learned is kept per file extension for
+ * the rest of the job: once the files of an extension turned out to be
+ * incompressible, further files with it are not compressed at all, except
+ * for every kResampleInterval'th one which is sampled again.
+ *
+ * Files are started and finished by the thread reading them, blocks may be
+ * accounted by the compression workers concurrently. */
+class AdaptiveCompression {
+ public:
+  static constexpr std::size_t kSampleBytes = 128 * 1024;
+  static constexpr double kMinSavings = 0.1;
+  static constexpr std::uint32_t kLearnFiles = 4;
+  static constexpr std::uint32_t kResampleInterval = 32;
+
+  /* Start the next file of size bytes, returns false if it should not be
+   * compressed at all because of what was learned about its extension. The
+   * whole file then counts as skipped, no blocks are accounted for it. */
+  bool StartFile(const char* fname, std::uint64_t size);
+  // Whether the next block of the current file should be compressed.
+  bool CompressBlock();
+  // A block of the current file was compressed from in to out bytes.
+  void BlockCompressed(std::size_t in,
+                       std::size_t out,
+                       std::chrono::nanoseconds time);
+  // A block of the current file was sent without compression.
+  void BlockStored(std::size_t bytes);
+  void FinishFile();
+
+  std::uint64_t SkippedBytes() const;
+  // Estimated from the time it took to compress the sampled data.
+  std::chrono::milliseconds CpuSaved() const;
+
+  static std::string Extension(const char* fname);
+
+ private:
+  struct Stats {
+    std::uint32_t files{};          /**< Files sampled */
+    std::uint32_t incompressible{}; /**< Sampled files that were not worth it */
+    std::uint32_t skipped{};        /**< Files not compressed at all */
+    std::uint64_t in{};             /**< Sampled bytes */
+    std::uint64_t out{};            /**< Sampled bytes after compression */
+    std::chrono::nanoseconds time{}; /**< Time spent compressing samples */
+  };
+  enum class Mode
+  {
+    kSample,
+    kCompress,
+    kStore
+  };
+
+  bool Incompressible(const Stats& stats) const;
+
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, Stats> extensions_;
+  Stats* current_{};
+  Mode mode_{Mode::kCompress};
+  Stats file_{};
+  std::uint64_t file_stored_{};
+  std::uint64_t skipped_bytes_{};
+  std::chrono::nanoseconds cpu_saved_{};
+};
+
+}  // namespace filedaemon
+
+#endif  // BAREOS_FILED_ADAPTIVE_COMPRESSION_H_
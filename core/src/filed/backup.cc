@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2011 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -515,6 +515,7 @@ int SaveFile(JobControlRecord* jcr, FindFilesPacket* ff_pkt, bool)
   int rtnstat = 0;
   b_save_ctx bsctx;
   bool has_file_data = false;
+  bool adaptive_compression = false;
   save_pkt sp; /* use by option plugin */
   BareosSocket* sd = jcr->store_bsock;
 
@@ -696,6 +697,17 @@ int SaveFile(JobControlRecord* jcr, FindFilesPacket* ff_pkt, bool)
     plugin_started = true;
   }
 
+  /* Files of a type that did not compress so far are not compressed at all,
+   * this has to be known before the data stream is selected. */
+  adaptive_compression = has_file_data && BitIsSet(FO_COMPRESS, ff_pkt->flags)
+                         && BitIsSet(FO_ADAPTIVE_COMPRESS, ff_pkt->flags);
+  if (!adaptive_compression) {
+    ClearBit(FO_ADAPTIVE_COMPRESS, ff_pkt->flags);
+  } else if (!jcr->fd_impl->adaptive_compression.StartFile(
+                 ff_pkt->fname, ff_pkt->statp.st_size)) {
+    ClearBit(FO_COMPRESS, ff_pkt->flags);
+  }
+
   // Send attributes -- must be done after binit()
   if (!EncodeAndSendAttributes(jcr, ff_pkt, data_stream)) { goto bail_out; }
 
@@ -779,6 +791,11 @@ int SaveFile(JobControlRecord* jcr, FindFilesPacket* ff_pkt, bool)
     if (!status) { goto bail_out; }
   }
 
+  if (adaptive_compression) {
+    jcr->fd_impl->adaptive_compression.FinishFile();
+    ClearBit(FO_ADAPTIVE_COMPRESS, ff_pkt->flags);
+  }
+
   if (have_darwin_os) {
     // Regular files can have resource forks and Finder Info
     if (ff_pkt->type != FT_LNKSAVED
@@ -900,10 +917,29 @@ static inline bool SendDataToSd(b_ctx* bctx)
 
   // Compress the data.
   if (BitIsSet(FO_COMPRESS, bctx->ff_pkt->flags)) {
-    if (!CompressData(bctx->jcr, bctx->ff_pkt->Compress_algo, bctx->rbuf,
-                      bctx->jcr->store_bsock->message_length, bctx->cbuf,
-                      bctx->max_compress_len, &bctx->compress_len)) {
-      return false;
+    auto& adaptive = bctx->jcr->fd_impl->adaptive_compression;
+    bool is_adaptive = BitIsSet(FO_ADAPTIVE_COMPRESS, bctx->ff_pkt->flags);
+    uint32_t magic = bctx->ch.magic;
+
+    if (is_adaptive && !adaptive.CompressBlock()
+        && static_cast<uint32_t>(sd->message_length)
+               <= bctx->max_compress_len) {
+      // Not worth it, send the block as it is.
+      memcpy(bctx->cbuf, bctx->rbuf, sd->message_length);
+      bctx->compress_len = sd->message_length;
+      magic = COMPRESS_NONE;
+      adaptive.BlockStored(sd->message_length);
+    } else {
+      auto start = std::chrono::steady_clock::now();
+      if (!CompressData(bctx->jcr, bctx->ff_pkt->Compress_algo, bctx->rbuf,
+                        bctx->jcr->store_bsock->message_length, bctx->cbuf,
+                        bctx->max_compress_len, &bctx->compress_len)) {
+        return false;
+      }
+      if (is_adaptive) {
+        adaptive.BlockCompressed(sd->message_length, bctx->compress_len,
+                                 std::chrono::steady_clock::now() - start);
+      }
     }
 
     // See if we need to generate a compression header.
@@ -912,7 +948,7 @@ static inline bool SendDataToSd(b_ctx* bctx)
 
       // Complete header
       SerBegin(bctx->chead, sizeof(comp_stream_header));
-      ser_uint32(bctx->ch.magic);
+      ser_uint32(magic);
       ser_uint32(bctx->compress_len);
       ser_uint16(bctx->ch.level);
       ser_uint16(bctx->ch.version);
@@ -1018,15 +1054,42 @@ bail_out:
 }
 #endif
 
+/**
+ * Holes of sparse files are not read at all if the filesystem can tell
+ * where they are, otherwise the blocks of zeros are dropped after reading
+ * them.
+ */
+static SparseBlockSkipper MakeSparseBlockSkipper(b_ctx& bctx)
+{
+  FindFilesPacket* ff_pkt = bctx.ff_pkt;
+  boffset_t file_size = 0;
+
+  if (BitIsSet(FO_SPARSE, ff_pkt->flags) && S_ISREG(ff_pkt->statp.st_mode)) {
+    file_size = ff_pkt->statp.st_size;
+  }
+
+  return SparseBlockSkipper(&ff_pkt->bfd, file_size, bctx.rsize);
+}
+
 static inline bool SendPlainDataSerially(b_ctx& bctx)
 {
   bool retval = false;
   BareosSocket* sd = bctx.jcr->store_bsock;
+  SparseBlockSkipper skipper = MakeSparseBlockSkipper(bctx);
 
   // Read the file data
-  while ((sd->message_length
-          = (uint32_t)bread(&bctx.ff_pkt->bfd, bctx.rbuf, bctx.rsize))
-         > 0) {
+  for (;;) {
+    boffset_t pos = skipper.Skip(bctx.fileAddr);
+    if (pos < 0) {
+      sd->message_length = -1;
+      break;
+    }
+    bctx.fileAddr = pos;
+
+    sd->message_length
+        = (uint32_t)bread(&bctx.ff_pkt->bfd, bctx.rbuf, bctx.rsize);
+    if (sd->message_length <= 0) { break; }
+
     if (!SendDataToSd(&bctx)) { goto bail_out; }
   }
   retval = true;
@@ -1186,6 +1249,34 @@ struct compression_context {
   int level;
 };
 
+static void WriteCompressionHeader(char* buf,
+                                   const comp_stream_header& ch,
+                                   uint32_t magic,
+                                   uint32_t size)
+{
+  ser_declare;
+  SerBegin(buf, sizeof(comp_stream_header));
+  ser_uint32(magic);
+  ser_uint32(size);
+  ser_uint16(ch.level);
+  ser_uint16(ch.version);
+  SerEnd(buf, sizeof(comp_stream_header));
+}
+
+// Wrap a block that is not worth compressing into a stored one.
+static shared_message DoStoreMessage(const compression_context& compctx,
+                                     const data_message& input)
+{
+  auto msg = input.derived();
+  msg.resize(input.data_size() + sizeof(comp_stream_header));
+  memcpy(msg.data_ptr() + sizeof(comp_stream_header), input.data_ptr(),
+         input.data_size());
+  WriteCompressionHeader(msg.data_ptr(), compctx.ch, COMPRESS_NONE,
+                         input.data_size());
+
+  return shared_message{new data_message{std::move(msg)}};
+}
+
 static result<shared_message> DoCompressMessage(compression_context& compctx,
                                                 const data_message& input)
 {
@@ -1212,16 +1303,7 @@ static result<shared_message> DoCompressMessage(compression_context& compctx,
     return error;
   }
 
-  {
-    // Write compression header
-    ser_declare;
-    SerBegin(msg.data_ptr(), sizeof(comp_stream_header));
-    ser_uint32(compctx.ch.magic);
-    ser_uint32(csize);
-    ser_uint16(compctx.ch.level);
-    ser_uint16(compctx.ch.version);
-    SerEnd(msg.data_ptr(), sizeof(comp_stream_header));
-  }
+  WriteCompressionHeader(msg.data_ptr(), compctx.ch, compctx.ch.magic, csize);
 
   auto total_size = csize + sizeof(comp_stream_header);
   ASSERT(total_size <= msg.data_size());
@@ -1271,6 +1353,11 @@ static inline bool SendPlainData(b_ctx& bctx)
     };
   }
 
+  AdaptiveCompression* adaptive = nullptr;
+  if (compctx && BitIsSet(FO_ADAPTIVE_COMPRESS, flags)) {
+    adaptive = &bctx.jcr->fd_impl->adaptive_compression;
+  }
+
   auto& threadpool = bctx.jcr->fd_impl->threads;
 
   work_group compute_group(num_workers * 3);
@@ -1299,8 +1386,11 @@ static inline bool SendPlainData(b_ctx& bctx)
 
   std::uint64_t bytes_read{0};
   std::uint64_t offset{0};
+  std::uint64_t file_addr{0};
+
+  std::uint64_t& header = *(support_sparse ? &file_addr : &offset);
 
-  std::uint64_t& header = *(support_sparse ? &bytes_read : &offset);
+  SparseBlockSkipper skipper = MakeSparseBlockSkipper(bctx);
 
   static_assert(sizeof(header) == OFFSET_FADDR_SIZE);
   bool include_header = support_sparse || support_offsets;
@@ -1312,6 +1402,13 @@ static inline bool SendPlainData(b_ctx& bctx)
     data_message msg(max_buf_size);
     for (bool skip_block = true; skip_block;) {
       skip_block = false;
+      boffset_t pos = skipper.Skip(file_addr);
+      if (pos < 0) {
+        read_error = true;
+        goto end_read_loop;
+      }
+      file_addr = pos;
+
       ssize_t read_bytes = bread(&bfd, msg.data_ptr(), msg.data_size());
       // update offset _before_ sending the header
       offset = bfd.offset;
@@ -1340,7 +1437,7 @@ static inline bool SendPlainData(b_ctx& bctx)
        */
       if (support_sparse
           && ((msg.data_size() == max_buf_size
-               && (msg.data_size() + max_buf_size < (uint64_t)file_size))
+               && (file_addr + msg.data_size() < (uint64_t)file_size))
               || unsized_file)
           // IsBufZero actually requires 8 bytes of alignment
           && IsBufZero(msg.data_ptr(), msg.data_size())) {
@@ -1349,7 +1446,8 @@ static inline bool SendPlainData(b_ctx& bctx)
         msg.set_header(header);
       }
 
-      // update bytes_read _after_ sending the header
+      // update file_addr _after_ sending the header
+      file_addr += read_bytes;
       bytes_read += read_bytes;
     }
     ASSERT(msg.data_size() > 0);
@@ -1377,11 +1475,25 @@ static inline bool SendPlainData(b_ctx& bctx)
     }
 
     std::future<result<shared_message>> copy_fut;
-    if (compctx) {
+    if (adaptive && !adaptive->CompressBlock()) {
+      adaptive->BlockStored(shared_msg->data_size());
       copy_fut = compute_group.submit(
-          [cctx = compctx.value(), shared_msg]() mutable {
-            return DoCompressMessage(cctx, *shared_msg.get());
+          [cctx = compctx.value(), shared_msg]() -> result<shared_message> {
+            return DoStoreMessage(cctx, *shared_msg.get());
           });
+    } else if (compctx) {
+      copy_fut = compute_group.submit([cctx = compctx.value(), shared_msg,
+                                       adaptive]() mutable {
+        auto start = std::chrono::steady_clock::now();
+        auto res = DoCompressMessage(cctx, *shared_msg.get());
+        if (adaptive && !res.holds_error()) {
+          adaptive->BlockCompressed(
+              shared_msg->data_size(),
+              res.value_unchecked()->data_size() - sizeof(comp_stream_header),
+              std::chrono::steady_clock::now() - start);
+        }
+        return res;
+      });
     } else {
       std::promise<result<shared_message>> prom;
       prom.set_value(std::move(shared_msg));
@@ -229,7 +229,8 @@ static char OKsetdebugv1[]
 static char BADjob[] = "2901 Bad Job\n";
 static char EndJob[]
     = "2800 End Job TermCode=%d JobFiles=%u ReadBytes=%s"
-      " JobBytes=%s Errors=%u VSS=%d Encrypt=%d\n";
+      " JobBytes=%s Errors=%u VSS=%d Encrypt=%d"
+      " CompressSkipped=%s CompressCpuSaved=%s\n";
 static char OKRunBeforeNow[] = "2000 OK RunBeforeNow\n";
 static char OKRunScript[] = "2000 OK RunScript\n";
 static char FailedRunScript[] = "2905 Failed RunScript\n";
@@ -296,19 +297,10 @@ void CleanupFileset(JobControlRecord* jcr)
       for (int j = 0; j < incexe->opts_list.size(); j++) {
         fo = (findFOPTS*)incexe->opts_list.get(j);
         if (fo->plugin) { free(fo->plugin); }
-        for (int k = 0; k < fo->regex.size(); k++) {
-          regfree((regex_t*)fo->regex.get(k));
-        }
-        for (int k = 0; k < fo->regexdir.size(); k++) {
-          regfree((regex_t*)fo->regexdir.get(k));
-        }
-        for (int k = 0; k < fo->regexfile.size(); k++) {
-          regfree((regex_t*)fo->regexfile.get(k));
-        }
         if (fo->size_match) { free(fo->size_match); }
-        fo->regex.destroy();
-        fo->regexdir.destroy();
-        fo->regexfile.destroy();
+        delete fo->regex;
+        delete fo->regexdir;
+        delete fo->regexfile;
         fo->wild.destroy();
         fo->wilddir.destroy();
         fo->wildfile.destroy();
@@ -330,9 +322,9 @@ void CleanupFileset(JobControlRecord* jcr)
       for (int j = 0; j < incexe->opts_list.size(); j++) {
         fo = (findFOPTS*)incexe->opts_list.get(j);
         if (fo->size_match) { free(fo->size_match); }
-        fo->regex.destroy();
-        fo->regexdir.destroy();
-        fo->regexfile.destroy();
+        delete fo->regex;
+        delete fo->regexdir;
+        delete fo->regexfile;
         fo->wild.destroy();
         fo->wilddir.destroy();
         fo->wildfile.destroy();
@@ -458,12 +450,15 @@ void* process_director_commands(JobControlRecord* jcr, BareosSocket* dir)
   }
 
   if (jcr->JobId) { /* send EndJob if running a job */
-    char ed1[50], ed2[50];
+    char ed1[50], ed2[50], ed3[50], ed4[50];
+    auto& adaptive = jcr->fd_impl->adaptive_compression;
     // Send termination status back to Dir
     dir->fsend(EndJob, jcr->getJobStatus(), jcr->JobFiles,
                edit_uint64(jcr->ReadBytes, ed1),
                edit_uint64(jcr->JobBytes, ed2), jcr->JobErrors,
-               jcr->fd_impl->enable_vss, jcr->fd_impl->crypto.pki_encrypt);
+               jcr->fd_impl->enable_vss, jcr->fd_impl->crypto.pki_encrypt,
+               edit_uint64(adaptive.SkippedBytes(), ed3),
+               edit_uint64(adaptive.CpuSaved().count(), ed4));
     Dmsg1(110, "End FD msg: %s\n", dir->msg);
   }
 
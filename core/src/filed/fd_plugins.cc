@@ -2020,6 +2020,9 @@ static bRC bareosGetValue(PluginContext* ctx, bVariable var, void* value)
     case bVarVersion:
       *(const char**)value = kBareosVersionStrings.FullWithDate;
       break;
+    case bVarPythonPluginOwnGil:
+      *static_cast<bool*>(value) = me->python_plugin_own_gil;
+      break;
     case bVarDistName:
       /* removed, as this value was never used by any plugin */
       return bRC_Error;
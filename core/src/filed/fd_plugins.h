@@ -212,6 +212,7 @@ typedef enum
   bVarPrefixLinks = 19,
   bVarCheckChanges = 20,
   bVarUsedConfig = 21,
+  bVarPythonPluginOwnGil = 22,
 } bVariable;
 
 // Events that are passed to plugin
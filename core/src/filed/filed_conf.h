@@ -94,6 +94,7 @@ class ClientResource
   char* working_directory = nullptr;
   char* plugin_directory = nullptr; /* Plugin directory */
   alist<const char*>* plugin_names = nullptr;
+  bool python_plugin_own_gil = false; /* Python plugins get their own GIL */
   char* scripts_directory = nullptr;
   MessagesResource* messages = nullptr; /* Daemon message handler */
   uint32_t MaxConcurrentJobs = 0;
@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2012 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -25,7 +25,9 @@
 #define BAREOS_FILED_FILED_JCR_IMPL_H_
 
 #include "include/bareos.h"
+#include "filed/adaptive_compression.h"
 #include "lib/crypto.h"
+#include "lib/event_loop.h"
 #include "lib/thread_pool.h"
 
 #include <atomic>
@@ -35,6 +37,7 @@ struct XattrData;
 
 namespace filedaemon {
 class BareosAccurateFilelist;
+struct SdHeartbeatReader;
 }
 
 /* clang-format off */
@@ -71,13 +74,13 @@ struct FiledJcrImpl {
   uint32_t EndFile{};
   uint32_t StartBlock{};
   uint32_t EndBlock{};
-  pthread_t heartbeat_id{};       /**< Id of heartbeat thread */
-  std::atomic<bool> hb_initialized_once{};    /**< Heartbeat initialized */
-  std::atomic<bool> hb_running{};             /**< Heartbeat running */
-  std::shared_ptr<BareosSocket> hb_bsock;     /**< Duped SD socket */
+  EventLoop::EventId hb_sd_watch{};           /**< Reads heartbeats from SD */
+  EventLoop::EventId hb_dir_timer{};          /**< Sends heartbeats to DIR */
+  std::shared_ptr<filedaemon::SdHeartbeatReader> hb_sd_reader; /**< Reads the duped SD socket */
   std::shared_ptr<BareosSocket> hb_dir_bsock; /**< Duped DIR socket */
   alist<RunScript*>* RunScripts{};            /**< Commands to run before and after job */
   CryptoContext crypto;           /**< Crypto ctx */
+  filedaemon::AdaptiveCompression adaptive_compression; /**< Compression bypass */
   filedaemon::DirectorResource* director{}; /**< Director resource */
   bool enable_vss{};              /**< VSS used by FD */
   bool got_metadata{};            /**< Set when found job_metadata */
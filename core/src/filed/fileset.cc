@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2011 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -191,33 +191,28 @@ void SetIncexe(JobControlRecord* jcr, findIncludeExcludeItem* incexe)
 int AddRegexToFileset(JobControlRecord* jcr, const char* item, int type)
 {
   findFOPTS* current_opts = start_options(jcr->fd_impl->ff);
-  regex_t* preg;
-  int rc;
-  char prbuf[500];
+  RegexSet** regexes;
+  std::string errmsg;
 
-  preg = (regex_t*)malloc(sizeof(regex_t));
-  if (BitIsSet(FO_IGNORECASE, current_opts->flags)) {
-    rc = regcomp(preg, item, REG_EXTENDED | REG_ICASE);
-  } else {
-    rc = regcomp(preg, item, REG_EXTENDED);
-  }
-  if (rc != 0) {
-    regerror(rc, preg, prbuf, sizeof(prbuf));
-    regfree(preg);
-    free(preg);
-    Jmsg(jcr, M_FATAL, 0, T_("REGEX %s compile error. ERR=%s\n"), item, prbuf);
-    return state_error;
-  }
   if (type == ' ') {
-    current_opts->regex.append(preg);
+    regexes = &current_opts->regex;
   } else if (type == 'D') {
-    current_opts->regexdir.append(preg);
+    regexes = &current_opts->regexdir;
   } else if (type == 'F') {
-    current_opts->regexfile.append(preg);
+    regexes = &current_opts->regexfile;
   } else {
     return state_error;
   }
 
+  if (!*regexes) { *regexes = new RegexSet; }
+  int cflags = REG_EXTENDED;
+  if (BitIsSet(FO_IGNORECASE, current_opts->flags)) { cflags |= REG_ICASE; }
+  if (!(*regexes)->Add(item, cflags, errmsg)) {
+    Jmsg(jcr, M_FATAL, 0, T_("REGEX %s compile error. ERR=%s\n"), item,
+         errmsg.c_str());
+    return state_error;
+  }
+
   return state_options;
 }
 
@@ -489,6 +484,8 @@ static int SetOptionsAndFlags(findFOPTS* fo, const char* opts)
             fo->Compress_algo = COMPRESS_FZ4H;
             fo->Compress_level = 1; /* not used with FZ4H */
           }
+        } else if (*p == 'a') {
+          SetBit(FO_ADAPTIVE_COMPRESS, fo->flags);
         }
         break;
       case 'z': /* Min, max or approx size or size range */
@@ -3,7 +3,7 @@
 
    Copyright (C) 2003-2012 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2022 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -34,196 +34,152 @@
 #include "filed/filed_globals.h"
 #include "lib/bnet.h"
 #include "lib/bsock.h"
+#include "lib/event_loop.h"
 #include "lib/watchdog.h"
 
+#include <mutex>
+
 namespace filedaemon {
 
-#define WAIT_INTERVAL 5
+/* The heartbeats of all jobs are events of the shared event loop, a job
+ * does not need a thread of its own for them. */
+
+/* A worker of the event loop reading from the SD blocks until the whole
+ * message arrived. When the job ends meanwhile, the worker gets interrupted
+ * by TIMEOUT_SIGNAL, like the heartbeat thread of a job used to be. */
+struct SdHeartbeatReader {
+  std::shared_ptr<BareosSocket> sd;
+  std::mutex mutex;
+  bool reading{false};
+  pthread_t thread{};
+};
+
+// Read whatever the SD sent, probably a heartbeat
+static bool ReadSdHeartbeat(SdHeartbeatReader& reader)
+{
+  BareosSocket* sd = reader.sd.get();
 
-extern "C" void* sd_heartbeat_thread(void* arg);
-extern "C" void* dir_heartbeat_thread(void* arg);
-extern bool no_signals;
+  {
+    std::lock_guard lock(reader.mutex);
+    if (sd->IsStop()) { return false; }
+    reader.reading = true;
+    reader.thread = pthread_self();
+  }
 
-/**
- * Listen on the SD socket for heartbeat signals.
- * Send heartbeats to the Director every HB_TIME
- *   seconds.
- */
-extern "C" void* sd_heartbeat_thread(void* arg)
-{
-  int32_t n;
-  JobControlRecord* jcr = (JobControlRecord*)arg;
-  std::shared_ptr<BareosSocket> sd, dir;
-  time_t last_heartbeat = time(NULL);
-  time_t now;
+  int32_t n = sd->recv();
 
-  pthread_detach(pthread_self());
+  {
+    std::lock_guard lock(reader.mutex);
+    reader.reading = false;
+  }
 
-  // Get our own local copy
-  sd.reset(jcr->store_bsock->clone());
-  dir.reset(jcr->dir_bsock->clone());
+  if (n == BNET_HARDEOF || n == BNET_ERROR || sd->IsStop()) { return false; }
 
-  jcr->fd_impl->hb_bsock = sd;
-  jcr->fd_impl->hb_running = true;
-  jcr->fd_impl->hb_dir_bsock = dir;
-  dir->suppress_error_msgs_ = true;
-  sd->suppress_error_msgs_ = true;
-  jcr->fd_impl->hb_initialized_once
-      = true;  // initialize last to avoid race condition
-
-  /* Hang reading the socket to the SD, and every time we get
-   * a heartbeat or we get a wait timeout (5 seconds), we
-   * check to see if we need to send a heartbeat to the
-   * Director.
-   */
-  while (!sd->IsStop()) {
-    n = BnetWaitDataIntr(sd.get(), WAIT_INTERVAL);
-    if (n < 0 || sd->IsStop()) { break; }
-    if (me->heartbeat_interval) {
-      now = time(NULL);
-      if (now - last_heartbeat >= me->heartbeat_interval) {
-        dir->signal(BNET_HEARTBEAT);
-        if (dir->IsStop()) { break; }
-        last_heartbeat = now;
-      }
-    }
-    if (n == 1) { /* input waiting */
-      sd->recv(); /* read it -- probably heartbeat from sd */
-      if (sd->IsStop()) { break; }
-      if (sd->message_length <= 0) {
-        Dmsg1(100, "Got BNET_SIG %d from SD\n", sd->message_length);
-      } else {
-        Dmsg2(100, "Got %d bytes from SD. MSG=%s\n", sd->message_length,
-              sd->msg);
-      }
-    }
-    Dmsg2(200, "wait_intr=%d stop=%d\n", n, IsBnetStop(sd.get()));
+  if (sd->message_length <= 0) {
+    Dmsg1(100, "Got BNET_SIG %d from SD\n", sd->message_length);
+  } else {
+    Dmsg2(100, "Got %d bytes from SD. MSG=%s\n", sd->message_length, sd->msg);
   }
+  return true;
+}
 
-  sd->close();
-  dir->close();
-  jcr->fd_impl->hb_bsock.reset();
-  jcr->fd_impl->hb_running = false;
-  jcr->fd_impl->hb_dir_bsock = NULL;
+static void SendDirHeartbeat(BareosSocket* dir)
+{
+  if (!dir->IsStop()) { dir->signal(BNET_HEARTBEAT); }
+}
 
-  return NULL;
+static void StartDirHeartbeatTimer(JobControlRecord* jcr)
+{
+  // Get our own local copy
+  std::shared_ptr<BareosSocket> dir(jcr->dir_bsock->clone());
+  dir->suppress_error_msgs_ = true;
+
+  jcr->fd_impl->hb_dir_bsock = dir;
+  jcr->fd_impl->hb_dir_timer = EventLoop::Shared().RunEvery(
+      std::chrono::seconds(me->heartbeat_interval),
+      [dir]() { SendDirHeartbeat(dir.get()); });
 }
 
-/* Startup the heartbeat thread -- see above */
+/**
+ * Listen on the SD socket for heartbeat signals.
+ * Send heartbeats to the Director every HB_TIME
+ *   seconds.
+ */
 void StartHeartbeatMonitor(JobControlRecord* jcr)
 {
-  /*
-   * If no signals are set, do not start the heartbeat because
-   * it gives a constant stream of TIMEOUT_SIGNAL signals that
-   * make debugging impossible.
-   */
+  /* Without signals a read of the SD socket could not be interrupted when
+   * the job ends. */
   if (!no_signals) {
-    jcr->fd_impl->hb_bsock = NULL;
-    jcr->fd_impl->hb_running = false;
-    jcr->fd_impl->hb_initialized_once = false;
-    jcr->fd_impl->hb_dir_bsock = NULL;
-    pthread_create(&jcr->fd_impl->heartbeat_id, NULL, sd_heartbeat_thread,
-                   (void*)jcr);
-  }
-}
+    auto reader = std::make_shared<SdHeartbeatReader>();
 
-/* Terminate the heartbeat thread. Used for both SD and DIR */
-void StopHeartbeatMonitor(JobControlRecord* jcr)
-{
-  int cnt = 0;
-  if (no_signals) { return; }
+    // Get our own local copy
+    reader->sd.reset(jcr->store_bsock->clone());
+    reader->sd->suppress_error_msgs_ = true;
 
-  /* Wait max 10 secs for heartbeat thread to start */
-  while (!jcr->fd_impl->hb_initialized_once && cnt++ < 200) {
-    Bmicrosleep(0, 50000); /* wait for start */
+    jcr->fd_impl->hb_sd_reader = reader;
+    jcr->fd_impl->hb_sd_watch = EventLoop::Shared().WatchReadable(
+        reader->sd->fd_, [reader]() { return ReadSdHeartbeat(*reader); });
   }
 
-  if (jcr->fd_impl->hb_running) {
-    jcr->fd_impl->hb_bsock->SetTimedOut(); /* set timed_out to Terminate read */
-    jcr->fd_impl->hb_bsock->SetTerminated(); /* set to Terminate read */
-  }
+  if (me->heartbeat_interval) { StartDirHeartbeatTimer(jcr); }
+}
 
-  if (jcr->fd_impl->hb_dir_bsock) {
-    jcr->fd_impl->hb_dir_bsock
-        ->SetTimedOut(); /* set timed_out to Terminate read */
-    jcr->fd_impl->hb_dir_bsock->SetTerminated(); /* set to Terminate read */
+// Make a read of the SD socket return, so its event can be cancelled.
+static void InterruptSdHeartbeatReader(SdHeartbeatReader& reader)
+{
+  {
+    std::lock_guard lock(reader.mutex);
+    reader.sd->SetTimedOut();
+    reader.sd->SetTerminated();
   }
 
-  if (jcr->fd_impl->hb_running) {
-    Dmsg0(100, "Send kill to heartbeat id\n");
-    pthread_kill(jcr->fd_impl->heartbeat_id,
-                 TIMEOUT_SIGNAL); /* make heartbeat thread go away */
+  /* Signal again until the read is over, the first signal might arrive
+   * just before the worker starts reading. */
+  for (;;) {
+    {
+      std::lock_guard lock(reader.mutex);
+      if (!reader.reading) { break; }
+      Dmsg0(100, "Send kill to SD heartbeat reader\n");
+      pthread_kill(reader.thread, TIMEOUT_SIGNAL);
+    }
     Bmicrosleep(0, 50000);
   }
-  cnt = 0;
+}
 
-  // Wait max 100 secs for heartbeat thread to stop
-  while (jcr->fd_impl->hb_running && cnt++ < 200) {
-    pthread_kill(jcr->fd_impl->heartbeat_id,
-                 TIMEOUT_SIGNAL); /* make heartbeat thread go away */
-    Bmicrosleep(0, 500000);
+/* Terminate the heartbeats. Used for both SD and DIR */
+void StopHeartbeatMonitor(JobControlRecord* jcr)
+{
+  /* Remove the events before closing the sockets, a closed fd might get
+   * reused while still being watched. */
+  if (jcr->fd_impl->hb_sd_reader) {
+    InterruptSdHeartbeatReader(*jcr->fd_impl->hb_sd_reader);
   }
-
-  if (jcr->fd_impl->hb_bsock) {
-    // delete jcr->fd_impl_->hb_bsock;
-    jcr->fd_impl->hb_bsock.reset();
+  EventLoop::Shared().Cancel(jcr->fd_impl->hb_sd_watch);
+  EventLoop::Shared().Cancel(jcr->fd_impl->hb_dir_timer);
+  jcr->fd_impl->hb_sd_watch = 0;
+  jcr->fd_impl->hb_dir_timer = 0;
+
+  if (jcr->fd_impl->hb_sd_reader) {
+    jcr->fd_impl->hb_sd_reader->sd->close();
+    jcr->fd_impl->hb_sd_reader.reset();
   }
 
   if (jcr->fd_impl->hb_dir_bsock) {
-    // delete jcr->fd_impl_->hb_dir_bsock;
+    jcr->fd_impl->hb_dir_bsock->close();
     jcr->fd_impl->hb_dir_bsock.reset();
   }
-
-  jcr->fd_impl->hb_initialized_once = false;
 }
 
 /**
- * Thread for sending heartbeats to the Director when there
- *   is no SD monitoring needed -- e.g. restore and verify Vol
+ * Send heartbeats to the Director when there is no SD
+ *   monitoring needed -- e.g. restore and verify Vol
  *   both do their own read() on the SD socket.
  */
-extern "C" void* dir_heartbeat_thread(void* arg)
-{
-  JobControlRecord* jcr = (JobControlRecord*)arg;
-  BareosSocket* dir;
-  time_t last_heartbeat = time(NULL);
-
-  pthread_detach(pthread_self());
-
-  // Get our own local copy
-  dir = jcr->dir_bsock->clone();
-
-  jcr->fd_impl->hb_bsock.reset(dir);
-  jcr->fd_impl->hb_running = true;
-  dir->suppress_error_msgs_ = true;
-  jcr->fd_impl->hb_initialized_once
-      = true;  // initialize last to avoid race condition
-
-  while (!dir->IsStop()) {
-    time_t now, next;
-
-    now = time(NULL);
-    next = now - last_heartbeat;
-    if (next >= me->heartbeat_interval) {
-      dir->signal(BNET_HEARTBEAT);
-      if (dir->IsStop()) { break; }
-      last_heartbeat = now;
-    }
-    Bmicrosleep(next, 0);
-  }
-  dir->close();
-  jcr->fd_impl->hb_bsock.reset();
-  jcr->fd_impl->hb_running = false;
-  return NULL;
-}
-
-// Same as above but we don't listen to the SD
 void StartDirHeartbeat(JobControlRecord* jcr)
 {
   if (me->heartbeat_interval) {
     jcr->dir_bsock->SetLocking();
-    pthread_create(&jcr->fd_impl->heartbeat_id, NULL, dir_heartbeat_thread,
-                   (void*)jcr);
+    StartDirHeartbeatTimer(jcr);
   }
 }
 
@@ -2,7 +2,7 @@
    BAREOS® - Backup Archiving REcovery Open Sourced
 
    Copyright (C) 2000-2011 Free Software Foundation Europe e.V.
-   Copyright (C) 2016-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2016-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -335,10 +335,24 @@ static int ReadDigest(BareosFilePacket* bfd,
   int64_t bufsiz = (int64_t)sizeof(buf);
   FindFilesPacket* ff_pkt = (FindFilesPacket*)jcr->fd_impl->ff;
   uint64_t fileAddr = 0; /* file address */
+  boffset_t file_size = 0;
 
+  if (BitIsSet(FO_SPARSE, ff_pkt->flags) && S_ISREG(ff_pkt->statp.st_mode)) {
+    file_size = ff_pkt->statp.st_size;
+  }
+  SparseBlockSkipper skipper(bfd, file_size, bufsiz);
 
   Dmsg0(50, "=== ReadDigest\n");
-  while ((n = bread(bfd, buf, bufsiz)) > 0) {
+  for (;;) {
+    boffset_t pos = skipper.Skip(fileAddr);
+    if (pos < 0) {
+      n = -1;
+      break;
+    }
+    fileAddr = pos;
+
+    if ((n = bread(bfd, buf, bufsiz)) <= 0) { break; }
+
     /* Check for sparse blocks */
     if (BitIsSet(FO_SPARSE, ff_pkt->flags)) {
       bool allZeros = false;
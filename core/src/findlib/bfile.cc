@@ -3,7 +3,7 @@
 
    Copyright (C) 2003-2010 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -31,6 +31,9 @@
 #include <unistd.h>
 #include <netinet/in.h>
 
+#include <algorithm>
+#include <limits>
+
 #include "include/fcntl_def.h"
 #include "include/bareos.h"
 #include "include/streams.h"
@@ -918,6 +921,11 @@ boffset_t blseek(BareosFilePacket* bfd, boffset_t offset, int whence)
   return ((boffset_t)offset_high << 32) | dwResult;
 }
 
+bool BfindData(BareosFilePacket*, boffset_t, boffset_t*, boffset_t*)
+{
+  return false;
+}
+
 #else /* Unix systems */
 
 /* ===============================================================
@@ -1197,4 +1205,71 @@ boffset_t blseek(BareosFilePacket* bfd, boffset_t offset, int whence)
   bfd->BErrNo = errno;
   return pos;
 }
+
+/**
+ * Find the first region of data at or after offset, data_start is set to
+ * the largest possible offset if the rest of the file is a hole. Returns
+ * false if this cannot be determined, e.g. for plugins. The file position
+ * is undefined afterwards.
+ */
+bool BfindData(BareosFilePacket* bfd,
+               boffset_t offset,
+               boffset_t* data_start,
+               boffset_t* data_end)
+{
+#  if defined(SEEK_DATA) && defined(SEEK_HOLE)
+  if (bfd->cmd_plugin) { return false; }
+
+  boffset_t start = (boffset_t)lseek(bfd->filedes, offset, SEEK_DATA);
+  if (start < 0) {
+    bfd->BErrNo = errno;
+    if (errno != ENXIO) { return false; }
+    *data_start = *data_end = std::numeric_limits<boffset_t>::max();
+    return true;
+  }
+
+  boffset_t end = (boffset_t)lseek(bfd->filedes, start, SEEK_HOLE);
+  if (end < 0) {
+    bfd->BErrNo = errno;
+    return false;
+  }
+
+  *data_start = start;
+  *data_end = end;
+  return true;
+#  else
+  (void)bfd;
+  (void)offset;
+  (void)data_start;
+  (void)data_end;
+  return false;
+#  endif
+}
 #endif
+
+SparseBlockSkipper::SparseBlockSkipper(BareosFilePacket* bfd,
+                                       boffset_t file_size,
+                                       std::size_t block_size)
+    : bfd_(bfd), block_size_(block_size)
+{
+  if (file_size <= block_size_ || block_size_ == 0) { return; }
+
+  // the block holding the last byte is always read
+  last_block_ = (file_size - 1) / block_size_ * block_size_;
+  enabled_ = true;
+}
+
+boffset_t SparseBlockSkipper::Skip(boffset_t pos)
+{
+  if (!enabled_ || pos < data_end_ || pos >= last_block_) { return pos; }
+
+  boffset_t data_start;
+  if (!BfindData(bfd_, pos, &data_start, &data_end_)) {
+    enabled_ = false;
+    return blseek(bfd_, pos, SEEK_SET) < 0 ? -1 : pos;
+  }
+
+  boffset_t next = data_start - data_start % block_size_;
+  next = std::max(pos, std::min(next, last_block_));
+  return blseek(bfd_, next, SEEK_SET) < 0 ? -1 : next;
+}
@@ -3,7 +3,7 @@
 
    Copyright (C) 2003-2010 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2022 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -144,8 +144,37 @@ int bclose(BareosFilePacket* bfd);
 ssize_t bread(BareosFilePacket* bfd, void* buf, size_t count);
 ssize_t bwrite(BareosFilePacket* bfd, void* buf, size_t count);
 boffset_t blseek(BareosFilePacket* bfd, boffset_t offset, int whence);
+bool BfindData(BareosFilePacket* bfd,
+               boffset_t offset,
+               boffset_t* data_start,
+               boffset_t* data_end);
 const char* stream_to_ascii(int stream);
 
+/**
+ * Skips the holes of a sparse file while it is read in blocks of
+ * block_size. Only blocks lying completely inside a hole are skipped and
+ * never the last one, so exactly the blocks that the sparse option would
+ * drop as all zeros after reading them are not read at all.
+ */
+class SparseBlockSkipper {
+ public:
+  SparseBlockSkipper(BareosFilePacket* bfd,
+                     boffset_t file_size,
+                     std::size_t block_size);
+
+  /* Called before reading the block at pos. Returns the position of the
+   * next block that has to be read, which the file is positioned at, or -1
+   * on seek errors. */
+  boffset_t Skip(boffset_t pos);
+
+ private:
+  BareosFilePacket* bfd_;
+  boffset_t block_size_;
+  boffset_t last_block_{0};
+  boffset_t data_end_{0};
+  bool enabled_{false};
+};
+
 bool processWin32BackupAPIBlock(BareosFilePacket* bfd,
                                 void* pBuffer,
                                 ssize_t dwSize);
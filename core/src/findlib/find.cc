@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2012 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -319,39 +319,23 @@ bool AcceptFile(FindFilesPacket* ff)
       }
     }
 
-    if (S_ISDIR(ff->statp.st_mode)) {
-      for (k = 0; k < fo->regexdir.size(); k++) {
-        if (regexec((regex_t*)fo->regexdir.get(k), ff->fname, 0, NULL, 0)
-            == 0) {
-          if (BitIsSet(FO_EXCLUDE, ff->flags)) {
-            return false; /* reject file */
-          }
-          return true; /* accept file */
-        }
-      }
-    } else {
-      for (k = 0; k < fo->regexfile.size(); k++) {
-        if (regexec((regex_t*)fo->regexfile.get(k), ff->fname, 0, NULL, 0)
-            == 0) {
-          if (BitIsSet(FO_EXCLUDE, ff->flags)) {
-            return false; /* reject file */
-          }
-          return true; /* accept file */
-        }
-      }
+    // All regexes of a kind are matched at once, see RegexSet
+    RegexSet* regexes = S_ISDIR(ff->statp.st_mode) ? fo->regexdir
+                                                   : fo->regexfile;
+    if (regexes && regexes->Search(ff->fname)) {
+      if (BitIsSet(FO_EXCLUDE, ff->flags)) { return false; /* reject file */ }
+      return true; /* accept file */
     }
 
-    for (k = 0; k < fo->regex.size(); k++) {
-      if (regexec((regex_t*)fo->regex.get(k), ff->fname, 0, NULL, 0) == 0) {
-        if (BitIsSet(FO_EXCLUDE, ff->flags)) { return false; /* reject file */ }
-        return true; /* accept file */
-      }
+    if (fo->regex && fo->regex->Search(ff->fname)) {
+      if (BitIsSet(FO_EXCLUDE, ff->flags)) { return false; /* reject file */ }
+      return true; /* accept file */
     }
 
     // If we have an empty Options clause with exclude, then exclude the file
-    if (BitIsSet(FO_EXCLUDE, ff->flags) && fo->regex.size() == 0
-        && fo->wild.size() == 0 && fo->regexdir.size() == 0
-        && fo->wilddir.size() == 0 && fo->regexfile.size() == 0
+    if (BitIsSet(FO_EXCLUDE, ff->flags) && !fo->regex
+        && fo->wild.size() == 0 && !fo->regexdir
+        && fo->wilddir.size() == 0 && !fo->regexfile
         && fo->wildfile.size() == 0 && fo->wildbase.size() == 0) {
       Dmsg1(debuglevel, "Empty options, rejecting: %s\n", ff->fname);
       return false; /* reject file */
@@ -506,9 +490,6 @@ findFOPTS* start_options(FindFilesPacket* ff)
     ff->fileset->state = state_options;
     findFOPTS* fo = (findFOPTS*)malloc(sizeof(findFOPTS));
     *fo = findFOPTS{};
-    fo->regex.init(1, true);
-    fo->regexdir.init(1, true);
-    fo->regexfile.init(1, true);
     fo->wild.init(1, true);
     fo->wilddir.init(1, true);
     fo->wildfile.init(1, true);
@@ -530,9 +511,6 @@ void NewOptions(FindFilesPacket* ff, findIncludeExcludeItem* incexe)
 
   fo = (findFOPTS*)malloc(sizeof(findFOPTS));
   *fo = findFOPTS{};
-  fo->regex.init(1, true);
-  fo->regexdir.init(1, true);
-  fo->regexfile.init(1, true);
   fo->wild.init(1, true);
   fo->wilddir.init(1, true);
   fo->wildfile.init(1, true);
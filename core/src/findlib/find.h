@@ -3,7 +3,7 @@
 
    Copyright (C) 2001-2010 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -51,12 +51,8 @@
 #define MODE_RALL (S_IRUSR | S_IRGRP | S_IROTH)
 
 #include "lib/fnmatch.h"
+#include "lib/regex_set.h"
 
-#ifndef HAVE_REGEX_H
-#  include "lib/bregex.h"
-#else
-#  include <regex.h>
-#endif
 #ifdef USE_READDIR_R
 #  ifndef HAVE_READDIR_R
 int Readdir_r(DIR* dirp, struct dirent* entry, struct dirent** result);
@@ -133,9 +129,9 @@ struct findFOPTS {
   char AccurateOpts[MAX_OPTS]{}; /**< Accurate mode options */
   char BaseJobOpts[MAX_OPTS]{};  /**< Basejob mode options */
   char* plugin{};                /**< Plugin that handle this section */
-  alist<regex_t*> regex;         /**< Regex string(s) */
-  alist<regex_t*> regexdir;      /**< Regex string(s) for directories */
-  alist<regex_t*> regexfile;     /**< Regex string(s) for files */
+  RegexSet* regex{};             /**< Regex string(s) */
+  RegexSet* regexdir{};          /**< Regex string(s) for directories */
+  RegexSet* regexfile{};         /**< Regex string(s) for files */
   alist<const char*> wild;       /**< Wild card strings */
   alist<const char*> wilddir;    /**< Wild card strings for directories */
   alist<const char*> wildfile;   /**< Wild card strings for files */
@@ -3,7 +3,7 @@
 
    Copyright (C) 2011-2011 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -137,7 +137,7 @@ static inline bool IncludeBlockHasPatterns(findIncludeExcludeItem* incexe)
      * hardlinked so we don't take into consideration
      * - regexfile = entries
      * - wildfile = entries */
-    if (fo->regex.size() > 0 || fo->regexdir.size() > 0 || fo->wild.size() > 0
+    if (fo->regex || fo->regexdir || fo->wild.size() > 0
         || fo->wilddir.size() > 0) {
       has_find_patterns = true;
     }
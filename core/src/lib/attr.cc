@@ -2,7 +2,7 @@
    BAREOS® - Backup Archiving REcovery Open Sourced
 
    Copyright (C) 2003-2011 Free Software Foundation Europe e.V.
-   Copyright (C) 2016-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2016-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -77,7 +77,11 @@ int UnpackAttributesRecord(JobControlRecord* jcr,
    * */
   attr->stream = stream;
   Dmsg1(debuglevel, "Attr: %s\n", rec);
-  if (sscanf(rec, "%d %d", &attr->file_index, &attr->type) != 2) {
+  char* end;
+  attr->file_index = strtol(rec, &end, 10);
+  p = end;
+  attr->type = strtol(p, &end, 10);
+  if (p == rec || end == p) {
     Jmsg(jcr, M_FATAL, 0, T_("Error scanning attributes: %s\n"), rec);
     Dmsg1(debuglevel, "\nError scanning attributes. %s\n", rec);
     return 0;
@@ -98,15 +102,12 @@ int UnpackAttributesRecord(JobControlRecord* jcr,
   while (*p++ != ' ') /* skip type */
   {}
 
-  attr->fname = p;  /* set filname position */
-  while (*p++ != 0) /* skip filename */
-  {}
-  attr->attr = p;   /* set attributes position */
-  while (*p++ != 0) /* skip attributes */
-  {}
-  attr->lname = p;  /* set link position */
-  while (*p++ != 0) /* skip link */
-  {}
+  attr->fname = p;    /* set filname position */
+  p += strlen(p) + 1; /* skip filename */
+  attr->attr = p;     /* set attributes position */
+  p += strlen(p) + 1; /* skip attributes */
+  attr->lname = p;    /* set link position */
+  p += strlen(p) + 1; /* skip link */
   attr->delta_seq = 0;
   if (attr->type == FT_RESTORE_FIRST) {
     /* We have an object, so do a binary copy */
@@ -120,13 +121,11 @@ int UnpackAttributesRecord(JobControlRecord* jcr,
     PmStrcpy(attr->attrEx, p); /* copy extended attributes, if any */
     if (attr->data_stream) {
       int64_t val;
-      while (*p++ != 0) /* skip extended attributes */
-      {}
+      p += strlen(p) + 1; /* skip extended attributes */
       FromBase64(&val, p);
       attr->data_stream = (int32_t)val;
     } else {
-      while (*p++ != 0) /* skip extended attributes */
-      {}
+      p += strlen(p) + 1; /* skip extended attributes */
       if (p - rec < reclen) {
         attr->delta_seq = str_to_int32(p); /* delta_seq */
       }
@@ -2,7 +2,7 @@
    BAREOS® - Backup Archiving REcovery Open Sourced
 
    Copyright (C) 2002-2011 Free Software Foundation Europe e.V.
-   Copyright (C) 2016-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2016-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -109,11 +109,48 @@ template <typename T> static void plug(T& st, uint64_t val)
   st = static_cast<T>(val);
 }
 
+/* Fields of a stat packet as written by EncodeStat() */
+enum
+{
+  kStatDev,
+  kStatIno,
+  kStatMode,
+  kStatNlink,
+  kStatUid,
+  kStatGid,
+  kStatRdev,
+  kStatSize,
+  kStatBlksize,
+  kStatBlocks,
+  kStatAtime,
+  kStatMtime,
+  kStatCtime,
+  kStatLinkFI,     /* optional */
+  kStatFlags,      /* optional */
+  kStatDataStream, /* optional */
+  kStatFields
+};
+
+/* Split a stat packet into its fields in a single pass. Returns the number
+ * of fields found, parsing stops at the end of the string. */
+static int DecodeStatFields(const char* buf, int64_t* values)
+{
+  const char* p = buf;
+  int n = 0;
+
+  while (n < kStatFields) {
+    p += FromBase64(&values[n++], p);
+    if (*p != ' ') { break; }
+    p++;
+  }
+  return n;
+}
+
 // Decode a stat packet from base64 characters
 int DecodeStat(char* buf, struct stat* statp, int stat_size, int32_t* LinkFI)
 {
-  char* p = buf;
-  int64_t val;
+  int64_t values[kStatFields] = {};
+  int fields;
 
   /* We store into the stat packet so make sure the caller's conception
    *  is the same as ours.  They can be different if LARGEFILE is not
@@ -121,81 +158,36 @@ int DecodeStat(char* buf, struct stat* statp, int stat_size, int32_t* LinkFI)
   ASSERT(stat_size == (int)sizeof(struct stat));
   memset(statp, 0, stat_size);
 
-  p += FromBase64(&val, p);
-  plug(statp->st_dev, val);
-  p++;
-  p += FromBase64(&val, p);
-  plug(statp->st_ino, val);
-  p++;
-  p += FromBase64(&val, p);
-  plug(statp->st_mode, val);
-  p++;
-  p += FromBase64(&val, p);
-  plug(statp->st_nlink, val);
-  p++;
-  p += FromBase64(&val, p);
-  plug(statp->st_uid, val);
-  p++;
-  p += FromBase64(&val, p);
-  plug(statp->st_gid, val);
-  p++;
-  p += FromBase64(&val, p);
-  plug(statp->st_rdev, val);
-  p++;
-  p += FromBase64(&val, p);
-  plug(statp->st_size, val);
-  p++;
+  fields = DecodeStatFields(buf, values);
+
+  plug(statp->st_dev, values[kStatDev]);
+  plug(statp->st_ino, values[kStatIno]);
+  plug(statp->st_mode, values[kStatMode]);
+  plug(statp->st_nlink, values[kStatNlink]);
+  plug(statp->st_uid, values[kStatUid]);
+  plug(statp->st_gid, values[kStatGid]);
+  plug(statp->st_rdev, values[kStatRdev]);
+  plug(statp->st_size, values[kStatSize]);
 #ifndef HAVE_MINGW
-  p += FromBase64(&val, p);
-  plug(statp->st_blksize, val);
-  p++;
-  p += FromBase64(&val, p);
-  plug(statp->st_blocks, val);
-  p++;
-#else
-  p += FromBase64(&val, p);
-  //   plug(statp->st_blksize, val);
-  p++;
-  p += FromBase64(&val, p);
-  //   plug(statp->st_blocks, val);
-  p++;
+  plug(statp->st_blksize, values[kStatBlksize]);
+  plug(statp->st_blocks, values[kStatBlocks]);
 #endif
-  p += FromBase64(&val, p);
-  plug(statp->st_atime, val);
-  p++;
-  p += FromBase64(&val, p);
-  plug(statp->st_mtime, val);
-  p++;
-  p += FromBase64(&val, p);
-  plug(statp->st_ctime, val);
+  plug(statp->st_atime, values[kStatAtime]);
+  plug(statp->st_mtime, values[kStatMtime]);
+  plug(statp->st_ctime, values[kStatCtime]);
 
   /* Optional FileIndex of hard linked file data */
-  if (*p == ' ' || (*p != 0 && *(p + 1) == ' ')) {
-    p++;
-    p += FromBase64(&val, p);
-    *LinkFI = (uint32_t)val;
-  } else {
+  if (fields <= kStatLinkFI) {
     *LinkFI = 0;
     return 0;
   }
+  *LinkFI = (uint32_t)values[kStatLinkFI];
 
   /* FreeBSD user flags */
-  if (*p == ' ' || (*p != 0 && *(p + 1) == ' ')) {
-    p++;
-    p += FromBase64(&val, p);
 #ifdef HAVE_CHFLAGS
-    plug(statp->st_flags, val);
-  } else {
-    statp->st_flags = 0;
+  plug(statp->st_flags, values[kStatFlags]);
 #endif
-  }
 
-  /* Look for data stream id */
-  if (*p == ' ' || (*p != 0 && *(p + 1) == ' ')) {
-    p++;
-    p += FromBase64(&val, p);
-  } else {
-    val = 0;
-  }
-  return (int)val;
+  /* Data stream id, 0 if not present */
+  return (int)values[kStatDataStream];
 }
@@ -2,7 +2,7 @@
    BAREOS® - Backup Archiving REcovery Open Sourced
 
    Copyright (C) 2000-2007 Free Software Foundation Europe e.V.
-   Copyright (C) 2016-2019 Bareos GmbH & Co. KG
+   Copyright (C) 2016-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -26,92 +26,7 @@
  */
 
 #include "include/bareos.h"
-
-static uint8_t const base64_digits[64]
-    = {'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M',
-       'N', 'O', 'P', 'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z',
-       'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l', 'm',
-       'n', 'o', 'p', 'q', 'r', 's', 't', 'u', 'v', 'w', 'x', 'y', 'z',
-       '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '+', '/'};
-
-static int base64_inited = 0;
-static uint8_t base64_map[256];
-
-/* Initialize the Base 64 conversion routines */
-void Base64Init(void)
-{
-  int i;
-  memset(base64_map, 0, sizeof(base64_map));
-  for (i = 0; i < 64; i++) base64_map[(uint8_t)base64_digits[i]] = i;
-  base64_inited = 1;
-}
-
-/* Convert a value to base64 characters.
- * The result is stored in where, which
- * must be at least 8 characters long.
- *
- * Returns the number of characters
- * stored (not including the EOS).
- */
-int ToBase64(int64_t value, char* where)
-{
-  uint64_t val;
-  int i = 0;
-  int n;
-
-  /* Handle negative values */
-  if (value < 0) {
-    where[i++] = '-';
-    value = -value;
-  }
-
-  /* Determine output size */
-  val = value;
-  do {
-    val >>= 6;
-    i++;
-  } while (val);
-  n = i;
-
-  /* Output characters */
-  val = value;
-  where[i] = 0;
-  do {
-    where[--i] = base64_digits[val & (uint64_t)0x3F];
-    val >>= 6;
-  } while (val);
-  return n;
-}
-
-/**
- * Convert the Base 64 characters in where to
- * a value. No checking is done on the validity
- * of the characters!!
- *
- * Returns the value.
- */
-int FromBase64(int64_t* value, char* where)
-{
-  uint64_t val = 0;
-  int i, neg;
-
-  if (!base64_inited) Base64Init();
-  /* Check if it is negative */
-  i = neg = 0;
-  if (where[i] == '-') {
-    i++;
-    neg = 1;
-  }
-  /* Construct value */
-  while (where[i] != 0 && where[i] != ' ') {
-    val <<= 6;
-    val += base64_map[(uint8_t)where[i++]];
-  }
-
-  *value = neg ? -(int64_t)val : (int64_t)val;
-  return i;
-}
-
+#include "lib/base64.h"
 
 /**
  * Encode binary data in bin of len bytes into
@@ -120,19 +35,44 @@ int FromBase64(int64_t* value, char* where)
  * If compatible is true, the BinToBase64 routine will be compatible
  * with what the rest of the world uses.
  *
+ * If compatible is false, the bytes are sign extended while they are
+ * shifted in, which sets the not yet written bits of the previous byte
+ * whenever a byte has its high bit set. This is what older versions
+ * stored, so it is kept to produce the same digests.
+ *
  *  Returns: the number of characters stored not
  *           including the EOS
  */
 int BinToBase64(char* buf, int buflen, char* bin, int binlen, bool compatible)
 {
   uint32_t reg, save, mask;
-  int rem, i;
+  int rem, i = 0;
   int j = 0;
 
+  buflen--; /* allow for storing EOS */
+
+  /* Convert groups of three bytes into four characters at a time, as long
+   * as they fit into the buffer. */
+  const uint8_t* in = (const uint8_t*)bin;
+  while (i + 3 <= binlen && j + 4 <= buflen) {
+    uint32_t b0 = in[i], b1 = in[i + 1], b2 = in[i + 2];
+    uint32_t high1 = b0 & 0x03, high2 = b1 & 0x0F;
+    if (!compatible) {
+      if (b1 & 0x80) { high1 = 0x03; }
+      if (b2 & 0x80) { high2 = 0x0F; }
+    }
+    buf[j] = base64_digits[b0 >> 2];
+    buf[j + 1] = base64_digits[(high1 << 4) | (b1 >> 4)];
+    buf[j + 2] = base64_digits[(high2 << 2) | (b2 >> 6)];
+    buf[j + 3] = base64_digits[b2 & 0x3F];
+    i += 3;
+    j += 4;
+  }
+
+  /* Remaining bytes, the loop starts on a byte boundary again */
   reg = 0;
   rem = 0;
-  buflen--; /* allow for storing EOS */
-  for (i = 0; i < binlen;) {
+  while (i < binlen) {
     if (rem < 6) {
       reg <<= 8;
       if (compatible) {
@@ -174,31 +114,27 @@ int Base64ToBin(char* dest, int dest_size, char* src, int srclen)
 {
   int nprbytes;
   uint8_t* bufout;
-  uint8_t* bufplain = (uint8_t*)dest;
   const uint8_t* bufin;
 
-  if (!base64_inited) Base64Init();
-
   if (dest_size < (((srclen + 3) / 4) * 3)) {
     /* dest buffer too small */
     *dest = 0;
     return 0;
   }
 
+  /* The encoded data ends at the first space */
+  const void* space = memchr(src, ' ', srclen);
+  nprbytes = space ? (const char*)space - src : srclen;
   bufin = (const uint8_t*)src;
-  while ((*bufin != ' ') && (srclen != 0)) {
-    bufin++;
-    srclen--;
-  }
-
-  nprbytes = bufin - (const uint8_t*)src;
-  bufin = (const uint8_t*)src;
-  bufout = (uint8_t*)bufplain;
+  bufout = (uint8_t*)dest;
 
   while (nprbytes > 4) {
-    *(bufout++) = (base64_map[bufin[0]] << 2 | base64_map[bufin[1]] >> 4);
-    *(bufout++) = (base64_map[bufin[1]] << 4 | base64_map[bufin[2]] >> 2);
-    *(bufout++) = (base64_map[bufin[2]] << 6 | base64_map[bufin[3]]);
+    uint32_t group = base64_map[bufin[0]] << 18 | base64_map[bufin[1]] << 12
+                     | base64_map[bufin[2]] << 6 | base64_map[bufin[3]];
+    bufout[0] = group >> 16;
+    bufout[1] = group >> 8;
+    bufout[2] = group;
+    bufout += 3;
     bufin += 4;
     nprbytes -= 4;
   }
@@ -2,7 +2,7 @@
    BAREOS® - Backup Archiving REcovery Open Sourced
 
    Copyright (C) 2000-2006 Free Software Foundation Europe e.V.
-   Copyright (C) 2016-2021 Bareos GmbH & Co. KG
+   Copyright (C) 2016-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -28,13 +28,90 @@
 #ifndef BAREOS_LIB_BASE64_H_
 #define BAREOS_LIB_BASE64_H_
 
+#include <array>
+#include <cstdint>
+
 /* Maximum size of len bytes after base64 encoding */
 #define BASE64_SIZE(len) ((4 * len + 2) / 3 + 1)
 
 // #define BASE64_SIZE(len) (((len + 3 - (len % 3)) / 3) * 4)
-void Base64Init(void);
-int ToBase64(int64_t value, char* where);
-int FromBase64(int64_t* value, char* where);
+
+inline constexpr char base64_digits[]
+    = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/* Reverse lookup of base64_digits, characters that are not base64 digits
+ * map to 0. */
+constexpr std::array<uint8_t, 256> MakeBase64Map()
+{
+  std::array<uint8_t, 256> map{};
+  for (int i = 0; i < 64; i++) { map[(uint8_t)base64_digits[i]] = i; }
+  return map;
+}
+
+inline constexpr std::array<uint8_t, 256> base64_map = MakeBase64Map();
+
+/* ToBase64() and FromBase64() run for every field of every stat packet, so
+ * they are defined here to be inlined into the attribute code. */
+
+/* Convert a value to base64 characters.
+ * The result is stored in where, which
+ * must be at least 13 characters long.
+ *
+ * Returns the number of characters
+ * stored (not including the EOS).
+ */
+inline int ToBase64(int64_t value, char* where)
+{
+  uint64_t val = value;
+  int i = 0;
+  int n = 1;
+
+  /* Handle negative values */
+  if (value < 0) {
+    where[i++] = '-';
+    val = 0 - val;
+  }
+
+  /* Determine output size */
+  for (uint64_t rest = val >> 6; rest; rest >>= 6) { n++; }
+
+  /* Output characters */
+  char* p = where + i + n;
+  *p = 0;
+  do {
+    *--p = base64_digits[val & (uint64_t)0x3F];
+    val >>= 6;
+  } while (val);
+  return i + n;
+}
+
+/**
+ * Convert the Base 64 characters in where to
+ * a value. No checking is done on the validity
+ * of the characters!!
+ *
+ * Returns the number of characters used.
+ */
+inline int FromBase64(int64_t* value, const char* where)
+{
+  uint64_t val = 0;
+  int i = 0;
+  bool neg = false;
+
+  /* Check if it is negative */
+  if (where[i] == '-') {
+    i++;
+    neg = true;
+  }
+  /* Construct value */
+  while (where[i] != 0 && where[i] != ' ') {
+    val = (val << 6) | base64_map[(uint8_t)where[i++]];
+  }
+
+  *value = neg ? -(int64_t)val : (int64_t)val;
+  return i;
+}
+
 int BinToBase64(char* buf, int buflen, char* bin, int binlen, bool compatible);
 int Base64ToBin(char* dest, int destlen, char* src, int srclen);
 int Base64LengthUnpadded(int source_length);
@@ -2,7 +2,7 @@
    BAREOS® - Backup Archiving REcovery Open Sourced
 
    Copyright (C) 2001-2011 Free Software Foundation Europe e.V.
-   Copyright (C) 2016-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2016-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -47,11 +47,18 @@ static char TERM_msg[] = "2999 Terminate\n";
  * Returns -2 on hard end of file (BNET_HARDEOF)
  * Returns -3 on error  (BNET_ERROR)
  */
-int BgetMsg(BareosSocket* sock)
+int BgetMsg(BareosSocket* sock) { return BgetMsg(sock, nullptr); }
+
+/**
+ * Same as above, but data is received into the buffer buffer_for() returns
+ * for its size, if it returns one. See BareosSocket::RecvInto().
+ */
+int BgetMsg(BareosSocket* sock,
+            const std::function<char*(int32_t size)>& buffer_for)
 {
   int n;
   for (;;) {
-    n = sock->recv();
+    n = buffer_for ? sock->RecvInto(buffer_for) : sock->recv();
     if (n >= 0) { /* normal return */
       return n;
     }
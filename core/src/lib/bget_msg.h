@@ -1,7 +1,7 @@
 /*
    BAREOS® - Backup Archiving REcovery Open Sourced
 
-   Copyright (C) 2018-2018 Bareos GmbH & Co. KG
+   Copyright (C) 2018-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -21,6 +21,12 @@
 #ifndef BAREOS_LIB_BGET_MSG_H_
 #define BAREOS_LIB_BGET_MSG_H_
 
+#include <functional>
+
+class BareosSocket;
+
 int BgetMsg(BareosSocket* sock);
+int BgetMsg(BareosSocket* sock,
+            const std::function<char*(int32_t size)>& buffer_for);
 
 #endif  // BAREOS_LIB_BGET_MSG_H_
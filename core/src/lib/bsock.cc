@@ -3,7 +3,7 @@
 
    Copyright (C) 2007-2011 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -326,6 +326,25 @@ bool BareosSocket::send(const char* msg_in, uint32_t nbytes)
   return send();
 }
 
+int32_t BareosSocket::RecvInto(
+    const std::function<char*(int32_t size)>& buffer_for)
+{
+  int32_t nbytes = recv();
+  if (nbytes > 0) {
+    if (char* buffer = buffer_for(nbytes)) { memcpy(buffer, msg, nbytes); }
+  }
+  return nbytes;
+}
+
+bool BareosSocket::SendMessages(
+    std::initializer_list<std::string_view> messages)
+{
+  for (const auto& message : messages) {
+    if (!send(message.data(), message.size())) { return false; }
+  }
+  return true;
+}
+
 void BareosSocket::SetKillable(bool killable)
 {
   if (jcr_) { jcr_->SetKillable(killable); }
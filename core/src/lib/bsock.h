@@ -2,7 +2,7 @@
    BAREOS® - Backup Archiving REcovery Open Sourced
 
    Copyright (C) 2000-2009 Free Software Foundation Europe e.V.
-   Copyright (C) 2016-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2016-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -51,6 +51,8 @@
 #include <functional>
 #include <cassert>
 #include <atomic>
+#include <initializer_list>
+#include <string_view>
 
 struct btimer_t; /* forward reference */
 class BareosSocket;
@@ -187,6 +189,13 @@ class BareosSocket {
   bool fsend(const char*, ...);
   bool vfsend(const char* fmt, va_list ap);
   bool send(const char* msg_in, uint32_t nbytes);
+  /* Receive the next message like recv(), but put its data where
+   * buffer_for(size) points to unless that returns nullptr. */
+  virtual int32_t RecvInto(
+      const std::function<char*(int32_t size)>& buffer_for);
+  /* Send each of the messages like send(msg_in, nbytes) does, without
+   * copying them into msg where possible. */
+  virtual bool SendMessages(std::initializer_list<std::string_view> messages);
   void SetKillable(bool killable);
   bool signal(int signal);
   const char* bstrerror(); /* last error on socket */
@@ -2,7 +2,7 @@
    BAREOS® - Backup Archiving REcovery Open Sourced
 
    Copyright (C) 2007-2011 Free Software Foundation Europe e.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -32,6 +32,9 @@
 #include "include/jcr.h"
 #include <netdb.h>
 #include <netinet/tcp.h>
+#if !defined(HAVE_WIN32)
+#  include <sys/uio.h>
+#endif
 #include "lib/bnet.h"
 #include "lib/bpoll.h"
 #include "lib/btimers.h"
@@ -502,6 +505,94 @@ bool BareosSocketTCP::send()
   return ok;
 }
 
+#if !defined(HAVE_WIN32)
+/*
+ * Send a few messages with a single gather write, so their data does not
+ * have to be copied behind a packet header first. Anything this cannot do
+ * in one go (tls, spooling, messages that need more than one packet) takes
+ * the normal path.
+ */
+bool BareosSocketTCP::SendMessages(
+    std::initializer_list<std::string_view> messages)
+{
+  static constexpr std::size_t max_messages = 8;
+  int32_t hdrs[max_messages];
+  struct iovec iov[2 * max_messages];
+  int iovcnt = 0;
+  int32_t pktsiz = 0;
+  int32_t nwritten;
+  struct iovec* next = iov;
+  bool ok = true;
+
+  if (errors || IsTerminated() || tls_conn || IsSpooling()
+      || IsBnetDumpEnabled() || messages.size() > max_messages) {
+    return BareosSocket::SendMessages(messages);
+  }
+  for (const auto& message : messages) {
+    if (message.size() > (std::size_t)max_message_len) {
+      return BareosSocket::SendMessages(messages);
+    }
+    hdrs[iovcnt / 2] = htonl(message.size());
+    iov[iovcnt].iov_base = &hdrs[iovcnt / 2];
+    iov[iovcnt++].iov_len = header_length;
+    iov[iovcnt].iov_base = const_cast<char*>(message.data());
+    iov[iovcnt++].iov_len = message.size();
+    pktsiz += header_length + message.size();
+  }
+
+  LockMutex();
+  out_msg_no += messages.size();
+  timer_start = watchdog_time; /* start timer */
+  ClearTimedOut();
+
+  while (iovcnt > 0) {
+    do {
+      errno = 0;
+      nwritten = ::writev(fd_, next, iovcnt);
+    } while (nwritten == -1 && errno == EINTR);
+    if (IsTimedOut() || IsTerminated()) {
+      ok = false;
+      break;
+    }
+    if (nwritten == -1 && errno == EAGAIN) {
+      WaitForWritableFd(fd_, 1, false);
+      continue;
+    }
+    if (nwritten <= 0) {
+      ok = false;
+      break;
+    }
+    if (UseBwlimit()) { ControlBwlimit(nwritten); }
+
+    // Skip what was written, the last vector may be written partially
+    while (iovcnt > 0 && (std::size_t)nwritten >= next->iov_len) {
+      nwritten -= next->iov_len;
+      next++;
+      iovcnt--;
+    }
+    if (iovcnt > 0) {
+      next->iov_base = (char*)next->iov_base + nwritten;
+      next->iov_len -= nwritten;
+    }
+  }
+  timer_start = 0; /* clear timer */
+
+  if (!ok) {
+    ++errors;
+    b_errno = errno ? errno : EIO;
+    if (!suppress_error_msgs_) {
+      Qmsg5(jcr_, M_ERROR, 0,
+            T_("Write error sending %d bytes to %s:%s:%d: ERR=%s\n"), pktsiz,
+            who_, host_, port_, this->bstrerror());
+    }
+  }
+
+  UnlockMutex();
+
+  return ok;
+}
+#endif
+
 /*
  * Receive a message from the other end. Each message consists of
  * two packets. The first is a header that contains the size
@@ -519,10 +610,18 @@ bool BareosSocketTCP::send()
  *    4. Error
  *  Using IsBnetStop() and IsBnetError() you can figure this all out.
  */
-int32_t BareosSocketTCP::recv()
+int32_t BareosSocketTCP::recv() { return RecvInto(nullptr); }
+
+/*
+ * Same as recv(), but a data packet is read straight into the buffer
+ * buffer_for() returns for its size instead of into msg.
+ */
+int32_t BareosSocketTCP::RecvInto(
+    const std::function<char*(int32_t size)>& buffer_for)
 {
   int32_t nbytes;
   int32_t pktsiz;
+  char* buffer = nullptr;
 
   msg[0] = 0;
   message_length = 0;
@@ -584,16 +683,20 @@ int32_t BareosSocketTCP::recv()
     goto get_out;
   }
 
-  // Make sure the buffer is big enough + one byte for EOS
-  if (pktsiz >= (int32_t)SizeofPoolMemory(msg)) {
-    msg = ReallocPoolMemory(msg, pktsiz + 100);
+  if (buffer_for) { buffer = buffer_for(pktsiz); }
+  if (!buffer) {
+    // Make sure the buffer is big enough + one byte for EOS
+    if (pktsiz >= (int32_t)SizeofPoolMemory(msg)) {
+      msg = ReallocPoolMemory(msg, pktsiz + 100);
+    }
+    buffer = msg;
   }
 
   timer_start = watchdog_time; /* set start wait time */
   ClearTimedOut();
 
   // Now read the actual data
-  if ((nbytes = read_nbytes(msg, pktsiz)) <= 0) {
+  if ((nbytes = read_nbytes(buffer, pktsiz)) <= 0) {
     timer_start = 0; /* clear timer */
     if (errno == 0) {
       b_errno = ENODATA;
@@ -621,7 +724,9 @@ int32_t BareosSocketTCP::recv()
   /* Always add a zero by to properly Terminate any string that was send to us.
    * Note, we ensured above that the buffer is at least one byte longer than
    * the message length. */
-  msg[nbytes] = 0; /* Terminate in case it is a string */
+  if (buffer == msg) {
+    msg[nbytes] = 0; /* Terminate in case it is a string */
+  }
 
   /* The following uses *lots* of resources so turn it on only for serious
    * debugging. */
@@ -1,7 +1,7 @@
 /*
    BAREOS® - Backup Archiving REcovery Open Sourced
 
-   Copyright (C) 2013-2021 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -81,7 +81,12 @@ class BareosSocketTCP : public BareosSocket {
                int port,
                bool verbose) override;
   int32_t recv() override;
+  int32_t RecvInto(
+      const std::function<char*(int32_t size)>& buffer_for) override;
   bool send() override;
+#if !defined(HAVE_WIN32)
+  bool SendMessages(std::initializer_list<std::string_view> messages) override;
+#endif
   bool fsend(const char*, ...);
   int32_t read_nbytes(char* ptr, int32_t nbytes) override;
   int32_t write_nbytes(char* ptr, int32_t nbytes) override;
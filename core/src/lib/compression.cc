@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2011 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -167,8 +167,12 @@ class z4_compressor {
     pZfastStream.next_out = (Bytef*)output;
     pZfastStream.avail_out = capacity;
 
-    if (auto zstat = fastlzlibCompress(&pZfastStream, Z_FINISH);
-        zstat != Z_STREAM_END) {
+    // Every call compresses one block of the stream.
+    int zstat;
+    do {
+      zstat = fastlzlibCompress(&pZfastStream, Z_FINISH);
+    } while (zstat == Z_OK);
+    if (zstat != Z_STREAM_END) {
       PoolMem errmsg;
       Mmsg(errmsg, "Compression fastlzlibCompress error: %d\n", zstat);
       return errmsg;
@@ -349,6 +353,85 @@ result<std::size_t> ThreadlocalCompress(uint32_t algo,
   return errmsg;
 }
 
+result<std::size_t> DecompressBuffer(uint32_t algo,
+                                     char const* input,
+                                     std::size_t size,
+                                     char* output,
+                                     std::size_t capacity)
+{
+  PoolMem errmsg;
+
+  switch (algo) {
+#ifdef HAVE_LIBZ
+    case COMPRESS_GZIP: {
+      z_stream stream{};
+      int zstat;
+
+      if (inflateInit(&stream) != Z_OK) {
+        return PoolMem{"Failed to initialize zlib."};
+      }
+      stream.next_in = (Bytef*)input;
+      stream.avail_in = size;
+      stream.next_out = (Bytef*)output;
+      stream.avail_out = capacity;
+      zstat = inflate(&stream, Z_FINISH);
+      std::size_t out = stream.total_out;
+      inflateEnd(&stream);
+      if (zstat != Z_STREAM_END) {
+        Mmsg(errmsg, "Decompression inflate error: %s", zlib_strerror(zstat));
+        return errmsg;
+      }
+      return out;
+    }
+#endif
+#ifdef HAVE_LZO
+    case COMPRESS_LZO1X: {
+      lzo_uint out = capacity;
+      int lzores = lzo1x_decompress_safe(
+          reinterpret_cast<const unsigned char*>(input), size,
+          reinterpret_cast<unsigned char*>(output), &out, nullptr);
+
+      if (lzores != LZO_E_OK) {
+        Mmsg(errmsg, "Decompression LZO error: %d", lzores);
+        return errmsg;
+      }
+      return out;
+    }
+#endif
+    case COMPRESS_FZFZ:
+    case COMPRESS_FZ4L:
+    case COMPRESS_FZ4H: {
+      zfast_stream stream{};
+      int zstat;
+
+      if (fastlzlibDecompressInit(&stream) != Z_OK) {
+        return PoolMem{"Failed to initialize FASTLZ decompression"};
+      }
+      zstat = fastlzlibSetCompressor(
+          &stream, algo == COMPRESS_FZFZ ? COMPRESSOR_FASTLZ : COMPRESSOR_LZ4);
+      if (zstat == Z_OK) {
+        stream.next_in = (Bytef*)input;
+        stream.avail_in = size;
+        stream.next_out = (Bytef*)output;
+        stream.avail_out = capacity;
+        do {
+          zstat = fastlzlibDecompress(&stream);
+        } while (zstat == Z_OK && stream.avail_in > 0);
+      }
+      std::size_t out = stream.total_out;
+      fastlzlibDecompressEnd(&stream);
+      if (zstat != Z_OK && zstat != Z_STREAM_END) {
+        Mmsg(errmsg, "Decompression fastlzlibDecompress error: %d", zstat);
+        return errmsg;
+      }
+      return out;
+    }
+  }
+
+  Mmsg(errmsg, "Unknown compression algorithm: %d", algo);
+  return errmsg;
+}
+
 bool SetupCompressionBuffers(JobControlRecord* jcr,
                              uint32_t compression_algorithm,
                              uint32_t* compress_buf_size)
@@ -911,6 +994,40 @@ cleanup:
   return false;
 }
 
+// Blocks the compressor could not shrink are sent as they are.
+static bool decompress_stored(JobControlRecord* jcr,
+                              char** data,
+                              uint32_t* length,
+                              bool sparse,
+                              bool want_data_stream)
+{
+  uint32_t offset = (sparse && want_data_stream) ? OFFSET_FADDR_SIZE : 0;
+  uint32_t stored_len = *length - sizeof(comp_stream_header);
+
+  if (jcr->compress.inflate_buffer_size < stored_len + offset) {
+    jcr->compress.inflate_buffer_size = stored_len + offset;
+    if (jcr->compress.inflate_buffer) {
+      jcr->compress.inflate_buffer = CheckPoolMemorySize(
+          jcr->compress.inflate_buffer, jcr->compress.inflate_buffer_size);
+    } else {
+      jcr->compress.inflate_buffer
+          = GetMemory(jcr->compress.inflate_buffer_size);
+    }
+  }
+
+  memcpy(jcr->compress.inflate_buffer + offset,
+         *data + sizeof(comp_stream_header), stored_len);
+
+  /* We return a decompressed data stream with the fileoffset encoded when this
+   * was a sparse stream. */
+  if (offset) { memcpy(jcr->compress.inflate_buffer, *data, OFFSET_FADDR_SIZE); }
+
+  *data = jcr->compress.inflate_buffer;
+  *length = stored_len;
+
+  return true;
+}
+
 bool DecompressData(JobControlRecord* jcr,
                     const char* last_fname,
                     int32_t stream,
@@ -995,6 +1112,10 @@ bool DecompressData(JobControlRecord* jcr,
                                             comp_magic, false,
                                             want_data_stream);
           }
+        case COMPRESS_NONE:
+          return decompress_stored(
+              jcr, data, length, stream == STREAM_SPARSE_COMPRESSED_DATA,
+              want_data_stream);
         default:
           Qmsg(jcr, M_ERROR, 0,
                T_("Compression algorithm 0x%x found, but not supported!\n"),
@@ -1,7 +1,7 @@
 /*
    BAREOS® - Backup Archiving REcovery Open Sourced
 
-   Copyright (C) 2018-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2018-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -41,6 +41,14 @@ result<std::size_t> ThreadlocalCompress(uint32_t algo,
                                         char* output,
                                         std::size_t capacity);
 
+// Counterpart of ThreadlocalCompress(): returns the number of bytes written
+// to the output on success
+result<std::size_t> DecompressBuffer(uint32_t algo,
+                                     char const* input,
+                                     std::size_t size,
+                                     char* output,
+                                     std::size_t capacity);
+
 std::size_t RequiredCompressionOutputBufferSize(uint32_t algo,
                                                 std::size_t max_input_size);
 
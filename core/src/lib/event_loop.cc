@@ -0,0 +1,329 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+
+#include "include/bareos.h"
+#include "lib/event_loop.h"
+#include "lib/bpoll.h"
+#include "lib/thread_specific_data.h"
+#include "lib/timer_thread.h"
+
+#ifdef HAVE_POLL_H
+#  include <poll.h>
+#elif HAVE_SYS_POLL_H
+#  include <sys/poll.h>
+#endif
+
+static constexpr std::size_t kSharedEventLoopWorkers = 4;
+
+// Longest time until the poll thread watches a newly added or re-armed fd
+static constexpr std::chrono::milliseconds kPollInterval(100);
+
+struct EventLoop::Event {
+  enum class Type
+  {
+    kOnce,
+    kRepeating,
+    kReadable
+  };
+
+  Event(Type t_type, std::function<bool()> t_callback, int t_fd = -1)
+      : type(t_type), callback(std::move(t_callback)), fd(t_fd)
+  {
+  }
+
+  Type type;
+  std::function<bool()> callback;
+  int fd;
+  TimerThread::Timer* timer{nullptr};
+  bool queued{false};
+  bool running{false};
+  bool cancelled{false};
+  std::thread::id running_in;
+};
+
+namespace {
+struct TimerContext {
+  EventLoop* loop;
+  EventLoop::EventId id;
+};
+}  // namespace
+
+EventLoop::EventLoop(std::size_t num_workers)
+{
+  for (std::size_t i = 0; i < num_workers; i++) {
+    workers_.emplace_back(&EventLoop::WorkerLoop, this);
+  }
+  poll_thread_ = std::thread(&EventLoop::PollLoop, this);
+}
+
+EventLoop::~EventLoop()
+{
+  std::vector<TimerThread::Timer*> timers;
+  {
+    std::lock_guard l(mutex_);
+    quit_ = true;
+    for (auto& [id, event] : events_) {
+      if (event->timer) { timers.push_back(event->timer); }
+    }
+  }
+  // after this no timer callback refers to us anymore
+  for (auto* timer : timers) { TimerThread::UnregisterTimer(timer); }
+
+  work_available_.notify_all();
+  fds_changed_.notify_all();
+  for (auto& worker : workers_) { worker.join(); }
+  poll_thread_.join();
+}
+
+EventLoop& EventLoop::Shared()
+{
+  // never destroyed, jobs may still use it while the daemon exits
+  static EventLoop* shared = new EventLoop(kSharedEventLoopWorkers);
+  return *shared;
+}
+
+EventLoop::EventId EventLoop::RunAfter(std::chrono::milliseconds delay,
+                                       std::function<void()> callback)
+{
+  auto event = std::make_unique<Event>(Event::Type::kOnce,
+                                       [callback = std::move(callback)]() {
+                                         callback();
+                                         return false;
+                                       });
+  if (delay.count() <= 0) { return Add(std::move(event)); }
+
+  /* The timer is a repeating one that is only removed by us, a single
+   * shot timer is freed by the timer thread and we could not tell whether
+   * a pointer to it is still valid. */
+  TimerThread::Timer* timer = TimerThread::NewTimer();
+  timer->single_shot = false;
+  timer->interval = delay;
+  event->timer = timer;
+  return Add(std::move(event));
+}
+
+EventLoop::EventId EventLoop::RunEvery(std::chrono::milliseconds interval,
+                                       std::function<void()> callback)
+{
+  auto event = std::make_unique<Event>(Event::Type::kRepeating,
+                                       [callback = std::move(callback)]() {
+                                         callback();
+                                         return true;
+                                       });
+  TimerThread::Timer* timer = TimerThread::NewTimer();
+  timer->single_shot = false;
+  timer->interval = std::max(interval, std::chrono::milliseconds(1));
+  event->timer = timer;
+  return Add(std::move(event));
+}
+
+EventLoop::EventId EventLoop::WatchReadable(int fd,
+                                            std::function<bool()> callback)
+{
+  return Add(
+      std::make_unique<Event>(Event::Type::kReadable, std::move(callback), fd));
+}
+
+EventLoop::EventId EventLoop::Add(std::unique_ptr<Event> event)
+{
+  /* The event only gets its timer once it is registered, so Cancel() does
+   * not unregister a timer we are still registering. */
+  TimerThread::Timer* timer = event->timer;
+  event->timer = nullptr;
+
+  EventId id;
+  {
+    std::lock_guard l(mutex_);
+    id = next_id_++;
+    Event::Type type = event->type;
+    events_.emplace(id, std::move(event));
+    if (type == Event::Type::kReadable) {
+      watched_fds_++;
+      fds_changed_.notify_one();
+    } else if (!timer) {
+      QueueLocked(id);
+    }
+  }
+
+  if (timer) {
+    timer->user_callback = TimerCallback;
+    timer->user_destructor = TimerDestructor;
+    timer->user_data = new TimerContext{this, id};
+    TimerThread::RegisterTimer(timer);
+
+    bool cancelled;
+    {
+      std::lock_guard l(mutex_);
+      auto it = events_.find(id);
+      cancelled = it == events_.end();
+      if (!cancelled) { it->second->timer = timer; }
+    }
+    if (cancelled) { TimerThread::UnregisterTimer(timer); }
+  }
+
+  return id;
+}
+
+void EventLoop::Cancel(EventId id)
+{
+  TimerThread::Timer* timer = nullptr;
+  {
+    std::unique_lock l(mutex_);
+    auto it = events_.find(id);
+    if (it == events_.end()) { return; }
+
+    Event* event = it->second.get();
+    if (event->running) {
+      // the worker running it removes it when the callback returns
+      event->cancelled = true;
+      if (event->running_in == std::this_thread::get_id()) { return; }
+      event_done_.wait(l, [this, id]() { return !events_.count(id); });
+      return;
+    }
+
+    timer = event->timer;
+    if (event->type == Event::Type::kReadable) { watched_fds_--; }
+    events_.erase(it);
+  }
+  if (timer) { TimerThread::UnregisterTimer(timer); }
+}
+
+std::size_t EventLoop::NumEvents()
+{
+  std::lock_guard l(mutex_);
+  return events_.size();
+}
+
+void EventLoop::QueueLocked(EventId id)
+{
+  auto it = events_.find(id);
+  if (it == events_.end()) { return; }
+
+  Event* event = it->second.get();
+  if (event->queued || event->running || event->cancelled) { return; }
+  event->queued = true;
+  queue_.push_back(id);
+  work_available_.notify_one();
+}
+
+void EventLoop::TimerCallback(TimerThread::Timer* t)
+{
+  auto* context = static_cast<TimerContext*>(t->user_data);
+  std::lock_guard l(context->loop->mutex_);
+  context->loop->QueueLocked(context->id);
+}
+
+void EventLoop::TimerDestructor(TimerThread::Timer* t)
+{
+  delete static_cast<TimerContext*>(t->user_data);
+}
+
+void EventLoop::WorkerLoop()
+{
+  SetJcrInThreadSpecificData(nullptr);
+
+  std::unique_lock l(mutex_);
+  for (;;) {
+    work_available_.wait(l, [this]() { return quit_ || !queue_.empty(); });
+    if (quit_) { break; }
+
+    EventId id = queue_.front();
+    queue_.pop_front();
+    auto it = events_.find(id);
+    if (it == events_.end()) { continue; }
+
+    Event* event = it->second.get();
+    event->queued = false;
+    event->running = true;
+    event->running_in = std::this_thread::get_id();
+    l.unlock();
+
+    bool keep = event->callback();
+
+    l.lock();
+    event->running = false;
+    TimerThread::Timer* timer = nullptr;
+    if (!keep || event->cancelled) {
+      timer = event->timer;
+      if (event->type == Event::Type::kReadable) { watched_fds_--; }
+      events_.erase(id);
+    } else if (event->type == Event::Type::kReadable) {
+      fds_changed_.notify_one();
+    }
+    event_done_.notify_all();
+
+    if (timer) {
+      l.unlock();
+      TimerThread::UnregisterTimer(timer);
+      l.lock();
+    }
+  }
+}
+
+void EventLoop::PollLoop()
+{
+  SetJcrInThreadSpecificData(nullptr);
+
+  std::unique_lock l(mutex_);
+  while (!quit_) {
+    std::vector<EventId> ids;
+    std::vector<int> fds;
+    for (auto& [id, event] : events_) {
+      if (event->type == Event::Type::kReadable && !event->queued
+          && !event->running && !event->cancelled) {
+        ids.push_back(id);
+        fds.push_back(event->fd);
+      }
+    }
+    if (ids.empty()) {
+      fds_changed_.wait_for(l, kPollInterval);
+      continue;
+    }
+    l.unlock();
+
+    std::vector<bool> ready(ids.size(), false);
+#ifdef HAVE_POLL
+    std::vector<struct pollfd> pfds(fds.size());
+    for (std::size_t i = 0; i < fds.size(); i++) {
+      pfds[i].fd = fds[i];
+      pfds[i].events = POLLIN;
+      pfds[i].revents = 0;
+    }
+    if (poll(pfds.data(), pfds.size(), kPollInterval.count()) > 0) {
+      for (std::size_t i = 0; i < pfds.size(); i++) {
+        ready[i] = pfds[i].revents != 0;
+      }
+    }
+#else
+    bool any_ready = false;
+    for (std::size_t i = 0; i < fds.size(); i++) {
+      ready[i] = WaitForReadableFd(fds[i], 0, true) != 0;
+      any_ready |= ready[i];
+    }
+    if (!any_ready) { std::this_thread::sleep_for(kPollInterval); }
+#endif
+
+    l.lock();
+    for (std::size_t i = 0; i < ids.size(); i++) {
+      if (ready[i]) { QueueLocked(ids[i]); }
+    }
+  }
+}
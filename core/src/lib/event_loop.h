@@ -0,0 +1,105 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+
+#ifndef BAREOS_LIB_EVENT_LOOP_H_
+#define BAREOS_LIB_EVENT_LOOP_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace TimerThread {
+struct Timer;
+}
+
+/* Runs the small, mostly idle chores every job has -- heartbeats, waiting
+ * for a start time, watching a socket for the odd message -- as events on
+ * a small fixed pool of worker threads instead of a thread per job.
+ *
+ * Timers are driven by the TimerThread and sockets by one poll thread,
+ * both only queue the event, its callback runs on a worker. The same event
+ * never runs on two workers at once. Callbacks must not block for long as
+ * they hold up a worker other jobs are waiting for. */
+class EventLoop {
+ public:
+  using EventId = std::uint64_t;
+
+  explicit EventLoop(std::size_t num_workers);
+  ~EventLoop();
+  EventLoop(const EventLoop&) = delete;
+  EventLoop& operator=(const EventLoop&) = delete;
+
+  // The loop shared by all jobs of a daemon, started on first use.
+  static EventLoop& Shared();
+
+  // Run callback once after delay.
+  EventId RunAfter(std::chrono::milliseconds delay,
+                   std::function<void()> callback);
+
+  // Run callback every interval until the event is cancelled.
+  EventId RunEvery(std::chrono::milliseconds interval,
+                   std::function<void()> callback);
+
+  /* Run callback whenever fd is readable or was closed by the peer. The
+   * fd is not watched while the callback runs and no longer at all once
+   * it returned false. */
+  EventId WatchReadable(int fd, std::function<bool()> callback);
+
+  /* Remove an event. Waits for its callback to finish if it is running,
+   * unless called from that callback. Unknown or finished ids are
+   * ignored. */
+  void Cancel(EventId id);
+
+  std::size_t NumWorkers() const { return workers_.size(); }
+  std::size_t NumEvents();
+
+ private:
+  struct Event;
+
+  EventId Add(std::unique_ptr<Event> event);
+  void QueueLocked(EventId id);
+  void WorkerLoop();
+  void PollLoop();
+  static void TimerCallback(TimerThread::Timer* t);
+  static void TimerDestructor(TimerThread::Timer* t);
+
+  std::mutex mutex_;
+  std::condition_variable work_available_;
+  std::condition_variable event_done_;
+  std::condition_variable fds_changed_;
+  std::unordered_map<EventId, std::unique_ptr<Event>> events_;
+  std::deque<EventId> queue_;
+  std::size_t watched_fds_{0};
+  EventId next_id_{1};
+  bool quit_{false};
+
+  std::vector<std::thread> workers_;
+  std::thread poll_thread_;
+};
+
+#endif  // BAREOS_LIB_EVENT_LOOP_H_
@@ -3,7 +3,7 @@
 
    Copyright (C) 2002-2012 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -517,7 +517,7 @@ static storagedaemon::BootStrapRecord* store_fileregex(
     storagedaemon::BootStrapRecord* bsr)
 {
   int token;
-  int rc;
+  std::string errmsg;
 
   token = LexGetToken(lc, BCT_STRING);
   if (token == BCT_ERROR) { return NULL; }
@@ -525,16 +525,12 @@ static storagedaemon::BootStrapRecord* store_fileregex(
   if (bsr->fileregex) free(bsr->fileregex);
   bsr->fileregex = strdup(lc->str);
 
-  if (bsr->fileregex_re == NULL) {
-    bsr->fileregex_re = (regex_t*)malloc(sizeof(regex_t));
-  }
-
-  rc = regcomp(bsr->fileregex_re, bsr->fileregex, REG_EXTENDED | REG_NOSUB);
-  if (rc != 0) {
-    char prbuf[500];
-    regerror(rc, bsr->fileregex_re, prbuf, sizeof(prbuf));
+  delete bsr->fileregex_re;
+  bsr->fileregex_re = new RegexSet;
+  if (!bsr->fileregex_re->Add(bsr->fileregex, REG_EXTENDED | REG_NOSUB,
+                              errmsg)) {
     Emsg2(M_ERROR, 0, T_("REGEX '%s' compile error. ERR=%s\n"), bsr->fileregex,
-          prbuf);
+          errmsg.c_str());
     return NULL;
   }
   return bsr;
@@ -936,10 +932,7 @@ static inline void RemoveBsr(storagedaemon::BootStrapRecord* bsr)
   FreeBsrItem((storagedaemon::BootStrapRecord*)bsr->JobType);
   FreeBsrItem((storagedaemon::BootStrapRecord*)bsr->JobLevel);
   if (bsr->fileregex) { free(bsr->fileregex); }
-  if (bsr->fileregex_re) {
-    regfree(bsr->fileregex_re);
-    free(bsr->fileregex_re);
-  }
+  delete bsr->fileregex_re;
   if (bsr->attr) { FreeAttr(bsr->attr); }
   if (bsr->next) { bsr->next->prev = bsr->prev; }
   if (bsr->prev) { bsr->prev->next = bsr->next; }
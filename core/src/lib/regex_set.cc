@@ -0,0 +1,956 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/* Automaton based matching of sets of POSIX extended regular expressions.
+ *
+ * Every pattern is parsed into a syntax tree and compiled into a Thompson
+ * NFA, all patterns of a set share one start state. The NFA is then turned
+ * into a DFA over classes of equivalent bytes by subset construction. As a
+ * pattern may match anywhere, the NFA start state is part of every DFA
+ * state, so the search is one pass over the subject without restarts. If
+ * the DFA would get too large the NFA is simulated directly, which is
+ * still linear in the length of the subject. */
+
+#include "include/bareos.h"
+#include "lib/regex_set.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cctype>
+#include <clocale>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <utility>
+
+namespace regex_set_detail {
+
+using ByteSet = std::bitset<256>;
+
+// Nesting of groups and of quantifiers, bounds the recursion below
+constexpr int kMaxGroupNesting = 100;
+constexpr int kMaxStackedQuantifiers = 8;
+constexpr int kMaxRepeat = 255;
+// NFA states of a single pattern and of all patterns of a set
+constexpr int64_t kMaxPatternStates = 5000;
+constexpr int64_t kMaxSetStates = 20000;
+constexpr size_t kMaxDfaStates = 2048;
+constexpr size_t kMaxCachedAutomata = 256;
+
+struct Node {
+  enum class Kind
+  {
+    kEmpty,
+    kBytes,
+    kBegin,
+    kEnd,
+    kConcat,
+    kAlternate,
+    kRepeat
+  };
+  Kind kind{Kind::kEmpty};
+  ByteSet bytes;
+  std::vector<Node> children;
+  int min{0};
+  int max{-1};  // -1 is unbounded
+};
+
+static bool CollationIsC()
+{
+  const char* collate = setlocale(LC_COLLATE, nullptr);
+  return !collate || bstrcmp(collate, "C") || bstrcmp(collate, "POSIX");
+}
+
+/* Parser for the POSIX extended syntax as accepted by regcomp(). It is only
+ * run on patterns regcomp() accepted and gives up (returns false) on
+ * everything it does not translate exactly, those patterns are then left
+ * to regexec(). */
+class Parser {
+ public:
+  Parser(const char* pattern, int cflags)
+      : p_(reinterpret_cast<const unsigned char*>(pattern))
+      , icase_(cflags & REG_ICASE)
+      , multibyte_(MB_CUR_MAX > 1)
+  {
+  }
+
+  bool Parse(Node& root)
+  {
+    for (const unsigned char* p = p_; *p; p++) {
+      if (*p >= 0x80) { return false; }
+    }
+    return ParseAlternation(root) && *p_ == '\0';
+  }
+
+  // The pattern matches single characters that may be multibyte sequences
+  bool UsesAnyChar() const { return uses_any_char_; }
+
+ private:
+  bool ParseAlternation(Node& node)
+  {
+    if (++depth_ > kMaxGroupNesting) { return false; }
+    node.kind = Node::Kind::kAlternate;
+    for (;;) {
+      node.children.emplace_back();
+      if (!ParseConcat(node.children.back())) { return false; }
+      if (*p_ != '|') { break; }
+      p_++;
+    }
+    depth_--;
+    return true;
+  }
+
+  bool ParseConcat(Node& node)
+  {
+    node.kind = Node::Kind::kConcat;
+    // An unmatched ) is an ordinary character
+    while (*p_ && *p_ != '|' && !(*p_ == ')' && depth_ > 1)) {
+      node.children.emplace_back();
+      if (!ParseRepeat(node.children.back())) { return false; }
+    }
+    return true;
+  }
+
+  static bool IsQuantifier(unsigned char c)
+  {
+    return c == '*' || c == '+' || c == '?' || c == '{';
+  }
+
+  static bool HasAnchor(const Node& node)
+  {
+    if (node.kind == Node::Kind::kBegin || node.kind == Node::Kind::kEnd) {
+      return true;
+    }
+    for (const auto& child : node.children) {
+      if (HasAnchor(child)) { return true; }
+    }
+    return false;
+  }
+
+  bool ParseRepeat(Node& node)
+  {
+    if (IsQuantifier(*p_) || !ParseAtom(node)) { return false; }
+
+    for (int stacked = 0; IsQuantifier(*p_); stacked++) {
+      /* regexec() does not treat anchors in repeated groups as plain
+       * assertions, e.g. (^a)* matches a second a after the first. */
+      if (stacked == kMaxStackedQuantifiers || HasAnchor(node)) {
+        return false;
+      }
+      int min = 0, max = -1;
+      switch (*p_++) {
+        case '*':
+          break;
+        case '+':
+          min = 1;
+          break;
+        case '?':
+          max = 1;
+          break;
+        default:
+          if (!ParseInterval(min, max)) { return false; }
+          break;
+      }
+      Node child = std::move(node);
+      node = Node{};
+      node.kind = Node::Kind::kRepeat;
+      node.min = min;
+      node.max = max;
+      node.children.push_back(std::move(child));
+    }
+    return true;
+  }
+
+  bool ParseNumber(int& number)
+  {
+    if (!isdigit(*p_)) { return false; }
+    number = 0;
+    while (isdigit(*p_)) {
+      number = number * 10 + (*p_++ - '0');
+      if (number > kMaxRepeat) { return false; }
+    }
+    return true;
+  }
+
+  bool ParseInterval(int& min, int& max)
+  {
+    bool have_min = ParseNumber(min);
+    if (!have_min) { min = 0; }
+    if (*p_ == ',') {
+      p_++;
+      if (!ParseNumber(max)) {
+        if (!have_min) { return false; }
+        max = -1;
+      }
+    } else {
+      if (!have_min) { return false; }
+      max = min;
+    }
+    if (*p_++ != '}') { return false; }
+    return max == -1 || max >= min;
+  }
+
+  bool ParseAtom(Node& node)
+  {
+    unsigned char c = *p_++;
+    switch (c) {
+      case '(':
+        if (!ParseAlternation(node) || *p_ != ')') { return false; }
+        p_++;
+        return true;
+      case '^':
+        node.kind = Node::Kind::kBegin;
+        return true;
+      case '$':
+        node.kind = Node::Kind::kEnd;
+        return true;
+      case '.':
+        AnyCharExcept(node, ByteSet{});
+        return true;
+      case '[':
+        return ParseBracket(node);
+      case '\\':
+        return ParseEscape(node);
+      default:
+        node.kind = Node::Kind::kBytes;
+        node.bytes.set(c);
+        FoldCase(node.bytes);
+        return true;
+    }
+  }
+
+  bool ParseEscape(Node& node)
+  {
+    unsigned char c = *p_++;
+    ByteSet set;
+    bool negate = false;
+
+    switch (c) {
+      case 'W':
+        negate = true;
+        [[fallthrough]];
+      case 'w':
+        if (multibyte_) { return false; }
+        for (int b = 1; b < 256; b++) {
+          if (isalnum(b) || b == '_') { set.set(b); }
+        }
+        break;
+      case 'S':
+        negate = true;
+        [[fallthrough]];
+      case 's':
+        if (multibyte_) { return false; }
+        for (int b = 1; b < 256; b++) {
+          if (isspace(b)) { set.set(b); }
+        }
+        break;
+      case '\0':
+      case 'b':
+      case 'B':
+      case '<':
+      case '>':
+      case '`':
+      case '\'':
+        return false;
+      default:
+        // back references
+        if (isdigit(c)) { return false; }
+        set.set(c);
+        break;
+    }
+    FoldCase(set);
+    if (negate) {
+      AnyCharExcept(node, set);
+    } else {
+      node.kind = Node::Kind::kBytes;
+      node.bytes = set;
+    }
+    return true;
+  }
+
+  static bool AddCharClass(ByteSet& set, const std::string& name)
+  {
+    static const std::pair<const char*, int (*)(int)> classes[] = {
+        {"alpha", isalpha}, {"digit", isdigit},   {"alnum", isalnum},
+        {"upper", isupper}, {"lower", islower},   {"space", isspace},
+        {"blank", isblank}, {"punct", ispunct},   {"print", isprint},
+        {"graph", isgraph}, {"cntrl", iscntrl},   {"xdigit", isxdigit},
+    };
+    for (const auto& [class_name, predicate] : classes) {
+      if (name == class_name) {
+        for (int b = 1; b < 256; b++) {
+          if (predicate(b)) { set.set(b); }
+        }
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /* Ranges follow the collation order of the locale. Only ranges between
+   * characters of the same kind have the obvious meaning everywhere. */
+  static bool RangeIsPlain(int lo, int hi)
+  {
+    if (isdigit(lo) && isdigit(hi)) { return true; }
+    if (islower(lo) && islower(hi)) { return true; }
+    if (isupper(lo) && isupper(hi)) { return true; }
+    return CollationIsC();
+  }
+
+  bool ParseBracket(Node& node)
+  {
+    ByteSet set;
+    bool negate = false;
+
+    if (*p_ == '^') {
+      negate = true;
+      p_++;
+    }
+    for (bool first = true;; first = false) {
+      int lo = *p_;
+      if (lo == '\0') { return false; }
+      if (lo == ']' && !first) {
+        p_++;
+        break;
+      }
+      if (lo == '[' && (p_[1] == ':' || p_[1] == '=' || p_[1] == '.')) {
+        // Equivalence classes and collating symbols depend on the locale
+        if (p_[1] != ':' || multibyte_) { return false; }
+        const char* name = reinterpret_cast<const char*>(p_ + 2);
+        const char* end = strstr(name, ":]");
+        if (!end || !AddCharClass(set, std::string(name, end))) {
+          return false;
+        }
+        p_ = reinterpret_cast<const unsigned char*>(end + 2);
+        if (*p_ == '-' && p_[1] != ']') { return false; }
+        continue;
+      }
+      p_++;
+      if (*p_ == '-' && p_[1] != ']' && p_[1] != '\0') {
+        if (lo == '-' && !first) { return false; }
+        int hi = p_[1];
+        if (hi == '[' || hi < lo || !RangeIsPlain(lo, hi)) { return false; }
+        p_ += 2;
+        for (int b = lo; b <= hi; b++) { set.set(b); }
+      } else {
+        set.set(lo);
+      }
+    }
+    FoldCase(set);
+    if (negate) {
+      AnyCharExcept(node, set);
+    } else {
+      node.kind = Node::Kind::kBytes;
+      node.bytes = set;
+    }
+    return true;
+  }
+
+  // regcomp() compares case insensitively by converting to lower case
+  void FoldCase(ByteSet& set) const
+  {
+    if (!icase_) { return; }
+    ByteSet lower;
+    for (int b = 0; b < 256; b++) {
+      if (set[b]) { lower.set(tolower(b) & 0xff); }
+    }
+    for (int b = 0; b < 256; b++) {
+      if (lower[tolower(b) & 0xff]) { set.set(b); }
+    }
+  }
+
+  static Node Bytes(int lo, int hi)
+  {
+    Node node;
+    node.kind = Node::Kind::kBytes;
+    for (int b = lo; b <= hi; b++) { node.bytes.set(b); }
+    return node;
+  }
+
+  static Node Sequence(int lead_lo, int lead_hi, int continuation_bytes)
+  {
+    Node node;
+    node.kind = Node::Kind::kConcat;
+    node.children.push_back(Bytes(lead_lo, lead_hi));
+    for (int i = 0; i < continuation_bytes; i++) {
+      node.children.push_back(Bytes(0x80, 0xbf));
+    }
+    return node;
+  }
+
+  /* Any character but NUL and the ones in excluded, which only contains
+   * single byte characters. In a multibyte locale a character is a UTF-8
+   * sequence, RegexSet makes sure the subject is valid UTF-8 then. */
+  void AnyCharExcept(Node& node, const ByteSet& excluded)
+  {
+    ByteSet single = ~excluded;
+    single.reset(0);
+    if (!multibyte_) {
+      node.kind = Node::Kind::kBytes;
+      node.bytes = single;
+      return;
+    }
+    uses_any_char_ = true;
+    for (int b = 0x80; b < 256; b++) { single.reset(b); }
+    node.kind = Node::Kind::kAlternate;
+    node.children.emplace_back();
+    node.children.back().kind = Node::Kind::kBytes;
+    node.children.back().bytes = single;
+    node.children.push_back(Sequence(0xc2, 0xdf, 1));
+    node.children.push_back(Sequence(0xe0, 0xef, 2));
+    node.children.push_back(Sequence(0xf0, 0xf4, 3));
+  }
+
+  const unsigned char* p_;
+  bool icase_;
+  bool multibyte_;
+  bool uses_any_char_{false};
+  int depth_{0};
+};
+
+// Number of NFA states Nfa::Build() creates for node, saturating
+static int64_t CountStates(const Node& node)
+{
+  int64_t count = 0;
+  switch (node.kind) {
+    case Node::Kind::kConcat:
+    case Node::Kind::kAlternate:
+      count = 1;
+      for (const auto& child : node.children) {
+        count += CountStates(child) + 1;
+      }
+      break;
+    case Node::Kind::kRepeat: {
+      int64_t child = CountStates(node.children[0]) + 1;
+      int64_t copies = node.max == -1 ? node.min + 1 : node.max;
+      count = 1 + child * std::max<int64_t>(copies, 1);
+      break;
+    }
+    default:
+      count = 1;
+      break;
+  }
+  return std::min(count, kMaxSetStates + 1);
+}
+
+struct NfaState {
+  enum class Type : uint8_t
+  {
+    kBytes,
+    kSplit,
+    kBegin,
+    kEnd,
+    kMatch
+  };
+  Type type;
+  int set{-1};  // index into Automaton::sets_ for kBytes
+  int out{-1};
+  int out1{-1};  // second edge of kSplit
+};
+
+class Automaton {
+ public:
+  Automaton(const std::vector<Node>& roots, bool mb_any_char, bool mb_icase)
+      : mb_any_char_(mb_any_char), mb_icase_(mb_icase)
+  {
+    start_ = AddState(NfaState::Type::kSplit);
+    int match = AddState(NfaState::Type::kMatch);
+    int last_split = start_;
+    for (const auto& root : roots) {
+      Frag frag = Build(root);
+      Patch(frag.holes, match);
+      if (nfa_[last_split].out == -1) {
+        nfa_[last_split].out = frag.start;
+      } else {
+        int split = AddState(NfaState::Type::kSplit);
+        nfa_[split].out = frag.start;
+        nfa_[last_split].out1 = split;
+        last_split = split;
+      }
+    }
+    mark_.assign(nfa_.size(), 0);
+    BuildByteClasses();
+    BuildDfa();
+  }
+
+  /* Whether Search() gives the same result as regexec() for subject. In a
+   * multibyte locale regexec() works on characters: invalid UTF-8 is not
+   * covered by the sequences matched for . and negated brackets, and case
+   * insensitive matching converts to upper case characters, which maps the
+   * dotless i and the long s to ASCII letters. */
+  bool Handles(const unsigned char* subject) const
+  {
+    if (!mb_any_char_ && !mb_icase_) { return true; }
+    for (const unsigned char* p = subject; *p; p++) {
+      if (*p < 0x80) { continue; }
+      if (mb_icase_
+          && ((p[0] == 0xc4 && p[1] == 0xb1) || (p[0] == 0xc5 && p[1] == 0xbf))) {
+        return false;
+      }
+      int len = Utf8SequenceLength(p);
+      if (len == 0) {
+        if (mb_any_char_) { return false; }
+        continue;
+      }
+      p += len - 1;
+    }
+    return true;
+  }
+
+  bool Search(const unsigned char* subject) const
+  {
+    return dfa_accept_now_.empty() ? SimulateNfa(subject) : RunDfa(subject);
+  }
+
+ private:
+  struct Frag {
+    int start;
+    std::vector<int> holes;  // state * 2 + 1 for out1, state * 2 for out
+  };
+
+  int AddState(NfaState::Type type)
+  {
+    nfa_.push_back(NfaState{type});
+    return static_cast<int>(nfa_.size()) - 1;
+  }
+
+  void Patch(const std::vector<int>& holes, int target)
+  {
+    for (int hole : holes) {
+      NfaState& state = nfa_[hole / 2];
+      (hole % 2 ? state.out1 : state.out) = target;
+    }
+  }
+
+  Frag Single(NfaState::Type type)
+  {
+    int state = AddState(type);
+    return Frag{state, {state * 2}};
+  }
+
+  // Sequence of frags, the frags are consumed
+  Frag Concat(std::vector<Frag>& frags)
+  {
+    Frag result = Single(NfaState::Type::kSplit);
+    for (auto& frag : frags) {
+      Patch(result.holes, frag.start);
+      result.holes = std::move(frag.holes);
+    }
+    return result;
+  }
+
+  Frag Optional(Frag frag)
+  {
+    int split = AddState(NfaState::Type::kSplit);
+    nfa_[split].out = frag.start;
+    frag.holes.push_back(split * 2 + 1);
+    frag.start = split;
+    return frag;
+  }
+
+  Frag Build(const Node& node)
+  {
+    switch (node.kind) {
+      case Node::Kind::kEmpty:
+        return Single(NfaState::Type::kSplit);
+      case Node::Kind::kBytes: {
+        Frag frag = Single(NfaState::Type::kBytes);
+        nfa_[frag.start].set = AddSet(node.bytes);
+        return frag;
+      }
+      case Node::Kind::kBegin:
+        return Single(NfaState::Type::kBegin);
+      case Node::Kind::kEnd:
+        return Single(NfaState::Type::kEnd);
+      case Node::Kind::kConcat: {
+        std::vector<Frag> frags;
+        for (const auto& child : node.children) {
+          frags.push_back(Build(child));
+        }
+        return Concat(frags);
+      }
+      case Node::Kind::kAlternate: {
+        Frag result{-1, {}};
+        int last_split = -1;
+        for (const auto& child : node.children) {
+          Frag frag = Build(child);
+          int split = AddState(NfaState::Type::kSplit);
+          nfa_[split].out = frag.start;
+          if (last_split == -1) {
+            result.start = split;
+          } else {
+            nfa_[last_split].out1 = split;
+          }
+          last_split = split;
+          result.holes.insert(result.holes.end(), frag.holes.begin(),
+                              frag.holes.end());
+        }
+        return result;
+      }
+      case Node::Kind::kRepeat: {
+        const Node& child = node.children[0];
+        std::vector<Frag> frags;
+        for (int i = 0; i < node.min; i++) { frags.push_back(Build(child)); }
+        if (node.max == -1) {
+          Frag frag = Build(child);
+          int split = AddState(NfaState::Type::kSplit);
+          nfa_[split].out = frag.start;
+          Patch(frag.holes, split);
+          frags.push_back(Frag{split, {split * 2 + 1}});
+        } else if (node.max > node.min) {
+          // x{0,3} is (x(x(x)?)?)?, built from the inside
+          Frag tail = Optional(Build(child));
+          for (int i = node.min + 1; i < node.max; i++) {
+            Frag frag = Build(child);
+            Patch(frag.holes, tail.start);
+            frag.holes = std::move(tail.holes);
+            tail = Optional(std::move(frag));
+          }
+          frags.push_back(std::move(tail));
+        }
+        return Concat(frags);
+      }
+    }
+    return Single(NfaState::Type::kSplit);
+  }
+
+  int AddSet(const ByteSet& set)
+  {
+    for (size_t i = 0; i < sets_.size(); i++) {
+      if (sets_[i] == set) { return static_cast<int>(i); }
+    }
+    sets_.push_back(set);
+    return static_cast<int>(sets_.size()) - 1;
+  }
+
+  // Bytes that are in the same sets are not distinguished by the DFA
+  void BuildByteClasses()
+  {
+    std::map<std::vector<bool>, uint8_t> classes;
+    for (int b = 0; b < 256; b++) {
+      std::vector<bool> signature(sets_.size());
+      for (size_t i = 0; i < sets_.size(); i++) { signature[i] = sets_[i][b]; }
+      auto it = classes.emplace(signature, classes.size()).first;
+      byte_class_[b] = it->second;
+      if (it->second == class_representative_.size()) {
+        class_representative_.push_back(b);
+      }
+    }
+  }
+
+  /* Adds the kBytes states reachable from state over epsilon edges to
+   * closure, returns whether the match state is reachable. */
+  bool AddClosure(int state,
+                  bool at_begin,
+                  bool at_end,
+                  std::vector<int>& closure,
+                  std::vector<uint32_t>& mark,
+                  uint32_t generation) const
+  {
+    bool match = false;
+    std::vector<int> stack{state};
+    while (!stack.empty()) {
+      int s = stack.back();
+      stack.pop_back();
+      if (s == -1 || mark[s] == generation) { continue; }
+      mark[s] = generation;
+      const NfaState& nfa_state = nfa_[s];
+      switch (nfa_state.type) {
+        case NfaState::Type::kBytes:
+          closure.push_back(s);
+          break;
+        case NfaState::Type::kSplit:
+          stack.push_back(nfa_state.out1);
+          stack.push_back(nfa_state.out);
+          break;
+        case NfaState::Type::kBegin:
+          if (at_begin) { stack.push_back(nfa_state.out); }
+          break;
+        case NfaState::Type::kEnd:
+          if (at_end) { stack.push_back(nfa_state.out); }
+          break;
+        case NfaState::Type::kMatch:
+          match = true;
+          break;
+      }
+    }
+    return match;
+  }
+
+  // Closure of the kernel and, as matches may start anywhere, the start
+  bool Closure(const std::vector<int>& kernel,
+               bool at_begin,
+               bool at_end,
+               std::vector<int>& closure,
+               std::vector<uint32_t>& mark,
+               uint32_t& generation) const
+  {
+    if (++generation == 0) {
+      std::fill(mark.begin(), mark.end(), 0);
+      generation = 1;
+    }
+    closure.clear();
+    bool match = AddClosure(start_, at_begin, at_end, closure, mark, generation);
+    for (int state : kernel) {
+      match |= AddClosure(state, at_begin, at_end, closure, mark, generation);
+    }
+    return match;
+  }
+
+  void Step(const std::vector<int>& closure,
+            int byte,
+            std::vector<int>& kernel) const
+  {
+    kernel.clear();
+    for (int state : closure) {
+      if (sets_[nfa_[state].set][byte]) { kernel.push_back(nfa_[state].out); }
+    }
+    std::sort(kernel.begin(), kernel.end());
+    kernel.erase(std::unique(kernel.begin(), kernel.end()), kernel.end());
+  }
+
+  void BuildDfa()
+  {
+    using Key = std::pair<bool, std::vector<int>>;
+    std::map<Key, int32_t> ids;
+    std::vector<Key> keys;
+    std::vector<int> closure, next;
+    uint32_t generation = 0;
+    size_t num_classes = class_representative_.size();
+
+    auto id_of = [&](Key key) {
+      auto [it, inserted] = ids.emplace(key, static_cast<int32_t>(keys.size()));
+      if (inserted) { keys.push_back(std::move(key)); }
+      return it->second;
+    };
+
+    id_of(Key{true, {}});
+    for (size_t id = 0; id < keys.size(); id++) {
+      if (keys.size() > kMaxDfaStates) {
+        dfa_accept_now_.clear();
+        dfa_accept_at_end_.clear();
+        dfa_transitions_.clear();
+        return;
+      }
+      bool at_begin = keys[id].first;
+      std::vector<int> kernel = keys[id].second;
+      bool accept_now
+          = Closure(kernel, at_begin, false, closure, mark_, generation);
+      dfa_accept_now_.push_back(accept_now);
+      dfa_accept_at_end_.push_back(
+          accept_now
+          || Closure(kernel, at_begin, true, next, mark_, generation));
+      if (accept_now) {
+        // The search stops here, the transitions are never used
+        dfa_transitions_.insert(dfa_transitions_.end(), num_classes,
+                                static_cast<int32_t>(id));
+        continue;
+      }
+      for (size_t c = 0; c < num_classes; c++) {
+        Step(closure, class_representative_[c], next);
+        dfa_transitions_.push_back(id_of(Key{false, next}));
+      }
+    }
+  }
+
+  bool RunDfa(const unsigned char* subject) const
+  {
+    size_t num_classes = class_representative_.size();
+    int32_t state = 0;
+    for (const unsigned char* p = subject; *p; p++) {
+      if (dfa_accept_now_[state]) { return true; }
+      state = dfa_transitions_[state * num_classes + byte_class_[*p]];
+    }
+    return dfa_accept_at_end_[state];
+  }
+
+  bool SimulateNfa(const unsigned char* subject) const
+  {
+    std::vector<int> kernel, closure;
+    std::vector<uint32_t> mark(nfa_.size(), 0);
+    uint32_t generation = 0;
+    bool at_begin = true;
+    for (const unsigned char* p = subject; *p; p++) {
+      if (Closure(kernel, at_begin, false, closure, mark, generation)) {
+        return true;
+      }
+      Step(closure, *p, kernel);
+      at_begin = false;
+    }
+    return Closure(kernel, at_begin, true, closure, mark, generation);
+  }
+
+  // Length of the valid UTF-8 sequence at p, 0 if it is invalid
+  static int Utf8SequenceLength(const unsigned char* p)
+  {
+    int len;
+    unsigned char lo = 0x80, hi = 0xbf;
+    if (p[0] >= 0xc2 && p[0] <= 0xdf) {
+      len = 2;
+    } else if (p[0] >= 0xe0 && p[0] <= 0xef) {
+      len = 3;
+      if (p[0] == 0xe0) { lo = 0xa0; }
+      if (p[0] == 0xed) { hi = 0x9f; }
+    } else if (p[0] >= 0xf0 && p[0] <= 0xf4) {
+      len = 4;
+      if (p[0] == 0xf0) { lo = 0x90; }
+      if (p[0] == 0xf4) { hi = 0x8f; }
+    } else {
+      return 0;
+    }
+    if (p[1] < lo || p[1] > hi) { return 0; }
+    for (int i = 2; i < len; i++) {
+      if (p[i] < 0x80 || p[i] > 0xbf) { return 0; }
+    }
+    return len;
+  }
+
+  bool mb_any_char_;
+  bool mb_icase_;
+  std::vector<NfaState> nfa_;
+  std::vector<ByteSet> sets_;
+  int start_;
+  std::vector<uint32_t> mark_;  // only used while building
+  uint8_t byte_class_[256];
+  std::vector<int> class_representative_;
+  std::vector<int32_t> dfa_transitions_;
+  std::vector<uint8_t> dfa_accept_now_;
+  std::vector<uint8_t> dfa_accept_at_end_;
+};
+
+/* Automata of the sets currently in use. An FD compiles the same fileset
+ * for every job and every matching thread, so they are shared. */
+static std::mutex cache_mutex;
+static std::map<std::string, std::weak_ptr<const Automaton>> cache;
+
+static std::shared_ptr<const Automaton> GetAutomaton(
+    const std::string& key,
+    const std::vector<Node>& roots,
+    bool mb_any_char,
+    bool mb_icase)
+{
+  std::lock_guard<std::mutex> lock(cache_mutex);
+
+  auto it = cache.find(key);
+  if (it != cache.end()) {
+    if (auto automaton = it->second.lock()) { return automaton; }
+  }
+
+  auto automaton
+      = std::make_shared<const Automaton>(roots, mb_any_char, mb_icase);
+  if (cache.size() >= kMaxCachedAutomata) {
+    for (auto entry = cache.begin(); entry != cache.end();) {
+      if (entry->second.expired()) {
+        entry = cache.erase(entry);
+      } else {
+        ++entry;
+      }
+    }
+  }
+  if (cache.size() < kMaxCachedAutomata) { cache[key] = automaton; }
+  return automaton;
+}
+
+}  // namespace regex_set_detail
+
+using namespace regex_set_detail;
+
+RegexSet::~RegexSet()
+{
+  for (auto& pattern : patterns_) {
+    regfree(pattern.preg);
+    free(pattern.preg);
+  }
+}
+
+bool RegexSet::Add(const char* pattern, int cflags, std::string& errmsg)
+{
+  regex_t* preg = (regex_t*)malloc(sizeof(regex_t));
+  int rc = regcomp(preg, pattern, cflags);
+  if (rc != 0) {
+    char prbuf[500];
+    regerror(rc, preg, prbuf, sizeof(prbuf));
+    regfree(preg);
+    free(preg);
+    errmsg = prbuf;
+    return false;
+  }
+  patterns_.push_back(Pattern{pattern, cflags, preg, true});
+  compiled_ = false;
+  return true;
+}
+
+void RegexSet::Compile()
+{
+  std::vector<Node> roots;
+  int64_t states = 0;
+  bool mb_any_char = false;
+  bool mb_icase = false;
+  bool multibyte = MB_CUR_MAX > 1;
+
+  // Character classes and ranges depend on the locale
+  std::string key = std::to_string(MB_CUR_MAX);
+  for (int category : {LC_CTYPE, LC_COLLATE}) {
+    const char* locale = setlocale(category, nullptr);
+    key += ' ';
+    key += locale ? locale : "";
+  }
+
+  for (auto& pattern : patterns_) {
+    Parser parser(pattern.text.c_str(), pattern.cflags);
+    Node root;
+
+    pattern.use_regexec = true;
+    if (pattern.cflags & REG_NEWLINE || !parser.Parse(root)) { continue; }
+    int64_t count = CountStates(root);
+    if (count > kMaxPatternStates || states + count > kMaxSetStates) {
+      continue;
+    }
+    states += count;
+    pattern.use_regexec = false;
+    mb_any_char |= parser.UsesAnyChar();
+    mb_icase |= multibyte && (pattern.cflags & REG_ICASE);
+    key += '\n' + std::to_string(pattern.cflags & REG_ICASE) + ' '
+           + std::to_string(pattern.text.size()) + ' ' + pattern.text;
+    roots.push_back(std::move(root));
+  }
+
+  automaton_ = nullptr;
+  if (!roots.empty()) {
+    automaton_ = GetAutomaton(key, roots, mb_any_char, mb_icase);
+  }
+  compiled_ = true;
+}
+
+bool RegexSet::Search(const char* subject)
+{
+  if (!compiled_) { Compile(); }
+
+  auto text = reinterpret_cast<const unsigned char*>(subject);
+  bool automaton_handles = automaton_ && automaton_->Handles(text);
+  if (automaton_handles && automaton_->Search(text)) { return true; }
+  for (auto& pattern : patterns_) {
+    if (pattern.use_regexec || (automaton_ && !automaton_handles)) {
+      if (regexec(pattern.preg, subject, 0, nullptr, 0) == 0) { return true; }
+    }
+  }
+  return false;
+}
@@ -0,0 +1,86 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+
+#ifndef BAREOS_LIB_REGEX_SET_H_
+#define BAREOS_LIB_REGEX_SET_H_
+
+#ifndef HAVE_REGEX_H
+#  include "lib/bregex.h"
+#else
+#  include <regex.h>
+#endif
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace regex_set_detail {
+class Automaton;
+}
+
+/* A set of POSIX extended regular expressions that is matched against a
+ * string at once, e.g. all regex = entries of a fileset options block.
+ *
+ * The patterns are compiled into one finite automaton, which is turned
+ * into a DFA as long as that stays small, so a search takes time linear in
+ * the length of the string, regardless of the number of patterns and
+ * without the exponential backtracking some patterns cause in
+ * regexec(). Sets with the same patterns share their automaton through a
+ * process wide cache. Patterns using something the automaton does not
+ * implement (back references, word boundaries, non ASCII characters) are
+ * still matched with regexec().
+ *
+ * Like a regex_t, a RegexSet must not be searched by several threads at
+ * once. */
+class RegexSet {
+ public:
+  RegexSet() = default;
+  ~RegexSet();
+  RegexSet(const RegexSet&) = delete;
+  RegexSet& operator=(const RegexSet&) = delete;
+
+  /* Add a pattern, cflags as for regcomp(). Returns false and the
+   * regerror() message in errmsg if the pattern does not compile. */
+  bool Add(const char* pattern, int cflags, std::string& errmsg);
+
+  // True if any of the patterns matches somewhere in subject.
+  bool Search(const char* subject);
+
+  std::size_t size() const { return patterns_.size(); }
+  bool empty() const { return patterns_.empty(); }
+
+ private:
+  struct Pattern {
+    std::string text;
+    int cflags;
+    regex_t* preg;
+    bool use_regexec;
+  };
+
+  void Compile();
+
+  std::vector<Pattern> patterns_;
+  std::shared_ptr<const regex_set_detail::Automaton> automaton_;
+  bool compiled_{false};
+};
+
+#endif  // BAREOS_LIB_REGEX_SET_H_
@@ -90,8 +90,6 @@ thread_local PluginContext* plugin_context = NULL;
 
 MOD_INIT(bareosdir)
 {
-  PyObject* m = NULL;
-  MOD_DEF(m, PYTHON_MODULE_NAME_QUOTED, NULL, Methods)
   static void* Bareosdir_API[Bareosdir_API_pointers];
   PyObject* c_api_object;
 
@@ -115,6 +115,9 @@ static PluginFunctions pluginFuncs
  */
 static PyThreadState* mainThreadState{nullptr};
 
+/* Run each plugin instance in a sub-interpreter with its own GIL. */
+static bool python_plugin_own_gil{false};
+
 /* functions common to all plugins */
 #include "plugins/include/python_plugins_common.inc"
 #include "plugins/include/python_plugin_modules_common.inc"
@@ -205,6 +208,12 @@ bRC loadPlugin(PluginApiDefinition* lbareos_plugin_interface_version,
       = lbareos_core_functions; /* Set Bareos funct pointers */
   bareos_plugin_interface_version = lbareos_plugin_interface_version;
 
+  if (bareos_core_functions->getBareosValue(nullptr, bDirVarPythonPluginOwnGil,
+                                            &python_plugin_own_gil)
+      != bRC_OK) {
+    python_plugin_own_gil = false;
+  }
+
   *plugin_information = &pluginInfo; /* Return pointer to our info */
   *plugin_functions = &pluginFuncs;  /* Return pointer to our functions */
 
@@ -246,9 +255,8 @@ static bRC newPlugin(PluginContext* plugin_ctx)
   /* set bareos_core_functions inside of barosdir module */
   Bareosdir_set_plugin_context(plugin_ctx);
   /* For each plugin instance we instantiate a new Python interpreter. */
-  PyEval_AcquireThread(mainThreadState);
-  plugin_priv_ctx->interpreter = Py_NewInterpreter();
-  PyEval_ReleaseThread(plugin_priv_ctx->interpreter);
+  plugin_priv_ctx->interpreter
+      = NewPluginInterpreter(mainThreadState, python_plugin_own_gil);
 
   /* Always register some events the python plugin itself can register
      any other events it is interested in.  */
@@ -272,13 +280,7 @@ static bRC freePlugin(PluginContext* plugin_ctx)
 
   if (plugin_priv_ctx->pModule) { Py_DECREF(plugin_priv_ctx->pModule); }
 
-  Py_EndInterpreter(plugin_priv_ctx->interpreter);
-#if PY_VERSION_HEX < VERSION_HEX(3, 2, 0)
-  PyEval_ReleaseLock();
-#else
-  PyThreadState_Swap(mainThreadState);
-  PyEval_ReleaseThread(mainThreadState);
-#endif
+  EndPluginInterpreter(plugin_priv_ctx->interpreter, mainThreadState);
 
   free(plugin_priv_ctx);
   plugin_ctx->plugin_private_context = NULL;
@@ -47,6 +47,7 @@
 namespace filedaemon {
 
 static const int debuglevel = 150;
+static const int32_t kMaxIoBatchSize = 64 * 1024 * 1024;
 
 static bRC set_bareos_core_functions(CoreFunctions* new_bareos_core_functions);
 static bRC set_plugin_context(PluginContext* new_plugin_context);
@@ -101,6 +102,68 @@ static bRC set_plugin_context(PluginContext* new_plugin_context)
   return bRC_OK;
 }
 
+static int bareosfd_traverse(PyObject* m, visitproc visit, void* arg)
+{
+  bareosfd_state* state = (bareosfd_state*)PyModule_GetState(m);
+
+  Py_VISIT(state->RestoreObjectType);
+  Py_VISIT(state->StatPacketType);
+  Py_VISIT(state->SavePacketType);
+  Py_VISIT(state->RestorePacketType);
+  Py_VISIT(state->IoPacketType);
+  Py_VISIT(state->AclPacketType);
+  Py_VISIT(state->XattrPacketType);
+  Py_VISIT(state->IoBufferType);
+  return 0;
+}
+
+static int bareosfd_clear(PyObject* m)
+{
+  bareosfd_state* state = (bareosfd_state*)PyModule_GetState(m);
+
+  Py_CLEAR(state->RestoreObjectType);
+  Py_CLEAR(state->StatPacketType);
+  Py_CLEAR(state->SavePacketType);
+  Py_CLEAR(state->RestorePacketType);
+  Py_CLEAR(state->IoPacketType);
+  Py_CLEAR(state->AclPacketType);
+  Py_CLEAR(state->XattrPacketType);
+  Py_CLEAR(state->IoBufferType);
+  return 0;
+}
+
+static void bareosfd_free(void* m) { bareosfd_clear((PyObject*)m); }
+
+/**
+ * Return the module state of the bareosfd module loaded into the interpreter
+ * of this plugin instance. The module is looked up once and then kept in the
+ * plugin context, the host releases it together with the interpreter.
+ */
+static bareosfd_state* GetModuleState(PluginContext* plugin_ctx)
+{
+  struct plugin_private_context* plugin_priv_ctx
+      = (struct plugin_private_context*)plugin_ctx->plugin_private_context;
+
+  if (!plugin_priv_ctx->bareosfd_module) {
+    plugin_priv_ctx->bareosfd_module
+        = PyImport_ImportModule(PYTHON_MODULE_NAME_QUOTED);
+    if (!plugin_priv_ctx->bareosfd_module) { return NULL; }
+  }
+
+  return (bareosfd_state*)PyModule_GetState(plugin_priv_ctx->bareosfd_module);
+}
+
+/* Objects of heap types hold a reference to their type. */
+static inline void FreeHeapTypeObject(PyObject* self)
+{
+  PyTypeObject* type = Py_TYPE(self);
+
+  type->tp_free(self);
+#if PY_VERSION_HEX >= VERSION_HEX(3, 8, 0)
+  Py_DECREF(type);
+#endif
+}
+
 /**
  * Any plugin options which are passed in are dispatched here to a Python
  * method and it can parse the plugin options. This function is also called
@@ -192,9 +255,13 @@ bail_out:
   return retval;
 }
 
-static inline PyStatPacket* NativeToPyStatPacket(struct stat* statp)
+static inline PyStatPacket* NativeToPyStatPacket(PluginContext* plugin_ctx,
+                                                 struct stat* statp)
 {
-  PyStatPacket* pStatp = PyObject_New(PyStatPacket, &PyStatPacketType);
+  bareosfd_state* state = GetModuleState(plugin_ctx);
+  if (!state) { return NULL; }
+
+  PyStatPacket* pStatp = PyObject_New(PyStatPacket, state->StatPacketType);
 
   if (pStatp) {
     pStatp->dev = statp->st_dev;
@@ -233,15 +300,20 @@ static inline void PyStatPacketToNative(PyStatPacket* pStatp,
   statp->st_blocks = pStatp->blocks;
 }
 
-static inline PySavePacket* NativeToPySavePacket(save_pkt* sp)
+static inline PySavePacket* NativeToPySavePacket(PluginContext* plugin_ctx,
+                                                 save_pkt* sp)
 {
-  PySavePacket* pSavePkt = PyObject_New(PySavePacket, &PySavePacketType);
+  bareosfd_state* state = GetModuleState(plugin_ctx);
+  if (!state) { return NULL; }
+
+  PySavePacket* pSavePkt = PyObject_New(PySavePacket, state->SavePacketType);
 
   if (pSavePkt) {
     pSavePkt->fname = PyUnicode_FromString(sp->fname ? sp->fname : "");
     pSavePkt->link = PyUnicode_FromString(sp->link ? sp->link : "");
     if (sp->statp.st_mode) {
-      pSavePkt->statp = (PyObject*)NativeToPyStatPacket(&sp->statp);
+      pSavePkt->statp
+          = (PyObject*)NativeToPyStatPacket(plugin_ctx, &sp->statp);
     } else {
       pSavePkt->statp = NULL;
     }
@@ -442,7 +514,7 @@ static bRC PyStartBackupFile(PluginContext* plugin_ctx, save_pkt* sp)
     PySavePacket* pSavePkt;
     PyObject* pRetVal;
 
-    pSavePkt = NativeToPySavePacket(sp);
+    pSavePkt = NativeToPySavePacket(plugin_ctx, sp);
     if (!pSavePkt) {
       Dmsg(plugin_ctx, debuglevel,
            LOGPREFIX "Failed to convert save packet to python.\n");
@@ -517,9 +589,14 @@ bail_out:
   return retval;
 }
 
-static inline PyIoPacket* NativeToPyIoPacket(io_pkt* io)
+static inline PyIoPacket* NativeToPyIoPacket(PluginContext* plugin_ctx,
+                                             io_pkt* io,
+                                             bool zero_copy_io)
 {
-  PyIoPacket* pIoPkt = PyObject_New(PyIoPacket, &PyIoPacketType);
+  bareosfd_state* state = GetModuleState(plugin_ctx);
+  if (!state) { return NULL; }
+
+  PyIoPacket* pIoPkt = PyObject_New(PyIoPacket, state->IoPacketType);
 
   if (pIoPkt) {
     // Initialize the Python IoPkt with the data we got passed in.
@@ -532,7 +609,28 @@ static inline PyIoPacket* NativeToPyIoPacket(io_pkt* io)
     pIoPkt->offset = io->offset;
     pIoPkt->filedes = io->filedes;
 
-    if (io->func == IO_WRITE && io->count > 0) {
+    if (zero_copy_io && state->IoBufferType
+        && (io->func == IO_READ || io->func == IO_WRITE) && io->count > 0) {
+      /* Hand out a view on the buffer of the core. On read the plugin fills
+       * it in place (e.g. using readinto()), on write it gets the data
+       * without an intermediate copy. */
+      PyIoBuffer* pIoBuf = PyObject_New(PyIoBuffer, state->IoBufferType);
+      if (!pIoBuf) {
+        Py_DECREF((PyObject*)pIoPkt);
+        return (PyIoPacket*)NULL;
+      }
+      pIoBuf->buf = io->buf;
+      pIoBuf->len = io->count;
+      pIoBuf->readonly = io->func == IO_WRITE;
+      pIoBuf->exports = 0;
+
+      pIoPkt->buf = PyMemoryView_FromObject((PyObject*)pIoBuf);
+      Py_DECREF((PyObject*)pIoBuf);
+      if (!pIoPkt->buf) {
+        Py_DECREF((PyObject*)pIoPkt);
+        return (PyIoPacket*)NULL;
+      }
+    } else if (io->func == IO_WRITE && io->count > 0) {
       /* Only initialize the buffer with read data when we are writing and
        * there is data.*/
       pIoPkt->buf = PyByteArray_FromStringAndSize(io->buf, io->count);
@@ -583,12 +681,53 @@ static inline bool PyIoPacketToNative(PyIoPacket* pIoPkt, io_pkt* io)
 
       if (!(buf = PyBytes_AsString(pIoPkt->buf))) { return false; }
       memcpy(io->buf, buf, io->status);
+    } else if (PyMemoryView_Check(pIoPkt->buf)) {
+      Py_buffer* view = PyMemoryView_GET_BUFFER(pIoPkt->buf);
+
+      if (view->len > io->count || io->status > io->count) { return false; }
+
+      // Data was read into our own buffer, nothing to copy.
+      if (view->buf != io->buf) {
+        if (!PyBuffer_IsContiguous(view, 'C')) { return false; }
+        memcpy(io->buf, view->buf, io->status);
+      }
     }
   }
 
   return true;
 }
 
+/* Release a memoryview handed out by NativeToPyIoPacket(). Slices and views
+ * derived from it keep the buffer of the core exported after release(), so
+ * fail when the plugin kept any of them beyond plugin_io(). */
+static inline bool ReleaseIoBufferView(PyObject* view)
+{
+  bool retval = true;
+
+  if (view) {
+    PyIoBuffer* pIoBuf = (PyIoBuffer*)PyMemoryView_GET_BUFFER(view)->obj;
+    Py_INCREF((PyObject*)pIoBuf);
+
+    PyObject* pRetVal = PyObject_CallMethod(view, "release", NULL);
+    if (pRetVal) {
+      Py_DECREF(pRetVal);
+    } else {
+      retval = false;
+    }
+    Py_DECREF(view);
+
+    // Derived views may only be kept alive by a reference cycle.
+    if (pIoBuf->exports > 0) { PyGC_Collect(); }
+    if (pIoBuf->exports > 0) { retval = false; }
+
+    // Refuse new exports, the buffer is reused by the core.
+    pIoBuf->buf = NULL;
+    Py_DECREF((PyObject*)pIoBuf);
+  }
+
+  return retval;
+}
+
 /**
  * Do actual I/O. Bareos calls this after startBackupFile
  * or after startRestoreFile to do the actual file
@@ -607,13 +746,23 @@ static bRC PyPluginIO(PluginContext* plugin_ctx, io_pkt* io)
   if (pFunc && PyCallable_Check(pFunc)) {
     PyIoPacket* pIoPkt;
     PyObject* pRetVal;
+    PyObject* pView = NULL;
 
-    pIoPkt = NativeToPyIoPacket(io);
+    pIoPkt
+        = NativeToPyIoPacket(plugin_ctx, io, plugin_priv_ctx->zero_copy_io);
     if (!pIoPkt) { goto bail_out; }
 
+    /* Keep our own reference to a handed out view as the plugin is free to
+     * replace IOP.buf. */
+    if (pIoPkt->buf && PyMemoryView_Check(pIoPkt->buf)) {
+      pView = pIoPkt->buf;
+      Py_INCREF(pView);
+    }
+
     pRetVal = PyObject_CallFunctionObjArgs(pFunc, (PyObject*)pIoPkt, NULL);
     if (!pRetVal) {
       Py_DECREF((PyObject*)pIoPkt);
+      ReleaseIoBufferView(pView);
       goto bail_out;
     } else {
       retval = ConvertPythonRetvalTobRCRetval(pRetVal);
@@ -621,10 +770,17 @@ static bRC PyPluginIO(PluginContext* plugin_ctx, io_pkt* io)
 
       if (!PyIoPacketToNative(pIoPkt, io)) {
         Py_DECREF((PyObject*)pIoPkt);
+        ReleaseIoBufferView(pView);
         goto bail_out;
       }
     }
     Py_DECREF((PyObject*)pIoPkt);
+
+    if (!ReleaseIoBufferView(pView)) {
+      Jmsg(plugin_ctx, M_FATAL,
+           LOGPREFIX "plugin_io() kept a reference to the I/O buffer\n");
+      goto bail_out;
+    }
   } else {
     Dmsg(plugin_ctx, debuglevel,
          LOGPREFIX "Failed to find function named plugin_io()\n");
@@ -715,10 +871,15 @@ bail_out:
   return retval;
 }
 
-static inline PyRestorePacket* NativeToPyRestorePacket(restore_pkt* rp)
+static inline PyRestorePacket* NativeToPyRestorePacket(
+    PluginContext* plugin_ctx,
+    restore_pkt* rp)
 {
+  bareosfd_state* state = GetModuleState(plugin_ctx);
+  if (!state) { return NULL; }
+
   PyRestorePacket* pRestorePacket
-      = PyObject_New(PyRestorePacket, &PyRestorePacketType);
+      = PyObject_New(PyRestorePacket, state->RestorePacketType);
 
   if (pRestorePacket) {
     pRestorePacket->stream = rp->stream;
@@ -727,7 +888,8 @@ static inline PyRestorePacket* NativeToPyRestorePacket(restore_pkt* rp)
     pRestorePacket->file_index = rp->file_index;
     pRestorePacket->LinkFI = rp->LinkFI;
     pRestorePacket->uid = rp->uid;
-    pRestorePacket->statp = (PyObject*)NativeToPyStatPacket(&rp->statp);
+    pRestorePacket->statp
+        = (PyObject*)NativeToPyStatPacket(plugin_ctx, &rp->statp);
     pRestorePacket->attrEx = rp->attrEx;
     pRestorePacket->ofname = rp->ofname;
     pRestorePacket->olname = rp->olname;
@@ -778,7 +940,7 @@ static bRC PyCreateFile(PluginContext* plugin_ctx, restore_pkt* rp)
     PyRestorePacket* pRestorePacket;
     PyObject* pRetVal;
 
-    pRestorePacket = NativeToPyRestorePacket(rp);
+    pRestorePacket = NativeToPyRestorePacket(plugin_ctx, rp);
     if (!pRestorePacket) { goto bail_out; }
 
     pRetVal = PyObject_CallFunctionObjArgs(pFunc, pRestorePacket, NULL);
@@ -821,7 +983,7 @@ static bRC PySetFileAttributes(PluginContext* plugin_ctx, restore_pkt* rp)
     PyRestorePacket* pRestorePacket;
     PyObject* pRetVal;
 
-    pRestorePacket = NativeToPyRestorePacket(rp);
+    pRestorePacket = NativeToPyRestorePacket(plugin_ctx, rp);
     if (!pRestorePacket) { goto bail_out; }
 
     pRetVal = PyObject_CallFunctionObjArgs(pFunc, pRestorePacket, NULL);
@@ -884,9 +1046,13 @@ bail_out:
   return retval;
 }
 
-static inline PyAclPacket* NativeToPyAclPacket(acl_pkt* ap)
+static inline PyAclPacket* NativeToPyAclPacket(PluginContext* plugin_ctx,
+                                               acl_pkt* ap)
 {
-  PyAclPacket* pAclPacket = PyObject_New(PyAclPacket, &PyAclPacketType);
+  bareosfd_state* state = GetModuleState(plugin_ctx);
+  if (!state) { return NULL; }
+
+  PyAclPacket* pAclPacket = PyObject_New(PyAclPacket, state->AclPacketType);
 
   if (pAclPacket) {
     pAclPacket->fname = ap->fname;
@@ -943,7 +1109,7 @@ static bRC PyGetAcl(PluginContext* plugin_ctx, acl_pkt* ap)
     PyAclPacket* pAclPkt;
     PyObject* pRetVal;
 
-    pAclPkt = NativeToPyAclPacket(ap);
+    pAclPkt = NativeToPyAclPacket(plugin_ctx, ap);
     if (!pAclPkt) { goto bail_out; }
 
     pRetVal = PyObject_CallFunctionObjArgs(pFunc, pAclPkt, NULL);
@@ -989,7 +1155,7 @@ static bRC PySetAcl(PluginContext* plugin_ctx, acl_pkt* ap)
     PyAclPacket* pAclPkt;
     PyObject* pRetVal;
 
-    pAclPkt = NativeToPyAclPacket(ap);
+    pAclPkt = NativeToPyAclPacket(plugin_ctx, ap);
     if (!pAclPkt) { goto bail_out; }
 
     pRetVal = PyObject_CallFunctionObjArgs(pFunc, pAclPkt, NULL);
@@ -1014,9 +1180,14 @@ bail_out:
   return retval;
 }
 
-static inline PyXattrPacket* NativeToPyXattrPacket(xattr_pkt* xp)
+static inline PyXattrPacket* NativeToPyXattrPacket(PluginContext* plugin_ctx,
+                                                   xattr_pkt* xp)
 {
-  PyXattrPacket* pXattrPacket = PyObject_New(PyXattrPacket, &PyXattrPacketType);
+  bareosfd_state* state = GetModuleState(plugin_ctx);
+  if (!state) { return NULL; }
+
+  PyXattrPacket* pXattrPacket
+      = PyObject_New(PyXattrPacket, state->XattrPacketType);
 
   if (pXattrPacket) {
     pXattrPacket->fname = xp->fname;
@@ -1093,7 +1264,7 @@ static bRC PyGetXattr(PluginContext* plugin_ctx, xattr_pkt* xp)
     PyXattrPacket* pXattrPkt;
     PyObject* pRetVal;
 
-    pXattrPkt = NativeToPyXattrPacket(xp);
+    pXattrPkt = NativeToPyXattrPacket(plugin_ctx, xp);
     if (!pXattrPkt) { goto bail_out; }
 
     pRetVal = PyObject_CallFunctionObjArgs(pFunc, pXattrPkt, NULL);
@@ -1139,7 +1310,7 @@ static bRC PySetXattr(PluginContext* plugin_ctx, xattr_pkt* xp)
     PyXattrPacket* pXattrPkt;
     PyObject* pRetVal;
 
-    pXattrPkt = NativeToPyXattrPacket(xp);
+    pXattrPkt = NativeToPyXattrPacket(plugin_ctx, xp);
     if (!pXattrPkt) { goto bail_out; }
 
     pRetVal = PyObject_CallFunctionObjArgs(pFunc, pXattrPkt, NULL);
@@ -1163,10 +1334,15 @@ bail_out:
   return retval;
 }
 
-static inline PyRestoreObject* NativeToPyRestoreObject(restore_object_pkt* rop)
+static inline PyRestoreObject* NativeToPyRestoreObject(
+    PluginContext* plugin_ctx,
+    restore_object_pkt* rop)
 {
+  bareosfd_state* state = GetModuleState(plugin_ctx);
+  if (!state) { return NULL; }
+
   PyRestoreObject* pRestoreObject
-      = PyObject_New(PyRestoreObject, &PyRestoreObjectType);
+      = PyObject_New(PyRestoreObject, state->RestoreObjectType);
 
   if (pRestoreObject) {
     pRestoreObject->object_name = PyUnicode_FromString(rop->object_name);
@@ -1202,7 +1378,7 @@ static bRC PyRestoreObjectData(PluginContext* plugin_ctx,
     PyRestoreObject* pRestoreObject;
     PyObject* pRetVal;
 
-    pRestoreObject = NativeToPyRestoreObject(rop);
+    pRestoreObject = NativeToPyRestoreObject(plugin_ctx, rop);
     if (!pRestoreObject) { goto bail_out; }
 
     pRetVal = PyObject_CallFunctionObjArgs(pFunc, pRestoreObject, NULL);
@@ -1243,7 +1419,7 @@ static bRC PyHandleBackupFile(PluginContext* plugin_ctx, save_pkt* sp)
     PySavePacket* pSavePkt;
     PyObject* pRetVal;
 
-    pSavePkt = NativeToPySavePacket(sp);
+    pSavePkt = NativeToPySavePacket(plugin_ctx, sp);
     if (!pSavePkt) { goto bail_out; }
 
     pRetVal = PyObject_CallFunctionObjArgs(pFunc, pSavePkt, NULL);
@@ -1844,6 +2020,73 @@ bail_out:
   return ConvertbRCRetvalToPythonRetval(retval);
 }
 
+/**
+ * Callback function which is exposed as a part of the additional methods
+ * which allow a Python plugin to have plugin_io() read into and write from
+ * memoryviews on the buffer of the core instead of bytearray copies.
+ */
+static PyObject* PyBareosSetZeroCopyIo(PyObject*, PyObject* args)
+{
+  PluginContext* plugin_ctx = plugin_context;
+  PyObject* pyBool;
+
+  if (!PyArg_ParseTuple(args, "O:BareosSetZeroCopyIo", &pyBool)) {
+    return NULL;
+  }
+  RETURN_RUNTIME_ERROR_IF_BFUNC_OR_BAREOS_PLUGIN_CTX_UNSET()
+
+  struct plugin_private_context* plugin_priv_ctx
+      = (struct plugin_private_context*)plugin_ctx->plugin_private_context;
+  if (!plugin_priv_ctx) { return ConvertbRCRetvalToPythonRetval(bRC_Error); }
+
+#if PY_VERSION_HEX < VERSION_HEX(3, 9, 0)
+  if (PyObject_IsTrue(pyBool)) {
+    Dmsg(plugin_ctx, debuglevel,
+         LOGPREFIX "zero copy io needs at least Python 3.9\n");
+    return ConvertbRCRetvalToPythonRetval(bRC_Error);
+  }
+#endif
+
+  plugin_priv_ctx->zero_copy_io = PyObject_IsTrue(pyBool);
+  Dmsg(plugin_ctx, debuglevel, LOGPREFIX "zero copy io %s\n",
+       plugin_priv_ctx->zero_copy_io ? "enabled" : "disabled");
+
+  return ConvertbRCRetvalToPythonRetval(bRC_OK);
+}
+
+/**
+ * Callback function which is exposed as a part of the additional methods
+ * which allow a Python plugin to request that reads are done in batches of
+ * the given size. The core then serves its (smaller) reads from the batch
+ * without calling into Python. A size of 0 disables batching.
+ */
+static PyObject* PyBareosSetIoBatchSize(PyObject*, PyObject* args)
+{
+  PluginContext* plugin_ctx = plugin_context;
+  int batch_size;
+
+  if (!PyArg_ParseTuple(args, "i:BareosSetIoBatchSize", &batch_size)) {
+    return NULL;
+  }
+  RETURN_RUNTIME_ERROR_IF_BFUNC_OR_BAREOS_PLUGIN_CTX_UNSET()
+
+  if (batch_size < 0 || batch_size > kMaxIoBatchSize) {
+    PyErr_Format(PyExc_ValueError, "batch size must be between 0 and %d",
+                 kMaxIoBatchSize);
+    return NULL;
+  }
+
+  struct plugin_private_context* plugin_priv_ctx
+      = (struct plugin_private_context*)plugin_ctx->plugin_private_context;
+  if (!plugin_priv_ctx) { return ConvertbRCRetvalToPythonRetval(bRC_Error); }
+
+  plugin_priv_ctx->io_batch_size = batch_size;
+  Dmsg(plugin_ctx, debuglevel, LOGPREFIX "io batch size set to %d\n",
+       batch_size);
+
+  return ConvertbRCRetvalToPythonRetval(bRC_OK);
+}
+
 // Some helper functions.
 static inline char* PyGetStringValue(PyObject* object)
 {
@@ -1924,7 +2167,7 @@ static void PyRestoreObject_dealloc(PyRestoreObject* self)
 {
   if (self->object_name) { Py_XDECREF(self->object_name); }
   if (self->object) { Py_XDECREF(self->object); }
-  PyObject_Del(self);
+  FreeHeapTypeObject((PyObject*)self);
 }
 
 // Python specific handlers for PyStatPacket structure mapping.
@@ -1987,7 +2230,10 @@ static int PyStatPacket_init(PyStatPacket* self, PyObject* args, PyObject* kwds)
 }
 
 // Destructor.
-static void PyStatPacket_dealloc(PyStatPacket* self) { PyObject_Del(self); }
+static void PyStatPacket_dealloc(PyStatPacket* self)
+{
+  FreeHeapTypeObject((PyObject*)self);
+}
 
 // Python specific handlers for PySavePacket structure mapping.
 
@@ -2084,7 +2330,7 @@ static void PySavePacket_dealloc(PySavePacket* self)
   if (self->object_name) { Py_XDECREF(self->object_name); }
   if (self->object) { Py_XDECREF(self->object); }
   if (self->statp) { Py_XDECREF(self->statp); }
-  PyObject_Del(self);
+  FreeHeapTypeObject((PyObject*)self);
 }
 
 // Python specific handlers for PyRestorePacket structure mapping.
@@ -2154,7 +2400,7 @@ static int PyRestorePacket_init(PyRestorePacket* self,
 // Destructor.
 static void PyRestorePacket_dealloc(PyRestorePacket* self)
 {
-  PyObject_Del(self);
+  FreeHeapTypeObject((PyObject*)self);
 }
 
 // Python specific handlers for PyIoPacket structure mapping.
@@ -2218,9 +2464,40 @@ static int PyIoPacket_init(PyIoPacket* self, PyObject* args, PyObject* kwds)
 static void PyIoPacket_dealloc(PyIoPacket* self)
 {
   if (self->buf) { Py_XDECREF(self->buf); }
-  PyObject_Del(self);
+  FreeHeapTypeObject((PyObject*)self);
+}
+
+#if PY_VERSION_HEX >= VERSION_HEX(3, 9, 0)
+// Python specific handlers for PyIoBuffer structure mapping.
+
+static int PyIoBuffer_getbuffer(PyIoBuffer* self, Py_buffer* view, int flags)
+{
+  if (!self->buf) {
+    PyErr_SetString(PyExc_BufferError, "I/O buffer is no longer valid");
+    view->obj = NULL;
+    return -1;
+  }
+
+  if (PyBuffer_FillInfo(view, (PyObject*)self, self->buf, self->len,
+                        self->readonly, flags)) {
+    return -1;
+  }
+  self->exports++;
+
+  return 0;
 }
 
+static void PyIoBuffer_releasebuffer(PyIoBuffer* self, Py_buffer*)
+{
+  self->exports--;
+}
+
+static void PyIoBuffer_dealloc(PyIoBuffer* self)
+{
+  FreeHeapTypeObject((PyObject*)self);
+}
+#endif
+
 // Python specific handlers for PyAclPacket structure mapping.
 
 // Representation.
@@ -2256,7 +2533,7 @@ static int PyAclPacket_init(PyAclPacket* self, PyObject* args, PyObject* kwds)
 static void PyAclPacket_dealloc(PyAclPacket* self)
 {
   if (self->content) { Py_XDECREF(self->content); }
-  PyObject_Del(self);
+  FreeHeapTypeObject((PyObject*)self);
 }
 
 // Python specific handlers for PyIOPacket structure mapping.
@@ -2298,7 +2575,7 @@ static void PyXattrPacket_dealloc(PyXattrPacket* self)
 {
   if (self->value) { Py_XDECREF(self->value); }
   if (self->name) { Py_XDECREF(self->name); }
-  PyObject_Del(self);
+  FreeHeapTypeObject((PyObject*)self);
 }
 
 } /* namespace filedaemon */
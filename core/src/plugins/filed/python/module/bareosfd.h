@@ -102,23 +102,19 @@ static PyMemberDef PyRestoreObject_members[]
         (char*)"Jobid"},
        {} /* Sentinel */};
 
-#  pragma GCC diagnostic push
-#  pragma GCC diagnostic ignored "-Wmissing-field-initializers"
-/* clang-format off */
-static PyTypeObject PyRestoreObjectType = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name      = "restore_object",
-    .tp_basicsize = sizeof(PyRestoreObject),
-    .tp_dealloc   = (destructor)PyRestoreObject_dealloc,
-    .tp_repr      = (reprfunc)PyRestoreObject_repr,
-    .tp_flags     = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
-    .tp_doc       = "io_pkt object",
-    .tp_methods   = PyRestoreObject_methods,
-    .tp_members   = PyRestoreObject_members,
-    .tp_init      = (initproc)PyRestoreObject_init,
-};
-/* clang-format on */
-#  pragma GCC diagnostic pop
+static PyType_Slot PyRestoreObject_slots[] = {
+    {Py_tp_dealloc, (void*)PyRestoreObject_dealloc},
+    {Py_tp_repr, (void*)PyRestoreObject_repr},
+    {Py_tp_doc, (void*)"io_pkt object"},
+    {Py_tp_methods, PyRestoreObject_methods},
+    {Py_tp_members, PyRestoreObject_members},
+    {Py_tp_init, (void*)PyRestoreObject_init},
+    {Py_tp_new, (void*)PyType_GenericNew},
+    {0, NULL}};
+
+static PyType_Spec PyRestoreObjectType_spec
+    = {"restore_object", sizeof(PyRestoreObject), 0,
+       Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, PyRestoreObject_slots};
 
 // The PyStatPacket type
 typedef struct {
@@ -174,23 +170,19 @@ static PyMemberDef PyStatPacket_members[] = {
      (char*)"Blocks"},
     {} /* Sentinel */};
 
-#  pragma GCC diagnostic push
-#  pragma GCC diagnostic ignored "-Wmissing-field-initializers"
-/* clang-format off */
-static PyTypeObject PyStatPacketType = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name      = "stat_pkt",
-    .tp_basicsize = sizeof(PyStatPacket),
-    .tp_dealloc   = (destructor)PyStatPacket_dealloc,
-    .tp_repr      = (reprfunc)PyStatPacket_repr,
-    .tp_flags     = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
-    .tp_doc       = "io_pkt object",
-    .tp_methods   = PyStatPacket_methods,
-    .tp_members   = PyStatPacket_members,
-    .tp_init      = (initproc)PyStatPacket_init,
-};
-/* clang-format on */
-#  pragma GCC diagnostic pop
+static PyType_Slot PyStatPacket_slots[] = {
+    {Py_tp_dealloc, (void*)PyStatPacket_dealloc},
+    {Py_tp_repr, (void*)PyStatPacket_repr},
+    {Py_tp_doc, (void*)"io_pkt object"},
+    {Py_tp_methods, PyStatPacket_methods},
+    {Py_tp_members, PyStatPacket_members},
+    {Py_tp_init, (void*)PyStatPacket_init},
+    {Py_tp_new, (void*)PyType_GenericNew},
+    {0, NULL}};
+
+static PyType_Spec PyStatPacketType_spec
+    = {"stat_pkt", sizeof(PyStatPacket), 0,
+       Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, PyStatPacket_slots};
 
 // The PySavePacket type
 typedef struct {
@@ -253,23 +245,19 @@ static PyMemberDef PySavePacket_members[] = {
      (char*)"Restore ObjectIndex"},
     {} /* Sentinel */};
 
-#  pragma GCC diagnostic push
-#  pragma GCC diagnostic ignored "-Wmissing-field-initializers"
-/* clang-format off */
-static PyTypeObject PySavePacketType = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name      = "save_pkt",
-    .tp_basicsize = sizeof(PySavePacket),
-    .tp_dealloc   = (destructor)PySavePacket_dealloc,
-    .tp_repr      = (reprfunc)PySavePacket_repr,
-    .tp_flags     = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
-    .tp_doc       = "save_pkt object",
-    .tp_methods   = PySavePacket_methods,
-    .tp_members   = PySavePacket_members,
-    .tp_init      = (initproc)PySavePacket_init,
-};
-/* clang-format on */
-#  pragma GCC diagnostic pop
+static PyType_Slot PySavePacket_slots[] = {
+    {Py_tp_dealloc, (void*)PySavePacket_dealloc},
+    {Py_tp_repr, (void*)PySavePacket_repr},
+    {Py_tp_doc, (void*)"save_pkt object"},
+    {Py_tp_methods, PySavePacket_methods},
+    {Py_tp_members, PySavePacket_members},
+    {Py_tp_init, (void*)PySavePacket_init},
+    {Py_tp_new, (void*)PyType_GenericNew},
+    {0, NULL}};
+
+static PyType_Spec PySavePacketType_spec
+    = {"save_pkt", sizeof(PySavePacket), 0,
+       Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, PySavePacket_slots};
 
 // The PyRestorePacket type
 typedef struct {
@@ -333,23 +321,19 @@ static PyMemberDef PyRestorePacket_members[] = {
      (char*)"file descriptor of current file"},
     {NULL, 0, 0, 0, NULL}};
 
-#  pragma GCC diagnostic push
-#  pragma GCC diagnostic ignored "-Wmissing-field-initializers"
-/* clang-format off */
-static PyTypeObject PyRestorePacketType = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name      = "restore_pkt",
-    .tp_basicsize = sizeof(PyRestorePacket),
-    .tp_dealloc   = (destructor)PyRestorePacket_dealloc,
-    .tp_repr      = (reprfunc)PyRestorePacket_repr,
-    .tp_flags     = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
-    .tp_doc       = "restore_pkt object",
-    .tp_methods   = PyRestorePacket_methods,
-    .tp_members   = PyRestorePacket_members,
-    .tp_init      = (initproc)PyRestorePacket_init,
-};
-/* clang-format on */
-#  pragma GCC diagnostic pop
+static PyType_Slot PyRestorePacket_slots[] = {
+    {Py_tp_dealloc, (void*)PyRestorePacket_dealloc},
+    {Py_tp_repr, (void*)PyRestorePacket_repr},
+    {Py_tp_doc, (void*)"restore_pkt object"},
+    {Py_tp_methods, PyRestorePacket_methods},
+    {Py_tp_members, PyRestorePacket_members},
+    {Py_tp_init, (void*)PyRestorePacket_init},
+    {Py_tp_new, (void*)PyType_GenericNew},
+    {0, NULL}};
+
+static PyType_Spec PyRestorePacketType_spec
+    = {"restore_pkt", sizeof(PyRestorePacket), 0,
+       Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, PyRestorePacket_slots};
 
 // The PyIOPacket type
 typedef struct {
@@ -406,23 +390,48 @@ static PyMemberDef PyIoPacket_members[]
         (char*)"file descriptor of current file"},
        {NULL, 0, 0, 0, NULL}};
 
-#  pragma GCC diagnostic push
-#  pragma GCC diagnostic ignored "-Wmissing-field-initializers"
-/* clang-format off */
-static PyTypeObject PyIoPacketType = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name      = "io_pkt",
-    .tp_basicsize = sizeof(PyIoPacket),
-    .tp_dealloc   = (destructor)PyIoPacket_dealloc,
-    .tp_repr      = (reprfunc)PyIoPacket_repr,
-    .tp_flags     = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
-    .tp_doc       = "io_pkt object",
-    .tp_methods   = PyIoPacket_methods,
-    .tp_members   = PyIoPacket_members,
-    .tp_init      = (initproc)PyIoPacket_init,
-};
-/* clang-format on */
-#  pragma GCC diagnostic pop
+static PyType_Slot PyIoPacket_slots[] = {
+    {Py_tp_dealloc, (void*)PyIoPacket_dealloc},
+    {Py_tp_repr, (void*)PyIoPacket_repr},
+    {Py_tp_doc, (void*)"io_pkt object"},
+    {Py_tp_methods, PyIoPacket_methods},
+    {Py_tp_members, PyIoPacket_members},
+    {Py_tp_init, (void*)PyIoPacket_init},
+    {Py_tp_new, (void*)PyType_GenericNew},
+    {0, NULL}};
+
+static PyType_Spec PyIoPacketType_spec
+    = {"io_pkt", sizeof(PyIoPacket), 0,
+       Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, PyIoPacket_slots};
+
+/* The PyIoBuffer type exports the I/O buffer of the core for zero copy I/O.
+ * Slices and other views taken from the memoryview passed to plugin_io()
+ * share its buffer and stay usable after the memoryview is released, so we
+ * count the exports to find out whether the plugin kept any of them. */
+typedef struct {
+  PyObject_HEAD char* buf; /* Buffer of the core, NULL once invalidated */
+  Py_ssize_t len;          /* Size of the buffer */
+  int readonly;            /* Set for IO_WRITE */
+  Py_ssize_t exports;      /* Number of exported buffers not yet released */
+} PyIoBuffer;
+
+#if PY_VERSION_HEX >= VERSION_HEX(3, 9, 0)
+// Forward declarations of type specific functions.
+static void PyIoBuffer_dealloc(PyIoBuffer* self);
+static int PyIoBuffer_getbuffer(PyIoBuffer* self, Py_buffer* view, int flags);
+static void PyIoBuffer_releasebuffer(PyIoBuffer* self, Py_buffer* view);
+
+static PyType_Slot PyIoBuffer_slots[] = {
+    {Py_tp_dealloc, (void*)PyIoBuffer_dealloc},
+    {Py_tp_doc, (void*)"I/O buffer of the core"},
+    {Py_bf_getbuffer, (void*)PyIoBuffer_getbuffer},
+    {Py_bf_releasebuffer, (void*)PyIoBuffer_releasebuffer},
+    {0, NULL}};
+
+static PyType_Spec PyIoBufferType_spec
+    = {"io_buffer", sizeof(PyIoBuffer), 0, Py_TPFLAGS_DEFAULT,
+       PyIoBuffer_slots};
+#endif
 
 // The PyAclPacket type
 typedef struct {
@@ -446,23 +455,19 @@ static PyMemberDef PyAclPacket_members[]
         (char*)"ACL content buffer"},
        {} /* Sentinel */};
 
-#  pragma GCC diagnostic push
-#  pragma GCC diagnostic ignored "-Wmissing-field-initializers"
-/* clang-format off */
-static PyTypeObject PyAclPacketType = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name      = "acl_pkt",
-    .tp_basicsize = sizeof(PyAclPacket),
-    .tp_dealloc   = (destructor)PyAclPacket_dealloc,
-    .tp_repr      = (reprfunc)PyAclPacket_repr,
-    .tp_flags     = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
-    .tp_doc       = "acl_pkt object",
-    .tp_methods   = PyAclPacket_methods,
-    .tp_members   = PyAclPacket_members,
-    .tp_init      = (initproc)PyAclPacket_init,
-};
-/* clang-format on */
-#  pragma GCC diagnostic pop
+static PyType_Slot PyAclPacket_slots[] = {
+    {Py_tp_dealloc, (void*)PyAclPacket_dealloc},
+    {Py_tp_repr, (void*)PyAclPacket_repr},
+    {Py_tp_doc, (void*)"acl_pkt object"},
+    {Py_tp_methods, PyAclPacket_methods},
+    {Py_tp_members, PyAclPacket_members},
+    {Py_tp_init, (void*)PyAclPacket_init},
+    {Py_tp_new, (void*)PyType_GenericNew},
+    {0, NULL}};
+
+static PyType_Spec PyAclPacketType_spec
+    = {"acl_pkt", sizeof(PyAclPacket), 0,
+       Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, PyAclPacket_slots};
 
 // The PyXattrPacket type
 typedef struct {
@@ -491,23 +496,36 @@ static PyMemberDef PyXattrPacket_members[]
         (char*)"XATTR value buffer"},
        {} /* Sentinel */};
 
-#  pragma GCC diagnostic push
-#  pragma GCC diagnostic ignored "-Wmissing-field-initializers"
-/* clang-format off */
-static PyTypeObject PyXattrPacketType = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name      = "xattr_pkt",
-    .tp_basicsize = sizeof(PyXattrPacket),
-    .tp_dealloc   = (destructor)PyXattrPacket_dealloc,
-    .tp_repr      = (reprfunc)PyXattrPacket_repr,
-    .tp_flags     = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
-    .tp_doc       = "xattr_pkt object",
-    .tp_methods   = PyXattrPacket_methods,
-    .tp_members   = PyXattrPacket_members,
-    .tp_init      = (initproc)PyXattrPacket_init,
-};
-/* clang-format off */
-#  pragma GCC diagnostic pop
+static PyType_Slot PyXattrPacket_slots[] = {
+    {Py_tp_dealloc, (void*)PyXattrPacket_dealloc},
+    {Py_tp_repr, (void*)PyXattrPacket_repr},
+    {Py_tp_doc, (void*)"xattr_pkt object"},
+    {Py_tp_methods, PyXattrPacket_methods},
+    {Py_tp_members, PyXattrPacket_members},
+    {Py_tp_init, (void*)PyXattrPacket_init},
+    {Py_tp_new, (void*)PyType_GenericNew},
+    {0, NULL}};
+
+static PyType_Spec PyXattrPacketType_spec
+    = {"xattr_pkt", sizeof(PyXattrPacket), 0,
+       Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, PyXattrPacket_slots};
+
+/* The types above are created per interpreter as heap types and live in the
+ * module state, so no Python object is shared between interpreters. */
+typedef struct {
+  PyTypeObject* RestoreObjectType;
+  PyTypeObject* StatPacketType;
+  PyTypeObject* SavePacketType;
+  PyTypeObject* RestorePacketType;
+  PyTypeObject* IoPacketType;
+  PyTypeObject* AclPacketType;
+  PyTypeObject* XattrPacketType;
+  PyTypeObject* IoBufferType; /* Not exported, NULL before Python 3.9 */
+} bareosfd_state;
+
+static int bareosfd_traverse(PyObject* m, visitproc visit, void* arg);
+static int bareosfd_clear(PyObject* m);
+static void bareosfd_free(void* m);
 
 // Callback methods from Python.
 static PyObject* PyBareosGetValue(PyObject* self, PyObject* args);
@@ -529,6 +547,8 @@ static PyObject* PyBareosCheckChanges(PyObject* self, PyObject* args);
 static PyObject* PyBareosAcceptFile(PyObject* self, PyObject* args);
 static PyObject* PyBareosSetSeenBitmap(PyObject* self, PyObject* args);
 static PyObject* PyBareosClearSeenBitmap(PyObject* self, PyObject* args);
+static PyObject* PyBareosSetZeroCopyIo(PyObject* self, PyObject* args);
+static PyObject* PyBareosSetIoBatchSize(PyObject* self, PyObject* args);
 
 static PyMethodDef Methods[] = {
     {"GetValue", PyBareosGetValue, METH_VARARGS, "Get a Plugin value"},
@@ -559,6 +579,10 @@ static PyMethodDef Methods[] = {
      "Set bit in the Accurate Seen bitmap"},
     {"ClearSeenBitmap", PyBareosClearSeenBitmap, METH_VARARGS,
      "Clear bit in the Accurate Seen bitmap"},
+    {"SetZeroCopyIo", PyBareosSetZeroCopyIo, METH_VARARGS,
+     "Pass memoryviews on the core I/O buffer to plugin_io()"},
+    {"SetIoBatchSize", PyBareosSetIoBatchSize, METH_VARARGS,
+     "Read this many bytes per plugin_io() call"},
     {NULL, NULL, 0, NULL}};
 
 
@@ -598,10 +622,12 @@ using namespace filedaemon;
 /* variables storing bareos pointers */
 thread_local PluginContext* plugin_context = NULL;
 
-MOD_INIT(bareosfd)
+MOD_INIT_WITH_STATE(bareosfd,
+                    sizeof(bareosfd_state),
+                    bareosfd_traverse,
+                    bareosfd_clear,
+                    bareosfd_free)
 {
-  PyObject* m = NULL;
-  MOD_DEF(m, PYTHON_MODULE_NAME_QUOTED, NULL, Methods)
   static void* Bareosfd_API[Bareosfd_API_pointers];
   PyObject* c_api_object;
 
@@ -618,48 +644,30 @@ MOD_INIT(bareosfd)
     return MOD_ERROR_VAL;
   }
 
-  PyRestoreObjectType.tp_new = PyType_GenericNew;
-  if (PyType_Ready(&PyRestoreObjectType) < 0) { return MOD_ERROR_VAL; }
-
-  PyStatPacketType.tp_new = PyType_GenericNew;
-  if (PyType_Ready(&PyStatPacketType) < 0) { return MOD_ERROR_VAL; }
-
-  PySavePacketType.tp_new = PyType_GenericNew;
-  if (PyType_Ready(&PySavePacketType) < 0) { return MOD_ERROR_VAL; }
-
-  PyRestorePacketType.tp_new = PyType_GenericNew;
-  if (PyType_Ready(&PyRestorePacketType) < 0) { return MOD_ERROR_VAL; }
-
-  PyIoPacketType.tp_new = PyType_GenericNew;
-  if (PyType_Ready(&PyIoPacketType) < 0) { return MOD_ERROR_VAL; }
-
-  PyAclPacketType.tp_new = PyType_GenericNew;
-  if (PyType_Ready(&PyAclPacketType) < 0) { return MOD_ERROR_VAL; }
-
-  PyXattrPacketType.tp_new = PyType_GenericNew;
-  if (PyType_Ready(&PyXattrPacketType) < 0) { return MOD_ERROR_VAL; }
-
-  Py_INCREF(&PyRestoreObjectType);
-  PyModule_AddObject(m, "RestoreObject", (PyObject*)&PyRestoreObjectType);
-
-  Py_INCREF(&PyStatPacketType);
-  PyModule_AddObject(m, "StatPacket", (PyObject*)&PyStatPacketType);
-
-  Py_INCREF(&PySavePacketType);
-  PyModule_AddObject(m, "SavePacket", (PyObject*)&PySavePacketType);
-
-  Py_INCREF(&PyRestorePacketType);
-  PyModule_AddObject(m, "RestorePacket", (PyObject*)&PyRestorePacketType);
-
-  Py_INCREF(&PyIoPacketType);
-  PyModule_AddObject(m, "IoPacket", (PyObject*)&PyIoPacketType);
-
-  Py_INCREF(&PyAclPacketType);
-  PyModule_AddObject(m, "AclPacket", (PyObject*)&PyAclPacketType);
-
-  Py_INCREF(&PyXattrPacketType);
-  PyModule_AddObject(m, "XattrPacket", (PyObject*)&PyXattrPacketType);
-
+  bareosfd_state* state = (bareosfd_state*)PyModule_GetState(m);
+
+#  define ADD_HEAP_TYPE(member, spec, name)                                  \
+    state->member = (PyTypeObject*)PyType_FromSpec(&spec);                    \
+    if (!state->member) { return MOD_ERROR_VAL; }                             \
+    Py_INCREF(state->member);                                                 \
+    if (PyModule_AddObject(m, name, (PyObject*)state->member)) {              \
+      Py_DECREF(state->member);                                               \
+      return MOD_ERROR_VAL;                                                   \
+    }
+
+  ADD_HEAP_TYPE(RestoreObjectType, PyRestoreObjectType_spec, "RestoreObject");
+  ADD_HEAP_TYPE(StatPacketType, PyStatPacketType_spec, "StatPacket");
+  ADD_HEAP_TYPE(SavePacketType, PySavePacketType_spec, "SavePacket");
+  ADD_HEAP_TYPE(RestorePacketType, PyRestorePacketType_spec, "RestorePacket");
+  ADD_HEAP_TYPE(IoPacketType, PyIoPacketType_spec, "IoPacket");
+  ADD_HEAP_TYPE(AclPacketType, PyAclPacketType_spec, "AclPacket");
+  ADD_HEAP_TYPE(XattrPacketType, PyXattrPacketType_spec, "XattrPacket");
+#  undef ADD_HEAP_TYPE
+
+#  if PY_VERSION_HEX >= VERSION_HEX(3, 9, 0)
+  state->IoBufferType = (PyTypeObject*)PyType_FromSpec(&PyIoBufferType_spec);
+  if (!state->IoBufferType) { return MOD_ERROR_VAL; }
+#  endif
 
   /* module dictionaries */
   DEFINE_bRCs_DICT();
@@ -39,6 +39,12 @@ struct plugin_private_context {
       interp;         // Python interpreter for this instance of the plugin
   PyObject* pModule;  // Python Module entry point
   PyObject* pyModuleFunctionsDict;  // Python Dictionary
+  PyObject* bareosfd_module;  // bareosfd module of this interpreter
+  bool zero_copy_io;      // Pass memoryviews on the core buffer to plugin_io
+  int32_t io_batch_size;  // Read this many bytes per plugin_io() call
+  POOLMEM* io_batch_buf;  // Data of the last batched read
+  int32_t io_batch_len;   // Number of valid bytes in io_batch_buf
+  int32_t io_batch_pos;   // Number of bytes already passed to the core
 };
 
 
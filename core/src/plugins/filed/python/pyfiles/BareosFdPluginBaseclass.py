@@ -339,7 +339,9 @@ class BareosFdPluginBaseclass(object):
             bareosfd.DebugMessage(
                 200, "Reading %d from file %s\n" % (IOP.count, self.FNAME)
             )
-            IOP.buf = bytearray(IOP.count)
+            # With zero copy I/O IOP.buf already is a view on the core buffer
+            if not isinstance(IOP.buf, memoryview):
+                IOP.buf = bytearray(IOP.count)
             try:
                 IOP.status = self.file.readinto(IOP.buf)
                 IOP.io_errno = 0
@@ -86,17 +86,6 @@ PluginApiDefinition* bareos_plugin_interface_version = NULL;
 
 namespace {
 
-unsigned long PyVersion()
-{
-#if PY_VERSION_HEX < VERSION_HEX(3, 11, 0)
-  // bake it in statically
-  return PY_VERSION_HEX;
-#else
-  // determine it at runtime
-  return Py_Version;
-#endif
-}
-
 /* List of interpreters accessed by this thread.
  * We use a vector instead of a set here since we expect that each thread
  * only accesses very few interpreters (<= 1) at the same time.
@@ -110,6 +99,9 @@ thread_local std::vector<PyThreadState*> tl_threadstates{};
  */
 PyThreadState* mainThreadState{nullptr};
 
+/* Run each plugin instance in a sub-interpreter with its own GIL. */
+bool python_plugin_own_gil{false};
+
 /* Return this threads thread state for interp if it exists.  Returns
  * nullptr otherwise */
 PyThreadState* GetThreadStateForInterp(PyInterpreterState* interp)
@@ -225,12 +217,10 @@ bRC newPlugin(PluginContext* plugin_ctx)
   Bareosfd_set_plugin_context(plugin_ctx);
 
   /* For each plugin instance we instantiate a new Python interpreter. */
-  PyEval_AcquireThread(mainThreadState);
-  auto* ts = Py_NewInterpreter();
+  auto* ts = NewPluginInterpreter(mainThreadState, python_plugin_own_gil);
   plugin_priv_ctx->interp = ts->interp;
   // register ts
   tl_threadstates.push_back(ts);
-  PyEval_ReleaseThread(ts);
 
   /* Always register some events the python plugin itself can register
      any other events it is interested in. */
@@ -269,20 +259,18 @@ bRC freePlugin(PluginContext* plugin_ctx)
 
   if (plugin_priv_ctx->object) { free(plugin_priv_ctx->object); }
 
+  if (plugin_priv_ctx->io_batch_buf) {
+    FreePoolMemory(plugin_priv_ctx->io_batch_buf);
+  }
+
   // Stop any sub interpreter started per plugin instance.
   auto* ts = PopThreadStateForInterp(plugin_priv_ctx->interp);
   PyEval_AcquireThread(ts);
 
   if (plugin_priv_ctx->pModule) { Py_DECREF(plugin_priv_ctx->pModule); }
+  Py_XDECREF(plugin_priv_ctx->bareosfd_module);
 
-  Py_EndInterpreter(ts);
-  if (PyVersion() < VERSION_HEX(3, 12, 0)) {
-    // release gil a different way
-    PyThreadState_Swap(mainThreadState);
-    PyEval_ReleaseThread(mainThreadState);
-  } else {
-    // endinterpreter releases the gil for us since 3.12
-  }
+  EndPluginInterpreter(ts, mainThreadState);
 
   free(plugin_priv_ctx);
   plugin_ctx->plugin_private_context = NULL;
@@ -365,6 +353,57 @@ bail_out:
   return retval;
 }
 
+/**
+ * Serve a read of the core from the data of the last batched read. Only when
+ * that is used up the python plugin_io() is called (with the batch size as
+ * count), so the gil is not taken at all while the core compresses and sends
+ * the data of the previous reads.
+ */
+bRC BatchedRead(PluginContext* plugin_ctx,
+                plugin_private_context* plugin_priv_ctx,
+                io_pkt* io)
+{
+  if (plugin_priv_ctx->io_batch_pos >= plugin_priv_ctx->io_batch_len) {
+    bRC retval;
+    io_pkt batch_io = *io;
+
+    if (!plugin_priv_ctx->io_batch_buf) {
+      plugin_priv_ctx->io_batch_buf = GetPoolMemory(PM_BSOCK);
+    }
+    plugin_priv_ctx->io_batch_buf = CheckPoolMemorySize(
+        plugin_priv_ctx->io_batch_buf, plugin_priv_ctx->io_batch_size);
+    plugin_priv_ctx->io_batch_len = 0;
+    plugin_priv_ctx->io_batch_pos = 0;
+
+    batch_io.buf = plugin_priv_ctx->io_batch_buf;
+    batch_io.count = plugin_priv_ctx->io_batch_size;
+    {
+      auto l = AcquireLock(plugin_priv_ctx->interp);
+      retval = Bareosfd_PyPluginIO(plugin_ctx, &batch_io);
+    }
+
+    io->status = batch_io.status;
+    io->io_errno = batch_io.io_errno;
+    io->lerror = batch_io.lerror;
+    io->win32 = batch_io.win32;
+
+    // Pass on errors and end of file.
+    if (retval != bRC_OK || batch_io.status <= 0) { return retval; }
+
+    plugin_priv_ctx->io_batch_len = batch_io.status;
+  }
+
+  int32_t length = std::min(
+      io->count, plugin_priv_ctx->io_batch_len - plugin_priv_ctx->io_batch_pos);
+  memcpy(io->buf, plugin_priv_ctx->io_batch_buf + plugin_priv_ctx->io_batch_pos,
+         length);
+  plugin_priv_ctx->io_batch_pos += length;
+  io->status = length;
+  io->io_errno = 0;
+
+  return bRC_OK;
+}
+
 /**
  * Do actual I/O. Bareos calls this after startBackupFile
  * or after startRestoreFile to do the actual file
@@ -380,6 +419,21 @@ bRC pluginIO(PluginContext* plugin_ctx, io_pkt* io)
 
   if (!plugin_priv_ctx->python_loaded) { goto bail_out; }
 
+  if (io->func == IO_READ && plugin_priv_ctx->io_batch_size > io->count) {
+    return BatchedRead(plugin_ctx, plugin_priv_ctx, io);
+  }
+
+  if (plugin_priv_ctx->io_batch_pos < plugin_priv_ctx->io_batch_len) {
+    /* The plugin already read ahead what is left of the last batch, so a
+     * relative seek has to take that into account. */
+    if (io->func == IO_SEEK && io->whence == SEEK_CUR) {
+      io->offset -= plugin_priv_ctx->io_batch_len
+                    - plugin_priv_ctx->io_batch_pos;
+    }
+  }
+  plugin_priv_ctx->io_batch_len = 0;
+  plugin_priv_ctx->io_batch_pos = 0;
+
   {
     auto l = AcquireLock(plugin_priv_ctx->interp);
     retval = Bareosfd_PyPluginIO(plugin_ctx, io);
@@ -977,6 +1031,12 @@ bRC loadPlugin(PluginApiDefinition* lbareos_plugin_interface_version,
       = lbareos_core_functions; /* Set Bareos funct pointers */
   bareos_plugin_interface_version = lbareos_plugin_interface_version;
 
+  if (bareos_core_functions->getBareosValue(nullptr, bVarPythonPluginOwnGil,
+                                            &python_plugin_own_gil)
+      != bRC_OK) {
+    python_plugin_own_gil = false;
+  }
+
   *plugin_information = &pluginInfo; /* Return pointer to our info */
   *plugin_functions = &pluginFuncs;  /* Return pointer to our functions */
 
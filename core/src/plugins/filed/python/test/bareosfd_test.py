@@ -146,6 +146,17 @@ class TestBareosFd(unittest.TestCase):
             str(test_IoPacket),
         )
 
+    def test_IoPacketZeroCopy(self):
+        data = bytearray(b"Hello IO")
+        test_IoPacket = bareosfd.IoPacket()
+        test_IoPacket.buf = memoryview(data)
+        test_IoPacket.buf[0:5] = b"HELLO"
+        self.assertEqual(bytearray(b"HELLO IO"), data)
+
+    def test_IoOptionsNeedPluginContext(self):
+        self.assertRaises(RuntimeError, bareosfd.SetZeroCopyIo, True)
+        self.assertRaises(RuntimeError, bareosfd.SetIoBatchSize, 4 * 1024 * 1024)
+
     def test_AclPacket(self):
         test_AclPacket = bareosfd.AclPacket()
         test_AclPacket.content = bytearray(b"Hello ACL")
@@ -24,31 +24,39 @@
 /* Common definitions used in all python plugins.  */
 
 /* macros for uniform python module definition
-   see http://python3porting.com/cextensions.html */
-#if PY_MAJOR_VERSION >= 3
-#  define MOD_ERROR_VAL NULL
-#  define MOD_SUCCESS_VAL(val) val
-#  define MOD_INIT(name) PyMODINIT_FUNC PyInit_##name(void)
-#  define MOD_DEF(ob, name, doc, methods)                         \
-    static struct PyModuleDef moduledef = {PyModuleDef_HEAD_INIT, \
-                                           name,                  \
-                                           doc,                   \
-                                           -1,                    \
-                                           methods,               \
-                                           NULL,                  \
-                                           NULL,                  \
-                                           NULL,                  \
-                                           NULL};                 \
-                                                                  \
-    ob = PyModule_Create(&moduledef);
+
+   The modules use multi-phase initialization (PEP 489), so every
+   (sub-)interpreter gets its own module object.  MOD_INIT() starts the
+   definition of the module exec function which has access to the new module
+   object as "m".  Since Python 3.12 the modules also declare that they can be
+   loaded into sub-interpreters having their own GIL (PEP 684).  Modules using
+   MOD_INIT_WITH_STATE() keep their per-interpreter objects in the module state
+   of state_size bytes, see PyModuleDef for traverse, clear and free. */
+#if PY_VERSION_HEX >= 0x030C0000
+#  define MOD_MULTIPLE_INTERPRETERS_SLOT \
+    {Py_mod_multiple_interpreters, Py_MOD_PER_INTERPRETER_GIL_SUPPORTED},
 #else
-#  define MOD_ERROR_VAL
-#  define MOD_SUCCESS_VAL(val)
-#  define MOD_INIT(name) PyMODINIT_FUNC init##name(void)
-#  define MOD_DEF(ob, name, doc, methods) \
-    ob = Py_InitModule3(name, methods, doc);
+#  define MOD_MULTIPLE_INTERPRETERS_SLOT
 #endif
 
+#define MOD_ERROR_VAL -1
+#define MOD_SUCCESS_VAL(val) 0
+#define MOD_INIT_WITH_STATE(name, state_size, traverse, clear, free)       \
+  static int name##_exec(PyObject* m);                                     \
+  static PyModuleDef_Slot name##_slots[]                                   \
+      = {{Py_mod_exec, (void*)name##_exec},                                \
+         MOD_MULTIPLE_INTERPRETERS_SLOT{0, NULL}};                         \
+  static struct PyModuleDef name##_moduledef                               \
+      = {PyModuleDef_HEAD_INIT, #name,    NULL,          state_size,       \
+         Methods,               name##_slots, traverse, clear,             \
+         free};                                                            \
+  PyMODINIT_FUNC PyInit_##name(void)                                       \
+  {                                                                        \
+    return PyModuleDef_Init(&name##_moduledef);                            \
+  }                                                                        \
+  static int name##_exec(PyObject* m)
+#define MOD_INIT(name) MOD_INIT_WITH_STATE(name, 0, NULL, NULL, NULL)
+
 #define STRINGIFY(x) #x
 #define TOSTRING(x) STRINGIFY(x)
 #define AT __FILE__ ":" TOSTRING(__LINE__)
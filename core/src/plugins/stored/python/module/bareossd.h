@@ -89,8 +89,6 @@ thread_local PluginContext* plugin_context = NULL;
 
 MOD_INIT(bareossd)
 {
-  PyObject* m = NULL;
-  MOD_DEF(m, PYTHON_MODULE_NAME_QUOTED, NULL, Methods)
   static void* Bareossd_API[Bareossd_API_pointers];
   PyObject* c_api_object;
 
@@ -2,7 +2,7 @@
    BAREOS® - Backup Archiving REcovery Open Sourced
 
    Copyright (C) 2000-2012 Free Software Foundation Europe e.V.
-   Copyright (C) 2016-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2016-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -42,6 +42,7 @@
 #include "lib/berrno.h"
 #include "lib/crypto.h"
 
+#include <functional>
 #include <thread>
 #include <variant>
 #include <deque>
@@ -95,12 +96,17 @@ void ProcessedFile::AddAttribute(DeviceRecord* record)
   attributes_.emplace_back(ProcessedFileData(record));
 }
 
+bool IsAttributeStream(int32_t maskedStream)
+{
+  return maskedStream == STREAM_UNIX_ATTRIBUTES
+         || maskedStream == STREAM_UNIX_ATTRIBUTES_EX
+         || maskedStream == STREAM_RESTORE_OBJECT
+         || CryptoDigestStreamType(maskedStream) != CRYPTO_DIGEST_NONE;
+}
+
 bool IsAttribute(DeviceRecord* record)
 {
-  return record->maskedStream == STREAM_UNIX_ATTRIBUTES
-         || record->maskedStream == STREAM_UNIX_ATTRIBUTES_EX
-         || record->maskedStream == STREAM_RESTORE_OBJECT
-         || CryptoDigestStreamType(record->maskedStream) != CRYPTO_DIGEST_NONE;
+  return IsAttributeStream(record->maskedStream);
 }
 
 static bool SaveFullyProcessedFilesAttributes(
@@ -139,16 +145,24 @@ class MessageHandler {
   };
 
   using result_type = std::variant<signal_type, message_type, error_type>;
+  using buffer_provider = std::function<char*(int32_t size)>;
 
-  MessageHandler(BareosSocket* fd)
-      : MessageHandler{fd,
+  /* Without a receive thread get_msg() receives the messages itself, which
+   * allows it to put their data where buffer_for tells it to. */
+  MessageHandler(BareosSocket* fd, bool with_receive_thread = true)
+      : MessageHandler{fd, with_receive_thread,
                        // 500 msg reserves at most 256MB in size
                        // probably much less because of signals
                        channel::CreateBufferedChannel<result_type>(500)}
   {
   }
 
-  std::optional<result_type> get_msg() { return output.get(); }
+  std::optional<result_type> get_msg(const buffer_provider& buffer_for
+                                     = nullptr)
+  {
+    if (receive_thread.joinable()) { return output.get(); }
+    return receive(buffer_for);
+  }
 
   const char* error()
   {
@@ -159,18 +173,20 @@ class MessageHandler {
   BareosSocket* close_and_get_sock()
   {
     end.store(true);
-    receive_thread.join();
+    if (receive_thread.joinable()) { receive_thread.join(); }
     return fd;
   }
 
  private:
   MessageHandler(BareosSocket* fd,
+                 bool with_receive_thread,
                  std::pair<channel::input<result_type>,
                            channel::output<result_type>> chan_pair)
       : fd{fd}
       , input{std::move(chan_pair.first)}
       , output{std::move(chan_pair.second)}
-      , receive_thread{enlist, this}
+      , receive_thread{with_receive_thread ? std::thread{enlist, this}
+                                           : std::thread{}}
   {
   }
 
@@ -185,35 +201,41 @@ class MessageHandler {
   // The thread created will try to access this class immediately after
   // being created!  As such everything else has to be initialized.
   std::thread receive_thread;
-  void do_work()
+
+  result_type receive(const buffer_provider& buffer_for)
   {
     POOLMEM* save = fd->msg;
+    PoolMem msg(PM_MESSAGE);
+    fd->msg = msg.addr();
+    result_type result;
+    int n = BgetMsg(fd, buffer_for);
+    // fd->msg might have been relocated
+    msg.addr() = fd->msg;
+    if (n < 0) {
+      if (n == BNET_SIGNAL) {
+        result = signal_type{fd->message_length};
+        // break; /* end of data */
+      } else if (n == BNET_HARDEOF) {
+        result = error_type{error_type::type::HARDEOF, fd->bstrerror()};
+      } else {
+        result = error_type{error_type::type::INTERNAL_ERROR, fd->bstrerror()};
+      }
+    } else {
+      std::size_t length = n;
+      result = message_type{length, std::move(msg)};
+    }
+    fd->msg = save;
+
+    return result;
+  }
+
+  void do_work()
+  {
     bool cont = true;
     for (int res = 0; cont; res = fd->WaitData(0, 100'000)) {
       if (res == fd->DataAvailable) {
-        PoolMem msg(PM_MESSAGE);
-        fd->msg = msg.addr();
-        result_type result;
-        int n = BgetMsg(fd);
-        // fd->msg might have been relocated
-        msg.addr() = fd->msg;
-        if (n < 0) {
-          if (n == BNET_SIGNAL) {
-            result = signal_type{fd->message_length};
-            // break; /* end of data */
-          } else if (n == BNET_HARDEOF) {
-            result = error_type{error_type::type::HARDEOF, fd->bstrerror()};
-            cont = false;
-          } else {
-            result
-                = error_type{error_type::type::INTERNAL_ERROR, fd->bstrerror()};
-            cont = false;
-          }
-        } else {
-          std::size_t length = n;
-          result = message_type{length, std::move(msg)};
-        }
-        fd->msg = nullptr;
+        result_type result = receive(nullptr);
+        if (std::holds_alternative<error_type>(result)) { cont = false; }
 
         if (!input.emplace(std::move(result))) {
           Dmsg1(20,
@@ -230,8 +252,6 @@ class MessageHandler {
     }
 
     input.close();
-
-    fd->msg = save;
   }
 
   static void enlist(MessageHandler* handler) { handler->do_work(); }
@@ -348,7 +368,20 @@ bool DoAppendData(JobControlRecord* jcr, BareosSocket* bs, const char* what)
   ProcessedFile file_currently_processed;
   uint32_t current_block_number = jcr->sd_impl->dcr->block->BlockNumber;
 
-  MessageHandler handler(std::exchange(bs, nullptr));
+  /* Data of records nobody translates can be received straight into the
+   * block, which leaves no room for a thread receiving ahead. */
+  const bool receive_into_block
+      = jcr->sd_impl->dcr->device_resource->receive_into_block
+        && !PluginEventEnabled(jcr, bSdEventWriteRecordTranslation);
+  bool received_in_block = false;
+  const MessageHandler::buffer_provider block_space
+      = [jcr, &received_in_block](int32_t size) {
+          char* space = jcr->sd_impl->dcr->RecordSpaceInBlock(size);
+          received_in_block = space != nullptr;
+          return space;
+        };
+
+  MessageHandler handler(std::exchange(bs, nullptr), !receive_into_block);
 
   for (last_file_index = 0; ok && !jcr->IsJobCanceled();) {
     /* Read Stream header from the daemon.
@@ -428,8 +461,12 @@ bool DoAppendData(JobControlRecord* jcr, BareosSocket* bs, const char* what)
      * We save the original data pointer from the record so we can restore
      * that after the loop ends. */
     rec_data = jcr->sd_impl->dcr->rec->data;
+    const bool data_into_block
+        = receive_into_block && !IsAttributeStream(stream & STREAMMASK_TYPE);
     while (!jcr->IsJobCanceled()) {
-      auto msg = handler.get_msg();
+      received_in_block = false;
+      auto msg = data_into_block ? handler.get_msg(block_space)
+                                 : handler.get_msg();
 
       if (!msg) {
         Jmsg2(jcr, M_FATAL, 0,
@@ -465,8 +502,6 @@ bool DoAppendData(JobControlRecord* jcr, BareosSocket* bs, const char* what)
       jcr->sd_impl->dcr->rec->maskedStream
           = stream & STREAMMASK_TYPE; /* strip high bits */
       jcr->sd_impl->dcr->rec->data_len = content.size;
-      jcr->sd_impl->dcr->rec->data
-          = content.data.addr(); /* use message buffer */
 
       Dmsg4(850, "before writ_rec FI=%d SessId=%d Strm=%s len=%d\n",
             jcr->sd_impl->dcr->rec->FileIndex,
@@ -475,7 +510,13 @@ bool DoAppendData(JobControlRecord* jcr, BareosSocket* bs, const char* what)
                             jcr->sd_impl->dcr->rec->FileIndex),
             jcr->sd_impl->dcr->rec->data_len);
 
-      ok = jcr->sd_impl->dcr->WriteRecord();
+      if (received_in_block) {
+        ok = jcr->sd_impl->dcr->WriteRecordInBlock();
+      } else {
+        jcr->sd_impl->dcr->rec->data
+            = content.data.addr(); /* use message buffer */
+        ok = jcr->sd_impl->dcr->WriteRecord();
+      }
       if (!ok) {
         Dmsg2(90, "Got WriteBlockToDev error on device %s. %s\n",
               jcr->sd_impl->dcr->dev->print_name(),
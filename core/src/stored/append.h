@@ -1,7 +1,7 @@
 /*
    BAREOS® - Backup Archiving REcovery Open Sourced
 
-   Copyright (C) 2018-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2018-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -62,6 +62,7 @@ class ProcessedFile {
 };
 
 bool DoAppendData(JobControlRecord* jcr, BareosSocket* bs, const char* what);
+bool IsAttributeStream(int32_t maskedStream);
 bool IsAttribute(DeviceRecord* record);
 bool SendAttrsToDir(JobControlRecord* jcr, DeviceRecord* rec);
 }  // namespace storagedaemon
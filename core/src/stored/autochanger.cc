@@ -3,7 +3,7 @@
 
    Copyright (C) 2002-2012 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2016 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -30,6 +30,7 @@
 #include "stored/stored.h"
 #include "stored/stored_globals.h"
 #include "stored/autochanger.h"
+#include "stored/changer_scheduler.h"
 #include "stored/device_control_record.h"
 #include "stored/wait.h"
 #include "lib/berrno.h"
@@ -44,11 +45,16 @@
 namespace storagedaemon {
 
 /* Forward referenced functions */
-static bool LockChanger(DeviceControlRecord* dcr);
+static bool LockChanger(
+    DeviceControlRecord* dcr,
+    const ChangerOperation& operation = ChangerOperation::Exclusive());
 static bool UnlockChanger(DeviceControlRecord* dcr);
 static bool UnloadOtherDrive(DeviceControlRecord* dcr,
                              slot_number_t slot,
                              bool lock_set);
+static bool OtherDriveNeedsChanger(DeviceControlRecord* dcr,
+                                   slot_number_t slot);
+static bool UpdateDriveSlotsFromInventory(DeviceControlRecord* dcr);
 static char* transfer_edit_device_codes(DeviceControlRecord* dcr,
                                         POOLMEM*& omsg,
                                         const char* imsg,
@@ -194,20 +200,43 @@ int AutoloadDevice(DeviceControlRecord* dcr, int writing, BareosSocket* dir)
     loaded_slot = GetAutochangerLoadedSlot(dcr);
     if (loaded_slot != wanted_slot) {
       PoolMem results(PM_MESSAGE);
-
-      if (!LockChanger(dcr)) {
+      AutochangerResource* changer_res = dcr->device_resource->changer_res;
+      bool exclusive = !changer_res
+                       || changer_res->max_concurrent_operations <= 1
+                       || OtherDriveNeedsChanger(dcr, wanted_slot);
+
+      /* When no other drive holds the wanted slot, only this drive and the
+       * slots involved need to be locked. The changer command then waits for
+       * this drive while other drives of the library are loaded or unloaded
+       * at the same time. */
+      if (!LockChanger(dcr, exclusive ? ChangerOperation::Exclusive()
+                                      : ChangerOperation::Drive(
+                                          dcr->dev->drive, loaded_slot,
+                                          wanted_slot))) {
         rtn_stat = -2;
         goto bail_out;
       }
 
+      // Another drive may have loaded the wanted slot while we were waiting
+      if (!exclusive && OtherDriveNeedsChanger(dcr, wanted_slot)) {
+        UnlockChanger(dcr);
+        if (!LockChanger(dcr)) {
+          rtn_stat = -2;
+          goto bail_out;
+        }
+        exclusive = true;
+      }
+
       // Unload anything in our drive
       if (!UnloadAutochanger(dcr, loaded_slot, true)) {
         UnlockChanger(dcr);
         goto bail_out;
       }
 
-      // Make sure desired slot is unloaded
-      if (!UnloadOtherDrive(dcr, wanted_slot, true)) {
+      /* Make sure desired slot is unloaded. Without the exclusive lock we
+       * must not touch the other drives, but then we already know that none
+       * of them holds the wanted slot. */
+      if (exclusive && !UnloadOtherDrive(dcr, wanted_slot, true)) {
         UnlockChanger(dcr);
         goto bail_out;
       }
@@ -305,7 +334,9 @@ slot_number_t GetAutochangerLoadedSlot(DeviceControlRecord* dcr, bool lock_set)
   /* Only lock the changer if the lock_set is false e.g. changer not locked by
    * calling function. */
   if (!lock_set) {
-    if (!LockChanger(dcr)) { return kInvalidSlotNumber; }
+    if (!LockChanger(dcr, ChangerOperation::Drive(dev->drive))) {
+      return kInvalidSlotNumber;
+    }
   }
 
   /* Find out what is loaded, zero means device is unloaded
@@ -362,24 +393,26 @@ slot_number_t GetAutochangerLoadedSlot(DeviceControlRecord* dcr, bool lock_set)
   return loaded_slot;
 }
 
-static bool LockChanger(DeviceControlRecord* dcr)
+/**
+ * Lock the changer for an operation. Operations on different drives and slots
+ * may run at the same time when the Autochanger resource allows more than one
+ * concurrent operation, everything else gets the changer for itself.
+ */
+static bool LockChanger(DeviceControlRecord* dcr,
+                        const ChangerOperation& operation)
 {
   AutochangerResource* changer_res = dcr->device_resource->changer_res;
 
   if (changer_res) {
-    int errstat;
-    Dmsg1(200, "Locking changer %s\n", changer_res->resource_name_);
-    if ((errstat = RwlWritelock(&changer_res->changer_lock)) != 0) {
-      BErrNo be;
-      Jmsg(dcr->jcr, M_ERROR_TERM, 0,
-           T_("Lock failure on autochanger. ERR=%s\n"), be.bstrerror(errstat));
-    }
+    Dmsg2(200, "Locking changer %s%s\n", changer_res->resource_name_,
+          operation.exclusive ? "" : " for one drive");
+    changer_res->scheduler->Acquire(operation);
 
-    /* We just locked the changer for exclusive use so let any plugin know we
+    /* We just locked the changer for our use so let any plugin know we
      * have. */
     if (GeneratePluginEvent(dcr->jcr, bSdEventChangerLock, dcr) != bRC_OK) {
       Dmsg0(100, "Locking changer: bSdEventChangerLock failed\n");
-      RwlWriteunlock(&changer_res->changer_lock);
+      changer_res->scheduler->Release();
       return false;
     }
   }
@@ -392,17 +425,10 @@ static bool UnlockChanger(DeviceControlRecord* dcr)
   AutochangerResource* changer_res = dcr->device_resource->changer_res;
 
   if (changer_res) {
-    int errstat;
-
     GeneratePluginEvent(dcr->jcr, bSdEventChangerUnlock, dcr);
 
     Dmsg1(200, "Unlocking changer %s\n", changer_res->resource_name_);
-    if ((errstat = RwlWriteunlock(&changer_res->changer_lock)) != 0) {
-      BErrNo be;
-      Jmsg(dcr->jcr, M_ERROR_TERM, 0,
-           T_("Unlock failure on autochanger. ERR=%s\n"),
-           be.bstrerror(errstat));
-    }
+    changer_res->scheduler->Release();
   }
 
   return true;
@@ -440,7 +466,9 @@ bool UnloadAutochanger(DeviceControlRecord* dcr,
   /* Only lock the changer if the lock_set is false e.g. changer not locked by
    * calling function. */
   if (!lock_set) {
-    if (!LockChanger(dcr)) { return false; }
+    if (!LockChanger(dcr, ChangerOperation::Drive(dev->drive, loaded_slot))) {
+      return false;
+    }
   }
 
   if (loaded_slot == kInvalidSlotNumber) {
@@ -510,6 +538,19 @@ static bool UnloadOtherDrive(DeviceControlRecord* dcr,
   if (!changer) { return false; }
   if (changer->device_resources->size() == 1) { return true; }
 
+  /* Ask the changer about all drives at once instead of one "loaded" command
+   * per drive when we know nothing about more than one of them. */
+  if (lock_set) {
+    int unknown = 0;
+    foreach_alist (device_resource, changer->device_resources) {
+      if (device_resource->dev
+          && !IsSlotNumberValid(device_resource->dev->GetSlot())) {
+        unknown++;
+      }
+    }
+    if (unknown > 1) { UpdateDriveSlotsFromInventory(dcr); }
+  }
+
   /* We look for the slot number corresponding to the tape
    * we want in other drives, and if possible, unload it. */
   Dmsg0(100, "Wiffle through devices looking for slot\n");
@@ -570,6 +611,87 @@ static bool UnloadOtherDrive(DeviceControlRecord* dcr,
   return UnloadDev(dcr, dev, lock_set);
 }
 
+/**
+ * Check if loading slot into our drive may involve another drive of the
+ * changer, either because the slot is loaded there or because we do not know
+ * what is loaded there.
+ */
+static bool OtherDriveNeedsChanger(DeviceControlRecord* dcr,
+                                   slot_number_t slot)
+{
+  AutochangerResource* changer = dcr->device_resource->changer_res;
+  DeviceResource* device_resource = nullptr;
+
+  if (!changer) { return true; }
+
+  foreach_alist (device_resource, changer->device_resources) {
+    Device* dev = device_resource->dev;
+    if (!dev || dev == dcr->dev) { continue; }
+
+    slot_number_t loaded = dev->GetSlot();
+    if (loaded == kInvalidSlotNumber || loaded == slot) { return true; }
+  }
+
+  return false;
+}
+
+/**
+ * Update the loaded slot of all drives of the changer with one "listall"
+ * command, which reports the drives as "D:<drive>:F:<slot>:<volume>" or
+ * "D:<drive>:E". Called with the changer locked for exclusive use.
+ */
+static bool UpdateDriveSlotsFromInventory(DeviceControlRecord* dcr)
+{
+  AutochangerResource* changer = dcr->device_resource->changer_res;
+  uint32_t timeout = dcr->device_resource->max_changer_wait;
+  DeviceResource* device_resource = nullptr;
+  POOLMEM* ChangerCmd;
+  PoolMem results(PM_MESSAGE);
+  int status;
+
+  if (!changer) { return false; }
+
+  ChangerCmd = GetPoolMemory(PM_FNAME);
+  ChangerCmd = edit_device_codes(
+      dcr, ChangerCmd, dcr->device_resource->changer_command, "listall");
+  Dmsg1(100, "Run program=%s\n", ChangerCmd);
+  status = RunProgramFullOutput(ChangerCmd, timeout, results.addr());
+  FreePoolMemory(ChangerCmd);
+
+  if (status != 0) {
+    Dmsg1(100, "listall failed status=%d, asking drives one by one\n",
+          status);
+    return false;
+  }
+
+  char* line = results.c_str();
+  while (line && *line) {
+    char* next = strchr(line, '\n');
+    if (next) { *next++ = 0; }
+
+    unsigned int drive_index = 0, slot = 0;
+    char state = 0;
+    int fields = sscanf(line, "D:%u:%c:%u", &drive_index, &state, &slot);
+    if ((fields == 2 && state == 'E') || (fields == 3 && state == 'F')) {
+      foreach_alist (device_resource, changer->device_resources) {
+        Device* dev = device_resource->dev;
+        if (!dev || dev->drive_index != drive_index) { continue; }
+
+        if (state == 'E') {
+          dev->SetSlotNumber(0);
+        } else if (IsSlotNumberValid(static_cast<slot_number_t>(slot))) {
+          dev->SetSlotNumber(static_cast<slot_number_t>(slot));
+        }
+        Dmsg2(100, "listall: drive %u has slot %hd\n", drive_index,
+              dev->GetSlot());
+      }
+    }
+    line = next;
+  }
+
+  return true;
+}
+
 // Unconditionally unload a specified drive
 bool UnloadDev(DeviceControlRecord* dcr, Device* dev, bool lock_set)
 {
@@ -602,7 +724,7 @@ bool UnloadDev(DeviceControlRecord* dcr, Device* dev, bool lock_set)
   /* Only lock the changer if the lock_set is false e.g. changer not locked by
    * calling function. */
   if (!lock_set) {
-    if (!LockChanger(dcr)) {
+    if (!LockChanger(dcr, ChangerOperation::Drive(dev->drive, slot))) {
       dcr->SetDev(save_dev);
       return false;
     }
@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2011 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2019-2021 Bareos GmbH & Co. KG
+   Copyright (C) 2019-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -33,6 +33,8 @@ AutochangerResource::AutochangerResource()
     , device_resources(nullptr)
     , changer_name(nullptr)
     , changer_command(nullptr)
+    , max_concurrent_operations(1)
+    , scheduler(nullptr)
 {
   return;
 }
@@ -44,7 +46,8 @@ AutochangerResource& AutochangerResource::operator=(
   device_resources = rhs.device_resources;
   changer_name = rhs.changer_name;
   changer_command = rhs.changer_command;
-  changer_lock = rhs.changer_lock;
+  max_concurrent_operations = rhs.max_concurrent_operations;
+  scheduler = rhs.scheduler;
   return *this;
 }
 
@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2011 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2019-2021 Bareos GmbH & Co. KG
+   Copyright (C) 2019-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -30,6 +30,7 @@ template <typename T> class alist;
 
 namespace storagedaemon {
 class DeviceResource;
+class ChangerOperationScheduler;
 
 class AutochangerResource : public BareosResource {
  public:
@@ -43,10 +44,11 @@ class AutochangerResource : public BareosResource {
 
 
   alist<DeviceResource*>*
-      device_resources;   /**< List of DeviceResource device pointers */
-  char* changer_name;     /**< Changer device name */
-  char* changer_command;  /**< Changer command  -- external program */
-  brwlock_t changer_lock; /**< One changer operation at a time */
+      device_resources;  /**< List of DeviceResource device pointers */
+  char* changer_name;    /**< Changer device name */
+  char* changer_command; /**< Changer command  -- external program */
+  uint32_t max_concurrent_operations; /**< Changer operations at a time */
+  ChangerOperationScheduler* scheduler; /**< Serializes changer operations */
 };
 } /* namespace storagedaemon */
 
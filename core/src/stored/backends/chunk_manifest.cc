@@ -0,0 +1,292 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Encoding of compressed chunks and the manifest of a chunked volume.
+ */
+
+#include "include/bareos.h"
+#include "include/ch.h"
+#include "lib/compression.h"
+#include "lib/crypto.h"
+#include "lib/serial.h"
+#include "chunk_manifest.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace storagedaemon {
+
+// Same default level as the compression of the file daemon.
+static constexpr uint32_t kCompressionLevel = 6;
+
+/*
+ * Store data with a chunk header in front of it. The data is compressed
+ * with algorithm, unless it gets bigger by that.
+ */
+bool EncodeChunk(uint32_t algorithm,
+                 const char* data,
+                 uint32_t size,
+                 std::vector<char>& stored,
+                 ChunkInfo& info,
+                 PoolMem& errmsg)
+{
+  uint32_t used_algorithm = COMPRESS_NONE;
+  uint32_t stored_size = size;
+
+  stored.resize(CHUNK_HEADER_SIZE
+                + std::max<std::size_t>(
+                    RequiredCompressionOutputBufferSize(algorithm, size),
+                    size));
+
+  if (algorithm != COMPRESS_NONE) {
+    result compressed = ThreadlocalCompress(
+        algorithm, kCompressionLevel, data, size,
+        stored.data() + CHUNK_HEADER_SIZE, stored.size() - CHUNK_HEADER_SIZE);
+
+    if (compressed.holds_error()) {
+      PmStrcpy(errmsg, compressed.error()->c_str());
+      return false;
+    }
+    if (*compressed.value() < size) {
+      used_algorithm = algorithm;
+      stored_size = *compressed.value();
+    }
+  }
+
+  if (used_algorithm == COMPRESS_NONE) {
+    memcpy(stored.data() + CHUNK_HEADER_SIZE, data, size);
+  }
+
+  ser_declare;
+  SerBegin(stored.data(), CHUNK_HEADER_SIZE);
+  ser_uint32(CHUNK_HEADER_MAGIC);
+  ser_uint32(used_algorithm);
+  ser_uint32(size);
+  ser_uint32(stored_size);
+  SerEnd(stored.data(), CHUNK_HEADER_SIZE);
+
+  stored.resize(CHUNK_HEADER_SIZE + stored_size);
+
+  info.size = size;
+  info.stored_size = stored.size();
+  info.algorithm = used_algorithm;
+
+  return true;
+}
+
+// Returns false when the stored chunk has no chunk header.
+static bool ReadChunkHeader(const char* stored,
+                            uint32_t stored_size,
+                            uint32_t& algorithm,
+                            uint32_t& data_size,
+                            uint32_t& payload_size)
+{
+  uint32_t magic = 0;
+
+  if (stored_size < CHUNK_HEADER_SIZE) { return false; }
+
+  unser_declare;
+  UnserBegin(stored, CHUNK_HEADER_SIZE);
+  unser_uint32(magic);
+  unser_uint32(algorithm);
+  unser_uint32(data_size);
+  unser_uint32(payload_size);
+  UnserEnd(stored, CHUNK_HEADER_SIZE);
+
+  return magic == CHUNK_HEADER_MAGIC
+         && payload_size == stored_size - CHUNK_HEADER_SIZE;
+}
+
+/*
+ * Get the data of a stored chunk. Chunks stored without a chunk header, like
+ * the ones written before compression was enabled, are returned as is.
+ */
+bool DecodeChunk(const char* stored,
+                 uint32_t stored_size,
+                 char* data,
+                 uint32_t capacity,
+                 uint32_t* size,
+                 PoolMem& errmsg)
+{
+  uint32_t algorithm = 0, data_size = 0, payload_size = 0;
+
+  if (!ReadChunkHeader(stored, stored_size, algorithm, data_size,
+                       payload_size)) {
+    if (stored_size > capacity) {
+      Mmsg(errmsg, T_("Chunk of %u bytes does not fit into %u bytes\n"),
+           stored_size, capacity);
+      return false;
+    }
+    memcpy(data, stored, stored_size);
+    *size = stored_size;
+    return true;
+  }
+
+  if (data_size > capacity) {
+    Mmsg(errmsg, T_("Chunk of %u bytes does not fit into %u bytes\n"),
+         data_size, capacity);
+    return false;
+  }
+
+  if (algorithm == COMPRESS_NONE) {
+    if (payload_size != data_size) {
+      Mmsg(errmsg, T_("Chunk header size error. size=%u stored=%u\n"),
+           data_size, payload_size);
+      return false;
+    }
+    memcpy(data, stored + CHUNK_HEADER_SIZE, data_size);
+  } else {
+    result decompressed = DecompressBuffer(
+        algorithm, stored + CHUNK_HEADER_SIZE, payload_size, data, capacity);
+
+    if (decompressed.holds_error()) {
+      Mmsg(errmsg, T_("Cannot decompress chunk: %s\n"),
+           decompressed.error()->c_str());
+      return false;
+    }
+    if (*decompressed.value() != data_size) {
+      Mmsg(errmsg, T_("Chunk decompressed to %u bytes instead of %u\n"),
+           (uint32_t)*decompressed.value(), data_size);
+      return false;
+    }
+  }
+
+  *size = data_size;
+  return true;
+}
+
+// Describe a stored chunk as its manifest entry would, without decoding it.
+ChunkInfo StoredChunkInfo(const char* stored, uint32_t stored_size)
+{
+  ChunkInfo info;
+  uint32_t payload_size = 0;
+
+  info.stored_size = stored_size;
+  if (!ReadChunkHeader(stored, stored_size, info.algorithm, info.size,
+                       payload_size)) {
+    info.size = stored_size;
+    info.algorithm = COMPRESS_NONE;
+  }
+  info.hash = ChunkHash(stored, stored_size);
+
+  return info;
+}
+
+// SHA-256 of a stored chunk as hex string, empty if no digest is available.
+std::string ChunkHash(const char* stored, uint32_t stored_size)
+{
+  uint8_t digest[CRYPTO_DIGEST_SHA256_SIZE];
+  uint32_t length = sizeof(digest);
+  std::string hash;
+  DIGEST* sha256 = crypto_digest_new(nullptr, CRYPTO_DIGEST_SHA256);
+
+  if (!sha256) { return hash; }
+
+  if (CryptoDigestUpdate(sha256, (const uint8_t*)stored, stored_size)
+      && CryptoDigestFinalize(sha256, digest, &length)) {
+    static const char hex[] = "0123456789abcdef";
+
+    for (uint32_t i = 0; i < length; i++) {
+      hash += hex[digest[i] >> 4];
+      hash += hex[digest[i] & 0xf];
+    }
+  }
+  CryptoDigestFree(sha256);
+
+  return hash;
+}
+
+// The COMPRESS_* values are four letters, so they can be written as text.
+static std::string AlgorithmToText(uint32_t algorithm)
+{
+  std::string text(4, ' ');
+
+  for (int i = 0; i < 4; i++) { text[i] = (algorithm >> (24 - 8 * i)) & 0xff; }
+
+  return text;
+}
+
+static uint32_t TextToAlgorithm(const std::string& text)
+{
+  uint32_t algorithm = 0;
+
+  for (char c : text) { algorithm = (algorithm << 8) | (uint8_t)c; }
+
+  return algorithm;
+}
+
+void ChunkManifest::Update(uint16_t chunk, const ChunkInfo& info)
+{
+  chunks_[chunk] = info;
+}
+
+const ChunkInfo* ChunkManifest::Find(uint16_t chunk) const
+{
+  auto found = chunks_.find(chunk);
+
+  return found != chunks_.end() ? &found->second : nullptr;
+}
+
+std::string ChunkManifest::Serialize() const
+{
+  std::string text = "# chunk size stored_size compression sha256\n";
+  PoolMem line(PM_MESSAGE);
+
+  for (auto& [chunk, info] : chunks_) {
+    Mmsg(line, "%04d %u %u %s %s\n", chunk, info.size, info.stored_size,
+         AlgorithmToText(info.algorithm).c_str(),
+         info.hash.empty() ? "-" : info.hash.c_str());
+    text += line.c_str();
+  }
+
+  return text;
+}
+
+bool ChunkManifest::Parse(const std::string& text)
+{
+  std::istringstream lines(text);
+  std::string line;
+
+  chunks_.clear();
+  while (std::getline(lines, line)) {
+    if (line.empty() || line[0] == '#') { continue; }
+
+    std::istringstream fields(line);
+    unsigned int chunk;
+    ChunkInfo info;
+    std::string algorithm;
+
+    if (!(fields >> chunk >> info.size >> info.stored_size >> algorithm
+          >> info.hash)
+        || chunk > UINT16_MAX || algorithm.size() != 4) {
+      chunks_.clear();
+      return false;
+    }
+    info.algorithm = TextToAlgorithm(algorithm);
+    if (info.hash == "-") { info.hash.clear(); }
+    chunks_[chunk] = info;
+  }
+
+  return true;
+}
+
+} /* namespace storagedaemon */
@@ -0,0 +1,95 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Encoding of compressed chunks and the manifest of a chunked volume.
+ */
+
+#ifndef BAREOS_STORED_BACKENDS_CHUNK_MANIFEST_H_
+#define BAREOS_STORED_BACKENDS_CHUNK_MANIFEST_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+class PoolMem;
+
+namespace storagedaemon {
+
+/*
+ * A compressed chunk is stored with a header in front of it:
+ *
+ *   magic       uint32 CHUNK_HEADER_MAGIC
+ *   algorithm   uint32 COMPRESS_* as in include/ch.h, COMPRESS_NONE if the
+ *               data did not compress
+ *   size        uint32 size of the data in the chunk
+ *   stored_size uint32 size of the (compressed) data after the header
+ *
+ * Chunks without this header are stored as is.
+ */
+#define CHUNK_HEADER_MAGIC 0x42434831 /* BCH1 */
+#define CHUNK_HEADER_SIZE 16
+
+struct ChunkInfo {
+  uint32_t size{};        /* Size of the data in the chunk */
+  uint32_t stored_size{}; /* Size of the object on the backing store */
+  uint32_t algorithm{};   /* Compression used for the object */
+  std::string hash;       /* SHA-256 of the object on the backing store */
+};
+
+bool EncodeChunk(uint32_t algorithm,
+                 const char* data,
+                 uint32_t size,
+                 std::vector<char>& stored,
+                 ChunkInfo& info,
+                 PoolMem& errmsg);
+bool DecodeChunk(const char* stored,
+                 uint32_t stored_size,
+                 char* data,
+                 uint32_t capacity,
+                 uint32_t* size,
+                 PoolMem& errmsg);
+std::string ChunkHash(const char* stored, uint32_t stored_size);
+ChunkInfo StoredChunkInfo(const char* stored, uint32_t stored_size);
+
+/*
+ * The manifest lists the chunks of a volume with their sizes and hashes, so
+ * the volume can be checked by looking at the objects on the backing store
+ * without reading them. It is stored as text, one chunk per line.
+ */
+class ChunkManifest {
+ public:
+  void Update(uint16_t chunk, const ChunkInfo& info);
+  const ChunkInfo* Find(uint16_t chunk) const;
+  void Clear() { chunks_.clear(); }
+  bool empty() const { return chunks_.empty(); }
+
+  std::string Serialize() const;
+  bool Parse(const std::string& text);
+
+ private:
+  std::map<uint16_t, ChunkInfo> chunks_;
+};
+
+} /* namespace storagedaemon */
+
+#endif  // BAREOS_STORED_BACKENDS_CHUNK_MANIFEST_H_
@@ -2,7 +2,7 @@
    BAREOS® - Backup Archiving REcovery Open Sourced
 
    Copyright (C) 2015-2017 Planets Communications B.V.
-   Copyright (C) 2017-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2017-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -29,6 +29,7 @@
 
 #include "include/fcntl_def.h"
 #include "include/bareos.h"
+#include "include/ch.h"
 #include "lib/edit.h"
 #include "stored/device_status_information.h"
 
@@ -403,7 +404,7 @@ bool ChunkedDevice::DequeueChunk()
           new_request->chunk, new_request->volname,
           edit_pthread(pthread_self(), ed1, sizeof(ed1)));
 
-    if (!FlushRemoteChunk(new_request)) {
+    if (!FlushStoredChunk(new_request)) {
       chunk_io_request* enqueued_request;
 
       /* See if we have a maximum number of retries to upload chunks to the
@@ -492,13 +493,14 @@ bool ChunkedDevice::FlushChunk(bool release_chunk, bool move_to_next_chunk)
   request.buffer = current_chunk_->buffer;
   request.wbuflen = current_chunk_->buflen;
   request.release = release_chunk;
+  request.encoded = false;
 
   if (io_threads_) {
     retval = EnqueueChunk(&request);
   } else {
     // no multithreading
     Dmsg1(100, "Try to flush chunk number: %d\n", request.chunk);
-    retval = FlushRemoteChunk(&request);
+    retval = FlushStoredChunk(&request);
   }
 
   // Clear the need flushing flag.
@@ -522,6 +524,246 @@ bool ChunkedDevice::FlushChunk(bool release_chunk, bool move_to_next_chunk)
   return retval;
 }
 
+/*
+ * Get the manifest of a volume, it is read from the backing store on first
+ * use. Must be called with the manifest_mutex_ locked.
+ */
+ChunkManifest* ChunkedDevice::GetManifest(const char* volname)
+{
+  auto found = manifests_.find(volname);
+
+  if (found != manifests_.end()) { return &found->second; }
+
+  std::string text;
+  ChunkManifest manifest;
+
+  if (!ReadRemoteManifest(volname, text)) { return nullptr; }
+  if (!manifest.Parse(text)) {
+    Mmsg1(errmsg, T_("Manifest of volume %s is damaged, starting a new one\n"),
+          volname);
+    Emsg0(M_WARNING, 0, errmsg);
+  }
+
+  return &(manifests_[volname] = std::move(manifest));
+}
+
+/*
+ * Flush a chunk to the backing store in the form it is stored there and
+ * record it in the manifest of the volume. When chunk compression is enabled
+ * the io-thread doing the upload also does the compression.
+ */
+bool ChunkedDevice::FlushStoredChunk(chunk_io_request* request)
+{
+  if (!UsesManifest()) { return FlushRemoteChunk(request); }
+
+  /* Like the backends do for the size of the objects, we never replace a chunk
+   * by one with less data in it. */
+  {
+    std::lock_guard<std::mutex> lock(manifest_mutex_);
+    ChunkManifest* manifest = GetManifest(request->volname);
+
+    if (!manifest) { return false; }
+    const ChunkInfo* uploaded = manifest->Find(request->chunk);
+    if (uploaded && uploaded->size > request->wbuflen) {
+      Dmsg4(100,
+            "Not uploading chunk %d of volume %s as it has %u bytes and the "
+            "uploaded one %u bytes\n",
+            request->chunk, request->volname, request->wbuflen, uploaded->size);
+      return true;
+    }
+  }
+
+  thread_local std::vector<char> stored;
+  chunk_io_request stored_request = *request;
+  ChunkInfo info;
+
+  info.size = info.stored_size = request->wbuflen;
+  info.algorithm = COMPRESS_NONE;
+  if (chunk_compression_) {
+    PoolMem error(PM_MESSAGE);
+
+    if (!EncodeChunk(chunk_compression_, request->buffer, request->wbuflen,
+                     stored, info, error)) {
+      Mmsg3(errmsg, T_("Failed to compress chunk %d of volume %s: %s\n"),
+            request->chunk, request->volname, error.c_str());
+      return false;
+    }
+    stored_request.buffer = stored.data();
+    stored_request.wbuflen = stored.size();
+  }
+  stored_request.release = false;
+  stored_request.encoded = true;
+  info.hash = ChunkHash(stored_request.buffer, stored_request.wbuflen);
+
+  if (!FlushRemoteChunk(&stored_request)) { return false; }
+
+  /* Only the copy in memory is updated here, the manifest is written when the
+   * device gets flushed or closed. */
+  std::lock_guard<std::mutex> lock(manifest_mutex_);
+  ChunkManifest* manifest = GetManifest(request->volname);
+
+  if (!manifest) { return false; }
+  manifest->Update(request->chunk, info);
+  unflushed_manifests_.insert(request->volname);
+
+  return true;
+}
+
+/*
+ * Write the manifests changed since they were last written. The copy in
+ * memory is only locked while it gets serialized, so the io-threads can go on
+ * uploading chunks. The writes themselves are serialized by
+ * manifest_flush_mutex_, so the last version written is also the latest one.
+ */
+bool ChunkedDevice::FlushManifests()
+{
+  std::lock_guard<std::mutex> flush_lock(manifest_flush_mutex_);
+
+  for (;;) {
+    std::string volname, manifest;
+
+    {
+      std::lock_guard<std::mutex> lock(manifest_mutex_);
+
+      if (unflushed_manifests_.empty()) { return true; }
+      volname = *unflushed_manifests_.begin();
+      unflushed_manifests_.erase(unflushed_manifests_.begin());
+
+      auto found = manifests_.find(volname);
+      if (found == manifests_.end() || found->second.empty()) { continue; }
+      manifest = found->second.Serialize();
+    }
+
+    if (!FlushRemoteManifest(volname.c_str(), manifest)) {
+      std::lock_guard<std::mutex> lock(manifest_mutex_);
+
+      unflushed_manifests_.insert(volname);
+      return false;
+    }
+  }
+}
+
+/*
+ * Read a chunk from the backing store and get the data in it. The object read
+ * is checked against its entry in the manifest of the volume. Chunks uploaded
+ * after the manifest was last written are not listed, they are read
+ * unchecked.
+ */
+bool ChunkedDevice::ReadStoredChunk(chunk_io_request* request)
+{
+  if (!UsesManifest()) { return ReadRemoteChunk(request); }
+
+  chunk_io_request stored_request = *request;
+  uint32_t stored_size = 0;
+
+  stored_chunk_.resize(request->wbuflen + CHUNK_HEADER_SIZE);
+  stored_request.buffer = stored_chunk_.data();
+  stored_request.wbuflen = stored_chunk_.size();
+  stored_request.rbuflen = &stored_size;
+  if (!ReadRemoteChunk(&stored_request)) { return false; }
+
+  ChunkInfo expected;
+  {
+    std::lock_guard<std::mutex> lock(manifest_mutex_);
+    ChunkManifest* manifest = GetManifest(request->volname);
+
+    if (manifest && manifest->Find(request->chunk)) {
+      expected = *manifest->Find(request->chunk);
+    }
+  }
+
+  if (!expected.hash.empty()
+      && (expected.stored_size != stored_size
+          || ChunkHash(stored_chunk_.data(), stored_size) != expected.hash)) {
+    Mmsg2(errmsg, T_("Chunk %d of volume %s does not match its manifest\n"),
+          request->chunk, request->volname);
+    Emsg0(M_ERROR, 0, errmsg);
+    dev_errno = EINVAL;
+    return false;
+  }
+
+  PoolMem error(PM_MESSAGE);
+  if (!DecodeChunk(stored_chunk_.data(), stored_size, request->buffer,
+                   request->wbuflen, request->rbuflen, error)) {
+    Mmsg3(errmsg, T_("Failed to read chunk %d of volume %s: %s"),
+          request->chunk, request->volname, error.c_str());
+    dev_errno = EINVAL;
+    return false;
+  }
+
+  return true;
+}
+
+/*
+ * Get the size of the data in a chunk from the size of the object on the
+ * backing store. Returns -1 when the object doesn't match the manifest.
+ */
+ssize_t ChunkedDevice::ChunkSizeFromManifest(const char* volname,
+                                             uint16_t chunk,
+                                             ssize_t stored_size)
+{
+  if (!UsesManifest()) { return stored_size; }
+
+  {
+    std::lock_guard<std::mutex> lock(manifest_mutex_);
+    ChunkManifest* manifest = GetManifest(volname);
+    const ChunkInfo* info = manifest ? manifest->Find(chunk) : nullptr;
+
+    if (info) {
+      if (info->stored_size != stored_size) {
+        Mmsg4(errmsg,
+              T_("Chunk %d of volume %s has %lld bytes but its manifest says "
+                 "%u bytes\n"),
+              chunk, volname, (long long)stored_size, info->stored_size);
+        return -1;
+      }
+      return info->size;
+    }
+  }
+
+  return UnlistedChunkSize(volname, chunk, stored_size);
+}
+
+/*
+ * Get the size of the data in a chunk the manifest doesn't list, as the
+ * device was not flushed or closed after uploading it. With chunk compression
+ * it can hold more data than the size of its object, so it is read once and
+ * added to the manifest.
+ */
+ssize_t ChunkedDevice::UnlistedChunkSize(const char* volname,
+                                         uint16_t chunk,
+                                         ssize_t stored_size)
+{
+  if (!chunk_compression_ || stored_size < CHUNK_HEADER_SIZE
+      || stored_size > current_chunk_->chunk_size + CHUNK_HEADER_SIZE) {
+    return stored_size;
+  }
+
+  std::vector<char> stored(stored_size);
+  uint32_t read_size = 0;
+  chunk_io_request request;
+
+  request.chunk = chunk;
+  request.volname = volname;
+  request.buffer = stored.data();
+  request.wbuflen = stored.size();
+  request.rbuflen = &read_size;
+  request.release = false;
+  request.encoded = true;
+  if (!ReadRemoteChunk(&request)) { return -1; }
+
+  ChunkInfo info = StoredChunkInfo(stored.data(), read_size);
+  std::lock_guard<std::mutex> lock(manifest_mutex_);
+  ChunkManifest* manifest = GetManifest(volname);
+
+  if (manifest && !manifest->Find(chunk)) {
+    manifest->Update(chunk, info);
+    unflushed_manifests_.insert(volname);
+  }
+
+  return info.size;
+}
+
 // Internal method for reading a chunk from the backing store.
 bool ChunkedDevice::ReadChunk()
 {
@@ -534,11 +776,12 @@ bool ChunkedDevice::ReadChunk()
   request.wbuflen = current_chunk_->chunk_size;
   request.rbuflen = &current_chunk_->buflen;
   request.release = false;
+  request.encoded = false;
 
   current_chunk_->end_offset
       = current_chunk_->start_offset + (current_chunk_->chunk_size - 1);
 
-  if (!ReadRemoteChunk(&request)) {
+  if (!ReadStoredChunk(&request)) {
     // If the chunk doesn't exist on the backing store it has a size of 0 bytes.
     current_chunk_->buflen = 0;
     return false;
@@ -613,6 +856,15 @@ int ChunkedDevice::SetupChunk(const char*, int flags, int)
 
   current_volname_ = strdup(getVolCatName());
 
+  /* The volume might have been written by another device since we last used
+   * it, so read its manifest again. */
+  if (UsesManifest()) {
+    std::lock_guard<std::mutex> lock(manifest_mutex_);
+    if (!unflushed_manifests_.count(current_volname_)) {
+      manifests_.erase(current_volname_);
+    }
+  }
+
   /* in principle it is not required to load_chunk(),
    * but we need a secure way to determine,
    * if the chunk already exists. */
@@ -896,6 +1148,13 @@ int ChunkedDevice::CloseChunk()
       retval = 0;
     }
 
+    /* Chunks still being uploaded by the io-threads get listed by the next
+     * flush of the device. */
+    if (UsesManifest() && !FlushManifests()) {
+      Emsg0(M_ERROR, 0, errmsg);
+      dev_errno = EIO;
+      retval = -1;
+    }
 
     // Invalidate chunk.
     current_chunk_->writing = false;
@@ -928,6 +1187,18 @@ bool ChunkedDevice::TruncateChunkedVolume(DeviceControlRecord* dcr)
     if (current_volname_) { free(current_volname_); }
 
     current_volname_ = strdup(getVolCatName());
+
+    if (UsesManifest()) {
+      {
+        std::lock_guard<std::mutex> lock(manifest_mutex_);
+
+        manifests_[current_volname_].Clear();
+        unflushed_manifests_.erase(current_volname_);
+      }
+      if (!FlushRemoteManifest(current_volname_, std::string())) {
+        return false;
+      }
+    }
   }
 
   return true;
@@ -1092,6 +1363,12 @@ bool ChunkedDevice::WaitUntilChunksWritten()
     Bmicrosleep(DEFAULT_RECHECK_INTERVAL_WRITE_BUFFER, 0);
   }
 
+  if (UsesManifest() && !FlushManifests()) {
+    Emsg0(M_ERROR, 0, errmsg);
+    dev_errno = EIO;
+    return false;
+  }
+
   return true;
 }
 
@@ -2,7 +2,7 @@
    BAREOS® - Backup Archiving REcovery Open Sourced
 
    Copyright (C) 2015-2017 Planets Communications B.V.
-   Copyright (C) 2018-2021 Bareos GmbH & Co. KG
+   Copyright (C) 2018-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -31,6 +31,14 @@
 template <typename T> class alist;
 
 #include "ordered_cbuf.h"
+#include "chunk_manifest.h"
+
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
 namespace storagedaemon {
 
 // Let io-threads check for work every 300 seconds.
@@ -83,6 +91,7 @@ struct chunk_io_request {
   uint32_t* rbuflen;   /* Size of the actual valid data in the chunk (Read) */
   uint8_t tries; /* Number of times the flush was tried to the backing store */
   bool release;  /* Should we release the data to which the buffer points ? */
+  bool encoded;  /* Buffer holds the chunk as stored, see chunk_manifest.h */
 };
 
 struct chunk_descriptor {
@@ -109,6 +118,11 @@ class ChunkedDevice : public Device {
   ordered_circbuf* cb_{};
   alist<thread_handle*>* thread_ids_{};
   chunk_descriptor* current_chunk_{};
+  std::vector<char> stored_chunk_;
+  std::mutex manifest_mutex_;
+  std::map<std::string, ChunkManifest> manifests_;
+  std::set<std::string> unflushed_manifests_;
+  std::mutex manifest_flush_mutex_;
 
   // Private Methods
   char* allocate_chunkbuffer();
@@ -118,7 +132,14 @@ class ChunkedDevice : public Device {
   void StopThreads();
   bool EnqueueChunk(chunk_io_request* request);
   bool FlushChunk(bool release_chunk, bool move_to_next_chunk);
+  bool FlushStoredChunk(chunk_io_request* request);
   bool ReadChunk();
+  bool ReadStoredChunk(chunk_io_request* request);
+  ChunkManifest* GetManifest(const char* volname);
+  bool FlushManifests();
+  ssize_t UnlistedChunkSize(const char* volname,
+                            uint16_t chunk,
+                            ssize_t stored_size);
   bool is_written();
 
  protected:
@@ -129,6 +150,8 @@ class ChunkedDevice : public Device {
   uint64_t chunk_size_{};
   boffset_t offset_{};
   bool use_mmap_{};
+  uint32_t chunk_compression_{};
+  bool use_manifest_{};
 
   // Protected Methods
   bool SetInflightChunk(chunk_io_request* request);
@@ -143,6 +166,10 @@ class ChunkedDevice : public Device {
   ssize_t ChunkedVolumeSize();
   bool LoadChunk();
   bool WaitUntilChunksWritten();
+  bool UsesManifest() const { return use_manifest_ || chunk_compression_; }
+  ssize_t ChunkSizeFromManifest(const char* volname,
+                                uint16_t chunk,
+                                ssize_t stored_size);
 
   // Methods implemented by inheriting class.
   virtual bool CheckRemoteConnection() = 0;
@@ -150,6 +177,12 @@ class ChunkedDevice : public Device {
   virtual bool ReadRemoteChunk(chunk_io_request* request) = 0;
   virtual ssize_t RemoteVolumeSize() = 0;
   virtual bool TruncateRemoteVolume(DeviceControlRecord* dcr) = 0;
+  // An empty manifest removes the manifest of the volume.
+  virtual bool FlushRemoteManifest(const char* volname,
+                                   const std::string& manifest)
+      = 0;
+  virtual bool ReadRemoteManifest(const char* volname, std::string& manifest)
+      = 0;
 
  public:
   // Public Methods
@@ -2,7 +2,7 @@
    BAREOS® - Backup Archiving REcovery Open Sourced
 
    Copyright (C) 2014-2017 Planets Communications B.V.
-   Copyright (C) 2014-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2014-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -41,6 +41,7 @@
  */
 
 #include "include/bareos.h"
+#include "include/ch.h"
 
 #include "stored/stored.h"
 #include "stored/sd_backends.h"
@@ -48,7 +49,17 @@
 #include "droplet_device.h"
 #include "lib/edit.h"
 
+#include <json.h>
+extern "C" {
+#include <droplet/s3/multipart.h>
+}
+
+#include <algorithm>
+#include <atomic>
+#include <map>
 #include <string>
+#include <thread>
+#include <vector>
 
 namespace storagedaemon {
 
@@ -65,7 +76,10 @@ enum device_option_type
   argument_iothreads,
   argument_ioslots,
   argument_retries,
-  argument_mmap
+  argument_mmap,
+  argument_partsize,
+  argument_compression,
+  argument_manifest
 };
 
 struct device_option {
@@ -85,8 +99,21 @@ static device_option device_options[]
        {"ioslots=", argument_ioslots, 8},
        {"retries=", argument_retries, 8},
        {"mmap", argument_mmap, 4},
+       {"partsize=", argument_partsize, 9},
+       {"compression=", argument_compression, 12},
+       {"manifest", argument_manifest, 8},
        {NULL, argument_none, 0}};
 
+struct chunk_compression {
+  const char* name;
+  uint32_t algorithm;
+};
+
+static chunk_compression chunk_compressions[]
+    = {{"gzip", COMPRESS_GZIP},   {"lzo", COMPRESS_LZO1X},
+       {"lzfast", COMPRESS_FZFZ}, {"lz4", COMPRESS_FZ4L},
+       {"lz4hc", COMPRESS_FZ4H},  {NULL, 0}};
+
 static int droplet_reference_count = 0;
 static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
 
@@ -159,16 +186,17 @@ static inline int DropletErrnoToSystemErrno(dpl_status_t status)
 }
 
 
-// Callback for getting the total size of a chunked volume.
+// Callback for getting the size of every chunk of a chunked volume.
 static dpl_status_t chunked_volume_size_callback(dpl_sysmd_t* sysmd,
                                                  dpl_ctx_t*,
-                                                 const char*,
+                                                 const char* chunkpath,
                                                  void* data)
 {
   dpl_status_t status = DPL_SUCCESS;
-  ssize_t* volumesize = (ssize_t*)data;
+  auto chunk_sizes = (std::map<uint16_t, ssize_t>*)data;
+  const char* chunk = strrchr(chunkpath, '/');
 
-  *volumesize = *volumesize + sysmd->size;
+  (*chunk_sizes)[chunk ? atoi(chunk + 1) : 0] = sysmd->size;
 
   return status;
 }
@@ -399,6 +427,49 @@ bool DropletDevice::CheckRemoteConnection()
  * This does the real work either by being called from a
  * io-thread or directly blocking the device.
  */
+/*
+ * All uploads of a device together, the parts of multipart uploads included,
+ * use at most as many connections as there are io-threads.
+ */
+uint32_t DropletDevice::MaxUploads() const
+{
+  return io_threads_ > 0 ? io_threads_ : default_max_uploads_;
+}
+
+// Wait until the device may open another upload connection.
+void DropletDevice::AcquireUpload()
+{
+  std::unique_lock<std::mutex> lock(uploads_mutex_);
+
+  uploads_changed_.wait(lock,
+                        [this] { return active_uploads_ < MaxUploads(); });
+  active_uploads_++;
+}
+
+// Take up to wanted upload connections that are free right now.
+uint32_t DropletDevice::AcquireExtraUploads(uint32_t wanted)
+{
+  std::lock_guard<std::mutex> lock(uploads_mutex_);
+  uint32_t max_uploads = MaxUploads();
+  uint32_t acquired = 0;
+
+  if (active_uploads_ < max_uploads) {
+    acquired = std::min(wanted, max_uploads - active_uploads_);
+  }
+  active_uploads_ += acquired;
+
+  return acquired;
+}
+
+void DropletDevice::ReleaseUploads(uint32_t count)
+{
+  {
+    std::lock_guard<std::mutex> lock(uploads_mutex_);
+    active_uploads_ -= count;
+  }
+  uploads_changed_.notify_all();
+}
+
 bool DropletDevice::FlushRemoteChunk(chunk_io_request* request)
 {
   bool retval = false;
@@ -412,6 +483,7 @@ bool DropletDevice::FlushRemoteChunk(chunk_io_request* request)
 
   // Set that we are uploading the chunk.
   if (!SetInflightChunk(request)) { return false; }
+  AcquireUpload();
 
   int tries = 0;
   bool success = false;
@@ -434,7 +506,9 @@ bool DropletDevice::FlushRemoteChunk(chunk_io_request* request)
 
     switch (status) {
       case DPL_SUCCESS:
-        if (sysmd->size > request->wbuflen) {
+        /* Encoded chunks are compared by the size of their data using the
+         * manifest of the volume before we get here. */
+        if (!request->encoded && sysmd->size > request->wbuflen) {
           success = true;
           goto bail_out;
         }
@@ -482,6 +556,13 @@ bool DropletDevice::FlushRemoteChunk(chunk_io_request* request)
         break;
     }
 
+    // Big chunks are uploaded as several parts at the same time.
+    if (part_size_ > 0 && request->wbuflen > part_size_) {
+      // The parts are retried on their own, so no need to start over.
+      success = FlushRemoteChunkInParts(request, chunk_name.c_str());
+      goto bail_out;
+    }
+
     /* Create some options for libdroplet.
      *
      * DPL_OPTION_NOALLOC - we provide the buffer to copy the data into
@@ -525,6 +606,7 @@ bool DropletDevice::FlushRemoteChunk(chunk_io_request* request)
 
 bail_out:
   retval = success;
+  ReleaseUploads(1);
   // Clear that we are uploading the chunk.
   ClearInflightChunk(request);
 
@@ -533,6 +615,134 @@ bail_out:
   return retval;
 }
 
+/*
+ * Upload a chunk as S3 multipart upload of part_size_ sized parts. The parts
+ * are uploaded in parallel using the upload connections of the device that
+ * are free and every part is retried on its own, so one slow or failing
+ * request does not mean sending the whole chunk again.
+ */
+bool DropletDevice::FlushRemoteChunkInParts(chunk_io_request* request,
+                                            const char* chunk_name)
+{
+  dpl_status_t status;
+  const char* upload_id = NULL;
+  std::string bucket;
+  uint32_t nr_parts = (request->wbuflen + part_size_ - 1) / part_size_;
+  std::vector<std::string> etags(nr_parts);
+  std::atomic<uint32_t> next_part{0};
+  std::atomic<dpl_status_t> part_status{DPL_SUCCESS};
+  std::vector<std::thread> uploaders;
+  json_object* parts = NULL;
+  bool retval = false;
+
+  dpl_ctx_lock(ctx_);
+  bucket = ctx_->cur_bucket;
+  dpl_ctx_unlock(ctx_);
+
+  status = dpl_s3_stream_multipart_init(ctx_, bucket.c_str(), chunk_name,
+                                        &upload_id);
+  if (status != DPL_SUCCESS) {
+    Mmsg2(errmsg, T_("Failed to start multipart upload of %s: ERR=%s.\n"),
+          chunk_name, dpl_status_str(status));
+    dev_errno = DropletErrnoToSystemErrno(status);
+    return false;
+  }
+
+  auto upload_parts = [&]() {
+    uint32_t part;
+
+    while (part_status == DPL_SUCCESS && (part = next_part++) < nr_parts) {
+      uint64_t offset = part * part_size_;
+      uint32_t len = std::min<uint64_t>(part_size_, request->wbuflen - offset);
+      const char* etag = NULL;
+      dpl_status_t result = DPL_FAILURE;
+
+      for (int tries = 0; tries < NUMBER_OF_RETRIES; tries++) {
+        if (tries > 0) { Bmicrosleep(INFLIGT_RETRY_TIME, 0); }
+        result = dpl_s3_stream_multipart_put(
+            ctx_, bucket.c_str(), chunk_name, upload_id,
+            part + 1, /* part numbers start at 1 */
+            request->buffer + offset, len, &etag);
+        if (result == DPL_SUCCESS || part_status != DPL_SUCCESS) { break; }
+        Dmsg3(100, "Upload of part %d of %s failed: %s. Retrying\n", part + 1,
+              chunk_name, dpl_status_str(result));
+      }
+
+      if (result != DPL_SUCCESS) {
+        dpl_status_t expected = DPL_SUCCESS;
+        part_status.compare_exchange_strong(expected, result);
+        break;
+      }
+      etags[part] = etag;
+      free((void*)etag);
+    }
+  };
+
+  /* The calling thread already holds an upload connection, helpers only get
+   * the ones that are not used by other uploads of the device. */
+  uint32_t nr_helpers = AcquireExtraUploads(nr_parts - 1);
+  Dmsg4(100,
+        "Uploading chunk %s in %d parts using %d connections (upload id %s)\n",
+        chunk_name, nr_parts, nr_helpers + 1, upload_id);
+  for (uint32_t i = 0; i < nr_helpers; i++) {
+    uploaders.emplace_back(upload_parts);
+  }
+  upload_parts();
+  for (auto& uploader : uploaders) { uploader.join(); }
+  ReleaseUploads(nr_helpers);
+
+  status = part_status;
+  if (status != DPL_SUCCESS) {
+    Mmsg2(errmsg, T_("Failed to upload parts of %s: ERR=%s.\n"), chunk_name,
+          dpl_status_str(status));
+    dev_errno = DropletErrnoToSystemErrno(status);
+    goto bail_out;
+  }
+
+  parts = json_object_new_array();
+  for (auto& etag : etags) {
+    json_object_array_add(parts, json_object_new_string(etag.c_str()));
+  }
+
+  for (int tries = 0; tries < NUMBER_OF_RETRIES; tries++) {
+    if (tries > 0) { Bmicrosleep(INFLIGT_RETRY_TIME, 0); }
+    status = dpl_s3_stream_multipart_complete(ctx_, bucket.c_str(), chunk_name,
+                                              upload_id, parts, nr_parts, NULL,
+                                              &sysmd_);
+    if (status == DPL_SUCCESS) { break; }
+  }
+
+  if (status != DPL_SUCCESS) {
+    Mmsg2(errmsg, T_("Failed to complete multipart upload of %s: ERR=%s.\n"),
+          chunk_name, dpl_status_str(status));
+    dev_errno = DropletErrnoToSystemErrno(status);
+    goto bail_out;
+  }
+
+  retval = true;
+
+bail_out:
+  if (!retval) {
+    /* Don't leave the uploaded parts behind on the server. */
+    for (int tries = 0; tries < NUMBER_OF_RETRIES; tries++) {
+      if (tries > 0) { Bmicrosleep(INFLIGT_RETRY_TIME, 0); }
+      status = dpl_s3_stream_multipart_abort(ctx_, bucket.c_str(), chunk_name,
+                                             upload_id);
+      if (status == DPL_SUCCESS) { break; }
+    }
+    if (status == DPL_SUCCESS) {
+      Dmsg2(100, "Aborted multipart upload %s of %s\n", upload_id, chunk_name);
+    } else {
+      Dmsg3(100, "Failed to abort multipart upload %s of %s: %s\n", upload_id,
+            chunk_name, dpl_status_str(status));
+    }
+  }
+  if (parts) { json_object_put(parts); }
+  free((void*)upload_id);
+
+  return retval;
+}
+
 // Internal method for reading a chunk from the remote backing store.
 bool DropletDevice::ReadRemoteChunk(chunk_io_request* request)
 {
@@ -656,6 +866,94 @@ bail_out:
   return retval;
 }
 
+// Store the manifest of a volume next to its chunks.
+bool DropletDevice::FlushRemoteManifest(const char* volname,
+                                        const std::string& manifest)
+{
+  dpl_status_t status = DPL_FAILURE;
+  PoolMem manifest_name(PM_FNAME);
+
+  Mmsg(manifest_name, "/%s/manifest", volname);
+  Dmsg1(100, "Flushing manifest %s\n", manifest_name.c_str());
+
+  for (int tries = 0; tries < NUMBER_OF_RETRIES; tries++) {
+    if (manifest.empty()) {
+      status = dpl_unlink(ctx_, manifest_name.c_str());
+      if (status == DPL_ENOENT) { status = DPL_SUCCESS; }
+    } else {
+      dpl_sysmd_t* sysmd = dpl_sysmd_dup(&sysmd_);
+
+      status = dpl_fput(ctx_,                   /* context */
+                        manifest_name.c_str(),  /* locator */
+                        NULL,                   /* options */
+                        NULL,                   /* condition */
+                        NULL,                   /* range */
+                        NULL,                   /* metadata */
+                        sysmd,                  /* sysmd */
+                        (char*)manifest.data(), /* data_buf */
+                        manifest.size());       /* data_len */
+      dpl_sysmd_free(sysmd);
+    }
+    if (status == DPL_SUCCESS) { return true; }
+
+    Bmicrosleep(INFLIGT_RETRY_TIME, 0);
+  }
+
+  Mmsg2(errmsg, T_("Failed to flush %s: ERR=%s.\n"), manifest_name.c_str(),
+        dpl_status_str(status));
+  dev_errno = DropletErrnoToSystemErrno(status);
+
+  return false;
+}
+
+/*
+ * Read the manifest of a volume, a volume without a manifest gives an empty
+ * one.
+ */
+bool DropletDevice::ReadRemoteManifest(const char* volname,
+                                       std::string& manifest)
+{
+  dpl_status_t status = DPL_FAILURE;
+  PoolMem manifest_name(PM_FNAME);
+
+  Mmsg(manifest_name, "/%s/manifest", volname);
+  Dmsg1(100, "Reading manifest %s\n", manifest_name.c_str());
+
+  manifest.clear();
+  for (int tries = 0; tries < NUMBER_OF_RETRIES; tries++) {
+    char* data = NULL;
+    unsigned int data_len = 0;
+
+    status = dpl_fget(ctx_,                  /* context */
+                      manifest_name.c_str(), /* locator */
+                      NULL,                  /* options */
+                      NULL,                  /* condition */
+                      NULL,                  /* range */
+                      &data,                 /* data_bufp */
+                      &data_len,             /* data_lenp */
+                      NULL,                  /* metadatap */
+                      NULL);                 /* sysmdp */
+    switch (status) {
+      case DPL_SUCCESS:
+        manifest.assign(data, data_len);
+        free(data);
+        return true;
+      case DPL_ENOENT:
+        return true;
+      default:
+        if (data) { free(data); }
+        Bmicrosleep(INFLIGT_RETRY_TIME, 0);
+        break;
+    }
+  }
+
+  Mmsg2(errmsg, T_("Failed to read %s: ERR=%s.\n"), manifest_name.c_str(),
+        dpl_status_str(status));
+  dev_errno = DropletErrnoToSystemErrno(status);
+
+  return false;
+}
+
 /*
  * Internal method for truncating a chunked volume on the remote backing
  * store.
@@ -784,6 +1082,28 @@ bool DropletDevice::initialize()
               use_mmap_ = true;
               done = true;
               break;
+            case argument_partsize:
+              size_to_uint64(bp + device_options[i].compare_size, &value);
+              part_size_ = value;
+              if (part_size_ > 0 && part_size_ < min_part_size_) {
+                part_size_ = min_part_size_;
+              }
+              done = true;
+              break;
+            case argument_compression:
+              for (int j = 0; chunk_compressions[j].name; j++) {
+                if (Bstrcasecmp(bp + device_options[i].compare_size,
+                                chunk_compressions[j].name)) {
+                  chunk_compression_ = chunk_compressions[j].algorithm;
+                  done = true;
+                  break;
+                }
+              }
+              break;
+            case argument_manifest:
+              use_manifest_ = true;
+              done = true;
+              break;
             default:
               break;
           }
@@ -893,6 +1213,14 @@ bool DropletDevice::initialize()
       free(ctx_->cur_bucket);
       ctx_->cur_bucket = strdup(bucketname_);
     }
+
+    // Multipart uploads are only available with the S3 API.
+    if (part_size_ > 0 && !bstrcmp(dpl_get_backend_name(ctx_), "s3")) {
+      Emsg2(M_WARNING, 0,
+            T_("Device %s: partsize is ignored for the %s backend\n"),
+            prt_name, dpl_get_backend_name(ctx_));
+      part_size_ = 0;
+    }
   }
 
   return true;
@@ -934,6 +1262,7 @@ ssize_t DropletDevice::RemoteVolumeSize()
   ssize_t volumesize = 0;
   dpl_sysmd_t* sysmd = NULL;
   PoolMem chunk_dir(PM_FNAME);
+  std::map<uint16_t, ssize_t> chunk_sizes;
 
   Mmsg(chunk_dir, "/%s", getVolCatName());
 
@@ -945,12 +1274,26 @@ ssize_t DropletDevice::RemoteVolumeSize()
 
   Dmsg1(100, "get RemoteVolumeSize(%s)\n", getVolCatName());
   if (!ForEachChunkInDirectoryRunCallback(
-          chunk_dir.c_str(), chunked_volume_size_callback, &volumesize)) {
+          chunk_dir.c_str(), chunked_volume_size_callback, &chunk_sizes)) {
     /* errno is already set in ForEachChunkInDirectoryRunCallback */
     volumesize = -1;
     goto bail_out;
   }
 
+  /* Compressed chunks hold more data than the size of their objects, the
+   * manifest knows how much. */
+  for (auto& [chunk, size] : chunk_sizes) {
+    ssize_t chunk_size = ChunkSizeFromManifest(getVolCatName(), chunk, size);
+
+    if (chunk_size < 0) {
+      Emsg0(M_ERROR, 0, errmsg);
+      dev_errno = EINVAL;
+      volumesize = -1;
+      break;
+    }
+    volumesize += chunk_size;
+  }
+
 bail_out:
   if (sysmd) { dpl_sysmd_free(sysmd); }
 
@@ -2,7 +2,7 @@
    BAREOS® - Backup Archiving REcovery Open Sourced
 
    Copyright (C) 2014-2017 Planets Communications B.V.
-   Copyright (C) 2014-2022 Bareos GmbH & Co. KG
+   Copyright (C) 2014-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -31,6 +31,9 @@
 #include <droplet.h>
 #include <droplet/vfs.h>
 
+#include <condition_variable>
+#include <mutex>
+
 namespace storagedaemon {
 /*
  * Generic callback for the DropletDevice::walk_directory() function.
@@ -52,6 +55,10 @@ class DropletDevice : public ChunkedDevice {
  private:
   /* maximun number of chunks in a volume (0000 to 9999) */
   const int max_chunks_ = 10000;
+  /* all parts of a multipart upload but the last need at least 5 MiB */
+  const uint64_t min_part_size_ = 5 * 1024 * 1024;
+  /* maximum number of parallel uploads when there are no io-threads */
+  const uint32_t default_max_uploads_ = 4;
   char* configstring_{};
   const char* profile_{};
   const char* location_{};
@@ -60,9 +67,19 @@ class DropletDevice : public ChunkedDevice {
   const char* bucketname_{};
   dpl_ctx_t* ctx_{};
   dpl_sysmd_t sysmd_{};
+  uint64_t part_size_{};
+  std::mutex uploads_mutex_;
+  std::condition_variable uploads_changed_;
+  uint32_t active_uploads_{}; /* connections used by uploads, parts included */
 
   bool initialize();
+  uint32_t MaxUploads() const;
+  void AcquireUpload();
+  uint32_t AcquireExtraUploads(uint32_t wanted);
+  void ReleaseUploads(uint32_t count);
   dpl_status_t check_path(const char* path);
+  bool FlushRemoteChunkInParts(chunk_io_request* request,
+                               const char* chunk_name);
 
   // Interface from ChunkedDevice
   bool CheckRemoteConnection() override;
@@ -70,6 +87,9 @@ class DropletDevice : public ChunkedDevice {
   bool ReadRemoteChunk(chunk_io_request* request) override;
   ssize_t RemoteVolumeSize() override;
   bool TruncateRemoteVolume(DeviceControlRecord* dcr) override;
+  bool FlushRemoteManifest(const char* volname,
+                           const std::string& manifest) override;
+  bool ReadRemoteManifest(const char* volname, std::string& manifest) override;
   bool ForEachChunkInDirectoryRunCallback(const char* dirname,
                                           t_dpl_walk_chunks_call_back callback,
                                           void* data,
@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2012 Free Software Foundation Europe e.V.
    Copyright (C) 2014-2014 Planets Communications B.V.
-   Copyright (C) 2014-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2014-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -34,6 +34,7 @@
 #include "include/fcntl_def.h"
 #include "include/bareos.h"
 #include "stored/device_control_record.h"
+#include "stored/device_status_information.h"
 #include "stored/stored.h"
 #include "generic_tape_device.h"
 #include "stored/autochanger.h"
@@ -43,6 +44,8 @@
 
 namespace storagedaemon {
 
+generic_tape_device::~generic_tape_device() { close(nullptr); }
+
 // Open a tape device
 void generic_tape_device::OpenDevice(DeviceControlRecord* dcr, DeviceMode omode)
 {
@@ -1150,6 +1153,9 @@ char* generic_tape_device::StatusDev()
   SetBit(BMT_TAPE, status);
   Pmsg0(-20, T_(" Bareos status:"));
   Pmsg2(-20, T_(" file=%d block=%d\n"), file, block_num);
+  if (stream_buffer_) {
+    Pmsg1(-20, "%s", stream_buffer_->StatusString().c_str());
+  }
   if (d_ioctl(fd, MTIOCGET, (char*)&mt_stat) < 0) {
     BErrNo be;
 
@@ -1340,6 +1346,31 @@ bool generic_tape_device::UnmountBackend(DeviceControlRecord* dcr, int timeout)
   return retval;
 }
 
+// Return specific device status information.
+bool generic_tape_device::DeviceStatus(DeviceStatusInformation* dst)
+{
+  if (!stream_buffer_) { return false; }
+
+  dst->status_length
+      = PmStrcpy(dst->status, stream_buffer_->StatusString().c_str());
+
+  return true;
+}
+
+/**
+ * Write out the blocks held back by the streaming buffer. This has to happen
+ * before the drive gets positioned, is read from or gets closed.
+ *
+ * Returns: true  on success
+ *          false when the drive failed to take a buffered block
+ */
+bool generic_tape_device::FlushStreamBuffer()
+{
+  if (!stream_buffer_) { return true; }
+
+  return stream_buffer_->Flush();
+}
+
 int generic_tape_device::d_open(const char* pathname, int flags, int mode)
 {
   return ::open(pathname, flags, mode);
@@ -1347,15 +1378,47 @@ int generic_tape_device::d_open(const char* pathname, int flags, int mode)
 
 ssize_t generic_tape_device::d_read(int fd, void* buffer, size_t count)
 {
+  if (!FlushStreamBuffer()) { return -1; }
+
   return ::read(fd, buffer, count);
 }
 
 ssize_t generic_tape_device::d_write(int fd, const void* buffer, size_t count)
 {
+  if (device_resource && device_resource->tape_streaming_buffer_size > 0) {
+    if (!stream_buffer_) {
+      Dmsg1(100, "Using streaming buffer on %s\n", prt_name);
+      stream_buffer_ = std::make_unique<TapeStreamBuffer>(
+          device_resource->tape_streaming_buffer_size,
+          device_resource->tape_streaming_high_watermark,
+          device_resource->tape_streaming_low_watermark,
+          [](int wfd, const void* data, std::size_t len) {
+            return ::write(wfd, data, len);
+          });
+    }
+    return stream_buffer_->Write(fd, buffer, count);
+  }
+
   return ::write(fd, buffer, count);
 }
 
-int generic_tape_device::d_close(int fd) { return ::close(fd); }
+int generic_tape_device::d_close(int fd)
+{
+  bool flushed = true;
+
+  if (stream_buffer_) {
+    flushed = stream_buffer_->Flush();
+    stream_buffer_->Discard();
+  }
+
+  int status = ::close(fd);
+  if (!flushed) {
+    errno = EIO;
+    return -1;
+  }
+
+  return status;
+}
 
 int generic_tape_device::d_ioctl(int, ioctl_req_t, char*) { return -1; }
 
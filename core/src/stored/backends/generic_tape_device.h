@@ -2,7 +2,7 @@
    BAREOS® - Backup Archiving REcovery Open Sourced
 
    Copyright (C) 2014-2014 Planets Communications B.V.
-   Copyright (C) 2014-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2014-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -28,14 +28,17 @@
 #ifndef BAREOS_STORED_BACKENDS_GENERIC_TAPE_DEVICE_H_
 #define BAREOS_STORED_BACKENDS_GENERIC_TAPE_DEVICE_H_
 
+#include <memory>
+
 #include "stored/dev.h"
+#include "stored/backends/tape_stream_buffer.h"
 
 namespace storagedaemon {
 
 class generic_tape_device : public Device {
  public:
   generic_tape_device() = default;
-  virtual ~generic_tape_device() { close(nullptr); }
+  virtual ~generic_tape_device();
 
   // Interface from Device
   virtual SeekMode GetSeekMode() const override { return SeekMode::FILE_BLOCK; }
@@ -64,6 +67,7 @@ class generic_tape_device : public Device {
                           uint32_t rblock) override;
   virtual bool MountBackend(DeviceControlRecord* dcr, int timeout) override;
   virtual bool UnmountBackend(DeviceControlRecord* dcr, int timeout) override;
+  virtual bool DeviceStatus(DeviceStatusInformation* dst) override;
   virtual int d_close(int) override;
   virtual int d_open(const char* pathname, int flags, int mode) override;
   virtual int d_ioctl(int fd, ioctl_req_t request, char* mt = NULL) override;
@@ -74,10 +78,15 @@ class generic_tape_device : public Device {
   virtual ssize_t d_write(int fd, const void* buffer, size_t count) override;
   virtual bool d_truncate(DeviceControlRecord* dcr) override;
 
+ protected:
+  bool FlushStreamBuffer();
+
  private:
   bool do_mount(DeviceControlRecord* dcr, int mount, int dotimeout);
   void OsClrError();
   void HandleError(int func);
+
+  std::unique_ptr<TapeStreamBuffer> stream_buffer_;
 };
 
 } /* namespace storagedaemon */
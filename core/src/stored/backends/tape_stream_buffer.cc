@@ -0,0 +1,314 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * In-memory write-behind buffer that feeds a tape drive in full speed bursts.
+ */
+
+#include "include/bareos.h"
+#include "lib/edit.h"
+#include "tape_stream_buffer.h"
+
+#include <cerrno>
+#include <cstring>
+
+namespace storagedaemon {
+
+TapeStreamBuffer::TapeStreamBuffer(std::size_t size,
+                                   uint32_t high_watermark,
+                                   uint32_t low_watermark,
+                                   WriteFunction write_function)
+    : size_(size)
+    , high_bytes_(size / 100 * high_watermark)
+    , low_bytes_(size / 100 * low_watermark)
+    , write_function_(std::move(write_function))
+    , buffer_(std::make_unique<char[]>(size))
+{
+  stats_.size = size_;
+  writer_ = std::thread(&TapeStreamBuffer::WriterThread, this);
+}
+
+TapeStreamBuffer::~TapeStreamBuffer()
+{
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    quit_ = true;
+  }
+  cond_.notify_all();
+  writer_.join();
+}
+
+/**
+ * Find room for count bytes behind the last queued block. Blocks are never
+ * split, so when the end of the buffer is too small the block goes to the
+ * start of the buffer, provided the drive already took the blocks there.
+ */
+bool TapeStreamBuffer::Allocate(std::size_t count, std::size_t& offset) const
+{
+  if (entries_.empty()) {
+    offset = 0;
+    return count <= size_;
+  }
+
+  std::size_t head = entries_.front().offset;
+  std::size_t tail = entries_.back().offset + entries_.back().length;
+
+  if (tail > head) {
+    if (size_ - tail >= count) {
+      offset = tail;
+      return true;
+    }
+    if (head >= count) {
+      offset = 0;
+      return true;
+    }
+    return false;
+  }
+
+  if (head - tail >= count) {
+    offset = tail;
+    return true;
+  }
+  return false;
+}
+
+bool TapeStreamBuffer::ShouldDrain() const
+{
+  if (entries_.empty() || error_) { return false; }
+
+  return draining_ || flush_waiters_ > 0 || producer_waiting_
+         || buffered_ >= high_bytes_;
+}
+
+ssize_t TapeStreamBuffer::Write(int fd, const void* data, std::size_t count)
+{
+  if (count == 0) { return 0; }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (error_) {
+    errno = error_;
+    return -1;
+  }
+  if (early_warning_) {
+    early_warning_ = false;
+    errno = ENOSPC;
+    return -1;
+  }
+
+  if (count > size_) {
+    // Too big to be buffered, write it directly after the queued blocks.
+    flush_waiters_++;
+    cond_.notify_all();
+    cond_.wait(lock, [this] { return entries_.empty() || error_; });
+    flush_waiters_--;
+    if (error_) {
+      errno = error_;
+      return -1;
+    }
+    if (early_warning_) {
+      early_warning_ = false;
+      errno = ENOSPC;
+      return -1;
+    }
+    lock.unlock();
+    return write_function_(fd, data, count);
+  }
+
+  std::size_t offset;
+  if (!Allocate(count, offset)) {
+    stats_.producer_stalls++;
+    producer_waiting_ = true;
+    cond_.notify_all();
+    cond_.wait(lock, [&] { return error_ || Allocate(count, offset); });
+    producer_waiting_ = false;
+    if (error_) {
+      errno = error_;
+      return -1;
+    }
+  }
+
+  /* Only this thread adds blocks, the writer thread can only free up more
+   * space in the meantime. */
+  lock.unlock();
+  memcpy(buffer_.get() + offset, data, count);
+  lock.lock();
+
+  entries_.push_back(Entry{fd, offset, count});
+  buffered_ += count;
+  if (buffered_ > stats_.peak_buffered) { stats_.peak_buffered = buffered_; }
+  if (ShouldDrain()) { cond_.notify_all(); }
+
+  return count;
+}
+
+bool TapeStreamBuffer::Flush()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  flush_waiters_++;
+  cond_.notify_all();
+  cond_.wait(lock, [this] { return entries_.empty() || error_; });
+  flush_waiters_--;
+
+  if (error_) {
+    errno = EIO;
+    return false;
+  }
+  return true;
+}
+
+void TapeStreamBuffer::Discard()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  cond_.wait(lock, [this] { return !writing_; });
+  entries_.clear();
+  buffered_ = 0;
+  draining_ = false;
+  early_warning_ = false;
+  error_ = 0;
+  cond_.notify_all();
+}
+
+bool TapeStreamBuffer::Empty()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  return entries_.empty();
+}
+
+TapeStreamBuffer::Statistics TapeStreamBuffer::GetStatistics()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  Statistics stats = stats_;
+
+  stats.buffered = buffered_;
+  return stats;
+}
+
+std::string TapeStreamBuffer::StatusString()
+{
+  Statistics stats = GetStatistics();
+  char ed1[50], ed2[50], ed3[50], ed4[50], ed5[50];
+  PoolMem status(PM_MESSAGE);
+  uint64_t busy_usecs = stats.drive_busy.count();
+  uint64_t rate = 0;
+
+  if (busy_usecs > 0) { rate = stats.bytes_written * 1000000 / busy_usecs; }
+
+  status.bsprintf(
+      T_("    Streaming buffer: %sB of %sB used (peak %sB), %s drive starts, "
+         "%s stalls\n"),
+      edit_uint64_with_suffix(stats.buffered, ed1),
+      edit_uint64_with_suffix(stats.size, ed2),
+      edit_uint64_with_suffix(stats.peak_buffered, ed3),
+      edit_uint64_with_commas(stats.drive_starts, ed4),
+      edit_uint64_with_commas(stats.producer_stalls, ed5));
+  std::string result = status.c_str();
+
+  status.bsprintf(T_("    Streaming rate: %sB written at %sB/s\n"),
+                  edit_uint64_with_suffix(stats.bytes_written, ed1),
+                  edit_uint64_with_suffix(rate, ed2));
+  result += status.c_str();
+
+  return result;
+}
+
+/**
+ * Write the oldest queued block, called with the mutex locked. The block
+ * stays queued while it is written, so its space cannot be reused.
+ */
+void TapeStreamBuffer::WriteEntry(std::unique_lock<std::mutex>& lock,
+                                  const Entry& entry)
+{
+  bool early_warning = false;
+  int retry = 0;
+  ssize_t status;
+  int saved_errno;
+
+  writing_ = true;
+  lock.unlock();
+
+  auto start = std::chrono::steady_clock::now();
+  for (;;) {
+    status = write_function_(entry.fd, buffer_.get() + entry.offset,
+                             entry.length);
+    if (status == -1 && errno == EBUSY && retry++ < 3) {
+      std::this_thread::sleep_for(std::chrono::seconds(5));
+      continue;
+    }
+    if (status == -1 && errno == ENOSPC && !early_warning) {
+      /* The driver reports the early warning once and accepts the next
+       * write, so the blocks already queued still end up on this volume. */
+      early_warning = true;
+      continue;
+    }
+    break;
+  }
+  saved_errno = errno;
+  auto busy = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start);
+
+  lock.lock();
+  writing_ = false;
+  stats_.drive_busy += busy;
+  if (status == static_cast<ssize_t>(entry.length)) {
+    stats_.bytes_written += entry.length;
+    stats_.blocks_written++;
+    if (early_warning) { early_warning_ = true; }
+  } else if (status == -1 && saved_errno == ENOSPC) {
+    /* Refused again after the early warning, this block and the ones queued
+     * behind it are lost. Reporting that as the end of the medium would let
+     * the job continue on the next volume without them. */
+    error_ = EIO;
+  } else {
+    error_ = (status == -1 && saved_errno != 0) ? saved_errno : EIO;
+  }
+  entries_.pop_front();
+  buffered_ -= entry.length;
+}
+
+void TapeStreamBuffer::WriterThread()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  for (;;) {
+    cond_.wait(lock, [this] { return quit_ || ShouldDrain(); });
+    if (quit_) { break; }
+
+    if (!draining_) {
+      draining_ = true;
+      stats_.drive_starts++;
+    }
+
+    Entry entry = entries_.front();
+    WriteEntry(lock, entry);
+
+    if (entries_.empty()
+        || (buffered_ <= low_bytes_ && flush_waiters_ == 0
+            && !producer_waiting_)) {
+      draining_ = false;
+    }
+    cond_.notify_all();
+  }
+}
+
+} /* namespace storagedaemon */
@@ -0,0 +1,146 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * In-memory write-behind buffer that feeds a tape drive in full speed bursts.
+ */
+
+#ifndef BAREOS_STORED_BACKENDS_TAPE_STREAM_BUFFER_H_
+#define BAREOS_STORED_BACKENDS_TAPE_STREAM_BUFFER_H_
+
+#include <sys/types.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace storagedaemon {
+
+/**
+ * Ring buffer of tape blocks that is drained to the drive by its own thread.
+ *
+ * The drive is only started once the buffer is filled up to the high
+ * watermark and then written to until the fill level drops to the low
+ * watermark, so a slow producer makes the drive pause between long bursts
+ * instead of making it stop and reposition after every block.
+ *
+ * Every block is handed to the write function in one piece and in the order
+ * it was queued, so the block layout on tape is the same as without the
+ * buffer. As the caller already accounted for a queued block, errors can only
+ * be reported afterwards:
+ *  - ENOSPC (early warning end of medium) is handled by writing the block
+ *    again, as tape drivers allow writing past the early warning once it got
+ *    reported. The following Write() then fails with ENOSPC, so the volume
+ *    gets terminated after the blocks already queued. When the drive refuses
+ *    the block again, it is treated as an EIO error.
+ *  - Any other error is sticky: Write() and Flush() fail until Discard() is
+ *    called, so the volume cannot be closed as if nothing happened.
+ */
+class TapeStreamBuffer {
+ public:
+  using WriteFunction
+      = std::function<ssize_t(int fd, const void* data, std::size_t count)>;
+
+  struct Statistics {
+    std::size_t size{0};          /**< Capacity of the buffer */
+    std::size_t buffered{0};      /**< Bytes currently waiting for the drive */
+    std::size_t peak_buffered{0}; /**< Highest fill level seen */
+    uint64_t bytes_written{0};    /**< Bytes written to the drive */
+    uint64_t blocks_written{0};   /**< Blocks written to the drive */
+    uint64_t drive_starts{0};     /**< Number of bursts started */
+    uint64_t producer_stalls{0};  /**< Times a writer waited for space */
+    std::chrono::microseconds drive_busy{0}; /**< Time spent in write() */
+  };
+
+  TapeStreamBuffer(std::size_t size,
+                   uint32_t high_watermark,
+                   uint32_t low_watermark,
+                   WriteFunction write_function);
+  ~TapeStreamBuffer();
+
+  TapeStreamBuffer(const TapeStreamBuffer&) = delete;
+  TapeStreamBuffer& operator=(const TapeStreamBuffer&) = delete;
+
+  /**
+   * Queue one block for fd. Returns count on success, -1 with errno set when
+   * an earlier write failed or the drive reported the end of the medium.
+   */
+  ssize_t Write(int fd, const void* data, std::size_t count);
+
+  /**
+   * Wait until all queued blocks are written. Returns false with errno set
+   * to EIO when the drive failed to take a queued block.
+   */
+  bool Flush();
+
+  /**
+   * Drop everything still queued and forget about previous errors, used when
+   * the device gets closed.
+   */
+  void Discard();
+
+  bool Empty();
+  Statistics GetStatistics();
+  std::string StatusString();
+
+ private:
+  struct Entry {
+    int fd;
+    std::size_t offset;
+    std::size_t length;
+  };
+
+  bool Allocate(std::size_t count, std::size_t& offset) const;
+  bool ShouldDrain() const;
+  void WriterThread();
+  void WriteEntry(std::unique_lock<std::mutex>& lock, const Entry& entry);
+
+  const std::size_t size_;
+  const std::size_t high_bytes_;
+  const std::size_t low_bytes_;
+  WriteFunction write_function_;
+  std::unique_ptr<char[]> buffer_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<Entry> entries_;
+  std::size_t buffered_{0};
+  bool draining_{false};
+  bool writing_{false};
+  bool producer_waiting_{false};
+  int flush_waiters_{0};
+  bool early_warning_{false};
+  int error_{0};
+  bool quit_{false};
+  Statistics stats_;
+  std::thread writer_;
+};
+
+} /* namespace storagedaemon */
+
+#endif  // BAREOS_STORED_BACKENDS_TAPE_STREAM_BUFFER_H_
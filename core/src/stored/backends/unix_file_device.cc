@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2012 Free Software Foundation Europe e.V.
    Copyright (C) 2013-2013 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -30,6 +30,10 @@
  */
 
 #include <unistd.h>
+#if defined(HAVE_LINUX_OS)
+#  include <sys/ioctl.h>
+#  include <linux/fs.h>
+#endif
 
 #include "include/fcntl_def.h"
 #include "include/bareos.h"
@@ -216,6 +220,7 @@ bool unix_file_device::ScanForVolumeImpl(DeviceControlRecord* dcr)
 
 int unix_file_device::d_open(const char* pathname, int flags, int mode)
 {
+  clone_alignment_ = 0;
   return ::open(pathname, flags, mode);
 }
 
@@ -229,6 +234,174 @@ ssize_t unix_file_device::d_write(int fd, const void* buffer, size_t count)
   return ::write(fd, buffer, count);
 }
 
+/**
+ * Return the filesystem block size of the open volume when the data of other
+ * volumes can be shared with it, 0 when we cannot do that.
+ */
+uint32_t unix_file_device::CloneAlignment()
+{
+#if defined(FICLONERANGE) || defined(HAVE_COPY_FILE_RANGE)
+  if (fd < 0 || (!reflink_supported_ && !copy_range_supported_)) { return 0; }
+
+  if (clone_alignment_ == 0) {
+    struct stat st;
+
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_blksize > 0) {
+      clone_alignment_ = st.st_blksize;
+    }
+  }
+
+  return clone_alignment_;
+#else
+  return 0;
+#endif
+}
+
+/* Let the kernel share or copy length bytes from one volume to the other.
+ * Sets shared when the data is shared with the source volume rather than
+ * copied. */
+bool unix_file_device::CloneRange([[maybe_unused]] int src_fd,
+                                  [[maybe_unused]] uint64_t src_offset,
+                                  [[maybe_unused]] int dst_fd,
+                                  [[maybe_unused]] uint64_t dst_offset,
+                                  [[maybe_unused]] uint64_t length,
+                                  bool& shared)
+{
+  shared = false;
+#if defined(FICLONERANGE)
+  if (reflink_supported_) {
+    struct file_clone_range range;
+
+    range.src_fd = src_fd;
+    range.src_offset = src_offset;
+    range.src_length = length;
+    range.dest_offset = dst_offset;
+    if (ioctl(dst_fd, FICLONERANGE, &range) == 0) {
+      shared = true;
+      return true;
+    }
+
+    switch (errno) {
+      case EOPNOTSUPP:
+      case EXDEV:
+      case ENOTTY:
+      case EINVAL:
+        Dmsg1(100, "Disabling reflinks on device %s\n", print_name());
+        reflink_supported_ = false;
+        break;
+      default:
+        break;
+    }
+  }
+#endif
+
+#if defined(HAVE_COPY_FILE_RANGE)
+  if (copy_range_supported_) {
+    loff_t src_off = src_offset;
+    loff_t dst_off = dst_offset;
+
+    while (length > 0) {
+      ssize_t status
+          = copy_file_range(src_fd, &src_off, dst_fd, &dst_off, length, 0);
+
+      if (status <= 0) {
+        if (status < 0
+            && (errno == EXDEV || errno == ENOSYS || errno == EOPNOTSUPP)) {
+          Dmsg1(100, "Disabling copy_file_range on device %s\n",
+                print_name());
+          copy_range_supported_ = false;
+        }
+        return false;
+      }
+      length -= status;
+    }
+
+    return true;
+  }
+#endif
+
+  return false;
+}
+
+static bool PwriteAll(int fd, const char* buffer, size_t count, off_t offset)
+{
+  while (count > 0) {
+    ssize_t status = ::pwrite(fd, buffer, count, offset);
+
+    if (status < 0) {
+      if (errno == EINTR) { continue; }
+      return false;
+    }
+    buffer += status;
+    count -= status;
+    offset += status;
+  }
+
+  return true;
+}
+
+/**
+ * Write a block of which parts are still unchanged on another volume. Those
+ * parts that start at the same offset within a filesystem block as on the
+ * source volume get cloned, everything else is written as usual. As the data
+ * in the buffer is identical to what we clone, we can always fall back to
+ * writing it.
+ */
+ssize_t unix_file_device::d_write_cloned(int fd,
+                                         const void* buffer,
+                                         size_t count,
+                                         const BlockCloneExtent* extents,
+                                         int num_extents,
+                                         uint64_t& cloned,
+                                         uint64_t& copied)
+{
+  const char* buf = static_cast<const char*>(buffer);
+  uint32_t align = CloneAlignment();
+  off_t base;
+  size_t done = 0;
+
+  cloned = 0;
+  copied = 0;
+  if (align == 0 || (base = ::lseek(fd, 0, SEEK_CUR)) < 0) {
+    return ::write(fd, buffer, count);
+  }
+
+  for (int i = 0; i < num_extents; i++) {
+    const BlockCloneExtent& extent = extents[i];
+    uint64_t dst = base + extent.offset;
+
+    if (dst % align != extent.src_addr % align) { continue; }
+    if (extent.offset < done || extent.offset + extent.length > count) {
+      continue;
+    }
+
+    uint64_t start = (dst + align - 1) / align * align;
+    uint64_t end = (dst + extent.length) / align * align;
+    if (end <= start) { continue; }
+
+    if (!PwriteAll(fd, buf + done, (start - base) - done, base + done)) {
+      return -1;
+    }
+    done = start - base;
+
+    bool shared;
+    if (CloneRange(extent.src_fd, extent.src_addr + (start - dst), fd, start,
+                   end - start, shared)) {
+      if (shared) {
+        cloned += end - start;
+      } else {
+        copied += end - start;
+      }
+      done = end - base;
+    }
+  }
+
+  if (!PwriteAll(fd, buf + done, count - done, base + done)) { return -1; }
+  if (::lseek(fd, base + count, SEEK_SET) < 0) { return -1; }
+
+  return count;
+}
+
 int unix_file_device::d_close(int fd) { return ::close(fd); }
 
 int unix_file_device::d_ioctl(int, ioctl_req_t, char*) { return -1; }
@@ -2,7 +2,7 @@
    BAREOS® - Backup Archiving REcovery Open Sourced
 
    Copyright (C) 2013-2013 Planets Communications B.V.
-   Copyright (C) 2013-2022 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -52,6 +52,26 @@ class unix_file_device : public Device {
   ssize_t d_read(int fd, void* buffer, size_t count) override;
   ssize_t d_write(int fd, const void* buffer, size_t count) override;
   bool d_truncate(DeviceControlRecord* dcr) override;
+  uint32_t CloneAlignment() override;
+  ssize_t d_write_cloned(int fd,
+                         const void* buffer,
+                         size_t count,
+                         const BlockCloneExtent* extents,
+                         int num_extents,
+                         uint64_t& cloned,
+                         uint64_t& copied) override;
+
+ private:
+  bool CloneRange(int src_fd,
+                  uint64_t src_offset,
+                  int dst_fd,
+                  uint64_t dst_offset,
+                  uint64_t length,
+                  bool& shared);
+
+  uint32_t clone_alignment_{0};
+  bool reflink_supported_{true};
+  bool copy_range_supported_{true};
 };
 
 } /* namespace storagedaemon */
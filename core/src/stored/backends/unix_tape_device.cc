@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2012 Free Software Foundation Europe e.V.
    Copyright (C) 2013-2013 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -65,6 +65,8 @@ static std::vector<std::size_t> bufsizes(std::size_t count)
 
 int unix_tape_device::d_ioctl(int fd, ioctl_req_t request, char* op)
 {
+  if (!FlushStreamBuffer()) { return -1; }
+
   return ::ioctl(fd, request, op);
 }
 
@@ -75,6 +77,8 @@ unix_tape_device::unix_tape_device()
 
 ssize_t unix_tape_device::d_read(int fd, void* buffer, size_t count)
 {
+  if (!FlushStreamBuffer()) { return -1; }
+
   ssize_t ret = ::read(fd, buffer, count);
   /* If the driver fails to `read()` with `ENOMEM`, then the provided buffer
    * was too small. By re-reading with a temporary buffer that is enlarged
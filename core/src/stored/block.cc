@@ -3,7 +3,7 @@
 
    Copyright (C) 2001-2012 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -190,6 +190,7 @@ void EmptyBlock(DeviceBlock* block)
   block->write_failed = false;
   block->block_read = false;
   block->FirstIndex = block->LastIndex = 0;
+  block->num_clone_extents = 0;
 }
 
 /**
@@ -553,6 +554,28 @@ static const bool no_tape_write_test = false;
  * Returns: true  on success or EOT
  *          false on hard error
  */
+/**
+ * Forget about clone extents whose source volume is no longer open or which
+ * are not part of what is going to be written.
+ */
+static void DropStaleCloneExtents(DeviceBlock* block, uint32_t wlen)
+{
+  int valid = 0;
+
+  for (int i = 0; i < block->num_clone_extents; i++) {
+    const BlockCloneExtent& extent = block->clone_extents[i];
+
+    if (extent.src_dev->fd != extent.src_fd
+        || extent.src_dev->open_generation != extent.src_generation
+        || extent.offset + extent.length > wlen) {
+      Dmsg1(250, "Dropping stale clone extent at offset %u\n", extent.offset);
+      continue;
+    }
+    block->clone_extents[valid++] = extent;
+  }
+  block->num_clone_extents = valid;
+}
+
 bool DeviceControlRecord::WriteBlockToDev()
 {
   ssize_t status = 0;
@@ -702,6 +725,8 @@ bool DeviceControlRecord::WriteBlockToDev()
   }
 #endif
 
+  if (block->num_clone_extents > 0) { DropStaleCloneExtents(block, wlen); }
+
   /* Do write here,
    * make a somewhat feeble attempt to recover
    * from the OS telling us it is busy. */
@@ -716,7 +741,12 @@ bool DeviceControlRecord::WriteBlockToDev()
       Bmicrosleep(5, 0); /* pause a bit if busy or lots of errors */
       dev->clrerror(-1);
     }
-    status = dev->write(block->buf, (size_t)wlen);
+    if (block->num_clone_extents > 0) {
+      status = dev->WriteCloned(block->buf, (size_t)wlen, block->clone_extents,
+                                block->num_clone_extents);
+    } else {
+      status = dev->write(block->buf, (size_t)wlen);
+    }
   } while (status == -1 && (errno == EBUSY) && retry++ < 3);
 
   if (debug_block_checksum) {
@@ -987,6 +1017,15 @@ reread:
       Bmicrosleep(10, 0); /* pause a bit if busy or lots of errors */
       dev->clrerror(-1);
     }
+    if (track_rec_source) {
+      boffset_t pos = dev->d_lseek(dcr, (boffset_t)0, SEEK_CUR);
+
+      block->read_addr_valid = (pos >= 0);
+      block->read_addr = (uint64_t)pos;
+      block->read_generation = dev->open_generation;
+    } else {
+      block->read_addr_valid = false;
+    }
     status = dev->read(block->buf, (size_t)block->buf_len);
 
   } while (status == -1 && (errno == EBUSY || errno == EINTR || errno == EIO)
@@ -2,7 +2,7 @@
    BAREOS® - Backup Archiving REcovery Open Sourced
 
    Copyright (C) 2000-2012 Free Software Foundation Europe e.V.
-   Copyright (C) 2016-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2016-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -73,6 +73,22 @@ class Device; /* for forward reference */
    uint32_t VolSessionTime;
  */
 
+// Maximum number of cloneable ranges tracked per block.
+#define MAX_BLOCK_CLONE_EXTENTS 64
+
+/**
+ * Range of a block being written that is a verbatim copy of data on
+ * another volume, so it can be cloned instead of being written.
+ */
+struct BlockCloneExtent {
+  uint32_t offset;         /* offset into the block buffer */
+  uint32_t length;         /* number of bytes */
+  Device* src_dev;         /* device the data was read from */
+  int src_fd;              /* file descriptor the data was read from */
+  uint32_t src_generation; /* open generation of src_dev */
+  uint64_t src_addr;       /* byte address on the source volume */
+};
+
 /**
  * DeviceBlock for reading and writing blocks.
  * This is the basic unit that is written to the device, and
@@ -104,6 +120,13 @@ struct DeviceBlock {
   int32_t LastIndex;       /* last index this block */
   char* bufp;              /* pointer into buffer */
   POOLMEM* buf;            /* actual data buffer */
+  /* Where the block was read from, when tracked for block cloning */
+  bool read_addr_valid;    /* set when read_addr is valid */
+  uint64_t read_addr;      /* byte address the block was read from */
+  uint32_t read_generation; /* open generation of the device read from */
+  /* Ranges that can be cloned when writing this block */
+  int num_clone_extents;
+  BlockCloneExtent clone_extents[MAX_BLOCK_CLONE_EXTENTS];
 };
 
 inline uint32_t BlockWriteNavail(DeviceBlock* block)
@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2012 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -473,6 +473,9 @@ static void GetSessionRecord(Device* dev,
     case EOB_LABEL:
       rtype = T_("End of object");
       break;
+    case FILL_LABEL:
+      rtype = T_("Fill");
+      break;
     default:
       rtype = T_("Unknown");
       Dmsg1(10, "FI rtype=%d unknown\n", rec->FileIndex);
@@ -2,7 +2,7 @@
    BAREOS® - Backup Archiving REcovery Open Sourced
 
    Copyright (C) 2002-2010 Free Software Foundation Europe e.V.
-   Copyright (C) 2016-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2016-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -175,7 +175,7 @@ static int MatchFileregex(BootStrapRecord* bsr,
     bsr->skip_file = false;
     if (UnpackAttributesRecord(jcr, rec->Stream, rec->data, rec->data_len,
                                bsr->attr)) {
-      if (regexec(bsr->fileregex_re, bsr->attr->fname, 0, NULL, 0) == 0) {
+      if (bsr->fileregex_re->Search(bsr->attr->fname)) {
         Dmsg2(dbglevel, "Matched pattern, fname=%s FI=%d\n", bsr->attr->fname,
               rec->FileIndex);
       } else {
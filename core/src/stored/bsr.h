@@ -3,7 +3,7 @@
 
    Copyright (C) 2002-2008 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -28,12 +28,8 @@
 #ifndef BAREOS_STORED_BSR_H_
 #define BAREOS_STORED_BSR_H_
 
-#ifndef HAVE_REGEX_H
-#  include "lib/bregex.h"
-#else
-#  include <regex.h>
-#endif
 #include "lib/attr.h"
+#include "lib/regex_set.h"
 
 namespace storagedaemon {
 
@@ -166,7 +162,7 @@ struct BootStrapRecord {
   BsrJoblevel* JobLevel;
   BsrStream* stream;
   char* fileregex; /* set if restore is filtered on filename */
-  regex_t* fileregex_re;
+  RegexSet* fileregex_re;
   Attributes* attr; /* scratch space for unpacking */
 };
 
@@ -0,0 +1,119 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Scheduling of concurrent operations on one autochanger.
+ */
+
+#include "include/bareos.h"
+#include "stored/changer_scheduler.h"
+
+#include <algorithm>
+
+namespace storagedaemon {
+
+ChangerOperation ChangerOperation::Drive(drive_number_t drive,
+                                         slot_number_t slot1,
+                                         slot_number_t slot2)
+{
+  ChangerOperation operation;
+
+  operation.exclusive = false;
+  operation.drives.push_back(drive);
+  if (IsSlotNumberValid(slot1)) { operation.slots.push_back(slot1); }
+  if (IsSlotNumberValid(slot2) && slot2 != slot1) {
+    operation.slots.push_back(slot2);
+  }
+
+  return operation;
+}
+
+template <typename T>
+static bool Intersects(const std::vector<T>& a, const std::vector<T>& b)
+{
+  return std::any_of(a.begin(), a.end(), [&b](const T& value) {
+    return std::find(b.begin(), b.end(), value) != b.end();
+  });
+}
+
+ChangerOperationScheduler::ChangerOperationScheduler(
+    uint32_t max_concurrent_operations)
+    : max_concurrent_operations_(std::max(max_concurrent_operations, 1u))
+{
+}
+
+bool ChangerOperationScheduler::Conflicts(
+    const ChangerOperation& operation) const
+{
+  if (operation.exclusive) { return !holders_.empty(); }
+
+  // Waiting exclusive operations go first, so they cannot starve.
+  if (exclusive_waiting_ > 0) { return true; }
+  if (holders_.size() >= max_concurrent_operations_) { return true; }
+
+  for (auto& [id, holder] : holders_) {
+    if (holder.operation.exclusive
+        || Intersects(holder.operation.drives, operation.drives)
+        || Intersects(holder.operation.slots, operation.slots)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void ChangerOperationScheduler::Acquire(const ChangerOperation& operation)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto self = std::this_thread::get_id();
+
+  if (auto held = holders_.find(self); held != holders_.end()) {
+    held->second.depth++;
+    return;
+  }
+
+  if (operation.exclusive) { exclusive_waiting_++; }
+  cond_.wait(lock, [this, &operation] { return !Conflicts(operation); });
+  if (operation.exclusive) { exclusive_waiting_--; }
+
+  holders_[self] = Holder{operation, 1};
+}
+
+void ChangerOperationScheduler::Release()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto held = holders_.find(std::this_thread::get_id());
+
+  ASSERT(held != holders_.end());
+  if (--held->second.depth > 0) { return; }
+
+  holders_.erase(held);
+  cond_.notify_all();
+}
+
+int ChangerOperationScheduler::ActiveOperations()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  return holders_.size();
+}
+
+} /* namespace storagedaemon */
@@ -0,0 +1,94 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Scheduling of concurrent operations on one autochanger.
+ */
+
+#ifndef BAREOS_STORED_CHANGER_SCHEDULER_H_
+#define BAREOS_STORED_CHANGER_SCHEDULER_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "include/baconfig.h"
+
+namespace storagedaemon {
+
+/**
+ * The drives and slots a changer operation works on. An exclusive operation
+ * has the whole changer to itself, like listing or transferring volumes.
+ */
+struct ChangerOperation {
+  std::vector<drive_number_t> drives;
+  std::vector<slot_number_t> slots;
+  bool exclusive{true};
+
+  static ChangerOperation Exclusive() { return ChangerOperation{}; }
+  static ChangerOperation Drive(drive_number_t drive,
+                                slot_number_t slot1 = 0,
+                                slot_number_t slot2 = 0);
+};
+
+/**
+ * Lets up to max_concurrent_operations changer operations run at the same
+ * time, as long as they do not share a drive or a slot. With a maximum of one
+ * this is the plain changer lock.
+ *
+ * Like the rwlock it replaces, an operation can be acquired again by the
+ * thread that already holds one, which is then covered by the outer
+ * operation.
+ */
+class ChangerOperationScheduler {
+ public:
+  explicit ChangerOperationScheduler(uint32_t max_concurrent_operations);
+
+  void Acquire(const ChangerOperation& operation);
+  void Release();
+
+  uint32_t MaxConcurrentOperations() const
+  {
+    return max_concurrent_operations_;
+  }
+  int ActiveOperations();
+
+ private:
+  struct Holder {
+    ChangerOperation operation;
+    int depth{0};
+  };
+
+  bool Conflicts(const ChangerOperation& operation) const;
+
+  const uint32_t max_concurrent_operations_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::map<std::thread::id, Holder> holders_;
+  int exclusive_waiting_{0};
+};
+
+} /* namespace storagedaemon */
+
+#endif  // BAREOS_STORED_CHANGER_SCHEDULER_H_
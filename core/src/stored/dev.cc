@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2012 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -528,6 +528,8 @@ bool Device::open(DeviceControlRecord* dcr, DeviceMode omode)
 
   Dmsg2(100, "preserve=%08o fd=%d\n", preserve, fd);
 
+  if (fd >= 0) { open_generation++; }
+
   return fd >= 0;
 }
 
@@ -1101,6 +1103,38 @@ ssize_t Device::write(const void* buf, size_t len)
   return write_len;
 }
 
+/**
+ * Write a block of which parts are verbatim copies of data on other volumes.
+ * Those parts are shared with the source volume when the backend supports it.
+ */
+ssize_t Device::WriteCloned(const void* buf,
+                            size_t len,
+                            const BlockCloneExtent* extents,
+                            int num_extents)
+{
+  ssize_t write_len;
+  uint64_t cloned = 0;
+  uint64_t copied = 0;
+
+  GetTimerCount();
+
+  write_len
+      = d_write_cloned(fd, buf, len, extents, num_extents, cloned, copied);
+
+  last_tick = GetTimerCount();
+
+  DevWriteTime += last_tick;
+  VolCatInfo.VolWriteTime += last_tick;
+
+  if (write_len > 0) { /* skip error */
+    DevWriteBytes += write_len;
+    DevClonedBytes += cloned;
+    DevCopiedBytes += copied;
+  }
+
+  return write_len;
+}
+
 // Return the resource name for the device
 const char* Device::name() const { return device_resource->resource_name_; }
 
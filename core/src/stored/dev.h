@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2012 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -74,6 +74,7 @@ template <typename T> class dlist;
 namespace storagedaemon {
 
 struct DeviceStatusInformation;
+struct BlockCloneExtent;
 
 class DeviceResource;
 class DeviceControlRecord;
@@ -267,6 +268,7 @@ class Device {
   VolumeReservationItem* vol{};        /**< Pointer to Volume reservation item */
   btimer_t* tid{};            /**< Timer id */
   int fd{-1};                 /**< File descriptor */
+  uint32_t open_generation{}; /**< Incremented on each successful open */
 
   VolumeCatalogInfo VolCatInfo;       /**< Volume Catalog Information */
   Volume_Label VolHdr;                /**< Actual volume label */
@@ -290,6 +292,8 @@ class Device {
   btime_t DevWriteTime{};
   uint64_t DevWriteBytes{};
   uint64_t DevReadBytes{};
+  uint64_t DevClonedBytes{}; /**< Bytes cloned instead of written */
+  uint64_t DevCopiedBytes{}; /**< Bytes copied by the filesystem */
 
   /* Methods */
   btime_t GetTimerCount(); /**< Return the last timer interval (ms) */
@@ -401,6 +405,10 @@ class Device {
   bool open(DeviceControlRecord* dcr, DeviceMode omode);
   ssize_t read(void* buf, size_t len);
   ssize_t write(const void* buf, size_t len);
+  ssize_t WriteCloned(const void* buf,
+                      size_t len,
+                      const BlockCloneExtent* extents,
+                      int num_extents);
   bool mount(DeviceControlRecord* dcr, int timeout);
   bool unmount(DeviceControlRecord* dcr, int timeout);
   void EditMountCodes(PoolMem& omsg, const char* imsg);
@@ -455,6 +463,8 @@ public:
   virtual bool DeviceStatus(DeviceStatusInformation*) { return false; }
   virtual SeekMode GetSeekMode() const = 0;
   virtual bool CanReadConcurrently() const { return false; }
+  /* Alignment needed to share data with other volumes, 0 if unsupported. */
+  virtual uint32_t CloneAlignment() { return 0; }
 
   // Low level operations
   virtual int d_ioctl(int fd, ioctl_req_t request, char* mt_com = NULL) = 0;
@@ -467,6 +477,22 @@ public:
                             int whence) = 0;
   virtual bool d_truncate(DeviceControlRecord* dcr) = 0;
   virtual bool d_flush(DeviceControlRecord*) { return true; };
+  /* Write count bytes, cloning the given extents from their source volume
+   * where possible. Returns the bytes written and sets cloned to the number
+   * of bytes shared with the source volume and copied to the number of bytes
+   * the filesystem copied itself instead of them being written. */
+  virtual ssize_t d_write_cloned(int fd,
+                                 const void* buffer,
+                                 size_t count,
+                                 const BlockCloneExtent*,
+                                 int,
+                                 uint64_t& cloned,
+                                 uint64_t& copied)
+  {
+    cloned = 0;
+    copied = 0;
+    return d_write(fd, buffer, count);
+  }
 
     // Locking and blocking calls
   void rLock(bool locked = false);
@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2012 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -97,6 +97,9 @@ class DeviceControlRecord {
   bool any_volume{};         /**< Any OK for dir_find_next... */
   bool attached_to_dev{};    /**< Set when attached to dev */
   bool keep_dcr{};           /**< Do not free dcr in release_dcr */
+  bool track_rec_source{};   /**< Remember where read records are located */
+  bool clone_blocks{};       /**< Clone record data from the source volume */
+  bool rec_data_in_block{};  /**< Leave whole read records in the block */
   IODirection autodeflate{IODirection::NONE};
   IODirection autoinflate{IODirection::NONE};
   uint32_t VolFirstIndex{};        /**< First file index this Volume */
@@ -169,6 +172,8 @@ class DeviceControlRecord {
 
   // Methods in record.c
   bool WriteRecord();
+  char* RecordSpaceInBlock(uint32_t data_len);
+  bool WriteRecordInBlock();
 
   // Methods in reserve.c
   void ClearReserved();
@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2011 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -69,6 +69,8 @@ DeviceResource::DeviceResource(const DeviceResource& other)
   query_crypto_status = other.query_crypto_status;
   collectstats = other.collectstats;
   eof_on_error_is_eot = other.eof_on_error_is_eot;
+  block_cloning = other.block_cloning;
+  receive_into_block = other.receive_into_block;
   drive = other.drive;
   drive_index = other.drive_index;
   memcpy(cap_bits, other.cap_bits, CAP_BYTES);
@@ -90,6 +92,9 @@ DeviceResource::DeviceResource(const DeviceResource& other)
   volume_capacity = other.volume_capacity;
   max_spool_size = other.max_spool_size;
   max_job_spool_size = other.max_job_spool_size;
+  tape_streaming_buffer_size = other.tape_streaming_buffer_size;
+  tape_streaming_high_watermark = other.tape_streaming_high_watermark;
+  tape_streaming_low_watermark = other.tape_streaming_low_watermark;
 
   if (other.mount_point) { mount_point = strdup(other.mount_point); }
   if (other.mount_command) { mount_command = strdup(other.mount_command); }
@@ -125,6 +130,8 @@ DeviceResource& DeviceResource::operator=(const DeviceResource& rhs)
   query_crypto_status = rhs.query_crypto_status;
   collectstats = rhs.collectstats;
   eof_on_error_is_eot = rhs.eof_on_error_is_eot;
+  block_cloning = rhs.block_cloning;
+  receive_into_block = rhs.receive_into_block;
   drive = rhs.drive;
   drive_index = rhs.drive_index;
   memcpy(cap_bits, rhs.cap_bits, CAP_BYTES);
@@ -146,6 +153,9 @@ DeviceResource& DeviceResource::operator=(const DeviceResource& rhs)
   volume_capacity = rhs.volume_capacity;
   max_spool_size = rhs.max_spool_size;
   max_job_spool_size = rhs.max_job_spool_size;
+  tape_streaming_buffer_size = rhs.tape_streaming_buffer_size;
+  tape_streaming_high_watermark = rhs.tape_streaming_high_watermark;
+  tape_streaming_low_watermark = rhs.tape_streaming_low_watermark;
 
   mount_point = rhs.mount_point;
   mount_command = rhs.mount_command;
@@ -229,6 +239,16 @@ static void WarnOnSetMaxBlockSize(const DeviceResource& resource)
   }
 }
 
+static void WarnOnSetTapeStreamingBufferSize(const DeviceResource& resource)
+{
+  if (resource.IsMemberPresent("TapeStreamingBufferSize")) {
+    my_config->AddWarning(fmt::format(
+        FMT_STRING("Device {:s}: Setting 'Tape Streaming Buffer Size' is only "
+                   "supported on tape devices"),
+        resource.resource_name_));
+  }
+}
+
 static void WarnOnZeroMaxConcurrentJobs(int max_concurrent_jobs,
                                         std::string_view name)
 {
@@ -266,6 +286,7 @@ static bool ValidateTapeDevice(const DeviceResource& resource)
 static bool ValidateGenericDevice(const DeviceResource& resource)
 {
   WarnOnSetMaxBlockSize(resource);
+  WarnOnSetTapeStreamingBufferSize(resource);
   WarnOnZeroMaxConcurrentJobs(resource.max_concurrent_jobs,
                               resource.resource_name_);
   WarnOnGtOneMaxConcurrentJobs(resource.max_concurrent_jobs,
@@ -286,6 +307,16 @@ bool DeviceResource::Validate()
     return false;
   }
 
+  if (tape_streaming_high_watermark > 100
+      || tape_streaming_low_watermark >= tape_streaming_high_watermark) {
+    Jmsg(nullptr, M_ERROR, 0,
+         T_("Device %s: 'Tape Streaming Low Watermark' has to be lower than "
+            "'Tape Streaming High Watermark', which must not exceed 100.\n"),
+         resource_name_);
+
+    return false;
+  }
+
   to_lower(device_type);
   if (device_type == DeviceType::B_TAPE_DEV) {
     return ValidateTapeDevice(*this);
@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2011 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -55,6 +55,8 @@ class DeviceResource : public BareosResource {
   bool collectstats{false}; /**< Set if statistics should be collected */
   bool eof_on_error_is_eot{
       false};                    /**< Interpret EOF during read error as EOT */
+  bool block_cloning{false}; /**< Share unchanged data with source volumes */
+  bool receive_into_block{false}; /**< Receive backup data into the block */
   drive_number_t drive{0};       /**< Autochanger logical drive number */
   drive_number_t drive_index{0}; /**< Autochanger physical drive index */
   char cap_bits[CAP_BYTES]{0};   /**< Capabilities of this device */
@@ -81,6 +83,9 @@ class DeviceResource : public BareosResource {
   int64_t volume_capacity{0};        /**< Advisory capacity */
   int64_t max_spool_size{0};         /**< Max spool size for all jobs */
   int64_t max_job_spool_size{0};     /**< Max spool size for any single job */
+  int64_t tape_streaming_buffer_size{0};      /**< Tape write-behind buffer */
+  uint32_t tape_streaming_high_watermark{90}; /**< Fill % to start writing */
+  uint32_t tape_streaming_low_watermark{10};  /**< Fill % to stop writing */
 
   char* mount_point;     /**< Mount point for require mount devices */
   char* mount_command;   /**< Mount command */
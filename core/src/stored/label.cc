@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2012 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -911,6 +911,9 @@ void DumpLabelRecord(Device* dev, DeviceRecord* rec, bool verbose)
     case EOT_LABEL:
       type = T_("End of Tape");
       break;
+    case FILL_LABEL:
+      type = T_("Fill");
+      break;
     default:
       type = T_("Unknown");
       break;
@@ -3,7 +3,7 @@
 
    Copyright (C) 2006-2012 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -38,6 +38,7 @@
 #include "stored/stored_jcr_impl.h"
 #include "stored/label.h"
 #include "stored/mount.h"
+#include "stored/parallel_read.h"
 #include "stored/read_record.h"
 #include "stored/sd_stats.h"
 #include "stored/spool.h"
@@ -101,6 +102,65 @@ static bool response(JobControlRecord* jcr,
   return false;
 }
 
+/**
+ * When cloning blocks, place the data of the record so that its offset in the
+ * output volume modulo the filesystem block size matches its offset in the
+ * source volume. Only then the filesystem can share the extents. We get there
+ * by putting a FILL_LABEL record of the right size in front of it.
+ *
+ * Returns: false if error
+ *          true if OK (also when no alignment was done)
+ */
+static bool AlignClonedRecord(DeviceControlRecord* dcr, DeviceRecord* rec)
+{
+  Device* dev = dcr->dev;
+  DeviceBlock* block = dcr->block;
+  const RecordSourceExtent& first = rec->src_extent[0];
+  uint32_t align = dev->CloneAlignment();
+
+  if (align == 0 || first.offset != 0 || first.length < 2 * align) {
+    return true;
+  }
+
+  for (int tries = 0; tries < 2; tries++) {
+    uint64_t payload = dev->file_addr + block->binbuf + WRITE_RECHDR_LENGTH;
+
+    if (payload % align == first.addr % align) { return true; }
+
+    uint32_t fill = (first.addr % align + align
+                     - (payload + WRITE_RECHDR_LENGTH) % align)
+                    % align;
+
+    if (BlockWriteNavail(block) >= 2 * WRITE_RECHDR_LENGTH + fill + align) {
+      DeviceRecord* fill_rec = new_record(true);
+
+      fill_rec->FileIndex = FILL_LABEL;
+      fill_rec->Stream = dcr->jcr->JobId;
+      fill_rec->maskedStream = fill_rec->Stream;
+      fill_rec->VolSessionId = rec->VolSessionId;
+      fill_rec->VolSessionTime = rec->VolSessionTime;
+      fill_rec->data = CheckPoolMemorySize(fill_rec->data, fill);
+      memset(fill_rec->data, 0, fill);
+      fill_rec->data_len = fill;
+
+      bool written = WriteRecordToBlock(dcr, fill_rec);
+      FreeRecord(fill_rec);
+      ASSERT(written);
+
+      return true;
+    }
+
+    // Not enough room left in this block, start with a fresh one.
+    if (tries == 0 && block->binbuf > WRITE_BLKHDR_LENGTH) {
+      if (!dcr->WriteBlockToDevice()) { return false; }
+    } else {
+      break;
+    }
+  }
+
+  return true;
+}
+
 /**
  * Called here for each record from ReadRecords()
  * This function is used when we do a internal clone of a Job e.g.
@@ -214,6 +274,16 @@ static bool CloneRecordInternally(DeviceControlRecord* dcr, DeviceRecord* rec)
     jcr->sd_impl->dcr->after_rec = jcr->sd_impl->dcr->before_rec;
   } else {
     translated_record = true;
+    jcr->sd_impl->dcr->after_rec->src_extents = 0;
+  }
+
+  if (jcr->sd_impl->dcr->clone_blocks && rec->state == st_none
+      && jcr->sd_impl->dcr->after_rec->src_extents > 0) {
+    if (!AlignClonedRecord(jcr->sd_impl->dcr, jcr->sd_impl->dcr->after_rec)) {
+      Jmsg2(jcr, M_FATAL, 0, T_("Fatal append error on device %s: ERR=%s\n"),
+            dev->print_name(), dev->bstrerror());
+      goto bail_out;
+    }
   }
 
   while (!WriteRecordToBlock(jcr->sd_impl->dcr, jcr->sd_impl->dcr->after_rec)) {
@@ -427,6 +497,25 @@ static inline void CheckAutoXflation(JobControlRecord* jcr)
   }
 }
 
+/**
+ * See if we can let the filesystem share the data between the volumes we
+ * read and the volume we write instead of copying it.
+ */
+static inline void CheckBlockCloning(JobControlRecord* jcr)
+{
+  DeviceControlRecord* read_dcr = jcr->sd_impl->read_dcr;
+  DeviceControlRecord* dcr = jcr->sd_impl->dcr;
+
+  if (!dcr->device_resource->block_cloning || dcr->spool_data) { return; }
+  if (dcr->dev->CloneAlignment() == 0 || read_dcr->dev->CloneAlignment() == 0) {
+    return;
+  }
+
+  Dmsg1(200, "Enabling block cloning on device %s\n", dcr->dev->print_name());
+  read_dcr->track_rec_source = true;
+  dcr->clone_blocks = true;
+}
+
 // Read Data and commit to new job.
 bool DoMacRun(JobControlRecord* jcr)
 {
@@ -437,6 +526,8 @@ bool DoMacRun(JobControlRecord* jcr)
   bool acquire_fail = false;
   BareosSocket* dir = jcr->dir_bsock;
   Device* dev = jcr->sd_impl->dcr->dev;
+  uint64_t cloned_bytes = dev->DevClonedBytes;
+  uint64_t copied_bytes = dev->DevCopiedBytes;
 
   switch (jcr->getJobType()) {
     case JT_MIGRATE:
@@ -577,6 +668,9 @@ bool DoMacRun(JobControlRecord* jcr)
     /* Inform Storage daemon that we are done */
     sd->signal(BNET_TERMINATE);
   } else {
+    ParallelRecordReader parallel_reader(jcr);
+    int parallel_readers = 0;
+
     if (!jcr->sd_impl->read_dcr) {
       Jmsg(jcr, M_FATAL, 0, T_("Read device not properly initialized.\n"));
       goto bail_out;
@@ -589,8 +683,21 @@ bool DoMacRun(JobControlRecord* jcr)
           jcr->sd_impl->VolList->VolumeName);
 
     // Ready devices for reading and writing.
-    if (!AcquireDeviceForAppend(jcr->sd_impl->dcr)
-        || !AcquireDeviceForRead(jcr->sd_impl->read_dcr)) {
+    if (!AcquireDeviceForAppend(jcr->sd_impl->dcr)) {
+      ok = false;
+      acquire_fail = true;
+      goto bail_out;
+    }
+
+    /* See if we can read from more than one device, the reader threads
+     * acquire their devices themselves. Block cloning needs to know the
+     * source of every record, so it always reads sequentially. */
+    if (!jcr->sd_impl->dcr->device_resource->block_cloning) {
+      parallel_readers = parallel_reader.Setup(me->max_concurrent_read_devices);
+    }
+
+    if (parallel_readers == 0
+        && !AcquireDeviceForRead(jcr->sd_impl->read_dcr)) {
       ok = false;
       acquire_fail = true;
       goto bail_out;
@@ -641,8 +748,13 @@ bool DoMacRun(JobControlRecord* jcr)
     jcr->JobFiles = 0;
 
     // Read all data and make a local clone of it.
-    ok = ReadRecords(jcr->sd_impl->read_dcr, CloneRecordInternally,
-                     MountNextReadVolume);
+    if (parallel_readers > 0) {
+      ok = parallel_reader.ReadRecords(CloneRecordInternally);
+    } else {
+      CheckBlockCloning(jcr);
+      ok = ReadRecords(jcr->sd_impl->read_dcr, CloneRecordInternally,
+                       MountNextReadVolume);
+    }
   }
 
 bail_out:
@@ -706,6 +818,17 @@ bail_out:
          job_elapsed / 3600, job_elapsed % 3600 / 60, job_elapsed % 60,
          edit_uint64_with_suffix(jcr->JobBytes / job_elapsed, ec1));
 
+    if (jcr->sd_impl->dcr->clone_blocks) {
+      Jmsg(jcr, M_INFO, 0, T_("Cloned %s bytes instead of copying them.\n"),
+           edit_uint64_with_commas(dev->DevClonedBytes - cloned_bytes, ec1));
+      if (dev->DevCopiedBytes > copied_bytes) {
+        Jmsg(jcr, M_INFO, 0,
+             T_("Filesystem copied %s bytes that could not be cloned.\n"),
+             edit_uint64_with_commas(dev->DevCopiedBytes - copied_bytes,
+                                     ec1));
+      }
+    }
+
     // send final Vol info to DIR
     if (!ok || jcr->IsJobCanceled()) {
       DiscardAttributeSpool(jcr);
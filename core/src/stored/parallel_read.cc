@@ -0,0 +1,558 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Read the source volumes of a local copy, migration or consolidation job
+ * from several devices at the same time.
+ *
+ * The bootstrap of the job is split into segments that have no volume and
+ * no session in common. Every reader thread gets its own helper jcr and
+ * read device and reads the segments assigned to it. The records are copied
+ * into per segment queues and the job thread consumes the segments in
+ * bootstrap order, so the output is the same as when reading sequentially.
+ */
+
+#include "include/bareos.h"
+#include "stored/stored.h"
+#include "stored/acquire.h"
+#include "stored/bsr.h"
+#include "stored/device_control_record.h"
+#include "stored/job.h"
+#include "stored/mount.h"
+#include "stored/parallel_read.h"
+#include "stored/read_record.h"
+#include "stored/reserve.h"
+#include "stored/stored_jcr_impl.h"
+#include "lib/thread_specific_data.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace storagedaemon {
+
+static const int debuglevel = 100;
+
+/* Data the reader of the segment that is currently written may queue. */
+static const uint64_t current_segment_limit = 8 * 1024 * 1024;
+
+/* Data all readers together may queue for segments not written yet. */
+static const uint64_t read_ahead_limit = 64 * 1024 * 1024;
+
+struct ParallelRecordReader::Reader {
+  int number = 0;
+  JobControlRecord* jcr = nullptr;
+  DeviceControlRecord* dcr = nullptr;
+  std::string device_name;
+  std::vector<int> segments;
+  int segment = 0; /**< Segment the reader is currently in */
+  std::thread thread;
+  bool failed = false;
+  std::string errmsg;
+};
+
+/* What the FileIndex sequencing of the callback remembers per session. */
+struct SessionState {
+  uint32_t VolSessionId = 0;
+  uint32_t VolSessionTime = 0;
+  int32_t FileIndex = 0;
+};
+
+struct ParallelRecordReader::Segment {
+  std::deque<DeviceRecord*> records;
+  uint64_t bytes = 0;
+  bool finished = false;
+};
+
+/**
+ * The read dcr of a reader thread. The helper jcr has no connection to the
+ * Director, so we cannot ask the operator to mount a volume.
+ */
+class ParallelReadDcr : public DeviceControlRecord {
+ public:
+  ParallelReadDcr(ParallelRecordReader* t_owner,
+                  ParallelRecordReader::Reader* t_reader)
+      : owner(t_owner), reader(t_reader)
+  {
+  }
+
+  bool DirAskSysopToMountVolume(int) override
+  {
+    Mmsg(jcr->errmsg, T_("Volume \"%s\" could not be mounted on device %s.\n"),
+         VolumeName, dev->print_name());
+    return false;
+  }
+
+  ParallelRecordReader* owner;
+  ParallelRecordReader::Reader* reader;
+};
+
+static inline uint64_t RecordFootprint(const DeviceRecord* rec)
+{
+  return sizeof(DeviceRecord) + rec->data_len;
+}
+
+static DeviceRecord* CopyRecord(const DeviceRecord* rec)
+{
+  DeviceRecord* copy = new_record(true);
+
+  copy->File = rec->File;
+  copy->Block = rec->Block;
+  copy->VolSessionId = rec->VolSessionId;
+  copy->VolSessionTime = rec->VolSessionTime;
+  copy->FileIndex = rec->FileIndex;
+  copy->Stream = rec->Stream;
+  copy->maskedStream = rec->maskedStream;
+  copy->bsr = rec->bsr;
+  copy->match_stat = rec->match_stat;
+  copy->data = CheckPoolMemorySize(copy->data, rec->data_len);
+  memcpy(copy->data, rec->data, rec->data_len);
+  copy->data_len = rec->data_len;
+
+  return copy;
+}
+
+std::vector<int> SplitBootstrapIntoSegments(BootStrapRecord* root)
+{
+  std::vector<std::vector<std::string>> keys;
+  std::map<std::string, size_t> last_use;
+
+  for (BootStrapRecord* bsr = root; bsr; bsr = bsr->next) {
+    /* We need to know exactly which session a bsr selects, anything else
+     * (e.g. a hand written bootstrap) is read sequentially. */
+    if (!bsr->volume || !bsr->sessid || !bsr->sesstime || bsr->sessid->next
+        || bsr->sesstime->next || bsr->sessid->sessid != bsr->sessid->sessid2) {
+      return {};
+    }
+
+    std::vector<std::string> bsr_keys;
+    for (BsrVolume* vol = bsr->volume; vol; vol = vol->next) {
+      bsr_keys.push_back(std::string("V") + vol->VolumeName);
+    }
+    bsr_keys.push_back("S" + std::to_string(bsr->sesstime->sesstime) + ":"
+                       + std::to_string(bsr->sessid->sessid));
+
+    for (auto& key : bsr_keys) { last_use[key] = keys.size(); }
+    keys.push_back(std::move(bsr_keys));
+  }
+
+  /* A segment ends at the first bsr after which none of its volumes and
+   * sessions is used anymore. */
+  std::vector<int> segment_of(keys.size());
+  size_t segment_end = 0;
+  int segment = 0;
+  for (size_t i = 0; i < keys.size(); i++) {
+    for (auto& key : keys[i]) {
+      segment_end = std::max(segment_end, last_use[key]);
+    }
+    segment_of[i] = segment;
+    if (i == segment_end) { segment++; }
+  }
+
+  return segment_of;
+}
+
+ParallelRecordReader::ParallelRecordReader(JobControlRecord* jcr) : jcr_(jcr)
+{
+}
+
+ParallelRecordReader::~ParallelRecordReader()
+{
+  FreeReaders();
+  RestoreBootstrap();
+
+  for (auto& segment : segments_) {
+    for (DeviceRecord* rec : segment->records) { FreeRecord(rec); }
+  }
+}
+
+static JobControlRecord* NewReaderJcr(JobControlRecord* jcr)
+{
+  JobControlRecord* rjcr = NewStoredJcr();
+
+  /* JobId 0 keeps the helper out of the Director status and cancel handling,
+   * its read volumes are kept under the JobId of the job. */
+  rjcr->JobId = 0;
+  rjcr->sd_impl->parent_jcr = jcr;
+  bstrncpy(rjcr->Job, jcr->Job, sizeof(rjcr->Job));
+  rjcr->setJobType(jcr->getJobType());
+  rjcr->setJobLevel(jcr->getJobLevel());
+  rjcr->setJobStatus(JS_Running);
+
+  return rjcr;
+}
+
+// Reserve any free device of the read storage of the job for this reader.
+bool ParallelRecordReader::ReserveReader(Reader* reader)
+{
+  JobControlRecord* rjcr = reader->jcr;
+  ReserveContext rctx;
+  DirectorStorage* store = nullptr;
+  const char* device_name = nullptr;
+  bool ok = false;
+
+  reader->dcr = new ParallelReadDcr(this, reader);
+  rjcr->sd_impl->read_dcr = reader->dcr;
+
+  LockReservations();
+  rjcr->sd_impl->reserve_msgs = new alist<const char*>(10, not_owned_by_alist);
+  foreach_alist (store, jcr_->sd_impl->read_store) {
+    foreach_alist (device_name, store->device) {
+      memset(&rctx, 0, sizeof(ReserveContext));
+      rctx.jcr = rjcr;
+      rctx.store = store;
+      rctx.device_name = device_name;
+      rctx.any_drive = true;
+      if (SearchResForDevice(rctx) == 1) {
+        ok = true;
+        break;
+      }
+    }
+    if (ok) { break; }
+  }
+  ReleaseReserveMessages(rjcr);
+  UnlockReservations();
+
+  if (!ok) {
+    Dmsg1(debuglevel, "No additional read device for reader %d\n",
+          reader->number);
+    FreeDeviceControlRecord(reader->dcr);
+    reader->dcr = nullptr;
+    return false;
+  }
+
+  reader->device_name = reader->dcr->dev->print_name();
+  return true;
+}
+
+int ParallelRecordReader::Setup(uint32_t max_readers)
+{
+  DeviceControlRecord* read_dcr = jcr_->sd_impl->read_dcr;
+  BootStrapRecord* root = jcr_->sd_impl->read_session.bsr;
+
+  if (max_readers < 2 || !read_dcr || !root || !jcr_->sd_impl->read_store) {
+    return 0;
+  }
+
+  // SD plugins translate the records of the read dcr, keep such jobs simple.
+  if (jcr_->plugin_ctx_list && jcr_->plugin_ctx_list->size() > 0) {
+    Dmsg0(debuglevel, "SD plugins loaded, reading sequentially\n");
+    return 0;
+  }
+
+  bsr_segment_ = SplitBootstrapIntoSegments(root);
+  if (bsr_segment_.empty() || bsr_segment_.back() == 0) { return 0; }
+
+  int num_segments = bsr_segment_.back() + 1;
+  uint32_t wanted = std::min(max_readers, static_cast<uint32_t>(num_segments));
+
+  /* The first reader takes over the read device reserved for the job, the
+   * other ones look for a free device of the same storage. */
+  for (uint32_t i = 0; i < wanted; i++) {
+    auto reader = std::make_unique<Reader>();
+    reader->number = i;
+    reader->jcr = NewReaderJcr(jcr_);
+    readers_.push_back(std::move(reader));
+    if (i > 0 && !ReserveReader(readers_.back().get())) {
+      FreeJcr(readers_.back()->jcr);
+      readers_.pop_back();
+      break;
+    }
+  }
+
+  if (readers_.size() < 2) {
+    FreeReaders();
+    return 0;
+  }
+
+  Reader* first = readers_.front().get();
+  Device* dev = read_dcr->dev;
+
+  first->dcr = new ParallelReadDcr(this, first);
+  first->jcr->sd_impl->read_dcr = first->dcr;
+  SetupNewDcrDevice(first->jcr, first->dcr, dev, nullptr);
+  bstrncpy(first->dcr->pool_name, read_dcr->pool_name, MAX_NAME_LENGTH);
+  bstrncpy(first->dcr->pool_type, read_dcr->pool_type, MAX_NAME_LENGTH);
+  bstrncpy(first->dcr->media_type, read_dcr->media_type, MAX_NAME_LENGTH);
+  bstrncpy(first->dcr->dev_name, read_dcr->dev_name, MAX_NAME_LENGTH);
+  first->device_name = dev->print_name();
+
+  dev->Lock();
+  first->dcr->SetReserved();
+  read_dcr->ClearReserved();
+  dev->Unlock();
+  FreeDeviceControlRecord(read_dcr);
+
+  // Distribute the segments round robin and give every reader its own chain.
+  int num_readers = readers_.size();
+  for (int i = 0; i < num_segments; i++) {
+    segments_.push_back(std::make_unique<Segment>());
+    readers_[i % num_readers]->segments.push_back(i);
+  }
+
+  std::vector<BootStrapRecord*> tails(num_readers, nullptr);
+  for (BootStrapRecord* bsr = root; bsr; bsr = bsr->next) {
+    bsrs_.push_back(bsr);
+  }
+  for (size_t i = 0; i < bsrs_.size(); i++) {
+    BootStrapRecord* bsr = bsrs_[i];
+    int segment = bsr_segment_[i];
+    Reader* reader = readers_[segment % num_readers].get();
+
+    for (BsrVolume* vol = bsr->volume; vol; vol = vol->next) {
+      volume_segment_[vol->VolumeName] = segment;
+    }
+
+    BootStrapRecord*& tail = tails[reader->number];
+    if (!tail) {
+      reader->jcr->sd_impl->read_session.bsr = bsr;
+      bsr->use_fast_rejection = root->use_fast_rejection;
+      bsr->use_positioning = root->use_positioning;
+      bsr->prev = nullptr;
+    } else {
+      tail->next = bsr;
+      bsr->prev = tail;
+    }
+    bsr->root = reader->jcr->sd_impl->read_session.bsr;
+    tail = bsr;
+  }
+  for (BootStrapRecord* tail : tails) { tail->next = nullptr; }
+
+  PoolMem devices(PM_MESSAGE);
+  for (auto& reader : readers_) {
+    CreateRestoreVolumeList(reader->jcr);
+    if (reader->number > 0) { PmStrcat(devices, ", "); }
+    PmStrcat(devices, reader->device_name.c_str());
+  }
+
+  Jmsg(jcr_, M_INFO, 0,
+       T_("Reading %d segments from %d devices in parallel: %s\n"),
+       num_segments, num_readers, devices.c_str());
+
+  return num_readers;
+}
+
+bool ParallelRecordReader::QueueRecordCallback(DeviceControlRecord* dcr,
+                                               DeviceRecord* rec)
+{
+  ParallelReadDcr* pdcr = static_cast<ParallelReadDcr*>(dcr);
+
+  return pdcr->owner->QueueRecord(pdcr->reader, rec);
+}
+
+// Mark the segments of a reader before the given one as complete.
+void ParallelRecordReader::FinishSegmentsBefore(Reader* reader, int segment)
+{
+  for (int i : reader->segments) {
+    if (i < segment) { segments_[i]->finished = true; }
+  }
+}
+
+/**
+ * Called in the reader threads for every record read. As segments have
+ * their own volumes, the volume currently read tells us where the record
+ * belongs to. A reader never goes back to an earlier segment.
+ */
+bool ParallelRecordReader::QueueRecord(Reader* reader, DeviceRecord* rec)
+{
+  int segment = reader->segment;
+  auto found = volume_segment_.find(reader->dcr->VolumeName);
+  if (found != volume_segment_.end() && found->second > segment) {
+    segment = found->second;
+  }
+
+  DeviceRecord* copy = CopyRecord(rec);
+  uint64_t footprint = RecordFootprint(copy);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (segment != reader->segment) {
+    FinishSegmentsBefore(reader, segment);
+    reader->segment = segment;
+    cond_.notify_all();
+  }
+
+  Segment& seg = *segments_[segment];
+  while (!aborted_
+         && (segment == current_segment_
+                 ? seg.bytes >= current_segment_limit
+                 : ahead_bytes_ >= read_ahead_limit)) {
+    cond_.wait(lock);
+  }
+
+  if (aborted_) {
+    lock.unlock();
+    FreeRecord(copy);
+    return false;
+  }
+
+  seg.records.push_back(copy);
+  seg.bytes += footprint;
+  if (segment != current_segment_) { ahead_bytes_ += footprint; }
+  cond_.notify_all();
+
+  return true;
+}
+
+void ParallelRecordReader::ReaderDone(Reader* reader, bool ok)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  for (int i : reader->segments) { segments_[i]->finished = true; }
+  if (!ok && !aborted_) {
+    reader->failed = true;
+    aborted_ = true;
+  }
+  cond_.notify_all();
+}
+
+void ParallelRecordReader::ReaderThread(Reader* reader)
+{
+  JobControlRecord* rjcr = reader->jcr;
+  bool ok;
+
+  SetJcrInThreadSpecificData(rjcr);
+
+  ok = AcquireDeviceForRead(reader->dcr);
+  if (ok) {
+    ok = storagedaemon::ReadRecords(reader->dcr, QueueRecordCallback,
+                                    MountNextReadVolume);
+  }
+  if (!ok) {
+    reader->errmsg = rjcr->errmsg;
+    if (reader->errmsg.empty()) {
+      reader->errmsg = reader->dcr->dev->errmsg;
+    }
+  }
+
+  if (rjcr->sd_impl->read_dcr) { ReleaseDevice(rjcr->sd_impl->read_dcr); }
+  reader->dcr = nullptr;
+
+  ReaderDone(reader, ok);
+}
+
+// Stop all readers, called with the mutex held.
+void ParallelRecordReader::Abort()
+{
+  aborted_ = true;
+  for (auto& reader : readers_) { reader->jcr->setJobStatus(JS_Canceled); }
+  cond_.notify_all();
+}
+
+bool ParallelRecordReader::ReadRecords(RecordCallback callback)
+{
+  DeviceControlRecord* dcr = jcr_->sd_impl->dcr;
+  std::map<std::pair<uint32_t, uint32_t>, SessionState> sessions;
+  bool ok = true;
+
+  for (auto& reader : readers_) {
+    reader->thread
+        = std::thread(&ParallelRecordReader::ReaderThread, this, reader.get());
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (size_t i = 0; ok && i < segments_.size(); i++) {
+    Segment& seg = *segments_[i];
+
+    current_segment_ = i;
+    ahead_bytes_ -= seg.bytes;
+    cond_.notify_all();
+    Dmsg2(debuglevel, "Merging segment %d, %llu bytes queued\n", (int)i,
+          (unsigned long long)seg.bytes);
+
+    while (ok) {
+      if (aborted_ || jcr_->IsJobCanceled()) {
+        ok = false;
+        break;
+      }
+      if (seg.records.empty()) {
+        if (seg.finished) { break; }
+        cond_.wait_for(lock, std::chrono::seconds(1));
+        continue;
+      }
+
+      DeviceRecord* rec = seg.records.front();
+      seg.records.pop_front();
+      seg.bytes -= RecordFootprint(rec);
+      cond_.notify_all();
+      lock.unlock();
+
+      /* The FileIndex sequencing of the callback keeps its state in the
+       * record, which the reader used to do once per session. */
+      SessionState& last
+          = sessions[std::make_pair(rec->VolSessionId, rec->VolSessionTime)];
+      rec->last_VolSessionId = last.VolSessionId;
+      rec->last_VolSessionTime = last.VolSessionTime;
+      rec->last_FileIndex = last.FileIndex;
+
+      ok = callback(dcr, rec);
+
+      last.VolSessionId = rec->last_VolSessionId;
+      last.VolSessionTime = rec->last_VolSessionTime;
+      last.FileIndex = rec->last_FileIndex;
+      FreeRecord(rec);
+
+      lock.lock();
+    }
+  }
+
+  if (!ok) { Abort(); }
+  lock.unlock();
+
+  for (auto& reader : readers_) {
+    if (reader->thread.joinable()) { reader->thread.join(); }
+    if (reader->failed && !jcr_->IsJobCanceled()) {
+      Jmsg(jcr_, M_FATAL, 0, T_("Reading from device %s failed: ERR=%s"),
+           reader->device_name.c_str(), reader->errmsg.c_str());
+    }
+  }
+
+  return ok;
+}
+
+void ParallelRecordReader::FreeReaders()
+{
+  for (auto& reader : readers_) {
+    if (reader->thread.joinable()) { reader->thread.join(); }
+    if (reader->dcr) {
+      FreeDeviceControlRecord(reader->dcr);
+      reader->dcr = nullptr;
+    }
+    reader->jcr->sd_impl->read_session.bsr = nullptr;
+    FreeJcr(reader->jcr);
+  }
+  readers_.clear();
+}
+
+// Put the bootstrap of the job back into one chain.
+void ParallelRecordReader::RestoreBootstrap()
+{
+  if (bsrs_.empty()) { return; }
+
+  BootStrapRecord* root = bsrs_.front();
+  for (size_t i = 0; i < bsrs_.size(); i++) {
+    bsrs_[i]->prev = i > 0 ? bsrs_[i - 1] : nullptr;
+    bsrs_[i]->next = i + 1 < bsrs_.size() ? bsrs_[i + 1] : nullptr;
+    bsrs_[i]->root = root;
+  }
+  bsrs_.clear();
+}
+
+}  // namespace storagedaemon
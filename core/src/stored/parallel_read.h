@@ -0,0 +1,118 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Read the source volumes of a local copy, migration or consolidation job
+ * from several devices at the same time.
+ */
+
+#ifndef BAREOS_STORED_PARALLEL_READ_H_
+#define BAREOS_STORED_PARALLEL_READ_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "include/jcr.h"
+
+namespace storagedaemon {
+
+struct BootStrapRecord;
+struct DeviceRecord;
+class DeviceControlRecord;
+
+/**
+ * Split a bootstrap into read segments. A segment is a consecutive run of
+ * bootstrap records that shares no volume and no session with any other
+ * segment, so every segment can be read from its own device while the
+ * records still come out in bootstrap order when the segments are consumed
+ * one after another.
+ *
+ * Returns the segment number of each bootstrap record in chain order, or an
+ * empty vector when the bootstrap cannot be split safely.
+ */
+std::vector<int> SplitBootstrapIntoSegments(BootStrapRecord* bsr);
+
+/**
+ * Runs one reader thread per device and hands the records to the job
+ * thread in bootstrap order through a bounded reorder buffer.
+ */
+class ParallelRecordReader {
+ public:
+  using RecordCallback = bool (*)(DeviceControlRecord* dcr, DeviceRecord* rec);
+
+  explicit ParallelRecordReader(JobControlRecord* jcr);
+  ~ParallelRecordReader();
+
+  /**
+   * Must be called before the read device of the job got acquired. Reserves
+   * up to max_readers - 1 additional read devices and takes over the read
+   * device of the job.
+   *
+   * Returns the number of devices that will be read from, 0 when the job has
+   * to be read sequentially as before.
+   */
+  int Setup(uint32_t max_readers);
+
+  /**
+   * Read all records and pass them to callback in the order a sequential read
+   * would deliver them. The callback runs in the calling thread and gets the
+   * write dcr of the job, as the read devices belong to the reader threads.
+   */
+  bool ReadRecords(RecordCallback callback);
+
+  struct Reader;
+  struct Segment;
+
+ private:
+  bool ReserveReader(Reader* reader);
+  void ReaderThread(Reader* reader);
+  bool QueueRecord(Reader* reader, DeviceRecord* rec);
+  void FinishSegmentsBefore(Reader* reader, int segment);
+  void ReaderDone(Reader* reader, bool ok);
+  void Abort();
+  void RestoreBootstrap();
+  void FreeReaders();
+
+  static bool QueueRecordCallback(DeviceControlRecord* dcr, DeviceRecord* rec);
+
+  JobControlRecord* jcr_;
+  std::vector<BootStrapRecord*> bsrs_;
+  std::vector<int> bsr_segment_;
+  std::map<std::string, int> volume_segment_;
+  std::vector<std::unique_ptr<Reader>> readers_;
+  std::vector<std::unique_ptr<Segment>> segments_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  int current_segment_ = 0;
+  uint64_t ahead_bytes_ = 0;
+  bool aborted_ = false;
+};
+
+}  // namespace storagedaemon
+
+#endif  // BAREOS_STORED_PARALLEL_READ_H_
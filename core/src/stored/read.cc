@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2011 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -88,6 +88,11 @@ bool DoReadData(JobControlRecord* jcr)
     return false;
   }
 
+  /* Records nobody translates can be sent straight from the block they were
+   * read into. */
+  dcr->rec_data_in_block
+      = !PluginEventEnabled(jcr, bSdEventReadRecordTranslation);
+
   // Tell File daemon we will send data
   fd->fsend(OK_data);
   jcr->sendJobStatus(JS_Running);
@@ -115,6 +120,8 @@ static bool RecordCb(DeviceControlRecord* dcr, DeviceRecord* rec)
   bool ok = true;
   POOLMEM* save_msg;
   char ec1[50], ec2[50];
+  char header[100];
+  int header_len;
 
   if (rec->FileIndex < 0) { return true; }
 
@@ -123,31 +130,33 @@ static bool RecordCb(DeviceControlRecord* dcr, DeviceRecord* rec)
         FI_to_ascii(ec1, rec->FileIndex),
         stream_to_ascii(ec2, rec->Stream, rec->FileIndex), rec->data_len);
 
-  // Send record header to File daemon
-  if (!fd->fsend(rec_header, rec->VolSessionId, rec->VolSessionTime,
-                 rec->FileIndex, rec->Stream, rec->data_len)) {
-    Pmsg1(000, T_(">filed: Error Hdr=%s"), fd->msg);
-    Jmsg1(jcr, M_FATAL, 0, T_("Error sending to File daemon. ERR=%s\n"),
-          fd->bstrerror());
-    return false;
+  header_len = Bsnprintf(header, sizeof(header), rec_header, rec->VolSessionId,
+                         rec->VolSessionTime, rec->FileIndex, rec->Stream,
+                         rec->data_len);
+  Dmsg1(400, ">filed: Hdr=%s\n", header);
+  Dmsg1(400, ">filed: send %d bytes data.\n", rec->data_len);
+
+  if (rec->block_data) {
+    // Send record header and data straight from the block in one go
+    ok = fd->SendMessages(
+        {{header, (std::size_t)header_len}, {rec->block_data, rec->data_len}});
   } else {
-    Dmsg1(400, ">filed: Hdr=%s\n", fd->msg);
+    // Send record header, then the data record directly from the record
+    ok = fd->send(header, header_len);
+    if (ok) {
+      save_msg = fd->msg;  /* save fd message pointer */
+      fd->msg = rec->data; /* pass data directly to the FD */
+      fd->message_length = rec->data_len;
+      ok = fd->send();
+      fd->msg = save_msg; /* restore fd message pointer */
+    }
   }
 
-  // Send data record to File daemon
-  save_msg = fd->msg;  /* save fd message pointer */
-  fd->msg = rec->data; /* pass data directly to the FD */
-  fd->message_length = rec->data_len;
-
-  Dmsg1(400, ">filed: send %d bytes data.\n", fd->message_length);
-  if (!fd->send()) {
+  if (!ok) {
     Pmsg1(000, T_("Error sending to FD. ERR=%s\n"), fd->bstrerror());
     Jmsg1(jcr, M_FATAL, 0, T_("Error sending to File daemon. ERR=%s\n"),
           fd->bstrerror());
-
-    ok = false;
   }
-  fd->msg = save_msg; /* restore fd message pointer */
 
   return ok;
 }
@@ -3,7 +3,7 @@
 
    Copyright (C) 2002-2010 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -74,6 +74,9 @@ static void HandleSessionRecord(Device* dev,
     case EOM_LABEL:
       rtype = T_("End of Media");
       break;
+    case FILL_LABEL:
+      rtype = T_("Fill");
+      break;
     default:
       Bsnprintf(buf, sizeof(buf), T_("Unknown code %d\n"), rec->FileIndex);
       rtype = buf;
@@ -459,6 +462,8 @@ bool ReadRecords(DeviceControlRecord* dcr,
          * translation has taken place we just point the rec pointer to same
          * DeviceRecord as in the before_rec pointer. */
         if (dcr->after_rec) {
+          // The data changed, it no longer matches what is on the volume.
+          dcr->after_rec->src_extents = 0;
           ok = RecordCb(dcr, dcr->after_rec);
           FreeRecord(dcr->after_rec);
           dcr->after_rec = nullptr;
@@ -2,7 +2,7 @@
    BAREOS® - Backup Archiving REcovery Open Sourced
 
    Copyright (C) 2001-2012 Free Software Foundation Europe e.V.
-   Copyright (C) 2016-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2016-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -76,6 +76,9 @@ const char* FI_to_ascii(char* buf, int fi)
     case EOB_LABEL:
       return "EOB_LABEL";
       break;
+    case FILL_LABEL:
+      return "FILL_LABEL";
+      break;
     default:
       sprintf(buf, T_("unknown: %d"), fi);
       return buf;
@@ -163,6 +166,10 @@ static const char* record_compression_to_str(PoolMem& resultbuffer,
           compression_to_str(resultbuffer, "FZ4H", comp_len, comp_level,
                              comp_version);
           break;
+        case COMPRESS_NONE:
+          compression_to_str(resultbuffer, "NONE", comp_len, comp_level,
+                             comp_version);
+          break;
         default:
           tmp.bsprintf(
               T_("Compression algorithm 0x%x found, but not supported!\n"),
@@ -531,7 +538,7 @@ DeviceRecord* new_record(bool with_data)
 {
   DeviceRecord* rec;
 
-  rec = (DeviceRecord*)GetPoolMemory(PM_RECORD);
+  rec = (DeviceRecord*)GetMemory(sizeof(DeviceRecord));
   *rec = DeviceRecord{};
   if (with_data) {
     rec->data = GetPoolMemory(PM_MESSAGE);
@@ -554,6 +561,8 @@ void EmptyRecord(DeviceRecord* rec)
   ClearBit(REC_NO_MATCH, rec->state_bits);
   ClearBit(REC_CONTINUATION, rec->state_bits);
 
+  rec->src_extents = 0;
+  rec->block_data = nullptr;
   rec->state = st_none;
 }
 
@@ -563,6 +572,7 @@ void CopyRecordState(DeviceRecord* dst, DeviceRecord* src)
   int32_t Stream, maskedStream;
   uint32_t data_len;
   POOLMEM* data;
+  const char* block_data;
 
   // Preserve some important fields all other can be overwritten.
   Stream = dst->Stream;
@@ -570,6 +580,7 @@ void CopyRecordState(DeviceRecord* dst, DeviceRecord* src)
   data = dst->data;
   data_len = dst->data_len;
   own_mempool = dst->own_mempool;
+  block_data = dst->block_data;
 
   memcpy(dst, src, sizeof(DeviceRecord));
 
@@ -578,6 +589,7 @@ void CopyRecordState(DeviceRecord* dst, DeviceRecord* src)
   dst->data = data;
   dst->data_len = data_len;
   dst->own_mempool = own_mempool;
+  dst->block_data = block_data;
 }
 
 // Free the record entity
@@ -622,12 +634,57 @@ static inline ssize_t WriteHeaderToBlock(DeviceBlock* block,
   return WRITE_RECHDR_LENGTH;
 }
 
-static inline ssize_t WriteDataToBlock(DeviceBlock* block,
+/**
+ * Remember which parts of the data we are about to put into the block are
+ * still available unchanged on the source volume so the device can clone
+ * them instead of writing them.
+ *
+ * Returns the number of bytes to transfer, which is cut short at the end of
+ * a source extent so that the next extent starts in a new block and keeps
+ * the same distance to its source address as the previous one.
+ */
+static inline uint32_t AddCloneExtents(DeviceBlock* block,
+                                       const DeviceRecord* rec,
+                                       uint32_t offset,
+                                       uint32_t len)
+{
+  for (int i = 0; i < rec->src_extents; i++) {
+    const RecordSourceExtent& src = rec->src_extent[i];
+    uint32_t src_end = src.offset + src.length;
+
+    if (src_end <= offset) { continue; }
+    if (src.offset >= offset + len) { break; }
+
+    // No room for more extents, the rest of the block is simply written.
+    if (block->num_clone_extents >= MAX_BLOCK_CLONE_EXTENTS) { break; }
+
+    uint32_t start = MAX(src.offset, offset);
+    uint32_t end = MIN(src_end, offset + len);
+    BlockCloneExtent& extent = block->clone_extents[block->num_clone_extents++];
+
+    extent.offset = block->binbuf + (start - offset);
+    extent.length = end - start;
+    extent.src_dev = rec->src_dev;
+    extent.src_fd = rec->src_fd;
+    extent.src_generation = rec->src_generation;
+    extent.src_addr = src.addr + (start - src.offset);
+
+    if (end == src_end && end < rec->data_len) { return end - offset; }
+  }
+
+  return len;
+}
+
+static inline ssize_t WriteDataToBlock(DeviceControlRecord* dcr,
+                                       DeviceBlock* block,
                                        const DeviceRecord* rec)
 {
   uint32_t len;
 
   len = MIN(rec->remainder, BlockWriteNavail(block));
+  if (dcr->clone_blocks && rec->src_extents > 0) {
+    len = AddCloneExtents(block, rec, rec->data_len - rec->remainder, len);
+  }
   memcpy(block->bufp,
          ((unsigned char*)rec->data) + (rec->data_len - rec->remainder), len);
   block->bufp += len;
@@ -663,6 +720,7 @@ bool DeviceControlRecord::WriteRecord()
     after_rec = before_rec;
   } else {
     translated_record = true;
+    after_rec->src_extents = 0;
   }
 
   while (!WriteRecordToBlock(this, after_rec)) {
@@ -699,6 +757,54 @@ bail_out:
   return retval;
 }
 
+/**
+ * Return where the data of a record of data_len bytes goes if it is put into
+ * the current block as a whole behind its header, or nullptr if it does not
+ * fit. The caller can place the data there itself and then add the record
+ * with WriteRecordInBlock() instead of WriteRecord(), which saves copying it.
+ */
+char* DeviceControlRecord::RecordSpaceInBlock(uint32_t data_len)
+{
+  if (rec->state != st_none
+      || BlockWriteNavail(block) < WRITE_RECHDR_LENGTH + data_len) {
+    return nullptr;
+  }
+  return block->bufp + WRITE_RECHDR_LENGTH;
+}
+
+/**
+ * Add the record whose data was put where RecordSpaceInBlock() said to
+ * the current block. There is no record translation for such records.
+ *
+ * Returns: false if the job exceeded its quota.
+ */
+bool DeviceControlRecord::WriteRecordInBlock()
+{
+  char buf1[100], buf2[100];
+
+  ASSERT(rec->state == st_none);
+  ASSERT(BlockWriteNavail(block) >= WRITE_RECHDR_LENGTH + rec->data_len);
+
+  rec->remainder = rec->data_len;
+  WriteHeaderToBlock(block, rec, rec->Stream);
+  block->bufp += rec->data_len;
+  block->binbuf += rec->data_len;
+  rec->remainder = 0;
+
+  jcr->JobBytes += rec->data_len; /* increment bytes this job */
+  if (jcr->sd_impl->RemainingQuota
+      && jcr->JobBytes > jcr->sd_impl->RemainingQuota) {
+    Jmsg0(jcr, M_FATAL, 0, T_("Quota Exceeded. Job Terminated.\n"));
+    return false;
+  }
+
+  Dmsg4(850, "WriteRecordInBlock FI=%s SessId=%d Strm=%s len=%d\n",
+        FI_to_ascii(buf1, rec->FileIndex), rec->VolSessionId,
+        stream_to_ascii(buf2, rec->Stream, rec->FileIndex), rec->data_len);
+
+  return true;
+}
+
 /**
  * Write a Record to the block
  *
@@ -793,7 +899,7 @@ bool WriteRecordToBlock(DeviceControlRecord* dcr, DeviceRecord* rec)
          * Part of it may have already been transferred, and we
          * may not have enough room to transfer the whole this time. */
         if (rec->remainder > 0) {
-          n = WriteDataToBlock(block, rec);
+          n = WriteDataToBlock(dcr, block, rec);
           if (n < 0) {
             /* error appending data to block should be impossible
              * unless something is broken */
@@ -842,6 +948,38 @@ uint64_t GetRecordAddress(const DeviceRecord* rec)
   return ((uint64_t)rec->File) << 32 | rec->Block;
 }
 
+/**
+ * Remember where the next len bytes of record data live on the volume we are
+ * reading from. Pieces we cannot describe are simply not tracked and will
+ * be copied as usual when writing.
+ */
+static void TrackRecordSource(DeviceControlRecord* dcr,
+                              DeviceRecord* rec,
+                              uint32_t len)
+{
+  DeviceBlock* block = dcr->block;
+  Device* dev = dcr->dev;
+
+  if (rec->data_len == 0) { rec->src_extents = 0; }
+  if (!block->read_addr_valid || len == 0) { return; }
+  if (rec->src_extents >= REC_MAX_SOURCE_EXTENTS) { return; }
+
+  if (rec->src_extents == 0) {
+    rec->src_dev = dev;
+    rec->src_fd = dev->fd;
+    rec->src_generation = block->read_generation;
+  } else if (rec->src_dev != dev || rec->src_fd != dev->fd
+             || rec->src_generation != block->read_generation) {
+    // Continued on another volume, only the first part can be cloned.
+    return;
+  }
+
+  RecordSourceExtent& extent = rec->src_extent[rec->src_extents++];
+  extent.offset = rec->data_len;
+  extent.length = len;
+  extent.addr = block->read_addr + (block->bufp - block->buf);
+}
+
 /**
  * Read a Record from the block
  *
@@ -867,6 +1005,7 @@ bool ReadRecordFromBlock(DeviceControlRecord* dcr, DeviceRecord* rec)
 
   // Clear state flags
   ClearAllBits(REC_STATE_MAX, rec->state_bits);
+  rec->block_data = nullptr;
   if (dcr->block->dev->IsTape()) { SetBit(REC_ISTAPE, rec->state_bits); }
   rec->Block = ((Device*)(dcr->block->dev))->EndBlock;
   rec->File = ((Device*)(dcr->block->dev))->EndFile;
@@ -971,7 +1110,20 @@ bool ReadRecordFromBlock(DeviceControlRecord* dcr, DeviceRecord* rec)
     return false;
   }
 
-  rec->data = CheckPoolMemorySize(rec->data, rec->data_len + data_bytes);
+  /* A whole data record in this block can be used from there if the caller
+   * asked for it. Attributes stay in rec->data, the bootstrap fileregex
+   * matching unpacks them from there. */
+  const bool in_block = dcr->rec_data_in_block && FileIndex > 0
+                        && rec->data_len == 0 && remlen >= data_bytes
+                        && rec->maskedStream != STREAM_UNIX_ATTRIBUTES
+                        && rec->maskedStream != STREAM_UNIX_ATTRIBUTES_EX;
+
+  if (!in_block) {
+    rec->data = CheckPoolMemorySize(rec->data, rec->data_len + data_bytes);
+  }
+  if (dcr->track_rec_source) {
+    TrackRecordSource(dcr, rec, MIN(remlen, data_bytes));
+  }
 
   /* At this point, we have read the header, now we
    * must transfer as much of the data record as
@@ -981,7 +1133,11 @@ bool ReadRecordFromBlock(DeviceControlRecord* dcr, DeviceRecord* rec)
    * record. */
   if (remlen >= data_bytes) {
     // Got whole record
-    memcpy(rec->data + rec->data_len, dcr->block->bufp, data_bytes);
+    if (in_block) {
+      rec->block_data = dcr->block->bufp;
+    } else {
+      memcpy(rec->data + rec->data_len, dcr->block->bufp, data_bytes);
+    }
     dcr->block->bufp += data_bytes;
     dcr->block->binbuf -= data_bytes;
     rec->data_len += data_bytes;
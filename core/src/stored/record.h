@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2012 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2021 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -97,6 +97,19 @@ enum
 #define IsPartialRecord(r) (BitIsSet(REC_PARTIAL_RECORD, (r)->state_bits))
 #define IsBlockEmpty(r) (BitIsSet(REC_BLOCK_EMPTY, (r)->state_bits))
 
+// Maximum number of pieces of a record we track the volume location for.
+#define REC_MAX_SOURCE_EXTENTS 4
+
+/*
+ * Part of the record data that was read verbatim from a volume.
+ * Used to clone unchanged data instead of rewriting it.
+ */
+struct RecordSourceExtent {
+  uint32_t offset; /**< Offset into the record data */
+  uint32_t length; /**< Number of bytes */
+  uint64_t addr;   /**< Byte address on the volume it was read from */
+};
+
 /*
  * DeviceRecord for reading and writing records.
  * It consists of a Record Header, and the Record Data
@@ -104,6 +117,7 @@ enum
  * This is the memory structure for the record header.
  */
 struct BootStrapRecord; /* satisfy forward reference */
+class Device;           /* satisfy forward reference */
 struct DeviceRecord {
   dlink<DeviceRecord> link; /**< link for chaining in read_record.c */
   /**<
@@ -128,6 +142,22 @@ struct DeviceRecord {
   int32_t last_FileIndex{0};
   int32_t last_Stream{0};  /**< Used in SD-SD replication */
   bool own_mempool{false}; /**< Do we own the POOLMEM pointed to in data ? */
+  /**<
+   * Set instead of data when the reading DeviceControlRecord leaves whole
+   * records in its block, valid until the next record is read.
+   */
+  const char* block_data{nullptr};
+  /**<
+   * Where the data was read from, only filled when the reading
+   * DeviceControlRecord tracks it for block cloning. Pieces of the record
+   * beyond REC_MAX_SOURCE_EXTENTS or on another volume are not tracked
+   * and get copied when writing.
+   */
+  Device* src_dev{nullptr};       /**< Device the data was read from */
+  int src_fd{-1};                 /**< File descriptor the data was read from */
+  uint32_t src_generation{0};     /**< Open generation of src_dev */
+  int32_t src_extents{0};         /**< Number of valid src_extent entries */
+  RecordSourceExtent src_extent[REC_MAX_SOURCE_EXTENTS]{};
 };
 
 /*
@@ -143,6 +173,7 @@ struct DeviceRecord {
 #define EOT_LABEL -6 /**< End of physical tape (2 eofs) */
 #define SOB_LABEL -7 /**< Start of object -- file/directory */
 #define EOB_LABEL -8 /**< End of object (after all streams) */
+#define FILL_LABEL -9 /**< Padding used to align cloned data */
 
 /*
  * Volume Label Record.  This is the in-memory definition. The
@@ -2,7 +2,7 @@
    BAREOS® - Backup Archiving REcovery Open Sourced
 
    Copyright (C) 2000-2012 Free Software Foundation Europe e.V.
-   Copyright (C) 2016-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2016-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -43,6 +43,10 @@
 #include "include/jcr.h"
 #include "lib/parse_conf.h"
 
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 namespace storagedaemon {
 
 const int debuglevel = 150;
@@ -52,6 +56,15 @@ static int reservations_lock_count = 0;
 
 static brwlock_t reservation_lock;
 
+/* Autochanger and device resources by name and devices by media type, so a
+ * use device command does not walk all resources. The configuration does not
+ * change after the reservation system got initialized, so the indices are
+ * only read afterwards and need no lock. */
+static std::unordered_map<std::string, AutochangerResource*> changer_index;
+static std::unordered_map<std::string, DeviceResource*> device_index;
+static std::unordered_map<std::string, std::vector<DeviceResource*>>
+    media_type_index;
+
 /* Forward referenced functions */
 static int CanReserveDrive(DeviceControlRecord* dcr, ReserveContext& rctx);
 static int ReserveDevice(ReserveContext& rctx);
@@ -87,6 +100,26 @@ bool use_cmd(JobControlRecord* jcr)
   return true;
 }
 
+static void InitResourceIndices()
+{
+  AutochangerResource* changer;
+  DeviceResource* device_resource;
+
+  changer_index.clear();
+  device_index.clear();
+  media_type_index.clear();
+
+  foreach_res (changer, R_AUTOCHANGER) {
+    changer_index.emplace(changer->resource_name_, changer);
+  }
+  foreach_res (device_resource, R_DEVICE) {
+    device_index.emplace(device_resource->resource_name_, device_resource);
+    if (device_resource->media_type) {
+      media_type_index[device_resource->media_type].push_back(device_resource);
+    }
+  }
+}
+
 /**
  * This allows a given thread to recursively call LockReservations.
  * It must, of course, call unlock_... the same number of times.
@@ -101,12 +134,16 @@ void InitReservationsLock()
   }
 
   InitVolListLock();
+  InitResourceIndices();
 }
 
 void TermReservationsLock()
 {
   RwlDestroy(&reservation_lock);
   TermVolListLock();
+  changer_index.clear();
+  device_index.clear();
+  media_type_index.clear();
 }
 
 // This applies to a drive and to Volumes
@@ -382,6 +419,35 @@ static bool IsVolInAutochanger(ReserveContext& rctx, VolumeReservationItem* vol)
   return false;
 }
 
+/**
+ * Check if the device of a reserved volume is one of the devices the job
+ * asked for, before asking the Director about the volume.
+ */
+static bool IsVolOnRequestedDevice(alist<DirectorStorage*>* dirstore,
+                                   VolumeReservationItem* vol)
+{
+  DirectorStorage* store = nullptr;
+  const char* device_name = nullptr;
+  AutochangerResource* changer = vol->dev->device_resource->changer_res;
+
+  if (vol->dev->AttachedToAutochanger()) {
+    if (!changer || !vol->dev->autoselect) { return false; }
+  }
+
+  foreach_alist (store, dirstore) {
+    foreach_alist (device_name, store->device) {
+      if (vol->dev->AttachedToAutochanger()) {
+        if (bstrcmp(device_name, changer->resource_name_)) { return true; }
+      } else if (bstrcmp(device_name,
+                         vol->dev->device_resource->resource_name_)) {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
 /**
  * Search for a device suitable for this job.
  *
@@ -425,6 +491,14 @@ bool FindSuitableDeviceForJob(JobControlRecord* jcr, ReserveContext& rctx)
         continue;
       }
 
+      /* Only ask the Director about volumes we could use, as this is a
+       * network round trip done with the reservations locked. */
+      if (!IsVolOnRequestedDevice(dirstore, vol)) {
+        Dmsg1(debuglevel, "vol=%s not on a requested device\n",
+              vol->vol_name);
+        continue;
+      }
+
       // Check with Director if this Volume is OK
       bstrncpy(dcr->VolumeName, vol->vol_name, sizeof(dcr->VolumeName));
       if (!dcr->DirGetVolumeInfo(GET_VOL_INFO_FOR_WRITE)) { continue; }
@@ -526,55 +600,51 @@ bool FindSuitableDeviceForJob(JobControlRecord* jcr, ReserveContext& rctx)
 int SearchResForDevice(ReserveContext& rctx)
 {
   int status;
-  AutochangerResource* changer;
 
   // Look through Autochangers first
-  foreach_res (changer, R_AUTOCHANGER) {
-    Dmsg2(debuglevel, "Try match changer res=%s, wanted %s\n",
-          changer->resource_name_, rctx.device_name);
-    // Find resource, and make sure we were able to open it
-    if (bstrcmp(rctx.device_name, changer->resource_name_)) {
-      // Try each device_resource in this AutoChanger
-      foreach_alist (rctx.device_resource, changer->device_resources) {
-        Dmsg1(debuglevel, "Try changer device %s\n",
+  Dmsg1(debuglevel, "Try match changer res, wanted %s\n", rctx.device_name);
+  if (auto found = changer_index.find(rctx.device_name);
+      found != changer_index.end()) {
+    AutochangerResource* changer = found->second;
+
+    // Try each device_resource in this AutoChanger
+    foreach_alist (rctx.device_resource, changer->device_resources) {
+      Dmsg1(debuglevel, "Try changer device %s\n",
+            rctx.device_resource->resource_name_);
+      if (!rctx.device_resource->autoselect) {
+        Dmsg1(100, "Device %s not autoselect skipped.\n",
               rctx.device_resource->resource_name_);
-        if (!rctx.device_resource->autoselect) {
-          Dmsg1(100, "Device %s not autoselect skipped.\n",
-                rctx.device_resource->resource_name_);
-          continue; /* Device is not available */
-        }
-        status = ReserveDevice(rctx);
-        if (status != 1) { /* Try another device */
-          continue;
-        }
+        continue; /* Device is not available */
+      }
+      status = ReserveDevice(rctx);
+      if (status != 1) { /* Try another device */
+        continue;
+      }
 
-        // Debug code
-        if (rctx.store->append == SD_APPEND) {
-          Dmsg2(debuglevel, "Device %s reserved=%d for append.\n",
-                rctx.device_resource->resource_name_,
-                rctx.jcr->sd_impl->dcr->dev->NumReserved());
-        } else {
-          Dmsg2(debuglevel, "Device %s reserved=%d for read.\n",
-                rctx.device_resource->resource_name_,
-                rctx.jcr->sd_impl->read_dcr->dev->NumReserved());
-        }
-        return status;
+      // Debug code
+      if (rctx.store->append == SD_APPEND) {
+        Dmsg2(debuglevel, "Device %s reserved=%d for append.\n",
+              rctx.device_resource->resource_name_,
+              rctx.jcr->sd_impl->dcr->dev->NumReserved());
+      } else {
+        Dmsg2(debuglevel, "Device %s reserved=%d for read.\n",
+              rctx.device_resource->resource_name_,
+              rctx.jcr->sd_impl->read_dcr->dev->NumReserved());
       }
+      return status;
     }
   }
 
   // Now if requested look through regular devices
   if (!rctx.autochanger_only) {
-    foreach_res (rctx.device_resource, R_DEVICE) {
-      Dmsg2(debuglevel, "Try match res=%s wanted %s\n",
-            rctx.device_resource->resource_name_, rctx.device_name);
-
-      // Find resource, and make sure we were able to open it
-      if (bstrcmp(rctx.device_name, rctx.device_resource->resource_name_)) {
-        status = ReserveDevice(rctx);
-        if (status != 1) { /* Try another device_resource */
-          continue;
-        }
+    Dmsg1(debuglevel, "Try match res, wanted %s\n", rctx.device_name);
+
+    // Find resource, and make sure we were able to open it
+    if (auto found = device_index.find(rctx.device_name);
+        found != device_index.end()) {
+      rctx.device_resource = found->second;
+      status = ReserveDevice(rctx);
+      if (status == 1) {
         // Debug code
         if (rctx.store->append == SD_APPEND) {
           Dmsg2(debuglevel, "Device %s reserved=%d for append.\n",
@@ -593,13 +663,12 @@ int SearchResForDevice(ReserveContext& rctx)
      * devicereservebymediatype option is set we try one more time where we
      * allow any device_resource with a matching mediatype. */
     if (me->device_reserve_by_mediatype) {
-      foreach_res (rctx.device_resource, R_DEVICE) {
-        Dmsg3(debuglevel,
-              "Try match res=%s, mediatype=%s wanted mediatype=%s\n",
-              rctx.device_resource->resource_name_, rctx.store->media_type,
-              rctx.store->media_type);
+      Dmsg1(debuglevel, "Try match mediatype=%s\n", rctx.store->media_type);
 
-        if (bstrcmp(rctx.store->media_type, rctx.device_resource->media_type)) {
+      if (auto found = media_type_index.find(rctx.store->media_type);
+          found != media_type_index.end()) {
+        for (DeviceResource* device_resource : found->second) {
+          rctx.device_resource = device_resource;
           status = ReserveDevice(rctx);
           if (status != 1) { /* Try another device_resource */
             continue;
@@ -3,7 +3,7 @@
 
    Copyright (C) 2007-2011 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -359,6 +359,22 @@ bail_out:
   return rc;
 }
 
+// See if any plugin of the job would get the event, e.g. translate records.
+bool PluginEventEnabled(JobControlRecord* jcr, bSdEventType eventType)
+{
+  int i;
+  PluginContext* ctx;
+
+  if (!sd_plugin_list || !jcr || !jcr->plugin_ctx_list) { return false; }
+
+  foreach_alist_index (i, ctx, jcr->plugin_ctx_list) {
+    if (IsEventEnabled(ctx, eventType) && !IsPluginDisabled(ctx)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 // Print to file the plugin info.
 void DumpSdPlugin(Plugin* plugin, FILE* fp)
 {
@@ -651,6 +667,9 @@ static bRC bareosGetValue(PluginContext* ctx, bsdrVariable var, void* value)
       Dmsg1(debuglevel, "sd-plugin: return bsdVarPluginDir=%s\n",
             me->plugin_directory);
       break;
+    case bsdVarPythonPluginOwnGil:
+      *((bool*)value) = me->python_plugin_own_gil;
+      break;
     default:
       if (!ctx) { return bRC_Error; }
 
@@ -3,7 +3,7 @@
 
    Copyright (C) 2007-2011 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -68,7 +68,8 @@ typedef enum
   bsdVarJobErrors = 13,
   bsdVarJobFiles = 14,
   bsdVarJobBytes = 15,
-  bsdVarPluginDir = 16
+  bsdVarPluginDir = 16,
+  bsdVarPythonPluginOwnGil = 17
 } bsdrVariable;
 
 // Bareos Variable Ids (Write)
@@ -173,6 +174,7 @@ bRC GeneratePluginEvent(JobControlRecord* jcr,
                         bSdEventType event,
                         void* value = NULL,
                         bool reverse = false);
+bool PluginEventEnabled(JobControlRecord* jcr, bSdEventType eventType);
 #endif
 
 // Plugin definitions
@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2009 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -29,6 +29,7 @@
 #include "include/bareos.h"
 #include "stored/stored_conf.h"
 #include "stored/autochanger_resource.h"
+#include "stored/changer_scheduler.h"
 #include "stored/device_resource.h"
 #include "stored/stored.h"
 #include "stored/stored_globals.h"
@@ -86,8 +87,12 @@ static ResourceItem store_items[] = {
 #endif
   {"PluginDirectory", CFG_TYPE_DIR, ITEM(res_store, plugin_directory), 0, 0, NULL, NULL, NULL},
   {"PluginNames", CFG_TYPE_PLUGIN_NAMES, ITEM(res_store, plugin_names), 0, 0, NULL, NULL, NULL},
+  {"PythonPluginOwnGil", CFG_TYPE_BOOL, ITEM(res_store, python_plugin_own_gil), 0, CFG_ITEM_DEFAULT, "false", "24.0.0-",
+      "Run every Python plugin instance in a sub-interpreter with its own GIL (requires Python >= 3.12)."},
   {"ScriptsDirectory", CFG_TYPE_DIR, ITEM(res_store, scripts_directory), 0, 0, NULL, NULL, NULL},
   {"MaximumConcurrentJobs", CFG_TYPE_PINT32, ITEM(res_store, MaxConcurrentJobs), 0, CFG_ITEM_DEFAULT, "20", NULL, NULL},
+  {"MaximumConcurrentReadDevices", CFG_TYPE_PINT32, ITEM(res_store, max_concurrent_read_devices), 0, CFG_ITEM_DEFAULT, "1", "24.0.0-",
+      "Number of devices a local copy, migration or consolidation job may read its source volumes from at the same time."},
   {"Messages", CFG_TYPE_RES, ITEM(res_store, messages), R_MSGS, 0, NULL, NULL, NULL},
   {"SdConnectTimeout", CFG_TYPE_TIME, ITEM(res_store, SDConnectTimeout), 0, CFG_ITEM_DEFAULT, "1800" /* 30 minutes */, NULL, NULL},
   {"FdConnectTimeout", CFG_TYPE_TIME, ITEM(res_store, FDConnectTimeout), 0, CFG_ITEM_DEFAULT, "1800" /* 30 minutes */, NULL, NULL},
@@ -196,6 +201,15 @@ static ResourceItem dev_items[] = {
   {"SpoolDirectory", CFG_TYPE_DIR, ITEM(res_dev, spool_directory), 0, 0, NULL, NULL, NULL},
   {"MaximumSpoolSize", CFG_TYPE_SIZE64, ITEM(res_dev, max_spool_size), 0, 0, NULL, NULL, NULL},
   {"MaximumJobSpoolSize", CFG_TYPE_SIZE64, ITEM(res_dev, max_job_spool_size), 0, 0, NULL, NULL, NULL},
+  {"TapeStreamingBufferSize", CFG_TYPE_SIZE64, ITEM(res_dev, tape_streaming_buffer_size), 0, CFG_ITEM_DEFAULT, "0", "24.0.0-",
+      "Size of an in-memory buffer that collects the blocks written to a tape drive, so the drive is fed in "
+      "long bursts at full speed instead of stopping and repositioning when the data arrives too slowly. "
+      "0 disables the buffer."},
+  {"TapeStreamingHighWatermark", CFG_TYPE_PINT32, ITEM(res_dev, tape_streaming_high_watermark), 0, CFG_ITEM_DEFAULT, "90", "24.0.0-",
+      "Fill level of the Tape Streaming Buffer in percent at which writing to the drive starts."},
+  {"TapeStreamingLowWatermark", CFG_TYPE_PINT32, ITEM(res_dev, tape_streaming_low_watermark), 0, CFG_ITEM_DEFAULT, "10", "24.0.0-",
+      "Fill level of the Tape Streaming Buffer in percent at which writing to the drive pauses until the "
+      "High Watermark is reached again."},
   {"DriveIndex", CFG_TYPE_PINT16, ITEM(res_dev, drive_index), 0, 0, NULL, NULL, NULL},
   {"MountPoint", CFG_TYPE_STRNAME, ITEM(res_dev, mount_point), 0, 0, NULL, NULL, NULL},
   {"MountCommand", CFG_TYPE_STRNAME, ITEM(res_dev, mount_command), 0, 0, NULL, NULL, NULL},
@@ -213,6 +227,13 @@ static ResourceItem dev_items[] = {
   {"EofOnErrorIsEot", CFG_TYPE_BOOL, ITEM(res_dev, eof_on_error_is_eot), 0, CFG_ITEM_DEFAULT, NULL, "18.2.4-",
       "If Yes, Bareos will treat any read error at an end-of-file mark as end-of-tape. You should only set "
       "this option if your tape-drive fails to detect end-of-tape while reading."},
+  {"BlockCloning", CFG_TYPE_BOOL, ITEM(res_dev, block_cloning), 0, CFG_ITEM_DEFAULT, "false", "24.0.0-",
+      "If Yes, copy, migration and virtual full jobs reading from and writing to file devices let the filesystem "
+      "share unchanged data with the source volumes (reflinks) instead of copying it. This requires a filesystem "
+      "that supports it, like XFS or Btrfs, and costs some padding on the written volumes."},
+  {"ReceiveIntoBlock", CFG_TYPE_BOOL, ITEM(res_dev, receive_into_block), 0, CFG_ITEM_DEFAULT, "false", "24.0.0-",
+      "If Yes, backup data is received from the network straight into the block that is written to the device, "
+      "instead of being received ahead by a separate thread and copied into the block."},
   {"Count", CFG_TYPE_PINT32, ITEM(res_dev, count), 0, CFG_ITEM_DEFAULT, "1", NULL, "If Count is set to (1 < Count < 10000), "
   "this resource will be multiplied Count times. The names of multiplied resources will have a serial number (0001, 0002, ...) attached. "
   "If set to 1 only this single resource will be used and its name will not be altered."},
@@ -225,6 +246,8 @@ static ResourceItem autochanger_items[] = {
   {"Device", CFG_TYPE_ALIST_RES, ITEM(res_changer, device_resources), R_DEVICE, CFG_ITEM_REQUIRED, NULL, NULL, NULL},
   {"ChangerDevice", CFG_TYPE_STRNAME, ITEM(res_changer, changer_name), 0, CFG_ITEM_REQUIRED, NULL, NULL, NULL},
   {"ChangerCommand", CFG_TYPE_STRNAME, ITEM(res_changer, changer_command), 0, CFG_ITEM_REQUIRED, NULL, NULL, NULL},
+  {"MaximumConcurrentOperations", CFG_TYPE_PINT32, ITEM(res_changer, max_concurrent_operations), 0, CFG_ITEM_DEFAULT, "1", "24.0.0-",
+      "Number of changer commands that may run at the same time for different drives and slots."},
   {nullptr, 0, 0, nullptr, 0, 0, nullptr, nullptr, nullptr}
 };
 
@@ -803,12 +826,8 @@ static bool SaveResource(int type, ResourceItem* items, int pass)
           DeviceResource* q = nullptr;
           foreach_alist (q, p->device_resources) { q->changer_res = p; }
 
-          int errstat;
-          if ((errstat = RwlInit(&p->changer_lock, PRIO_SD_ACH_ACCESS)) != 0) {
-            BErrNo be;
-            Jmsg1(NULL, M_ERROR_TERM, 0, T_("Unable to init lock: ERR=%s\n"),
-                  be.bstrerror(errstat));
-          }
+          p->scheduler
+              = new ChangerOperationScheduler(p->max_concurrent_operations);
         }
         break;
       }
@@ -914,7 +933,7 @@ static void FreeResource(BareosResource* res, int type)
       if (p->changer_name) { free(p->changer_name); }
       if (p->changer_command) { free(p->changer_command); }
       if (p->device_resources) { delete p->device_resources; }
-      RwlDestroy(&p->changer_lock);
+      if (p->scheduler) { delete p->scheduler; }
       delete p;
       break;
     }
@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2011 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -103,9 +103,12 @@ class StorageResource
   char* working_directory = nullptr; /**< Working directory for checkpoints */
   char* plugin_directory = nullptr;  /**< Plugin directory */
   alist<const char*>* plugin_names = nullptr;
+  bool python_plugin_own_gil = false; /**< Python plugins get their own GIL */
   char* scripts_directory = nullptr;
   std::vector<std::string> backend_directories;
   uint32_t MaxConcurrentJobs = 0;      /**< Maximum concurrent jobs to run */
+  uint32_t max_concurrent_read_devices = 0; /**< Devices a job may read from
+                                                at the same time */
   uint32_t ndmploglevel = 0;           /**< Initial NDMP log level */
   uint32_t jcr_watchdog_time = 0;      /**< Absolute time after which a Job gets
                                       terminated regardless of its progress */
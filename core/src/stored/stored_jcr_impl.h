@@ -98,6 +98,7 @@ struct StoredJcrImpl {
   bool PreferMountedVols{};       /**< Prefer mounted vols rather than new */
   bool insert_jobmedia_records{}; /**< Need to insert job media records */
   uint64_t RemainingQuota{};      /**< Available bytes to use as quota */
+  JobControlRecord* parent_jcr{}; /**< Job a parallel read helper reads for */
 
   storagedaemon::ReadSession read_session;
   storagedaemon::DeviceWaitTimes device_wait_times;
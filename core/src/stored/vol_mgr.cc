@@ -2,7 +2,7 @@
    BAREOS® - Backup Archiving REcovery Open Sourced
 
    Copyright (C) 2000-2013 Free Software Foundation Europe e.V.
-   Copyright (C) 2015-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2015-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -32,10 +32,14 @@
 #include "stored/stored.h"
 #include "stored/stored_globals.h"
 #include "stored/device_control_record.h"
+#include "stored/stored_jcr_impl.h"
 #include "stored/autochanger.h"
 #include "include/jcr.h"
 #include "lib/berrno.h"
 
+#include <string>
+#include <unordered_map>
+
 namespace storagedaemon {
 
 const int debuglevel = 150;
@@ -45,6 +49,13 @@ static dlist<VolumeReservationItem>* vol_list = NULL;
 static dlist<VolumeReservationItem>* read_vol_list = NULL;
 static pthread_mutex_t read_vol_lock = PTHREAD_MUTEX_INITIALIZER;
 
+/* Hashed indices on the volume lists, so looking up a volume does not need to
+ * walk the lists. vol_index is protected by vol_list_lock and read_vol_index
+ * by read_vol_lock like the lists themselves. */
+static std::unordered_map<std::string, VolumeReservationItem*> vol_index;
+static std::unordered_multimap<std::string, VolumeReservationItem*>
+    read_vol_index;
+
 /* Global static variables */
 static int vol_list_lock_count = 0;
 static int read_vol_list_lock_count = 0;
@@ -140,6 +151,17 @@ void UnlockReadVolumes()
   pthread_mutex_unlock(&read_vol_lock);
 }
 
+/*
+ * Parallel read helpers run as JobId 0, their read volumes are kept under
+ * the JobId of the job they read for.
+ */
+static uint32_t ReadVolumeJobId(JobControlRecord* jcr)
+{
+  JobControlRecord* parent = jcr->sd_impl->parent_jcr;
+
+  return parent ? parent->JobId : jcr->JobId;
+}
+
 /**
  * Add a volume to the read list.
  *
@@ -157,7 +179,7 @@ void AddReadVolume(JobControlRecord* jcr, const char* VolumeName)
   VolumeReservationItem *nvol, *vol;
 
   nvol = new_vol_item(NULL, VolumeName);
-  nvol->SetJobid(jcr->JobId);
+  nvol->SetJobid(ReadVolumeJobId(jcr));
   nvol->SetReading();
   LockReadVolumes();
   vol = (VolumeReservationItem*)read_vol_list->binary_insert(nvol, ReadCompare);
@@ -166,6 +188,7 @@ void AddReadVolume(JobControlRecord* jcr, const char* VolumeName)
     Dmsg2(debuglevel, "read_vol=%s JobId=%d already in list.\n", VolumeName,
           jcr->JobId);
   } else {
+    read_vol_index.emplace(VolumeName, nvol);
     Dmsg2(debuglevel, "add_read_vol=%s JobId=%d\n", VolumeName, jcr->JobId);
   }
   UnlockReadVolumes();
@@ -178,7 +201,7 @@ void RemoveReadVolume(JobControlRecord* jcr, const char* VolumeName)
 
   LockReadVolumes();
   vol.vol_name = strdup(VolumeName);
-  vol.SetJobid(jcr->JobId);
+  vol.SetJobid(ReadVolumeJobId(jcr));
 
   fvol
       = (VolumeReservationItem*)read_vol_list->binary_search(&vol, ReadCompare);
@@ -189,6 +212,13 @@ void RemoveReadVolume(JobControlRecord* jcr, const char* VolumeName)
           jcr->JobId, fvol != NULL);
   }
   if (fvol) {
+    auto range = read_vol_index.equal_range(VolumeName);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second == fvol) {
+        read_vol_index.erase(it);
+        break;
+      }
+    }
     read_vol_list->remove(fvol);
     FreeVolItem(fvol);
   }
@@ -204,7 +234,7 @@ void RemoveReadVolume(JobControlRecord* jcr, const char* VolumeName)
  */
 static VolumeReservationItem* find_read_volume(const char* VolumeName)
 {
-  VolumeReservationItem vol, *fvol;
+  VolumeReservationItem* fvol = NULL;
 
   if (read_vol_list->empty()) {
     Dmsg0(debuglevel, "find_read_vol: read_vol_list empty.\n");
@@ -213,12 +243,11 @@ static VolumeReservationItem* find_read_volume(const char* VolumeName)
 
   // Do not lock reservations here
   LockReadVolumes();
-  vol.vol_name = strdup(VolumeName);
 
-  // Note, we do want a simple CompareByVolumename on volume name only here
-  fvol = (VolumeReservationItem*)read_vol_list->binary_search(
-      &vol, CompareByVolumename);
-  free(vol.vol_name);
+  /* The read list is sorted by JobId first, so look the name up in the index
+   * instead of searching the list. */
+  auto found = read_vol_index.find(VolumeName);
+  if (found != read_vol_index.end()) { fvol = found->second; }
 
   Dmsg2(debuglevel, "find_read_vol=%s found=%d\n", VolumeName, fvol != NULL);
   UnlockReadVolumes();
@@ -413,7 +442,7 @@ VolumeReservationItem* reserve_volume(DeviceControlRecord* dcr,
    * accesses by multiple readers at once without disturbing each other. */
   if (me->filedevice_concurrent_read && !dcr->IsWriting()
       && dcr->dev->CanReadConcurrently()) {
-    nvol->SetJobid(dcr->jcr->JobId);
+    nvol->SetJobid(ReadVolumeJobId(dcr->jcr));
     nvol->SetReading();
     vol = nvol;
     dcr->dev->vol = vol;
@@ -421,10 +450,14 @@ VolumeReservationItem* reserve_volume(DeviceControlRecord* dcr,
     /* Read volumes on file based devices are not inserted into the write volume
      * list. */
     goto get_out;
+  } else if (auto found = vol_index.find(VolumeName);
+             found != vol_index.end()) {
+    vol = found->second;
   } else {
-    // Now try to insert the new Volume
+    // Now insert the new Volume
     vol = (VolumeReservationItem*)vol_list->binary_insert(nvol,
                                                           CompareByVolumename);
+    vol_index.emplace(VolumeName, vol);
   }
 
   if (vol != nvol) {
@@ -652,15 +685,13 @@ void ReadVolWalkEnd(VolumeReservationItem* vol)
  */
 static VolumeReservationItem* find_volume(const char* VolumeName)
 {
-  VolumeReservationItem vol, *fvol;
+  VolumeReservationItem* fvol = NULL;
 
   if (vol_list->empty()) { return NULL; }
   /* Do not lock reservations here */
   LockVolumes();
-  vol.vol_name = strdup(VolumeName);
-  fvol = (VolumeReservationItem*)vol_list->binary_search(&vol,
-                                                         CompareByVolumename);
-  free(vol.vol_name);
+  auto found = vol_index.find(VolumeName);
+  if (found != vol_index.end()) { fvol = found->second; }
   Dmsg2(debuglevel, "find_vol=%s found=%d\n", VolumeName, fvol != NULL);
 
   if (debug_level >= debuglevel) { DebugListVolumes("find_volume"); }
@@ -747,6 +778,10 @@ bool FreeVolume(Device* dev)
     if (vol->IsWriting() || !me->filedevice_concurrent_read
         || !dev->CanReadConcurrently()) {
       vol_list->remove(vol);
+      if (auto found = vol_index.find(vol->vol_name);
+          found != vol_index.end() && found->second == vol) {
+        vol_index.erase(found);
+      }
     }
     Dmsg2(debuglevel, "=== remove volume %s dev=%s\n", vol->vol_name,
           dev->print_name());
@@ -798,6 +833,7 @@ void FreeVolumeLists()
     FreeVolumeList("vol_list", vol_list);
     delete vol_list;
     vol_list = NULL;
+    vol_index.clear();
     UnlockVolumes();
   }
 
@@ -806,6 +842,7 @@ void FreeVolumeLists()
     FreeVolumeList("read_vol_list", read_vol_list);
     delete read_vol_list;
     read_vol_list = NULL;
+    read_vol_index.clear();
     UnlockReadVolumes();
   }
 }
@@ -886,16 +923,19 @@ dlist<VolumeReservationItem>* dup_vol_list(JobControlRecord* jcr)
   foreach_vol (vol) {
     VolumeReservationItem *nvol, *tvol;
 
+    /* The volume list is sorted already, so appending keeps the copy sorted
+     * and a duplicate can only be the last item. */
     tvol = new_vol_item(NULL, vol->vol_name);
     tvol->dev = vol->dev;
-    nvol = (VolumeReservationItem*)temp_vol_list->binary_insert(
-        tvol, CompareByVolumename);
-    if (tvol != nvol) {
+    nvol = temp_vol_list->last();
+    if (nvol && CompareByVolumename(tvol, nvol) == 0) {
       tvol->dev = NULL; /* don't zap dev entry */
       FreeVolItem(tvol);
       Pmsg0(000, "Logic error. Duplicating vol list hit duplicate.\n");
       Jmsg(jcr, M_WARNING, 0,
            "Logic error. Duplicating vol list hit duplicate.\n");
+    } else {
+      temp_vol_list->append(tvol);
     }
   }
   endeach_vol(vol);
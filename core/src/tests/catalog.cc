@@ -1,7 +1,7 @@
 /*
    BAREOS® - Backup Archiving REcovery Open Sourced
 
-   Copyright (C) 2019-2023 Bareos GmbH & Co. KG
+   Copyright (C) 2019-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -164,3 +164,66 @@ TEST_F(CatalogTest, database)
 
   EXPECT_EQ(time_converted, StrToUtime("2019-11-27 15:04:49"));
 }
+
+TEST_F(CatalogTest, pooled_connections_are_reused)
+{
+  auto* catalog = jcr->dir_impl->res.catalog;
+
+  ASSERT_TRUE(db_sql_pool_initialize(
+      catalog->db_driver, catalog->db_name, catalog->db_user,
+      catalog->db_password.value, catalog->db_address, catalog->db_port,
+      catalog->db_socket, catalog->disable_batch_insert,
+      catalog->try_reconnect, catalog->exit_on_fatal, 1, 2, 1, 60, 30));
+
+  BareosDb* first = directordaemon::GetDatabaseConnection(jcr);
+  ASSERT_NE(first, nullptr);
+  ASSERT_TRUE(first->SqlQuery("CREATE TEMPORARY TABLE pool_test (i INT)", 0));
+  DbSqlClosePooledConnection(jcr, first);
+
+  // The idle connection is handed out again with a clean session.
+  BareosDb* second = directordaemon::GetDatabaseConnection(jcr);
+  EXPECT_EQ(second, first);
+  EXPECT_TRUE(second->SqlQuery("CREATE TEMPORARY TABLE pool_test (i INT)", 0));
+  DbSqlClosePooledConnection(jcr, second);
+
+  auto statistics = DbSqlPoolStatistics();
+  ASSERT_EQ(statistics.size(), 1u);
+  EXPECT_EQ(statistics[0].requests, 2u);
+  EXPECT_EQ(statistics[0].reused, 2u);
+  EXPECT_EQ(statistics[0].interactive_in_use, 0);
+}
+
+static int CollectRows(void* ctx, int, char** row)
+{
+  static_cast<std::vector<std::string>*>(ctx)->emplace_back(row[0]);
+  return 0;
+}
+
+TEST_F(CatalogTest, pipelined_queries)
+{
+  std::vector<std::string> rows;
+  std::vector<PipelinedQuery> queries{
+      {"CREATE TEMPORARY TABLE pipeline_test (i INT)"},
+      {"INSERT INTO pipeline_test VALUES (1), (2), (3)"},
+      {"SELECT i FROM pipeline_test ORDER BY i", CollectRows, &rows},
+      {"UPDATE pipeline_test SET i = i + 10 WHERE i > 1"}};
+
+  ASSERT_TRUE(db->SqlQueryPipeline(queries));
+  EXPECT_EQ(queries[1].affected_rows, 3);
+  EXPECT_EQ(queries[2].affected_rows, 3);
+  EXPECT_EQ(queries[3].affected_rows, 2);
+  EXPECT_EQ(rows, (std::vector<std::string>{"1", "2", "3"}));
+
+  // A failing statement stops the batch and leaves the connection usable
+  std::vector<PipelinedQuery> failing{
+      {"INSERT INTO pipeline_test VALUES (4)"},
+      {"INSERT INTO pipeline_test VALUES ('not a number')"},
+      {"INSERT INTO pipeline_test VALUES (5)"}};
+  EXPECT_FALSE(db->SqlQueryPipeline(failing));
+  EXPECT_EQ(failing[2].affected_rows, -1);
+
+  rows.clear();
+  ASSERT_TRUE(db->SqlQuery("SELECT i FROM pipeline_test WHERE i = 5",
+                           CollectRows, &rows));
+  EXPECT_TRUE(rows.empty());
+}
@@ -0,0 +1,9 @@
+host = localhost:9000
+use_https = false
+access_key = minioadmin
+secret_key = minioadmin
+pricing_dir = ""
+aws_auth_sign_version = 4       # Currently, AWS S3 uses version 4. The Ceph S3 gateway uses version 2.
+aws_region = eu-central-1
+backend = posix
+base_path = /root/repo/_gate_build/core/src/tests
@@ -0,0 +1,224 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+
+#if defined(HAVE_MINGW)
+#  include "include/bareos.h"
+#  include "gtest/gtest.h"
+#else
+#  include "gtest/gtest.h"
+#  include "include/bareos.h"
+#endif
+
+#include "lib/event_loop.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+// Polls cond for at most two seconds
+template <typename F> static bool Eventually(F cond)
+{
+  auto deadline = std::chrono::steady_clock::now() + 2s;
+  while (!cond()) {
+    if (std::chrono::steady_clock::now() > deadline) { return false; }
+    std::this_thread::sleep_for(5ms);
+  }
+  return true;
+}
+
+TEST(event_loop, run_after_runs_once_after_delay)
+{
+  EventLoop loop(2);
+  std::atomic<int> runs{0};
+  auto start = std::chrono::steady_clock::now();
+  std::atomic<std::chrono::steady_clock::time_point> ran_at{};
+
+  loop.RunAfter(100ms, [&]() {
+    ran_at = std::chrono::steady_clock::now();
+    runs++;
+  });
+
+  EXPECT_TRUE(Eventually([&]() { return runs == 1; }));
+  EXPECT_GE(ran_at.load() - start, 100ms);
+  std::this_thread::sleep_for(300ms);
+  EXPECT_EQ(runs, 1);
+  EXPECT_EQ(loop.NumEvents(), 0u);
+}
+
+TEST(event_loop, run_every_repeats_until_cancelled)
+{
+  EventLoop loop(2);
+  std::atomic<int> runs{0};
+
+  auto id = loop.RunEvery(20ms, [&]() { runs++; });
+  EXPECT_TRUE(Eventually([&]() { return runs >= 3; }));
+  loop.Cancel(id);
+
+  int runs_after_cancel = runs;
+  std::this_thread::sleep_for(100ms);
+  EXPECT_EQ(runs, runs_after_cancel);
+  EXPECT_EQ(loop.NumEvents(), 0u);
+}
+
+TEST(event_loop, cancelled_event_does_not_run)
+{
+  EventLoop loop(1);
+  std::atomic<bool> ran{false};
+
+  auto id = loop.RunAfter(50ms, [&]() { ran = true; });
+  loop.Cancel(id);
+  std::this_thread::sleep_for(150ms);
+  EXPECT_FALSE(ran);
+
+  // cancelling twice or unknown ids is harmless
+  loop.Cancel(id);
+  loop.Cancel(12345);
+}
+
+TEST(event_loop, cancel_waits_for_running_callback)
+{
+  EventLoop loop(2);
+  std::atomic<bool> started{false}, finished{false};
+
+  auto id = loop.RunAfter(0ms, [&]() {
+    started = true;
+    std::this_thread::sleep_for(100ms);
+    finished = true;
+  });
+  ASSERT_TRUE(Eventually([&]() { return started.load(); }));
+  loop.Cancel(id);
+  EXPECT_TRUE(finished);
+}
+
+TEST(event_loop, callback_can_cancel_itself)
+{
+  EventLoop loop(1);
+  std::atomic<int> runs{0};
+  EventLoop::EventId id{};
+  std::mutex id_mutex;
+
+  {
+    std::lock_guard l(id_mutex);
+    id = loop.RunEvery(10ms, [&]() {
+      std::lock_guard l(id_mutex);
+      runs++;
+      loop.Cancel(id);
+    });
+  }
+
+  EXPECT_TRUE(Eventually([&]() { return loop.NumEvents() == 0; }));
+  std::this_thread::sleep_for(50ms);
+  EXPECT_EQ(runs, 1);
+}
+
+TEST(event_loop, events_of_many_jobs_share_the_workers)
+{
+  constexpr int kJobs = 1000;
+  EventLoop loop(3);
+  std::mutex mutex;
+  std::set<std::thread::id> threads;
+  std::atomic<int> runs{0};
+  std::atomic<int> running{0}, max_running{0};
+
+  for (int i = 0; i < kJobs; i++) {
+    loop.RunAfter(std::chrono::milliseconds(i % 50), [&]() {
+      int now_running = ++running;
+      int seen = max_running;
+      while (now_running > seen
+             && !max_running.compare_exchange_weak(seen, now_running)) {
+      }
+      {
+        std::lock_guard l(mutex);
+        threads.insert(std::this_thread::get_id());
+      }
+      running--;
+      runs++;
+    });
+  }
+
+  EXPECT_TRUE(Eventually([&]() { return runs == kJobs; }));
+  EXPECT_LE(threads.size(), loop.NumWorkers());
+  EXPECT_LE(max_running, 3);
+}
+
+TEST(event_loop, repeating_event_never_runs_twice_at_once)
+{
+  EventLoop loop(4);
+  std::atomic<int> running{0};
+  std::atomic<bool> overlapped{false};
+  std::atomic<int> runs{0};
+
+  auto id = loop.RunEvery(1ms, [&]() {
+    if (++running > 1) { overlapped = true; }
+    std::this_thread::sleep_for(10ms);
+    running--;
+    runs++;
+  });
+  EXPECT_TRUE(Eventually([&]() { return runs >= 5; }));
+  loop.Cancel(id);
+  EXPECT_FALSE(overlapped);
+}
+
+#if !defined(HAVE_WIN32)
+TEST(event_loop, watch_readable_runs_when_data_arrives)
+{
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+
+  EventLoop loop(2);
+  std::atomic<int> bytes{0};
+  std::atomic<bool> eof{false};
+
+  loop.WatchReadable(fds[0], [&]() {
+    char buf[16];
+    ssize_t n = read(fds[0], buf, sizeof(buf));
+    if (n <= 0) {
+      eof = true;
+      return false;
+    }
+    bytes += n;
+    return true;
+  });
+
+  std::this_thread::sleep_for(50ms);
+  EXPECT_EQ(bytes, 0);
+
+  ASSERT_EQ(write(fds[1], "abc", 3), 3);
+  EXPECT_TRUE(Eventually([&]() { return bytes == 3; }));
+  ASSERT_EQ(write(fds[1], "de", 2), 2);
+  EXPECT_TRUE(Eventually([&]() { return bytes == 5; }));
+
+  close(fds[1]);
+  EXPECT_TRUE(Eventually([&]() { return eof.load(); }));
+  EXPECT_TRUE(Eventually([&]() { return loop.NumEvents() == 0; }));
+  close(fds[0]);
+}
+#endif
+
+TEST(event_loop, shared_loop_is_a_singleton)
+{
+  EXPECT_EQ(&EventLoop::Shared(), &EventLoop::Shared());
+  EXPECT_GT(EventLoop::Shared().NumWorkers(), 0u);
+}
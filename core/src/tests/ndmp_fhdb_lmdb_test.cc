@@ -0,0 +1,229 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+
+/* Feeds NDMP file history through the LMDB handlers in the order a data
+ * server may send it, i.e. entries arriving before their parent directories,
+ * and checks the paths of the attribute records stored for them. The test is
+ * built with a small MAX_PATH_CACHE_BYTES so the path cache has to drop
+ * entries while resolving the paths. */
+
+#if defined(HAVE_MINGW)
+#  include "include/bareos.h"
+#  include "gtest/gtest.h"
+#else
+#  include "gtest/gtest.h"
+#  include "include/bareos.h"
+#endif
+
+#include "include/filetypes.h"
+#include "include/jcr.h"
+#include "include/protocol_types.h"
+#include "dird/dird.h"
+#include "ndmp/ndmagents.h"
+#include "dird/ndmp_dma_priv.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace directordaemon {
+
+// Paths of the attribute records the LMDB file history stored.
+static std::vector<std::string> stored_paths;
+
+/* Stand-ins for the catalog part of the file history, so the test only needs
+ * the LMDB handlers themselves. */
+void NdmpStoreAttributeRecord(JobControlRecord*,
+                              char* fname,
+                              char*,
+                              char*,
+                              int8_t,
+                              uint64_t,
+                              uint64_t)
+{
+  stored_paths.emplace_back(fname);
+}
+
+void NdmpConvertFstat(ndmp9_file_stat* fstat,
+                      int32_t,
+                      int8_t* FileType,
+                      PoolMem&)
+{
+  *FileType = (fstat->ftype == NDMP9_FILE_DIR) ? FT_DIREND : FT_REG;
+}
+
+extern "C" int BndmpFhdbAddFile(struct ndmlog*, int, char*, ndmp9_file_stat*)
+{
+  return 0;
+}
+
+}  // namespace directordaemon
+
+using namespace directordaemon;
+
+namespace fs = std::filesystem;
+
+static char filesystem_name[] = "/fs";
+static constexpr uint64_t kRootNode = 100;
+
+class NdmpFhdbLmdb : public ::testing::TestWithParam<int32_t> {
+ protected:
+  void SetUp() override
+  {
+    workdir = fs::temp_directory_path()
+              / ("bareos-fhdb-lmdb-" + std::to_string(getpid()));
+    fs::create_directories(workdir);
+    working_directory = workdir.c_str();
+
+    jcr.JobId = 1;
+    jcr.setJobProtocol(GetParam());
+
+    nis.jcr = &jcr;
+    nis.filesystem = filesystem_name;
+    nis.save_filehist = true;
+    ixlog.ctx = &nis;
+
+    stored_paths.clear();
+    NdmpFhdbLmdbRegister(&ixlog);
+    ASSERT_NE(nis.fhdb_state, nullptr);
+    ASSERT_EQ(ndmfhdb_add_dirnode_root(&ixlog, 0, kRootNode), 0);
+  }
+
+  void TearDown() override
+  {
+    NdmpFhdbLmdbUnregister(&ixlog);
+    fs::remove_all(workdir);
+  }
+
+  // The directory entry of a node followed by its file statistics.
+  void AddEntry(const char* name,
+                uint64_t dir_node,
+                uint64_t node,
+                ndmp9_file_type ftype)
+  {
+    ndmp9_file_stat fstat{};
+
+    fstat.ftype = ftype;
+    fstat.node.valid = NDMP9_VALIDITY_VALID;
+    fstat.node.value = node;
+    ASSERT_EQ(ndmfhdb_add_dir(&ixlog, 0, const_cast<char*>(name), dir_node,
+                              node),
+              0);
+    ASSERT_EQ(ndmfhdb_add_node(&ixlog, 0, node, &fstat), 0);
+  }
+
+  std::vector<std::string> ProcessDb()
+  {
+    NdmpFhdbLmdbProcessDb(&ixlog);
+    std::vector<std::string> paths = stored_paths;
+    std::sort(paths.begin(), paths.end());
+    return paths;
+  }
+
+  fs::path workdir;
+  JobControlRecord jcr{};
+  NIS nis{};
+  struct ndmlog ixlog {};
+};
+
+TEST_P(NdmpFhdbLmdb, entries_before_their_parents)
+{
+  // . and .. are no real entries and are ignored
+  for (const char* name : {".", ".."}) {
+    ASSERT_EQ(ndmfhdb_add_dir(&ixlog, 0, const_cast<char*>(name), kRootNode,
+                              kRootNode),
+              0);
+  }
+
+  AddEntry("a.txt", 103, 110, NDMP9_FILE_REG);
+  AddEntry("docs", 102, 103, NDMP9_FILE_DIR);
+  AddEntry("c.txt", kRootNode, 112, NDMP9_FILE_REG);
+  AddEntry("user", 101, 102, NDMP9_FILE_DIR);
+  AddEntry("b.txt", 102, 111, NDMP9_FILE_REG);
+  AddEntry("home", kRootNode, 101, NDMP9_FILE_DIR);
+
+  /* Native NDMP stores the entries whose parents are known right away, the
+   * others have to wait until the dump is done. */
+  if (GetParam() == PT_NDMP_NATIVE) {
+    std::vector<std::string> early = stored_paths;
+    std::sort(early.begin(), early.end());
+    EXPECT_EQ(early, (std::vector<std::string>{"/fs/c.txt", "/fs/home/"}));
+  } else {
+    EXPECT_TRUE(stored_paths.empty());
+  }
+
+  EXPECT_EQ(ProcessDb(), (std::vector<std::string>{
+                             "/fs/c.txt",
+                             "/fs/home/",
+                             "/fs/home/user/",
+                             "/fs/home/user/b.txt",
+                             "/fs/home/user/docs/",
+                             "/fs/home/user/docs/a.txt",
+                         }));
+  EXPECT_EQ(jcr.JobFiles, 6u);
+}
+
+TEST_P(NdmpFhdbLmdb, more_directories_than_the_path_cache_holds)
+{
+  constexpr int kDirs = 50;
+  constexpr int kFiles = 3;
+  std::vector<std::string> expected;
+
+  /* Every directory has a subdirectory with some files. Half of the trees
+   * arrive deepest entry first, the other half in the usual order. */
+  for (int i = 0; i < kDirs; i++) {
+    std::string dir = "directory-" + std::to_string(i);
+    std::string subdir = "subdirectory-" + std::to_string(i);
+    uint64_t dir_node = 1000 + i;
+    uint64_t subdir_node = 2000 + i;
+    std::vector<std::pair<std::string, uint64_t>> files;
+
+    expected.push_back("/fs/" + dir + "/");
+    expected.push_back("/fs/" + dir + "/" + subdir + "/");
+    for (int j = 0; j < kFiles; j++) {
+      std::string file = "file-" + std::to_string(j);
+      files.emplace_back(file, 10000 + i * kFiles + j);
+      expected.push_back("/fs/" + dir + "/" + subdir + "/" + file);
+    }
+
+    if (i % 2) {
+      for (auto& [file, node] : files) {
+        AddEntry(file.c_str(), subdir_node, node, NDMP9_FILE_REG);
+      }
+      AddEntry(subdir.c_str(), dir_node, subdir_node, NDMP9_FILE_DIR);
+      AddEntry(dir.c_str(), kRootNode, dir_node, NDMP9_FILE_DIR);
+    } else {
+      AddEntry(dir.c_str(), kRootNode, dir_node, NDMP9_FILE_DIR);
+      AddEntry(subdir.c_str(), dir_node, subdir_node, NDMP9_FILE_DIR);
+      for (auto& [file, node] : files) {
+        AddEntry(file.c_str(), subdir_node, node, NDMP9_FILE_REG);
+      }
+    }
+  }
+
+  std::sort(expected.begin(), expected.end());
+  EXPECT_EQ(ProcessDb(), expected);
+}
+
+INSTANTIATE_TEST_SUITE_P(Protocols,
+                         NdmpFhdbLmdb,
+                         ::testing::Values(PT_NDMP_BAREOS, PT_NDMP_NATIVE));
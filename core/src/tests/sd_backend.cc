@@ -1,7 +1,7 @@
 /*
    BAREOS® - Backup Archiving REcovery Open Sourced
 
-   Copyright (C) 2021-2022 Bareos GmbH & Co. KG
+   Copyright (C) 2021-2024 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -29,10 +29,18 @@
 
 
 #include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
 #include <future>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 #define STORAGE_DAEMON 1
 #include "include/jcr.h"
+#include "include/streams.h"
 #include "lib/crypto_cache.h"
 #include "lib/edit.h"
 #include "lib/parse_conf.h"
@@ -40,18 +48,45 @@
 #include "stored/device_control_record.h"
 #include "stored/stored_jcr_impl.h"
 #include "stored/job.h"
+#include "stored/match_bsr.h"
 #include "stored/sd_plugins.h"
 #include "stored/sd_stats.h"
 #include "stored/stored.h"
 #include "stored/stored_globals.h"
 #include "stored/wait.h"
 #include "stored/sd_backends.h"
+#include "lib/parse_bsr.h"
 
 #define CONFIG_SUBDIR "sd_backend"
 #include "sd_backend_tests.h"
 
 using namespace storagedaemon;
 
+// File created by mkstemp(), closed and removed however the test ends.
+class TemporaryFile {
+ public:
+  explicit TemporaryFile(const char* prefix) : name_(prefix)
+  {
+    name_ += "XXXXXX";
+    fd_ = mkstemp(name_.data());
+  }
+  ~TemporaryFile()
+  {
+    if (fd_ < 0) { return; }
+    close(fd_);
+    unlink(name_.c_str());
+  }
+  TemporaryFile(const TemporaryFile&) = delete;
+  TemporaryFile& operator=(const TemporaryFile&) = delete;
+
+  int fd() const { return fd_; }
+  const char* name() const { return name_.c_str(); }
+
+ private:
+  std::string name_;
+  int fd_{-1};
+};
+
 
 // Test that load and unloads a tape device.
 TEST_F(sd, backend_load_unload)
@@ -90,3 +125,415 @@ TEST_F(sd, backend_load_unload)
   Dmsg0(100, "cleanup\n");
   FreeJcr(jcr);
 }
+
+// Test that writing a block with clone extents results in the same data.
+TEST_F(sd, file_backend_write_cloned)
+{
+  const char* name = "sd_backend_test";
+  char dev_name[10] = "file1";
+
+  JobControlRecord* jcr = SetupDummyJcr(name, nullptr, nullptr);
+  ASSERT_TRUE(jcr);
+
+  DeviceResource* device_resource
+      = (DeviceResource*)my_config->GetResWithName(R_DEVICE, dev_name);
+  ASSERT_TRUE(device_resource);
+  EXPECT_TRUE(device_resource->block_cloning);
+
+  std::unique_ptr<Device> dev(FactoryCreateDevice(jcr, device_resource));
+  ASSERT_TRUE(dev);
+
+  TemporaryFile src_file("/tmp/sd_backend_src_");
+  ASSERT_GE(src_file.fd(), 0);
+  TemporaryFile dst_file("/tmp/sd_backend_dst_");
+  ASSERT_GE(dst_file.fd(), 0);
+
+  // The device writes to the destination file, which closes the descriptor.
+  dev->fd = dst_file.fd();
+
+  uint32_t align = dev->CloneAlignment();
+  if (align == 0) {
+    FreeJcr(jcr);
+    GTEST_SKIP() << "filesystem of " << dst_file.name()
+                 << " cannot share data";
+  }
+
+  // Source volume with some data at a known offset
+  std::vector<char> src(8 * align);
+  for (size_t i = 0; i < src.size(); i++) { src[i] = (char)(i * 7 + 3); }
+  ASSERT_EQ(write(src_file.fd(), src.data(), src.size()), (ssize_t)src.size());
+
+  ASSERT_EQ(dev->d_write(dev->fd, "0123456789", 10), 10);
+  const uint64_t base = 10;
+
+  /* Block with some data in front and the source data at the same offset
+   * within a filesystem block as on the source volume. */
+  const uint64_t src_addr = align + 100;
+  const uint32_t len = 4 * align + 17;
+  const uint32_t offset
+      = 100 + (src_addr % align + align - (base + 100) % align) % align;
+  std::vector<char> block(offset + len + 50, 'x');
+  memcpy(block.data() + offset, src.data() + src_addr, len);
+
+  BlockCloneExtent extent{};
+  extent.offset = offset;
+  extent.length = len;
+  extent.src_dev = dev.get();
+  extent.src_fd = src_file.fd();
+  extent.src_addr = src_addr;
+
+  uint64_t cloned = 0;
+  uint64_t copied = 0;
+  ASSERT_EQ(dev->d_write_cloned(dev->fd, block.data(), block.size(), &extent, 1,
+                                cloned, copied),
+            (ssize_t)block.size());
+  EXPECT_LE(cloned + copied, len);
+  EXPECT_EQ(lseek(dev->fd, 0, SEEK_CUR), (off_t)(base + block.size()));
+
+  std::vector<char> result(base + block.size());
+  ASSERT_EQ(pread(dev->fd, result.data(), result.size(), 0),
+            (ssize_t)result.size());
+  EXPECT_EQ(memcmp(result.data(), "0123456789", base), 0);
+  EXPECT_EQ(memcmp(result.data() + base, block.data(), block.size()), 0);
+
+  dev->fd = -1;
+  FreeJcr(jcr);
+}
+
+/* Test the copy path of block cloning: a record read from a volume
+ * remembers where its data came from, and the blocks written from it point
+ * back to exactly these bytes of the source volume. */
+TEST_F(sd, copy_record_with_source_extents)
+{
+  const char* name = "sd_backend_test";
+  char dev_name[10] = "file1";
+
+  JobControlRecord* jcr = SetupDummyJcr(name, nullptr, nullptr);
+  ASSERT_TRUE(jcr);
+
+  DeviceResource* device_resource
+      = (DeviceResource*)my_config->GetResWithName(R_DEVICE, dev_name);
+  ASSERT_TRUE(device_resource);
+
+  std::unique_ptr<Device> dev(FactoryCreateDevice(jcr, device_resource));
+  ASSERT_TRUE(dev);
+
+  DeviceControlRecord dcr;
+  dcr.jcr = jcr;
+  dcr.dev = dev.get();
+  dcr.block = new_block(dev.get());
+  dcr.rec = new_record(false);
+
+  using Blocks = std::vector<std::vector<char>>;
+  using Extents = std::vector<std::pair<size_t, BlockCloneExtent>>;
+
+  // Returns the blocks the record was written to and their clone extents.
+  auto write_record = [&](DeviceRecord* rec, Blocks& blocks,
+                          Extents& extents) {
+    bool done;
+
+    EmptyBlock(dcr.block);
+    do {
+      done = WriteRecordToBlock(&dcr, rec);
+      for (int i = 0; i < dcr.block->num_clone_extents; i++) {
+        extents.emplace_back(blocks.size(), dcr.block->clone_extents[i]);
+      }
+      blocks.emplace_back(dcr.block->buf, dcr.block->bufp);
+      EmptyBlock(dcr.block);
+    } while (!done);
+  };
+
+  /* Reads the record back from blocks stored one after the other on a
+   * volume, starting at volume_addr. */
+  auto read_record = [&](const Blocks& blocks, uint64_t volume_addr) {
+    DeviceRecord* rec = new_record();
+
+    for (size_t i = 0; i < blocks.size(); i++) {
+      memcpy(dcr.block->buf, blocks[i].data(), blocks[i].size());
+      dcr.block->BlockVer = BLOCK_VER;
+      dcr.block->bufp = dcr.block->buf + WRITE_BLKHDR_LENGTH;
+      dcr.block->binbuf = blocks[i].size() - WRITE_BLKHDR_LENGTH;
+      dcr.block->read_addr_valid = true;
+      dcr.block->read_addr = volume_addr;
+      dcr.block->read_generation = dev->open_generation;
+      volume_addr += blocks[i].size();
+
+      EXPECT_TRUE(ReadRecordFromBlock(&dcr, rec));
+      EXPECT_EQ(BitIsSet(REC_PARTIAL_RECORD, rec->state_bits),
+                i + 1 < blocks.size());
+    }
+    return rec;
+  };
+
+  for (size_t nr_blocks : {3, 2 * REC_MAX_SOURCE_EXTENTS}) {
+    // Record spread over nr_blocks blocks of the source volume
+    std::vector<char> data((nr_blocks - 1) * dcr.block->buf_len);
+    for (size_t i = 0; i < data.size(); i++) { data[i] = (char)(i * 31 + 7); }
+
+    dcr.rec->VolSessionId = jcr->VolSessionId;
+    dcr.rec->VolSessionTime = jcr->VolSessionTime;
+    dcr.rec->FileIndex = 1;
+    dcr.rec->Stream = STREAM_FILE_DATA;
+    dcr.rec->maskedStream = STREAM_FILE_DATA;
+    dcr.rec->data = data.data();
+    dcr.rec->data_len = data.size();
+    dcr.rec->state = st_none;
+
+    Blocks src_blocks;
+    Extents no_extents;
+    dcr.clone_blocks = false;
+    write_record(dcr.rec, src_blocks, no_extents);
+    dcr.rec->data = nullptr;
+    ASSERT_EQ(src_blocks.size(), nr_blocks);
+    EXPECT_TRUE(no_extents.empty());
+
+    // Source volume with some other data in front of the record
+    const uint64_t volume_addr = 12345;
+    std::vector<char> volume(volume_addr, 'v');
+    for (auto& block : src_blocks) {
+      volume.insert(volume.end(), block.begin(), block.end());
+    }
+
+    dcr.track_rec_source = true;
+    DeviceRecord* rec = read_record(src_blocks, volume_addr);
+    dcr.track_rec_source = false;
+    ASSERT_EQ(std::vector<char>(rec->data, rec->data + rec->data_len), data);
+
+    // Pieces beyond REC_MAX_SOURCE_EXTENTS are not tracked.
+    ASSERT_EQ(rec->src_extents,
+              (int32_t)std::min<size_t>(nr_blocks, REC_MAX_SOURCE_EXTENTS));
+    uint32_t tracked = 0;
+    for (int i = 0; i < rec->src_extents; i++) {
+      EXPECT_EQ(rec->src_extent[i].offset, tracked);
+      tracked += rec->src_extent[i].length;
+    }
+    EXPECT_EQ(rec->src_dev, dev.get());
+    if (nr_blocks <= REC_MAX_SOURCE_EXTENTS) {
+      EXPECT_EQ(tracked, data.size());
+    } else {
+      EXPECT_LT(tracked, data.size());
+    }
+
+    // Write the copy, every clone extent points to the same bytes
+    Blocks copy_blocks;
+    Extents extents;
+    rec->state = st_none;
+    dcr.clone_blocks = true;
+    write_record(rec, copy_blocks, extents);
+    dcr.clone_blocks = false;
+
+    uint32_t cloned = 0;
+    for (auto& [block_nr, extent] : extents) {
+      ASSERT_LE(extent.offset + extent.length, copy_blocks[block_nr].size());
+      ASSERT_LE(extent.src_addr + extent.length, volume.size());
+      EXPECT_EQ(memcmp(copy_blocks[block_nr].data() + extent.offset,
+                       volume.data() + extent.src_addr, extent.length),
+                0);
+      EXPECT_EQ(extent.src_dev, dev.get());
+      EXPECT_EQ(extent.src_generation, dev->open_generation);
+      cloned += extent.length;
+    }
+    EXPECT_EQ(cloned, tracked);
+    FreeRecord(rec);
+
+    // The copy reads back as the original record
+    rec = read_record(copy_blocks, 0);
+    EXPECT_EQ(std::vector<char>(rec->data, rec->data + rec->data_len), data);
+    FreeRecord(rec);
+  }
+
+  FreeRecord(dcr.rec);
+  FreeBlock(dcr.block);
+  FreeJcr(jcr);
+}
+
+/* Test that records received straight into the block end up the same as
+ * copied ones and can be read back without copying them out again. */
+TEST_F(sd, records_in_block)
+{
+  const char* name = "sd_backend_test";
+  char dev_name[10] = "file1";
+
+  JobControlRecord* jcr = SetupDummyJcr(name, nullptr, nullptr);
+  ASSERT_TRUE(jcr);
+
+  DeviceResource* device_resource
+      = (DeviceResource*)my_config->GetResWithName(R_DEVICE, dev_name);
+  ASSERT_TRUE(device_resource);
+
+  Device* dev = FactoryCreateDevice(jcr, device_resource);
+  ASSERT_TRUE(dev);
+
+  DeviceControlRecord dcr;
+  dcr.jcr = jcr;
+  dcr.dev = dev;
+  dcr.block = new_block(dev);
+  dcr.rec = new_record(false);
+
+  std::vector<std::vector<char>> records;
+  for (uint32_t len : {1000u, 1u, 30000u, 0u, 4096u}) {
+    std::vector<char> data(len);
+    for (uint32_t i = 0; i < len; i++) { data[i] = (char)(i * 13 + len); }
+    records.push_back(std::move(data));
+  }
+
+  auto setup_record = [&](int32_t file_index, const std::vector<char>& data) {
+    dcr.rec->VolSessionId = jcr->VolSessionId;
+    dcr.rec->VolSessionTime = jcr->VolSessionTime;
+    dcr.rec->FileIndex = file_index;
+    dcr.rec->Stream = STREAM_FILE_DATA;
+    dcr.rec->maskedStream = STREAM_FILE_DATA;
+    dcr.rec->data_len = data.size();
+  };
+
+  // Copied into the block
+  for (size_t i = 0; i < records.size(); i++) {
+    setup_record(i + 1, records[i]);
+    dcr.rec->data = const_cast<char*>(records[i].data());
+    ASSERT_TRUE(WriteRecordToBlock(&dcr, dcr.rec));
+  }
+  std::vector<char> copied(dcr.block->buf, dcr.block->bufp);
+
+  // Put into the block by the caller
+  EmptyBlock(dcr.block);
+  dcr.rec->data = nullptr;
+  for (size_t i = 0; i < records.size(); i++) {
+    char* space = dcr.RecordSpaceInBlock(records[i].size());
+    ASSERT_TRUE(space);
+    if (!records[i].empty()) {
+      memcpy(space, records[i].data(), records[i].size());
+    }
+    setup_record(i + 1, records[i]);
+    ASSERT_TRUE(dcr.WriteRecordInBlock());
+  }
+  std::vector<char> in_block(dcr.block->buf, dcr.block->bufp);
+  EXPECT_EQ(in_block, copied);
+  EXPECT_FALSE(dcr.RecordSpaceInBlock(BlockWriteNavail(dcr.block)));
+  EXPECT_TRUE(dcr.RecordSpaceInBlock(BlockWriteNavail(dcr.block)
+                                     - WRITE_RECHDR_LENGTH));
+
+  // Read back, whole records stay in the block
+  dcr.block->BlockVer = BLOCK_VER;
+  dcr.block->bufp = dcr.block->buf + WRITE_BLKHDR_LENGTH;
+  dcr.block->binbuf = in_block.size() - WRITE_BLKHDR_LENGTH;
+  dcr.rec_data_in_block = true;
+  DeviceRecord* rec = new_record();
+  for (size_t i = 0; i < records.size(); i++) {
+    ASSERT_TRUE(ReadRecordFromBlock(&dcr, rec));
+    EXPECT_EQ(rec->FileIndex, (int32_t)(i + 1));
+    ASSERT_EQ(rec->data_len, records[i].size());
+    ASSERT_TRUE(rec->block_data);
+    EXPECT_GE(rec->block_data, dcr.block->buf);
+    EXPECT_LE(rec->block_data + rec->data_len, dcr.block->bufp);
+    EXPECT_EQ(std::vector<char>(rec->block_data,
+                                rec->block_data + rec->data_len),
+              records[i]);
+  }
+
+  FreeRecord(rec);
+  FreeRecord(dcr.rec);
+  FreeBlock(dcr.block);
+  delete dev;
+  FreeJcr(jcr);
+}
+
+TEST_F(sd, fileregex_with_records_in_block)
+{
+  const char* name = "sd_backend_test";
+  char dev_name[10] = "file1";
+
+  JobControlRecord* jcr = SetupDummyJcr(name, nullptr, nullptr);
+  ASSERT_TRUE(jcr);
+
+  DeviceResource* device_resource
+      = (DeviceResource*)my_config->GetResWithName(R_DEVICE, dev_name);
+  ASSERT_TRUE(device_resource);
+
+  Device* dev = FactoryCreateDevice(jcr, device_resource);
+  ASSERT_TRUE(dev);
+
+  DeviceControlRecord dcr;
+  dcr.jcr = jcr;
+  dcr.dev = dev;
+  dcr.block = new_block(dev);
+  dcr.rec = new_record(false);
+
+  auto attributes = [](int32_t file_index, const char* fname) {
+    std::string attr = std::to_string(file_index) + " 3 " + fname;
+    attr += '\0';
+    attr += "lstat";
+    attr += '\0';  // no link
+    attr += '\0';
+    return attr;
+  };
+
+  // attributes and data of two files, only the second one is restored
+  struct {
+    int32_t file_index;
+    int32_t stream;
+    std::string data;
+  } records[] = {
+      {1, STREAM_UNIX_ATTRIBUTES, attributes(1, "/tmp/skipped.txt")},
+      {1, STREAM_FILE_DATA, "data of skipped.txt"},
+      {2, STREAM_UNIX_ATTRIBUTES, attributes(2, "/tmp/restored.txt")},
+      {2, STREAM_FILE_DATA, "data of restored.txt"},
+  };
+  for (auto& record : records) {
+    dcr.rec->VolSessionId = jcr->VolSessionId;
+    dcr.rec->VolSessionTime = jcr->VolSessionTime;
+    dcr.rec->FileIndex = record.file_index;
+    dcr.rec->Stream = record.stream;
+    dcr.rec->maskedStream = record.stream;
+    dcr.rec->data = record.data.data();
+    dcr.rec->data_len = record.data.size();
+    ASSERT_TRUE(WriteRecordToBlock(&dcr, dcr.rec));
+  }
+  dcr.rec->data = nullptr;
+
+  std::string fname = "sd_backend_fileregex.bsr";
+  {
+    std::ofstream bsr_file(fname);
+    bsr_file << "Volume=\"TestVolume\"\n";
+    bsr_file << "FileIndex=1-2\n";
+    bsr_file << "FileRegex=restored\n";
+  }
+  BootStrapRecord* bsr = libbareos::parse_bsr(jcr, fname.data());
+  std::remove(fname.c_str());
+  ASSERT_TRUE(bsr);
+  ASSERT_TRUE(bsr->fileregex_re);
+
+  Volume_Label volrec{};
+  bstrncpy(volrec.VolumeName, "TestVolume", sizeof(volrec.VolumeName));
+  Session_Label sessrec{};
+
+  dcr.block->BlockVer = BLOCK_VER;
+  dcr.block->binbuf = dcr.block->bufp - dcr.block->buf - WRITE_BLKHDR_LENGTH;
+  dcr.block->bufp = dcr.block->buf + WRITE_BLKHDR_LENGTH;
+  dcr.rec_data_in_block = true;
+  DeviceRecord* rec = new_record();
+  std::vector<std::string> restored;
+  for (auto& record : records) {
+    ASSERT_TRUE(ReadRecordFromBlock(&dcr, rec));
+    ASSERT_EQ(rec->Stream, record.stream);
+    const char* data = rec->block_data ? rec->block_data : rec->data;
+    EXPECT_EQ(std::string(data, rec->data_len), record.data);
+    if (record.stream == STREAM_UNIX_ATTRIBUTES) {
+      // copied, the fileregex match unpacks them from rec->data
+      EXPECT_FALSE(rec->block_data);
+    } else {
+      EXPECT_TRUE(rec->block_data);
+    }
+    if (MatchBsr(bsr, rec, &volrec, &sessrec, jcr) == 1
+        && record.stream == STREAM_FILE_DATA) {
+      restored.emplace_back(data, rec->data_len);
+    }
+  }
+  EXPECT_EQ(restored, std::vector<std::string>{"data of restored.txt"});
+
+  libbareos::FreeBsr(bsr);
+  FreeRecord(rec);
+  FreeRecord(dcr.rec);
+  FreeBlock(dcr.block);
+  delete dev;
+  FreeJcr(jcr);
+}
@@ -0,0 +1,156 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+
+#if defined(HAVE_MINGW)
+#  include "include/bareos.h"
+#  include "gtest/gtest.h"
+#else
+#  include "gtest/gtest.h"
+#  include "include/bareos.h"
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "stored/changer_scheduler.h"
+
+using namespace storagedaemon;
+
+// Run operation in its own thread and report whether it got the changer.
+class Contender {
+ public:
+  Contender(ChangerOperationScheduler& scheduler, ChangerOperation operation)
+      : thread_([this, &scheduler, operation] {
+        started_ = true;
+        scheduler.Acquire(operation);
+        acquired_ = true;
+        while (!release_) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        scheduler.Release();
+      })
+  {
+    while (!started_) { std::this_thread::yield(); }
+  }
+
+  ~Contender()
+  {
+    release_ = true;
+    thread_.join();
+  }
+
+  bool Acquired(int wait_ms = 200)
+  {
+    for (int i = 0; i < wait_ms && !acquired_; i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return acquired_;
+  }
+
+  void Release() { release_ = true; }
+
+ private:
+  std::atomic<bool> started_{false};
+  std::atomic<bool> acquired_{false};
+  std::atomic<bool> release_{false};
+  std::thread thread_;
+};
+
+TEST(sd_changer_scheduler, one_operation_at_a_time_by_default)
+{
+  ChangerOperationScheduler scheduler(1);
+
+  scheduler.Acquire(ChangerOperation::Drive(0, 1));
+  Contender other(scheduler, ChangerOperation::Drive(1, 2));
+  EXPECT_FALSE(other.Acquired(50));
+
+  scheduler.Release();
+  EXPECT_TRUE(other.Acquired());
+}
+
+TEST(sd_changer_scheduler, independent_drives_run_concurrently)
+{
+  ChangerOperationScheduler scheduler(2);
+
+  scheduler.Acquire(ChangerOperation::Drive(0, 1, 3));
+  Contender other(scheduler, ChangerOperation::Drive(1, 2));
+  EXPECT_TRUE(other.Acquired());
+  EXPECT_EQ(scheduler.ActiveOperations(), 2);
+
+  // the limit is reached
+  Contender third(scheduler, ChangerOperation::Drive(2, 4));
+  EXPECT_FALSE(third.Acquired(50));
+
+  scheduler.Release();
+  EXPECT_TRUE(third.Acquired());
+}
+
+TEST(sd_changer_scheduler, shared_drive_or_slot_conflicts)
+{
+  ChangerOperationScheduler scheduler(4);
+
+  scheduler.Acquire(ChangerOperation::Drive(0, 1, 3));
+  Contender same_drive(scheduler, ChangerOperation::Drive(0, 5));
+  Contender same_slot(scheduler, ChangerOperation::Drive(1, 3));
+  EXPECT_FALSE(same_drive.Acquired(50));
+  EXPECT_FALSE(same_slot.Acquired(50));
+
+  scheduler.Release();
+  EXPECT_TRUE(same_drive.Acquired());
+  EXPECT_TRUE(same_slot.Acquired());
+}
+
+TEST(sd_changer_scheduler, exclusive_waits_for_all_and_blocks_newcomers)
+{
+  ChangerOperationScheduler scheduler(4);
+
+  scheduler.Acquire(ChangerOperation::Drive(0, 1));
+  Contender exclusive(scheduler, ChangerOperation::Exclusive());
+  EXPECT_FALSE(exclusive.Acquired(50));
+
+  // does not overtake the waiting exclusive operation
+  Contender newcomer(scheduler, ChangerOperation::Drive(1, 2));
+  EXPECT_FALSE(newcomer.Acquired(50));
+
+  scheduler.Release();
+  EXPECT_TRUE(exclusive.Acquired());
+  EXPECT_FALSE(newcomer.Acquired(50));
+
+  exclusive.Release();
+  EXPECT_TRUE(newcomer.Acquired());
+}
+
+TEST(sd_changer_scheduler, nested_acquire_by_same_thread)
+{
+  ChangerOperationScheduler scheduler(1);
+
+  scheduler.Acquire(ChangerOperation::Exclusive());
+  scheduler.Acquire(ChangerOperation::Drive(0));
+  EXPECT_EQ(scheduler.ActiveOperations(), 1);
+
+  scheduler.Release();
+  Contender other(scheduler, ChangerOperation::Drive(1));
+  EXPECT_FALSE(other.Acquired(50));
+
+  scheduler.Release();
+  EXPECT_TRUE(other.Acquired());
+}
@@ -0,0 +1,203 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+
+#if defined(HAVE_MINGW)
+#  include "include/bareos.h"
+#  include "gtest/gtest.h"
+#else
+#  include "gtest/gtest.h"
+#  include "include/bareos.h"
+#endif
+
+#include <random>
+#include <vector>
+
+#include "include/ch.h"
+#include "stored/backends/chunk_manifest.h"
+
+using namespace storagedaemon;
+
+static std::vector<char> CompressibleData(std::size_t size)
+{
+  std::vector<char> data(size);
+
+  for (std::size_t i = 0; i < size; i++) { data[i] = 'a' + (i / 64) % 26; }
+
+  return data;
+}
+
+static std::vector<char> RandomData(std::size_t size)
+{
+  std::mt19937 generator(42);
+  std::vector<char> data(size);
+
+  for (auto& c : data) { c = generator(); }
+
+  return data;
+}
+
+static std::vector<char> Decode(const std::vector<char>& stored,
+                                std::size_t capacity)
+{
+  std::vector<char> data(capacity);
+  uint32_t size = 0;
+  PoolMem error(PM_MESSAGE);
+
+  EXPECT_TRUE(DecodeChunk(stored.data(), stored.size(), data.data(),
+                          data.size(), &size, error))
+      << error.c_str();
+  data.resize(size);
+
+  return data;
+}
+
+static std::vector<uint32_t> Algorithms()
+{
+  std::vector<uint32_t> algorithms;
+#if defined(HAVE_LIBZ)
+  algorithms.push_back(COMPRESS_GZIP);
+#endif
+#if defined(HAVE_LZO)
+  algorithms.push_back(COMPRESS_LZO1X);
+#endif
+  algorithms.push_back(COMPRESS_FZFZ);
+  algorithms.push_back(COMPRESS_FZ4L);
+  algorithms.push_back(COMPRESS_FZ4H);
+
+  return algorithms;
+}
+
+TEST(chunk_manifest, compressible_chunk_roundtrip)
+{
+  auto data = CompressibleData(1024 * 1024);
+
+  for (uint32_t algorithm : Algorithms()) {
+    std::vector<char> stored;
+    ChunkInfo info;
+    PoolMem error(PM_MESSAGE);
+
+    ASSERT_TRUE(EncodeChunk(algorithm, data.data(), data.size(), stored, info,
+                            error))
+        << error.c_str();
+    EXPECT_EQ(info.algorithm, algorithm);
+    EXPECT_EQ(info.size, data.size());
+    EXPECT_EQ(info.stored_size, stored.size());
+    EXPECT_LT(stored.size(), data.size() / 4);
+    EXPECT_EQ(Decode(stored, data.size()), data);
+  }
+}
+
+TEST(chunk_manifest, incompressible_chunk_is_stored_uncompressed)
+{
+  auto data = RandomData(256 * 1024);
+  std::vector<char> stored;
+  ChunkInfo info;
+  PoolMem error(PM_MESSAGE);
+
+  ASSERT_TRUE(EncodeChunk(COMPRESS_FZ4L, data.data(), data.size(), stored,
+                          info, error));
+  EXPECT_EQ(info.algorithm, (uint32_t)COMPRESS_NONE);
+  EXPECT_EQ(stored.size(), data.size() + CHUNK_HEADER_SIZE);
+  EXPECT_EQ(Decode(stored, data.size()), data);
+}
+
+TEST(chunk_manifest, chunk_without_header_is_read_as_is)
+{
+  auto data = RandomData(4096);
+
+  EXPECT_EQ(Decode(data, data.size()), data);
+}
+
+TEST(chunk_manifest, chunk_too_big_for_buffer_is_an_error)
+{
+  auto data = CompressibleData(64 * 1024);
+  std::vector<char> stored, buffer(1024);
+  ChunkInfo info;
+  PoolMem error(PM_MESSAGE);
+  uint32_t size = 0;
+
+  ASSERT_TRUE(EncodeChunk(COMPRESS_FZ4L, data.data(), data.size(), stored,
+                          info, error));
+  EXPECT_FALSE(DecodeChunk(stored.data(), stored.size(), buffer.data(),
+                           buffer.size(), &size, error));
+}
+
+TEST(chunk_manifest, stored_chunk_is_described_like_its_manifest_entry)
+{
+  auto data = CompressibleData(64 * 1024);
+  std::vector<char> stored;
+  ChunkInfo info;
+  PoolMem error(PM_MESSAGE);
+
+  ASSERT_TRUE(EncodeChunk(COMPRESS_FZ4L, data.data(), data.size(), stored,
+                          info, error));
+  info.hash = ChunkHash(stored.data(), stored.size());
+
+  ChunkInfo described = StoredChunkInfo(stored.data(), stored.size());
+  EXPECT_EQ(described.size, info.size);
+  EXPECT_EQ(described.stored_size, info.stored_size);
+  EXPECT_EQ(described.algorithm, info.algorithm);
+  EXPECT_EQ(described.hash, info.hash);
+
+  // a chunk without header holds as much data as it is big
+  described = StoredChunkInfo(data.data(), data.size());
+  EXPECT_EQ(described.size, data.size());
+  EXPECT_EQ(described.stored_size, data.size());
+  EXPECT_EQ(described.algorithm, (uint32_t)COMPRESS_NONE);
+}
+
+TEST(chunk_manifest, hash_is_sha256)
+{
+  EXPECT_EQ(ChunkHash("abc", 3),
+            "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+}
+
+TEST(chunk_manifest, serialize_and_parse)
+{
+  ChunkManifest manifest, parsed;
+  ChunkInfo info;
+
+  info.size = 10485760;
+  info.stored_size = 2097168;
+  info.algorithm = COMPRESS_FZ4L;
+  info.hash = ChunkHash("chunk", 5);
+  manifest.Update(0, info);
+  info.hash.clear();
+  manifest.Update(9999, info);
+
+  ASSERT_TRUE(parsed.Parse(manifest.Serialize()));
+  EXPECT_EQ(parsed.Serialize(), manifest.Serialize());
+
+  const ChunkInfo* found = parsed.Find(0);
+  ASSERT_NE(found, nullptr);
+  EXPECT_EQ(found->size, 10485760u);
+  EXPECT_EQ(found->stored_size, 2097168u);
+  EXPECT_EQ(found->algorithm, (uint32_t)COMPRESS_FZ4L);
+  EXPECT_EQ(found->hash, ChunkHash("chunk", 5));
+  ASSERT_NE(parsed.Find(9999), nullptr);
+  EXPECT_TRUE(parsed.Find(9999)->hash.empty());
+  EXPECT_EQ(parsed.Find(1), nullptr);
+
+  EXPECT_TRUE(parsed.Parse(""));
+  EXPECT_TRUE(parsed.empty());
+  EXPECT_FALSE(parsed.Parse("0000 10 garbage\n"));
+  EXPECT_FALSE(parsed.Parse("70000 10 10 NONE -\n"));
+}
@@ -0,0 +1,103 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+
+#if defined(HAVE_MINGW)
+#  include "include/bareos.h"
+#  include "gtest/gtest.h"
+#else
+#  include "gtest/gtest.h"
+#  include "include/bareos.h"
+#endif
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "stored/stored.h"
+#include "stored/parallel_read.h"
+#include "lib/parse_bsr.h"
+
+using namespace storagedaemon;
+
+struct BsrEntry {
+  const char* volume;
+  uint32_t sessid;
+  uint32_t sesstime;
+};
+
+static std::vector<int> Segments(const std::vector<BsrEntry>& entries,
+                                 bool with_session = true)
+{
+  std::string fname = "sd_parallel_read.bsr";
+  {
+    std::ofstream bsr_file(fname);
+    for (auto& entry : entries) {
+      bsr_file << "Volume=\"" << entry.volume << "\"\n";
+      bsr_file << "MediaType=\"File\"\n";
+      if (with_session) {
+        bsr_file << "VolSessionId=" << entry.sessid << "\n";
+        bsr_file << "VolSessionTime=" << entry.sesstime << "\n";
+      }
+      bsr_file << "FileIndex=1-100\n";
+    }
+  }
+
+  BootStrapRecord* bsr = libbareos::parse_bsr(nullptr, fname.data());
+  std::remove(fname.c_str());
+  EXPECT_NE(bsr, nullptr);
+  if (!bsr) { return {}; }
+
+  std::vector<int> segments = SplitBootstrapIntoSegments(bsr);
+  libbareos::FreeBsr(bsr);
+  return segments;
+}
+
+TEST(sd_parallel_read, one_segment_per_job_and_volume)
+{
+  EXPECT_EQ(Segments({{"Full-0001", 1, 100},
+                      {"Incr-0002", 2, 100},
+                      {"Incr-0003", 3, 100}}),
+            (std::vector<int>{0, 1, 2}));
+}
+
+TEST(sd_parallel_read, job_spanning_volumes_stays_in_one_segment)
+{
+  EXPECT_EQ(Segments({{"Full-0001", 1, 100},
+                      {"Full-0002", 1, 100},
+                      {"Incr-0003", 2, 100}}),
+            (std::vector<int>{0, 0, 1}));
+}
+
+TEST(sd_parallel_read, shared_volume_joins_segments)
+{
+  EXPECT_EQ(Segments({{"Full-0001", 1, 100},
+                      {"Incr-0002", 2, 100},
+                      {"Full-0001", 3, 100},
+                      {"Incr-0004", 4, 100}}),
+            (std::vector<int>{0, 0, 0, 1}));
+}
+
+TEST(sd_parallel_read, no_split_without_sessions)
+{
+  EXPECT_TRUE(
+      Segments({{"Full-0001", 1, 100}, {"Incr-0002", 2, 100}}, false).empty());
+}
@@ -0,0 +1,218 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+
+#if defined(HAVE_MINGW)
+#  include "include/bareos.h"
+#  include "gtest/gtest.h"
+#else
+#  include "gtest/gtest.h"
+#  include "include/bareos.h"
+#endif
+
+#include <cerrno>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "stored/backends/tape_stream_buffer.h"
+
+using namespace storagedaemon;
+
+// Records the blocks written and fails on request like a tape driver would.
+class FakeDrive {
+ public:
+  ssize_t Write(int, const void* data, std::size_t count)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (fail_at_ == blocks_.size() && fail_errno_ != 0) {
+      errno = fail_errno_;
+      if (fail_errno_ == ENOSPC && !end_of_tape_) { fail_errno_ = 0; }
+      return -1;
+    }
+    blocks_.emplace_back(static_cast<const char*>(data), count);
+    return count;
+  }
+
+  void FailAt(std::size_t block, int error)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    fail_at_ = block;
+    fail_errno_ = error;
+  }
+
+  // Refuse every block from this one on, like a drive at the end of the tape.
+  void EndOfTapeAt(std::size_t block)
+  {
+    FailAt(block, ENOSPC);
+    std::unique_lock<std::mutex> lock(mutex_);
+    end_of_tape_ = true;
+  }
+
+  std::vector<std::string> Blocks()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return blocks_;
+  }
+
+  TapeStreamBuffer::WriteFunction Function()
+  {
+    return [this](int fd, const void* data, std::size_t count) {
+      return Write(fd, data, count);
+    };
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<std::string> blocks_;
+  std::size_t fail_at_{0};
+  int fail_errno_{0};
+  bool end_of_tape_{false};
+};
+
+static std::string Block(char c, std::size_t size = 100)
+{
+  return std::string(size, c);
+}
+
+static ssize_t Queue(TapeStreamBuffer& buffer, const std::string& block)
+{
+  return buffer.Write(1, block.data(), block.size());
+}
+
+static void WaitForBlocks(TapeStreamBuffer& buffer, uint64_t blocks)
+{
+  for (int i = 0; i < 1000; i++) {
+    if (buffer.GetStatistics().blocks_written >= blocks) { return; }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+}
+
+TEST(sd_tape_stream_buffer, waits_for_high_watermark)
+{
+  FakeDrive drive;
+  TapeStreamBuffer buffer(1000, 90, 10, drive.Function());
+
+  for (char c = 'a'; c < 'i'; c++) { EXPECT_EQ(Queue(buffer, Block(c)), 100); }
+  EXPECT_EQ(buffer.GetStatistics().blocks_written, 0u);
+
+  EXPECT_EQ(Queue(buffer, Block('i')), 100);
+  WaitForBlocks(buffer, 8);
+
+  auto stats = buffer.GetStatistics();
+  EXPECT_EQ(stats.blocks_written, 8u);
+  EXPECT_EQ(stats.buffered, 100u);
+  EXPECT_EQ(stats.peak_buffered, 900u);
+  EXPECT_EQ(stats.drive_starts, 1u);
+
+  EXPECT_TRUE(buffer.Flush());
+  EXPECT_EQ(buffer.GetStatistics().bytes_written, 900u);
+  EXPECT_EQ(drive.Blocks().back(), Block('i'));
+}
+
+TEST(sd_tape_stream_buffer, keeps_blocks_whole_and_in_order)
+{
+  FakeDrive drive;
+  TapeStreamBuffer buffer(1000, 50, 10, drive.Function());
+  std::vector<std::string> expected;
+
+  for (int i = 0; i < 50; i++) {
+    expected.push_back(Block('A' + i % 26, 300 + i));
+    EXPECT_EQ(Queue(buffer, expected.back()),
+              static_cast<ssize_t>(expected.back().size()));
+  }
+  EXPECT_TRUE(buffer.Flush());
+
+  EXPECT_EQ(drive.Blocks(), expected);
+  EXPECT_GT(buffer.GetStatistics().producer_stalls, 0u);
+}
+
+TEST(sd_tape_stream_buffer, writes_oversized_block_directly)
+{
+  FakeDrive drive;
+  TapeStreamBuffer buffer(1000, 90, 10, drive.Function());
+
+  EXPECT_EQ(Queue(buffer, Block('a')), 100);
+  EXPECT_EQ(Queue(buffer, Block('b', 2000)), 2000);
+  EXPECT_EQ(drive.Blocks(),
+            (std::vector<std::string>{Block('a'), Block('b', 2000)}));
+}
+
+TEST(sd_tape_stream_buffer, reports_early_warning_after_queued_blocks)
+{
+  FakeDrive drive;
+  TapeStreamBuffer buffer(1000, 90, 10, drive.Function());
+
+  drive.FailAt(1, ENOSPC);
+  for (char c = 'a'; c < 'e'; c++) { EXPECT_EQ(Queue(buffer, Block(c)), 100); }
+  EXPECT_TRUE(buffer.Flush());
+  EXPECT_EQ(drive.Blocks().size(), 4u);
+
+  errno = 0;
+  EXPECT_EQ(Queue(buffer, Block('e')), -1);
+  EXPECT_EQ(errno, ENOSPC);
+
+  // the volume can be finished after the early warning got reported
+  EXPECT_EQ(Queue(buffer, Block('e')), 100);
+  EXPECT_TRUE(buffer.Flush());
+  EXPECT_EQ(drive.Blocks().size(), 5u);
+}
+
+TEST(sd_tape_stream_buffer, refused_block_after_early_warning_is_an_error)
+{
+  FakeDrive drive;
+  TapeStreamBuffer buffer(1000, 90, 10, drive.Function());
+
+  drive.EndOfTapeAt(1);
+  for (char c = 'a'; c < 'e'; c++) { EXPECT_EQ(Queue(buffer, Block(c)), 100); }
+  errno = 0;
+  EXPECT_FALSE(buffer.Flush());
+  EXPECT_EQ(errno, EIO);
+
+  // not reported as end of medium, the queued blocks did not make it
+  errno = 0;
+  EXPECT_EQ(Queue(buffer, Block('e')), -1);
+  EXPECT_EQ(errno, EIO);
+  EXPECT_EQ(drive.Blocks(), (std::vector<std::string>{Block('a')}));
+}
+
+TEST(sd_tape_stream_buffer, write_error_is_sticky)
+{
+  FakeDrive drive;
+  TapeStreamBuffer buffer(1000, 90, 10, drive.Function());
+
+  drive.FailAt(1, EIO);
+  for (char c = 'a'; c < 'e'; c++) { EXPECT_EQ(Queue(buffer, Block(c)), 100); }
+  EXPECT_FALSE(buffer.Flush());
+  EXPECT_FALSE(buffer.Flush());
+
+  errno = 0;
+  EXPECT_EQ(Queue(buffer, Block('e')), -1);
+  EXPECT_EQ(errno, EIO);
+  EXPECT_EQ(drive.Blocks(), (std::vector<std::string>{Block('a')}));
+
+  drive.FailAt(0, 0);
+  buffer.Discard();
+  EXPECT_EQ(Queue(buffer, Block('f')), 100);
+  EXPECT_TRUE(buffer.Flush());
+  EXPECT_EQ(drive.Blocks().back(), Block('f'));
+}
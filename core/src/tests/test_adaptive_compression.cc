@@ -0,0 +1,159 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+#if defined(HAVE_MINGW)
+#  include "include/bareos.h"
+#  include "gtest/gtest.h"
+#else
+#  include "gtest/gtest.h"
+#  include "include/bareos.h"
+#endif
+
+#include "filed/adaptive_compression.h"
+#include "include/ch.h"
+#include "include/jcr.h"
+#include "include/streams.h"
+#include "lib/compression.h"
+#include "lib/serial.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using filedaemon::AdaptiveCompression;
+using namespace std::chrono_literals;
+
+static constexpr std::size_t kBlock = 64 * 1024;
+
+/* Sends a file of blocks blocks that compress to ratio of their size, like
+ * SaveFile() does: a file not compressed at all is sent without accounting
+ * its blocks. */
+static bool SendFile(AdaptiveCompression& adaptive,
+                     const char* fname,
+                     int blocks,
+                     double ratio)
+{
+  bool compressed_at_all = adaptive.StartFile(fname, blocks * kBlock);
+  for (int i = 0; compressed_at_all && i < blocks; i++) {
+    if (adaptive.CompressBlock()) {
+      adaptive.BlockCompressed(kBlock, kBlock * ratio, 1ms);
+    } else {
+      adaptive.BlockStored(kBlock);
+    }
+  }
+  adaptive.FinishFile();
+  return compressed_at_all;
+}
+
+TEST(adaptive_compression, extension)
+{
+  EXPECT_EQ(AdaptiveCompression::Extension("/tmp/photo.JPG"), "jpg");
+  EXPECT_EQ(AdaptiveCompression::Extension("/tmp/a.tar.gz"), "gz");
+  EXPECT_EQ(AdaptiveCompression::Extension("C:\\data\\movie.mkv"), "mkv");
+  EXPECT_EQ(AdaptiveCompression::Extension("/home/user/.bashrc"), "");
+  EXPECT_EQ(AdaptiveCompression::Extension("/etc/dir.d/fstab"), "");
+  EXPECT_EQ(AdaptiveCompression::Extension("/tmp/x.averyveryverylongone"), "");
+}
+
+TEST(adaptive_compression, incompressible_file_is_stored_after_sample)
+{
+  AdaptiveCompression adaptive;
+  adaptive.StartFile("/data/random.bin", 16 * kBlock);
+  std::size_t compressed = 0;
+  for (int i = 0; i < 16; i++) {
+    if (adaptive.CompressBlock()) {
+      adaptive.BlockCompressed(kBlock, kBlock + 16, 1ms);
+      compressed += kBlock;
+    } else {
+      adaptive.BlockStored(kBlock);
+    }
+  }
+  adaptive.FinishFile();
+
+  EXPECT_EQ(compressed, AdaptiveCompression::kSampleBytes);
+  EXPECT_EQ(adaptive.SkippedBytes(), 16 * kBlock - compressed);
+  // the stored blocks would have taken as long as the sampled ones
+  EXPECT_EQ(adaptive.CpuSaved(), 14ms);
+}
+
+TEST(adaptive_compression, compressible_file_is_compressed)
+{
+  AdaptiveCompression adaptive;
+  EXPECT_TRUE(SendFile(adaptive, "/data/log.txt", 16, 0.3));
+  EXPECT_EQ(adaptive.SkippedBytes(), 0u);
+  EXPECT_EQ(adaptive.CpuSaved(), 0ms);
+}
+
+TEST(adaptive_compression, learns_incompressible_extensions)
+{
+  AdaptiveCompression adaptive;
+  for (std::uint32_t i = 0; i < AdaptiveCompression::kLearnFiles; i++) {
+    EXPECT_TRUE(SendFile(adaptive, "/photos/img.jpg", 1, 0.99));
+  }
+  // small files never leave the sample phase, so nothing was skipped yet
+  EXPECT_EQ(adaptive.SkippedBytes(), 0u);
+
+  int sampled = 0;
+  for (std::uint32_t i = 0; i < 2 * AdaptiveCompression::kResampleInterval;
+       i++) {
+    if (SendFile(adaptive, "/photos/IMG.JPG", 1, 0.99)) { sampled++; }
+  }
+  EXPECT_EQ(sampled, 2);
+  EXPECT_EQ(adaptive.SkippedBytes(),
+            (2 * AdaptiveCompression::kResampleInterval - 2) * kBlock);
+  // priced like the sampled files of the extension
+  EXPECT_EQ(adaptive.CpuSaved(),
+            (2 * AdaptiveCompression::kResampleInterval - 2) * 1ms);
+
+  // other extensions are not affected
+  EXPECT_TRUE(SendFile(adaptive, "/photos/notes.txt", 1, 0.99));
+}
+
+TEST(adaptive_compression, compressible_files_of_an_extension_keep_it)
+{
+  AdaptiveCompression adaptive;
+  for (int i = 0; i < 20; i++) {
+    EXPECT_TRUE(SendFile(adaptive, "/docs/report.pdf", 1, i % 2 ? 0.99 : 0.5));
+  }
+}
+
+TEST(adaptive_compression, stored_block_decompresses_to_its_data)
+{
+  std::string data(1000, 'x');
+  for (std::size_t i = 0; i < data.size(); i++) { data[i] = i * 7; }
+
+  std::vector<char> block(sizeof(comp_stream_header) + data.size());
+  ser_declare;
+  SerBegin(block.data(), sizeof(comp_stream_header));
+  ser_uint32(COMPRESS_NONE);
+  ser_uint32(data.size());
+  ser_uint16(0);
+  ser_uint16(COMP_HEAD_VERSION);
+  SerEnd(block.data(), sizeof(comp_stream_header));
+  memcpy(block.data() + sizeof(comp_stream_header), data.data(), data.size());
+
+  auto jcr = std::make_shared<JobControlRecord>();
+  char* buf = block.data();
+  uint32_t len = block.size();
+  ASSERT_TRUE(DecompressData(jcr.get(), "test", STREAM_COMPRESSED_DATA, &buf,
+                             &len, false));
+  EXPECT_EQ(std::string(buf, len), data);
+  CleanupCompression(jcr.get());
+}
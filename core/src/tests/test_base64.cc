@@ -0,0 +1,265 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+#if defined(HAVE_MINGW)
+#  include "include/bareos.h"
+#  include "gtest/gtest.h"
+#else
+#  include "gtest/gtest.h"
+#  include "include/bareos.h"
+#endif
+
+#include "include/streams.h"
+#include "lib/attr.h"
+#include "lib/attribs.h"
+#include "lib/base64.h"
+
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+/* The base64 variant of Bareos is stored in catalogs and on volumes, so
+ * these tests compare the codec with the byte by byte implementation it
+ * had before it was optimized. */
+namespace reference {
+static const char digits[]
+    = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static int ToBase64(int64_t value, char* where)
+{
+  uint64_t val;
+  int i = 0;
+  int n;
+
+  if (value < 0) {
+    where[i++] = '-';
+    value = -value;
+  }
+  val = value;
+  do {
+    val >>= 6;
+    i++;
+  } while (val);
+  n = i;
+  val = value;
+  where[i] = 0;
+  do {
+    where[--i] = digits[val & (uint64_t)0x3F];
+    val >>= 6;
+  } while (val);
+  return n;
+}
+
+static int BinToBase64(char* buf,
+                       int buflen,
+                       const char* bin,
+                       int binlen,
+                       bool compatible)
+{
+  uint32_t reg, save, mask;
+  int rem, i;
+  int j = 0;
+
+  reg = 0;
+  rem = 0;
+  buflen--;
+  for (i = 0; i < binlen;) {
+    if (rem < 6) {
+      reg <<= 8;
+      if (compatible) {
+        reg |= (uint8_t)bin[i++];
+      } else {
+        reg |= (int8_t)bin[i++];
+      }
+      rem += 8;
+    }
+    save = reg;
+    reg >>= (rem - 6);
+    if (j < buflen) { buf[j++] = digits[reg & 0x3F]; }
+    reg = save;
+    rem -= 6;
+  }
+  if (rem && j < buflen) {
+    mask = (1 << rem) - 1;
+    if (compatible) {
+      buf[j++] = digits[(reg & mask) << (6 - rem)];
+    } else {
+      buf[j++] = digits[reg & mask];
+    }
+  }
+  buf[j] = 0;
+  return j;
+}
+}  // namespace reference
+
+static std::vector<int64_t> InterestingValues()
+{
+  std::vector<int64_t> values{0,
+                              1,
+                              -1,
+                              63,
+                              64,
+                              -64,
+                              4095,
+                              4096,
+                              std::numeric_limits<int32_t>::max(),
+                              std::numeric_limits<int32_t>::min(),
+                              std::numeric_limits<int64_t>::max(),
+                              std::numeric_limits<int64_t>::min()};
+  std::mt19937_64 gen(42);
+  for (int i = 0; i < 1000; i++) {
+    int64_t value = static_cast<int64_t>(gen());
+    values.push_back(value >> (i % 64));
+  }
+  return values;
+}
+
+TEST(base64, to_base64_matches_reference)
+{
+  for (int64_t value : InterestingValues()) {
+    char expected[32], actual[32];
+    int expected_len = reference::ToBase64(value, expected);
+    int actual_len = ToBase64(value, actual);
+    EXPECT_EQ(actual_len, expected_len) << value;
+    EXPECT_STREQ(actual, expected) << value;
+  }
+}
+
+TEST(base64, from_base64_reverts_to_base64)
+{
+  for (int64_t value : InterestingValues()) {
+    char buf[32];
+    int len = ToBase64(value, buf);
+    int64_t decoded = 0;
+    EXPECT_EQ(FromBase64(&decoded, buf), len);
+    EXPECT_EQ(decoded, value) << buf;
+  }
+
+  int64_t decoded = 0;
+  char field[] = "BAA rest";
+  EXPECT_EQ(FromBase64(&decoded, field), 3);
+  EXPECT_EQ(decoded, 4096);
+}
+
+TEST(base64, bin_to_base64_matches_reference)
+{
+  std::mt19937 gen(7);
+  for (int binlen = 0; binlen < 80; binlen++) {
+    std::vector<char> bin(binlen);
+    for (auto& c : bin) { c = static_cast<char>(gen()); }
+    for (bool compatible : {false, true}) {
+      for (int buflen : {1, 5, 13, BASE64_SIZE(binlen), 200}) {
+        char expected[256], actual[256];
+        int expected_len = reference::BinToBase64(
+            expected, buflen, bin.data(), binlen, compatible);
+        int actual_len
+            = BinToBase64(actual, buflen, bin.data(), binlen, compatible);
+        EXPECT_EQ(actual_len, expected_len)
+            << binlen << " " << compatible << " " << buflen;
+        EXPECT_STREQ(actual, expected)
+            << binlen << " " << compatible << " " << buflen;
+      }
+    }
+  }
+}
+
+TEST(base64, base64_to_bin_reverts_compatible_encoding)
+{
+  std::mt19937 gen(11);
+  for (int binlen = 1; binlen < 80; binlen++) {
+    std::vector<char> bin(binlen);
+    for (auto& c : bin) { c = static_cast<char>(gen()); }
+    char encoded[256], decoded[256];
+    int len = BinToBase64(encoded, sizeof(encoded), bin.data(), binlen, true);
+    EXPECT_EQ(len, Base64LengthUnpadded(binlen));
+    EXPECT_EQ(Base64ToBin(decoded, sizeof(decoded), encoded, len), binlen);
+    EXPECT_EQ(std::string(decoded, binlen), std::string(bin.data(), binlen));
+  }
+}
+
+TEST(attribs, decode_stat_reverts_encode_stat)
+{
+  struct stat statp {};
+  statp.st_dev = 2051;
+  statp.st_ino = 3686712;
+  statp.st_mode = 0100644;
+  statp.st_nlink = 2;
+  statp.st_uid = 1000;
+  statp.st_gid = 100;
+  statp.st_size = 123456789012;
+  statp.st_atime = 1435243526;
+  statp.st_mtime = 1435243527;
+  statp.st_ctime = 1435243528;
+
+  char buf[512];
+  EncodeStat(buf, &statp, sizeof(statp), 17, 3);
+
+  struct stat decoded;
+  int32_t LinkFI = 0;
+  EXPECT_EQ(DecodeStat(buf, &decoded, sizeof(decoded), &LinkFI), 3);
+  EXPECT_EQ(LinkFI, 17);
+  EXPECT_EQ(decoded.st_dev, statp.st_dev);
+  EXPECT_EQ(decoded.st_ino, statp.st_ino);
+  EXPECT_EQ(decoded.st_mode, statp.st_mode);
+  EXPECT_EQ(decoded.st_nlink, statp.st_nlink);
+  EXPECT_EQ(decoded.st_uid, statp.st_uid);
+  EXPECT_EQ(decoded.st_gid, statp.st_gid);
+  EXPECT_EQ(decoded.st_size, statp.st_size);
+  EXPECT_EQ(decoded.st_atime, statp.st_atime);
+  EXPECT_EQ(decoded.st_mtime, statp.st_mtime);
+  EXPECT_EQ(decoded.st_ctime, statp.st_ctime);
+}
+
+TEST(attribs, decode_stat_without_optional_fields)
+{
+  // LStat as written by old clients, without LinkFI, flags and data stream
+  char lstat[] = "gD OEE4 IHo B GHH GHH A G9S BAA 4 BVjBQG BVjBQG BVjBQG";
+  struct stat statp;
+  int32_t LinkFI = -1;
+
+  EXPECT_EQ(DecodeStat(lstat, &statp, sizeof(statp), &LinkFI), 0);
+  EXPECT_EQ(LinkFI, 0);
+  EXPECT_EQ(statp.st_dev, 2051);
+  EXPECT_EQ(statp.st_ino, 3686712);
+  EXPECT_EQ(statp.st_mode, 33256);
+  EXPECT_EQ(statp.st_size, 28498);
+  EXPECT_EQ(statp.st_mtime, 1435243526);
+}
+
+TEST(attr, unpack_attributes_record)
+{
+  char rec[] = "12 3 /etc/passwd\0gD OEE4 IHo B GHH GHH A G9S BAA 4 BVjBQG "
+               "BVjBQG BVjBQG A A C\0\0\0" "5";
+  Attributes* attr = new_attr(nullptr);
+
+  EXPECT_EQ(UnpackAttributesRecord(nullptr, STREAM_UNIX_ATTRIBUTES, rec,
+                                   sizeof(rec), attr),
+            1);
+  EXPECT_EQ(attr->file_index, 12);
+  EXPECT_EQ(attr->type, 3);
+  EXPECT_STREQ(attr->fname, "/etc/passwd");
+  EXPECT_STREQ(attr->attr,
+               "gD OEE4 IHo B GHH GHH A G9S BAA 4 BVjBQG BVjBQG BVjBQG A A C");
+  EXPECT_STREQ(attr->lname, "");
+  EXPECT_EQ(attr->delta_seq, 5);
+
+  FreeAttr(attr);
+}
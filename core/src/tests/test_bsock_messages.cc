@@ -0,0 +1,138 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+#if defined(HAVE_MINGW)
+#  include "include/bareos.h"
+#  include "gtest/gtest.h"
+#else
+#  include "gtest/gtest.h"
+#  include "include/bareos.h"
+#endif
+
+#include "lib/bget_msg.h"
+#include "lib/bnet.h"
+#include "lib/bsock_tcp.h"
+
+#include <sys/socket.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+class bsock_messages : public ::testing::Test {
+ protected:
+  void SetUp() override
+  {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    sender = Wrap(fds[0], "sender");
+    receiver = Wrap(fds[1], "receiver");
+  }
+
+  void TearDown() override
+  {
+    for (BareosSocket* bs : {sender, receiver}) {
+      if (bs) {
+        bs->close();
+        delete bs;
+      }
+    }
+  }
+
+  static BareosSocket* Wrap(int sockfd, const char* who)
+  {
+    BareosSocket* bs = new BareosSocketTCP;
+    bs->fd_ = sockfd;
+    bs->SetWho(strdup(who));
+    bs->SetHost(strdup("localhost"));
+    bs->SetPort(0);
+    return bs;
+  }
+
+  std::string Receive()
+  {
+    int32_t n = receiver->recv();
+    if (n < 0) { return "signal"; }
+    return std::string(receiver->msg, n);
+  }
+
+  BareosSocket* sender{};
+  BareosSocket* receiver{};
+};
+
+TEST_F(bsock_messages, messages_arrive_separately)
+{
+  std::string data(70000, 'x');
+  for (std::size_t i = 0; i < data.size(); i++) { data[i] = i % 251; }
+
+  std::thread send([&] {
+    EXPECT_TRUE(sender->SendMessages({"rechdr 1 2 3 4 70000", data}));
+    EXPECT_TRUE(sender->SendMessages({"", "last"}));
+  });
+  EXPECT_EQ(Receive(), "rechdr 1 2 3 4 70000");
+  EXPECT_EQ(Receive(), data);
+  EXPECT_EQ(Receive(), "");
+  EXPECT_EQ(Receive(), "last");
+  send.join();
+  EXPECT_EQ(sender->out_msg_no, 4u);
+}
+
+TEST_F(bsock_messages, long_messages_are_split_into_packets)
+{
+  // a Bareos packet carries at most 1000000 bytes including its header
+  std::string data(1000000, 'y');
+
+  std::thread send([&] { EXPECT_TRUE(sender->SendMessages({"hdr", data})); });
+  EXPECT_EQ(Receive(), "hdr");
+  std::string received = Receive();
+  received += Receive();
+  EXPECT_EQ(received, data);
+  send.join();
+}
+
+TEST_F(bsock_messages, data_is_received_into_given_buffer)
+{
+  std::vector<char> buffer(100, 0);
+  int32_t asked = 0;
+  auto buffer_for = [&](int32_t size) {
+    asked = size;
+    return size <= 100 ? buffer.data() : nullptr;
+  };
+
+  std::string big(200, 'b');
+  std::thread send([&] {
+    EXPECT_TRUE(sender->SendMessages({"small", big}));
+    sender->signal(BNET_EOD);
+  });
+
+  EXPECT_EQ(receiver->RecvInto(buffer_for), 5);
+  EXPECT_EQ(std::string(buffer.data(), 5), "small");
+  EXPECT_EQ(receiver->msg[0], 0);
+
+  // buffer too small, so the data goes to msg as usual
+  EXPECT_EQ(BgetMsg(receiver, buffer_for), 200);
+  EXPECT_EQ(asked, 200);
+  EXPECT_EQ(std::string(receiver->msg), big);
+
+  asked = 0;
+  EXPECT_EQ(BgetMsg(receiver, buffer_for), BNET_SIGNAL);
+  EXPECT_EQ(receiver->message_length, BNET_EOD);
+  EXPECT_EQ(asked, 0);
+  send.join();
+}
@@ -0,0 +1,278 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+#if defined(HAVE_MINGW)
+#  include "include/bareos.h"
+#  include "gtest/gtest.h"
+#else
+#  include "gtest/gtest.h"
+#  include "include/bareos.h"
+#endif
+
+#include "lib/regex_set.h"
+
+#include <chrono>
+#include <clocale>
+#include <random>
+#include <string>
+#include <vector>
+
+/* A RegexSet has to match exactly like regexec() does, so all tests
+ * compare it with regexec() on the same patterns. */
+static bool Regexec(const std::string& pattern,
+                    int cflags,
+                    const std::string& subject)
+{
+  regex_t preg;
+  if (regcomp(&preg, pattern.c_str(), cflags) != 0) { return false; }
+  bool match = regexec(&preg, subject.c_str(), 0, nullptr, 0) == 0;
+  regfree(&preg);
+  return match;
+}
+
+static const std::vector<std::string> patterns{
+    "a",
+    "^a",
+    "a$",
+    "^$",
+    "^a*$",
+    "ab|ba",
+    "(ab)+",
+    "a(b|)c",
+    "()",
+    "(|a)b",
+    "a{2}",
+    "a{1,3}b",
+    "^a{2,}$",
+    "a{,2}b",
+    "(a|b)*abb",
+    "a.b",
+    "^.$",
+    "[ab]c",
+    "[^ab]",
+    "^[^/]*$",
+    "[]a]",
+    "[^]a]",
+    "[a-]",
+    "[-a]",
+    "[a-c]x",
+    "[[:digit:]]+",
+    "[[:alpha:][:digit:]]",
+    "[^[:space:]]",
+    "\\.",
+    "\\\\",
+    "\\(a\\)",
+    "\\w+",
+    "\\W",
+    "\\s",
+    "\\S$",
+    "a)",
+    "x**",
+    "(a*)*b",
+    "(a|aa)*c",
+    "^(a+)+$",
+    "a$b",
+    "(^a|b$)",
+    "\\.(mp3|avi|mkv)$",
+    "^/home/[^/]+/\\.cache/",
+    "/\\.snapshot(/|$)",
+    "\\.(tmp|bak|swp)$",
+    "~$",
+    "(a)\\1",
+    "\\ba",
+    "[[=a=]]",
+};
+
+static const std::vector<std::string> subjects{
+    "",
+    "a",
+    "b",
+    "ab",
+    "ba",
+    "abc",
+    "ac",
+    "abb",
+    "aab",
+    "aaab",
+    "aaaaaaaaab",
+    "aac",
+    "A",
+    "AB",
+    "x",
+    "]",
+    "-",
+    "a)",
+    "(a)",
+    "a.b",
+    "a\\b",
+    "123",
+    "a b",
+    "a\tb",
+    "x**",
+    "/home/user/.cache/thumbnails",
+    "/home/.cache/x",
+    "/srv/music/song.mp3",
+    "/srv/music/song.mp3.txt",
+    "/data/.snapshot",
+    "/data/.snapshot/hourly.0",
+    "/data/.snapshots",
+    "/tmp/file.swp",
+    "/etc/fstab~",
+};
+
+TEST(regex_set, single_patterns_match_like_regexec)
+{
+  for (int cflags : {REG_EXTENDED, REG_EXTENDED | REG_ICASE}) {
+    for (const auto& pattern : patterns) {
+      RegexSet set;
+      std::string errmsg;
+      ASSERT_TRUE(set.Add(pattern.c_str(), cflags, errmsg))
+          << pattern << ": " << errmsg;
+      for (const auto& subject : subjects) {
+        EXPECT_EQ(set.Search(subject.c_str()),
+                  Regexec(pattern, cflags, subject))
+            << "pattern " << pattern << " subject " << subject << " cflags "
+            << cflags;
+      }
+    }
+  }
+}
+
+TEST(regex_set, sets_match_if_any_pattern_matches)
+{
+  std::mt19937 gen(5);
+  for (int round = 0; round < 200; round++) {
+    RegexSet set;
+    std::vector<std::string> chosen;
+    std::string errmsg;
+    for (int i = 0; i < 1 + round % 7; i++) {
+      chosen.push_back(patterns[gen() % patterns.size()]);
+      ASSERT_TRUE(set.Add(chosen.back().c_str(), REG_EXTENDED, errmsg));
+    }
+    EXPECT_EQ(set.size(), chosen.size());
+    for (const auto& subject : subjects) {
+      bool expected = false;
+      for (const auto& pattern : chosen) {
+        expected |= Regexec(pattern, REG_EXTENDED, subject);
+      }
+      EXPECT_EQ(set.Search(subject.c_str()), expected) << subject;
+    }
+  }
+}
+
+static std::string RandomPattern(std::mt19937& gen, int depth)
+{
+  static const char* atoms[]
+      = {"a", "b", ".", "[ab]", "[^a]", "^", "$", "\\.", "/", "[a-b/]"};
+  static const char* quantifiers[] = {"", "", "*", "+", "?", "{2}", "{1,2}"};
+  std::string pattern;
+  int length = 1 + gen() % 4;
+  for (int i = 0; i < length; i++) {
+    if (depth < 3 && gen() % 4 == 0) {
+      pattern += "(" + RandomPattern(gen, depth + 1) + ")";
+    } else {
+      pattern += atoms[gen() % (sizeof(atoms) / sizeof(char*))];
+      if (pattern.back() == '^' || pattern.back() == '$') { continue; }
+    }
+    pattern += quantifiers[gen() % (sizeof(quantifiers) / sizeof(char*))];
+  }
+  if (gen() % 5 == 0) { pattern += "|" + RandomPattern(gen, depth + 1); }
+  return pattern;
+}
+
+TEST(regex_set, random_patterns_match_like_regexec)
+{
+  std::mt19937 gen(9);
+  const char alphabet[] = "ab/.A";
+  for (int round = 0; round < 2000; round++) {
+    std::string pattern = RandomPattern(gen, 0);
+    int cflags = REG_EXTENDED | (round % 3 == 0 ? REG_ICASE : 0);
+    RegexSet set;
+    std::string errmsg;
+    if (!set.Add(pattern.c_str(), cflags, errmsg)) { continue; }
+    for (int i = 0; i < 30; i++) {
+      std::string subject;
+      for (int j = gen() % 10; j > 0; j--) {
+        subject += alphabet[gen() % (sizeof(alphabet) - 1)];
+      }
+      EXPECT_EQ(set.Search(subject.c_str()), Regexec(pattern, cflags, subject))
+          << "pattern " << pattern << " subject " << subject;
+    }
+  }
+}
+
+TEST(regex_set, invalid_pattern_is_rejected)
+{
+  RegexSet set;
+  std::string errmsg;
+  EXPECT_FALSE(set.Add("a(b", REG_EXTENDED, errmsg));
+  EXPECT_FALSE(errmsg.empty());
+  EXPECT_TRUE(set.empty());
+  EXPECT_FALSE(set.Search("a(b"));
+}
+
+TEST(regex_set, utf8_characters_match_like_regexec)
+{
+  const char* saved = setlocale(LC_CTYPE, nullptr);
+  std::string previous = saved ? saved : "C";
+  if (!setlocale(LC_CTYPE, "C.UTF-8") && !setlocale(LC_CTYPE, "en_US.UTF-8")) {
+    GTEST_SKIP() << "no UTF-8 locale available";
+  }
+
+  const std::vector<std::string> utf8_patterns{
+      "^.$", "^a.b$", "^[^a]$", "^.{3}$", "x[^/]*y", "s", "^I$"};
+  // valid sequences of two, three and four bytes and invalid ones
+  const std::vector<std::string> utf8_subjects{
+      "\xc3\xa4",     "a\xc3\xa4" "b", "\xe2\x82\xac", "\xf0\x9f\x98\x80",
+      "\xc3",         "\xff",        "a\xc3" "b",     "\xed\xa0\x80",
+      "x\xc3\xa4/y",  "x\xc3\xa4y",   "\xc5\xbf",     "\xc4\xb1",
+      "\xc3\xa4\xc3\xb6\xc3\xbc"};
+
+  for (int cflags : {REG_EXTENDED, REG_EXTENDED | REG_ICASE}) {
+    for (const auto& pattern : utf8_patterns) {
+      RegexSet set;
+      std::string errmsg;
+      ASSERT_TRUE(set.Add(pattern.c_str(), cflags, errmsg));
+      for (const auto& subject : utf8_subjects) {
+        EXPECT_EQ(set.Search(subject.c_str()),
+                  Regexec(pattern, cflags, subject))
+            << "pattern " << pattern << " subject " << subject;
+      }
+    }
+  }
+  setlocale(LC_CTYPE, previous.c_str());
+}
+
+// Patterns that make backtracking matchers take exponential time
+TEST(regex_set, pathological_patterns_take_linear_time)
+{
+  RegexSet set;
+  std::string errmsg;
+  for (const char* pattern : {"^(a+)+$", "^(a|aa)*c$", "^(a*)*b$",
+                              "^(a|a?)+$", "(.*a){12}x"}) {
+    ASSERT_TRUE(set.Add(pattern, REG_EXTENDED, errmsg)) << pattern;
+  }
+
+  std::string subject(10000, 'a');
+  subject += '!';
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_FALSE(set.Search(subject.c_str()));
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(2));
+}
@@ -0,0 +1,140 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+#include "gtest/gtest.h"
+#include "include/bareos.h"
+#include "include/fcntl_def.h"
+#include "findlib/find.h"
+#include "lib/util.h"
+
+#include <string>
+#include <vector>
+
+static constexpr std::size_t block_size = 64 * 1024;
+
+static const std::string test_file{TEST_TEMP_DIR "/sparse_file_test"};
+
+/* Writes a file of file_size bytes that only has data at the given
+ * offsets, everything else is left as a hole. */
+static void MakeSparseFile(boffset_t file_size,
+                           const std::vector<boffset_t>& data_offsets)
+{
+  int fd = open(test_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(ftruncate(fd, file_size), 0);
+  for (boffset_t offset : data_offsets) {
+    ASSERT_EQ(pwrite(fd, "data", 4, offset), 4);
+  }
+  close(fd);
+}
+
+struct Block {
+  boffset_t addr;
+  ssize_t size;
+  bool operator==(const Block& other) const
+  {
+    return addr == other.addr && size == other.size;
+  }
+};
+
+/* Reads the file like the backup does with the sparse option and returns
+ * the blocks that are sent, and the number of blocks read. */
+static std::vector<Block> SentBlocks(bool skip_holes, int& blocks_read)
+{
+  BareosFilePacket bfd;
+  binit(&bfd);
+  EXPECT_GE(bopen(&bfd, test_file.c_str(), O_RDONLY | O_BINARY, 0, 0), 0);
+
+  struct stat statp;
+  stat(test_file.c_str(), &statp);
+  SparseBlockSkipper skipper(&bfd, skip_holes ? statp.st_size : 0,
+                             block_size);
+
+  std::vector<Block> sent;
+  std::vector<char> buf(block_size);
+  boffset_t addr = 0;
+  blocks_read = 0;
+  for (;;) {
+    addr = skipper.Skip(addr);
+    EXPECT_GE(addr, 0);
+    ssize_t n = bread(&bfd, buf.data(), buf.size());
+    if (n <= 0) { break; }
+    blocks_read++;
+    if (!(n == (ssize_t)block_size && addr + n < statp.st_size
+          && IsBufZero(buf.data(), n))) {
+      sent.push_back({addr, n});
+    }
+    addr += n;
+  }
+  bclose(&bfd);
+  return sent;
+}
+
+static void ExpectSameBlocksSent(boffset_t file_size,
+                                 const std::vector<boffset_t>& data_offsets)
+{
+  MakeSparseFile(file_size, data_offsets);
+  int read_all, read_skipping;
+  auto expected = SentBlocks(false, read_all);
+  auto sent = SentBlocks(true, read_skipping);
+  EXPECT_EQ(sent, expected);
+  EXPECT_LE(read_skipping, read_all);
+  unlink(test_file.c_str());
+}
+
+TEST(sparse_file, same_blocks_are_sent_when_skipping_holes)
+{
+  const boffset_t mb = 1024 * 1024;
+  ExpectSameBlocksSent(0, {});
+  ExpectSameBlocksSent(100, {});
+  ExpectSameBlocksSent(block_size, {});
+  ExpectSameBlocksSent(16 * mb, {});
+  ExpectSameBlocksSent(16 * mb, {0});
+  ExpectSameBlocksSent(16 * mb, {16 * mb - 4});
+  ExpectSameBlocksSent(16 * mb + 100, {});
+  ExpectSameBlocksSent(16 * mb + 100, {3 * mb + 17, 8 * mb, 12 * mb - 2});
+  ExpectSameBlocksSent(3 * block_size, {block_size - 2});
+  ExpectSameBlocksSent(64 * mb, {mb, 2 * mb, 40 * mb, 63 * mb + 5});
+}
+
+TEST(sparse_file, holes_are_not_read)
+{
+  const boffset_t mb = 1024 * 1024;
+  MakeSparseFile(64 * mb, {32 * mb});
+
+  BareosFilePacket bfd;
+  binit(&bfd);
+  ASSERT_GE(bopen(&bfd, test_file.c_str(), O_RDONLY | O_BINARY, 0, 0), 0);
+  boffset_t data_start, data_end;
+  bool has_holes = BfindData(&bfd, 0, &data_start, &data_end)
+                   && data_start > 0;
+  bclose(&bfd);
+  if (!has_holes) {
+    unlink(test_file.c_str());
+    GTEST_SKIP() << "filesystem does not report holes";
+  }
+
+  int blocks_read;
+  auto sent = SentBlocks(true, blocks_read);
+  // the block with data and the last one
+  EXPECT_EQ(sent.size(), 2u);
+  EXPECT_LE(blocks_read, 4);
+  unlink(test_file.c_str());
+}
@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+#   BAREOS - Backup Archiving REcovery Open Sourced
+#
+#   Copyright (C) 2024-2024 Bareos GmbH & Co. KG
+#
+#   This program is Free Software; you can redistribute it and/or
+#   modify it under the terms of version three of the GNU Affero General Public
+#   License as published by the Free Software Foundation and included
+#   in the file LICENSE.
+#
+#   This program is distributed in the hope that it will be useful, but
+#   WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+#   Affero General Public License for more details.
+#
+#   You should have received a copy of the GNU Affero General Public License
+#   along with this program; if not, write to the Free Software
+#   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+#   02110-1301, USA.
+
+# Forwards S3 requests to minio, but fails the upload of every part of a
+# multipart upload except the first one. The client has to abort these
+# uploads, which the test checks by listing the unfinished uploads on minio.
+
+import http.client
+import ssl
+from argparse import ArgumentParser
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlparse
+
+FAILED_PART = b"""<?xml version="1.0" encoding="UTF-8"?>
+<Error><Code>InternalError</Code><Message>part upload failed by proxy</Message></Error>
+"""
+
+
+class FailingProxy(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def fails(self):
+        query = parse_qs(urlparse(self.path).query)
+        return (
+            self.command == "PUT"
+            and "uploadId" in query
+            and query.get("partNumber", ["1"]) != ["1"]
+        )
+
+    def reply(self, status, reason, headers, body):
+        self.send_response(status, reason)
+        for name, value in headers:
+            if name.lower() not in ("connection", "content-length", "transfer-encoding"):
+                self.send_header(name, value)
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        if self.command != "HEAD":
+            self.wfile.write(body)
+
+    def forward(self):
+        length = int(self.headers.get("Content-Length", 0))
+        body = self.rfile.read(length) if length else None
+
+        if self.fails():
+            self.reply(500, "Internal Server Error", [], FAILED_PART)
+            return
+
+        # The Host header is part of the signature, so it is passed on as is.
+        headers = {
+            name: value
+            for name, value in self.headers.items()
+            if name.lower() not in ("connection", "expect")
+        }
+        if self.server.use_https:
+            minio = http.client.HTTPSConnection(
+                "localhost",
+                self.server.minio_port,
+                context=ssl._create_unverified_context(),
+            )
+        else:
+            minio = http.client.HTTPConnection("localhost", self.server.minio_port)
+        minio.request(self.command, self.path, body, headers)
+        response = minio.getresponse()
+        self.reply(
+            response.status, response.reason, response.getheaders(), response.read()
+        )
+        minio.close()
+
+    do_DELETE = forward
+    do_GET = forward
+    do_HEAD = forward
+    do_POST = forward
+    do_PUT = forward
+
+
+def main():
+    parser = ArgumentParser(description="S3 proxy failing multipart uploads")
+    parser.add_argument("--port", type=int, required=True)
+    parser.add_argument("--minio-port", type=int, required=True)
+    parser.add_argument("--certs-dir", help="serve https with minio's certificate")
+    args = parser.parse_args()
+
+    server = ThreadingHTTPServer(("localhost", args.port), FailingProxy)
+    server.minio_port = args.minio_port
+    server.use_https = args.certs_dir is not None
+    if server.use_https:
+        context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        context.load_cert_chain(
+            args.certs_dir + "/public.crt", args.certs_dir + "/private.key"
+        )
+        server.socket = context.wrap_socket(server.socket, server_side=True)
+    server.serve_forever()
+
+
+if __name__ == "__main__":
+    main()